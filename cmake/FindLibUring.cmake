@@ -0,0 +1,22 @@
+find_path(LIBURING_INCLUDE_DIR
+  NAMES liburing.h
+)
+
+if(BUILD_STATIC)
+    set(LIBURING_LIB_NAME liburing.a)
+else()
+    set(LIBURING_LIB_NAME uring)
+endif()
+find_library(LIBURING_LIBRARY
+    NAMES ${LIBURING_LIB_NAME}
+)
+
+set(LIBURING_INCLUDE_DIRS "${LIBURING_INCLUDE_DIR}")
+set(LIBURING_LIBRARIES "${LIBURING_LIBRARY}")
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(LibUring REQUIRED_VARS
+    LIBURING_LIBRARIES LIBURING_INCLUDE_DIRS)
+
+mark_as_advanced(LIBURING_LIBRARY LIBURING_LIBRARIES
+    LIBURING_INCLUDE_DIR LIBURING_INCLUDE_DIRS)
@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "salad/bloom.h"
+
+/*
+ * Bloom filter lookup benchmark.
+ *
+ * Emulates a vinyl point lookup that has to check bloom
+ * filters of many runs before reading a page: every lookup
+ * probes all filters with a key that is not stored in any
+ * of them, so each probe is a cache miss once the filters
+ * don't fit in the CPU cache.
+ *
+ * The split filter is benchmarked with the portable lookup
+ * and, if the CPU supports it, with the SIMD lookup chosen by
+ * bloom_init() (marked with an asterisk).
+ *
+ * Correctness of both filter types is checked by
+ * test/unit/bloom.cc.
+ */
+
+/* Number of bloom filters (runs) checked by a lookup. */
+enum { FILTER_COUNT = 64 };
+
+/* Number of values stored in each filter. */
+static const uint32_t value_count = 100000;
+
+/* Number of lookups in a run. */
+static const uint32_t lookup_count = 200000;
+
+/* False positive rate of each filter. */
+static const double fpr = 0.05;
+
+static uint32_t
+h(uint32_t i)
+{
+	return i * 2654435761U;
+}
+
+static double
+clock_monotonic(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+bench_run(enum bloom_type type, const char *name)
+{
+	static struct bloom filters[FILTER_COUNT];
+
+	for (uint32_t i = 0; i < FILTER_COUNT; i++) {
+		int rc = type == BLOOM_SPLIT ?
+			 bloom_create_split(&filters[i], value_count, fpr) :
+			 bloom_create(&filters[i], value_count, fpr);
+		if (rc != 0) {
+			fprintf(stderr, "%s: out of memory\n", name);
+			exit(EXIT_FAILURE);
+		}
+		/* Filters store disjoint sets of even numbers. */
+		for (uint32_t j = 0; j < value_count; j++)
+			bloom_add(&filters[i], h((i * value_count + j) * 2));
+	}
+
+	/* Look up odd numbers, which are stored nowhere. */
+	uint64_t false_positive = 0;
+	double start = clock_monotonic();
+	for (uint32_t i = 0; i < lookup_count; i++) {
+		uint32_t hash = h(i * 2 + 1);
+		for (uint32_t j = 0; j < FILTER_COUNT; j++) {
+			if (bloom_maybe_has(&filters[j], hash))
+				false_positive++;
+		}
+	}
+	double elapsed = clock_monotonic() - start;
+	double probe_count = (double)lookup_count * FILTER_COUNT;
+
+	printf("%-8s %8.1f %9.2f %7.4f %13zu\n", name,
+	       elapsed * 1e9 / probe_count, elapsed * 1e6 / lookup_count,
+	       false_positive / probe_count, bloom_store_size(&filters[0]));
+
+	for (uint32_t i = 0; i < FILTER_COUNT; i++)
+		bloom_destroy(&filters[i]);
+}
+
+int
+main(void)
+{
+	printf("%d filters of %u values, target fpr %.2f\n",
+	       FILTER_COUNT, value_count, fpr);
+	printf("%-8s %8s %9s %7s %13s\n", "filter", "ns/probe",
+	       "us/lookup", "fpr", "bytes/filter");
+	bench_run(BLOOM_CLASSIC, "classic");
+	bench_run(BLOOM_SPLIT, "split");
+	/* Split filter lookup implementation chosen for the CPU. */
+	bloom_split_maybe_has_f generic = bloom_split_maybe_has;
+	bloom_init();
+	if (bloom_split_maybe_has != generic)
+		bench_run(BLOOM_SPLIT, "split*");
+	return 0;
+}
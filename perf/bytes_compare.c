@@ -0,0 +1,181 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "bit/bit.h"
+
+/*
+ * String key comparison benchmark: bytes_compare() versus
+ * memcmp() followed by a length comparison, which is what
+ * string and varbinary comparators in tuple_compare.cc did
+ * before they were switched to bytes_compare().
+ *
+ * Emulates tree lookups by string keys: every lookup is a binary
+ * search in a sorted array of keys. Keys are zero-padded numbers,
+ * like "user:00001234", so most comparisons have to go past a long
+ * common prefix, which is when tuple hints don't help and the key
+ * comparison itself matters.
+ *
+ * Correctness of bytes_compare() is checked by test/unit/bit.c.
+ */
+
+/*
+ * Number of keys in the array. The array fits in the CPU cache,
+ * so that the figures show the cost of comparisons rather than
+ * that of cache misses.
+ */
+static const uint32_t key_count = 1 << 16;
+
+/* Number of lookups in a run. */
+static const uint32_t lookup_count = 2000000;
+
+/* Number of runs for each comparison function. */
+static const int repeat_count = 5;
+
+/* Key lengths to run the benchmark for. */
+static const uint32_t key_sizes[] = { 8, 12, 16, 24, 32, 48 };
+
+enum { KEY_SIZE_MAX = 48 };
+
+struct key {
+	uint32_t size;
+	char data[KEY_SIZE_MAX];
+};
+
+static uint32_t
+h(uint32_t i)
+{
+	return i * 2654435761U;
+}
+
+static double
+clock_monotonic(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+key_create(struct key *key, uint32_t size, uint32_t i)
+{
+	char buf[KEY_SIZE_MAX + 1];
+	snprintf(buf, sizeof(buf), "%0*u", (int)size, i);
+	key->size = size;
+	memcpy(key->data, buf, size);
+}
+
+static inline int
+memcmp_compare(const char *a, uint32_t size_a,
+	       const char *b, uint32_t size_b)
+{
+	int r = memcmp(a, b, MIN(size_a, size_b));
+	if (r != 0)
+		return r;
+	return COMPARE_RESULT(size_a, size_b);
+}
+
+/*
+ * @use_words is a constant at each call site, so the compiler
+ * generates a separate loop for each comparison function.
+ */
+static inline __attribute__((always_inline)) uint64_t
+lookup_all(const struct key *keys, const struct key *lookups,
+	   bool use_words)
+{
+	uint64_t found = 0;
+	for (uint32_t i = 0; i < lookup_count; i++) {
+		const struct key *key = &lookups[i];
+		uint32_t begin = 0, end = key_count;
+		while (begin < end) {
+			uint32_t mid = begin + (end - begin) / 2;
+			const struct key *k = &keys[mid];
+			int r = use_words ?
+				bytes_compare(k->data, k->size,
+					      key->data, key->size) :
+				memcmp_compare(k->data, k->size,
+					       key->data, key->size);
+			if (r == 0) {
+				found++;
+				break;
+			}
+			if (r < 0)
+				begin = mid + 1;
+			else
+				end = mid;
+		}
+	}
+	return found;
+}
+
+static __attribute__((noinline)) uint64_t
+lookup_all_memcmp(const struct key *keys, const struct key *lookups)
+{
+	return lookup_all(keys, lookups, false);
+}
+
+static __attribute__((noinline)) uint64_t
+lookup_all_words(const struct key *keys, const struct key *lookups)
+{
+	return lookup_all(keys, lookups, true);
+}
+
+static void
+bench_run(uint32_t key_size, struct key *keys, struct key *lookups)
+{
+	/* Every other key is stored so that half of lookups miss. */
+	for (uint32_t i = 0; i < key_count; i++)
+		key_create(&keys[i], key_size, i * 2);
+	for (uint32_t i = 0; i < lookup_count; i++)
+		key_create(&lookups[i], key_size, h(i) % (key_count * 2));
+
+	/* Alternate the two and take the best time of each. */
+	double elapsed_memcmp = 0, elapsed_words = 0;
+	uint64_t found_memcmp = 0, found_words = 0;
+	for (int i = 0; i < repeat_count; i++) {
+		double start = clock_monotonic();
+		found_memcmp = lookup_all_memcmp(keys, lookups);
+		double elapsed = clock_monotonic() - start;
+		if (i == 0 || elapsed < elapsed_memcmp)
+			elapsed_memcmp = elapsed;
+
+		start = clock_monotonic();
+		found_words = lookup_all_words(keys, lookups);
+		elapsed = clock_monotonic() - start;
+		if (i == 0 || elapsed < elapsed_words)
+			elapsed_words = elapsed;
+	}
+	if (found_memcmp != found_words) {
+		fprintf(stderr, "key size %u: found %llu != %llu\n",
+			key_size, (unsigned long long)found_memcmp,
+			(unsigned long long)found_words);
+		exit(EXIT_FAILURE);
+	}
+	printf("%8u %17.1f %17.1f %8.2f\n", key_size,
+	       elapsed_memcmp * 1e9 / lookup_count,
+	       elapsed_words * 1e9 / lookup_count,
+	       elapsed_memcmp / elapsed_words);
+}
+
+int
+main(void)
+{
+	struct key *keys = malloc(sizeof(*keys) * key_count);
+	struct key *lookups = malloc(sizeof(*lookups) * lookup_count);
+	if (keys == NULL || lookups == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return EXIT_FAILURE;
+	}
+	printf("%u keys, %u lookups, best of %d runs\n",
+	       key_count, lookup_count, repeat_count);
+	printf("%8s %17s %17s %8s\n", "key size", "memcmp ns/lookup",
+	       "words ns/lookup", "speedup");
+	for (size_t i = 0; i < lengthof(key_sizes); i++)
+		bench_run(key_sizes[i], keys, lookups);
+	free(keys);
+	free(lookups);
+	return 0;
+}
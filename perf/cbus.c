@@ -0,0 +1,478 @@
+#include <assert.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "memory.h"
+#include "fiber.h"
+#include "cbus.h"
+#include "tt_pthread.h"
+#include "salad/stailq.h"
+
+/*
+ * cbus throughput and latency benchmark.
+ *
+ * Each producer thread pushes messages to the main thread,
+ * which bounces them back. A producer keeps at most 'window'
+ * messages in flight: window = 1 measures the round trip
+ * latency, a large window measures the throughput.
+ *
+ * Every configuration is run twice: over cbus and over a
+ * baseline queue protected by a mutex, with the consumer woken
+ * up by ev_async (eventfd) whenever the queue becomes non-empty.
+ * The baseline is how cbus delivered messages before the
+ * lock-free output queue and busy-polling were introduced.
+ */
+
+/* Maximal number of producer threads. */
+enum { PRODUCER_MAX = 4 };
+
+/* Number of messages sent by each producer in a run. */
+static const int message_count = 500000;
+
+struct bench_msg {
+	/* Link in a cbus pipe. */
+	struct cmsg cmsg;
+	/* Link in a mutex queue. */
+	struct stailq_entry in_queue;
+	struct producer *producer;
+};
+
+/* Baseline: a mutex protected queue with an ev_async wakeup. */
+struct mutex_queue {
+	pthread_mutex_t mutex;
+	/* Messages not fetched by the consumer yet. */
+	struct stailq items;
+	/* Event loop of the consumer thread. */
+	struct ev_loop *consumer;
+	/* Sent when the queue becomes non-empty. */
+	struct ev_async async;
+	/* Consumer fiber waiting for messages or NULL. */
+	struct fiber *fiber;
+};
+
+static void
+mutex_queue_async_cb(struct ev_loop *loop, struct ev_async *watcher,
+		     int revents)
+{
+	(void)loop;
+	(void)revents;
+	struct mutex_queue *q = watcher->data;
+	if (q->fiber != NULL)
+		fiber_wakeup(q->fiber);
+}
+
+/* Must be called in the consumer thread. */
+static void
+mutex_queue_create(struct mutex_queue *q)
+{
+	tt_pthread_mutex_init(&q->mutex, NULL);
+	stailq_create(&q->items);
+	q->consumer = loop();
+	q->fiber = NULL;
+	ev_async_init(&q->async, mutex_queue_async_cb);
+	q->async.data = q;
+	ev_async_start(q->consumer, &q->async);
+}
+
+static void
+mutex_queue_destroy(struct mutex_queue *q)
+{
+	/* Wait for the producer that may still be sending the signal. */
+	tt_pthread_mutex_lock(&q->mutex);
+	assert(stailq_empty(&q->items));
+	tt_pthread_mutex_unlock(&q->mutex);
+	ev_async_stop(q->consumer, &q->async);
+	tt_pthread_mutex_destroy(&q->mutex);
+}
+
+static void
+mutex_queue_push(struct mutex_queue *q, struct stailq *batch)
+{
+	tt_pthread_mutex_lock(&q->mutex);
+	bool was_empty = stailq_empty(&q->items);
+	stailq_concat(&q->items, batch);
+	/*
+	 * Signal under the lock, otherwise the consumer may fetch
+	 * the messages and destroy the queue before we are done.
+	 */
+	if (was_empty)
+		ev_async_send(q->consumer, &q->async);
+	tt_pthread_mutex_unlock(&q->mutex);
+}
+
+/* Wait until the queue is non-empty and move its content to 'out'. */
+static void
+mutex_queue_pop(struct mutex_queue *q, struct stailq *out)
+{
+	while (true) {
+		tt_pthread_mutex_lock(&q->mutex);
+		stailq_concat(out, &q->items);
+		tt_pthread_mutex_unlock(&q->mutex);
+		if (!stailq_empty(out))
+			return;
+		q->fiber = fiber();
+		fiber_yield();
+		q->fiber = NULL;
+	}
+}
+
+/* Producer thread. */
+struct producer {
+	/* Name of endpoint hosted by this thread. */
+	char name[32];
+	/* Cord corresponding to this thread. */
+	struct cord cord;
+	/* Pipe from this to the main thread. */
+	struct cpipe main_pipe;
+	/* Pipe from the main to this thread. */
+	struct cpipe thread_pipe;
+	/* Queue from the main to this thread (baseline). */
+	struct mutex_queue queue;
+	/* Route of a benchmark message. */
+	struct cmsg_hop route[2];
+	/* Messages not in flight. */
+	struct bench_msg **free;
+	int free_count;
+	/* Max number of messages in flight. */
+	int window;
+	/* Signalled when a message returns. */
+	struct fiber_cond cond;
+	/* Start and completion message. */
+	struct cmsg cmsg;
+	/* Number of messages that made a round trip. */
+	int completed;
+};
+
+static struct producer producers[PRODUCER_MAX];
+
+/* Queue from producers to the main thread (baseline). */
+static struct mutex_queue main_queue;
+
+/* Number of producers that are still sending messages. */
+static int active_producer_count;
+
+/* Number of messages received by the main thread. */
+static int received;
+
+static void
+producer_init(struct producer *p, int id, int window)
+{
+	snprintf(p->name, sizeof(p->name), "producer_%d", id);
+	p->window = window;
+	p->completed = 0;
+	fiber_cond_create(&p->cond);
+	p->free = calloc(window, sizeof(*p->free));
+	assert(p->free != NULL);
+	for (int i = 0; i < window; i++) {
+		struct bench_msg *msg = malloc(sizeof(*msg));
+		assert(msg != NULL);
+		msg->producer = p;
+		p->free[i] = msg;
+	}
+	p->free_count = window;
+}
+
+static void
+producer_free(struct producer *p)
+{
+	assert(p->free_count == p->window);
+	for (int i = 0; i < p->window; i++)
+		free(p->free[i]);
+	free(p->free);
+	fiber_cond_destroy(&p->cond);
+}
+
+/* {{{ cbus */
+
+static void
+bench_msg_received_cb(struct cmsg *cmsg)
+{
+	(void)cmsg;
+	received++;
+}
+
+static void
+bench_msg_returned_cb(struct cmsg *cmsg)
+{
+	struct bench_msg *msg = container_of(cmsg, struct bench_msg, cmsg);
+	struct producer *p = msg->producer;
+	p->free[p->free_count++] = msg;
+	p->completed++;
+	fiber_cond_signal(&p->cond);
+}
+
+static void
+producer_complete_cb(struct cmsg *cmsg)
+{
+	(void)cmsg;
+	assert(active_producer_count > 0);
+	if (--active_producer_count == 0) {
+		/* Stop the main fiber when all producers are done. */
+		fiber_cancel(fiber());
+	}
+}
+
+static int
+producer_send_f(va_list ap)
+{
+	struct producer *p = va_arg(ap, struct producer *);
+	for (int i = 0; i < message_count; i++) {
+		while (p->free_count == 0)
+			fiber_cond_wait(&p->cond);
+		struct bench_msg *msg = p->free[--p->free_count];
+		cmsg_init(&msg->cmsg, p->route);
+		cpipe_push(&p->main_pipe, &msg->cmsg);
+	}
+	while (p->free_count < p->window)
+		fiber_cond_wait(&p->cond);
+	/* Notify the main thread that we are done. */
+	static struct cmsg_hop complete_route[] = {
+		{ producer_complete_cb, NULL }
+	};
+	cmsg_init(&p->cmsg, complete_route);
+	cpipe_push(&p->main_pipe, &p->cmsg);
+	return 0;
+}
+
+static void
+producer_start_cb(struct cmsg *cmsg)
+{
+	struct producer *p = container_of(cmsg, struct producer, cmsg);
+	struct fiber *f = fiber_new("send", producer_send_f);
+	assert(f != NULL);
+	fiber_start(f, p);
+}
+
+static int
+cbus_producer_f(va_list ap)
+{
+	struct producer *p = va_arg(ap, struct producer *);
+
+	cpipe_create(&p->main_pipe, "main");
+
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, p->name, fiber_schedule_cb, fiber());
+
+	cbus_loop(&endpoint);
+
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&p->main_pipe);
+	return 0;
+}
+
+static void
+cbus_producer_create(struct producer *p, int id, int window)
+{
+	producer_init(p, id, window);
+	p->route[0].f = bench_msg_received_cb;
+	p->route[0].pipe = &p->thread_pipe;
+	p->route[1].f = bench_msg_returned_cb;
+	p->route[1].pipe = NULL;
+
+	if (cord_costart(&p->cord, p->name, cbus_producer_f, p) != 0)
+		unreachable();
+
+	cpipe_create(&p->thread_pipe, p->name);
+}
+
+static void
+cbus_producer_start(struct producer *p)
+{
+	static struct cmsg_hop start_route[] = {
+		{ producer_start_cb, NULL }
+	};
+	cmsg_init(&p->cmsg, start_route);
+	cpipe_push(&p->thread_pipe, &p->cmsg);
+}
+
+static void
+cbus_producer_destroy(struct producer *p)
+{
+	cbus_stop_loop(&p->thread_pipe);
+	cpipe_destroy(&p->thread_pipe);
+
+	if (cord_join(&p->cord) != 0)
+		unreachable();
+	producer_free(p);
+}
+
+static int
+cbus_bench_f(va_list ap)
+{
+	int producer_count = va_arg(ap, int);
+	int window = va_arg(ap, int);
+
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "main", fiber_schedule_cb, fiber());
+
+	active_producer_count = producer_count;
+	for (int i = 0; i < producer_count; i++)
+		cbus_producer_create(&producers[i], i, window);
+	for (int i = 0; i < producer_count; i++)
+		cbus_producer_start(&producers[i]);
+
+	cbus_loop(&endpoint);
+
+	for (int i = 0; i < producer_count; i++)
+		cbus_producer_destroy(&producers[i]);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	return 0;
+}
+
+/* }}} cbus */
+
+/* {{{ mutex queue */
+
+static int
+mutex_producer_f(va_list ap)
+{
+	struct producer *p = va_arg(ap, struct producer *);
+	mutex_queue_create(&p->queue);
+
+	int sent = 0;
+	struct stailq batch;
+	stailq_create(&batch);
+	while (p->completed < message_count) {
+		/* Send as many messages as the window allows. */
+		while (p->free_count > 0 && sent < message_count) {
+			struct bench_msg *msg = p->free[--p->free_count];
+			stailq_add_tail_entry(&batch, msg, in_queue);
+			sent++;
+		}
+		if (!stailq_empty(&batch))
+			mutex_queue_push(&main_queue, &batch);
+		/* Wait for returned messages. */
+		struct stailq returned;
+		stailq_create(&returned);
+		mutex_queue_pop(&p->queue, &returned);
+		struct bench_msg *msg, *tmp;
+		stailq_foreach_entry_safe(msg, tmp, &returned, in_queue) {
+			p->free[p->free_count++] = msg;
+			p->completed++;
+		}
+	}
+	mutex_queue_destroy(&p->queue);
+	return 0;
+}
+
+static int
+mutex_bench_f(va_list ap)
+{
+	int producer_count = va_arg(ap, int);
+	int window = va_arg(ap, int);
+
+	mutex_queue_create(&main_queue);
+	for (int i = 0; i < producer_count; i++) {
+		struct producer *p = &producers[i];
+		producer_init(p, i, window);
+		if (cord_costart(&p->cord, p->name, mutex_producer_f, p) != 0)
+			unreachable();
+	}
+
+	int total = producer_count * message_count;
+	struct stailq batches[PRODUCER_MAX];
+	while (received < total) {
+		struct stailq input;
+		stailq_create(&input);
+		mutex_queue_pop(&main_queue, &input);
+		for (int i = 0; i < producer_count; i++)
+			stailq_create(&batches[i]);
+		/* Bounce the messages, one batch per producer. */
+		struct bench_msg *msg, *tmp;
+		stailq_foreach_entry_safe(msg, tmp, &input, in_queue) {
+			received++;
+			int i = msg->producer - producers;
+			stailq_add_tail_entry(&batches[i], msg, in_queue);
+		}
+		for (int i = 0; i < producer_count; i++) {
+			if (!stailq_empty(&batches[i]))
+				mutex_queue_push(&producers[i].queue,
+						 &batches[i]);
+		}
+	}
+
+	for (int i = 0; i < producer_count; i++) {
+		if (cord_join(&producers[i].cord) != 0)
+			unreachable();
+		producer_free(&producers[i]);
+	}
+	mutex_queue_destroy(&main_queue);
+	return 0;
+}
+
+/* }}} mutex queue */
+
+static double
+clock_monotonic(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+bench_run(const char *name, fiber_func bench_f,
+	  int producer_count, int window)
+{
+	assert(producer_count <= PRODUCER_MAX);
+	received = 0;
+	double start = clock_monotonic();
+	struct fiber *f = fiber_new("bench", bench_f);
+	assert(f != NULL);
+	fiber_set_joinable(f, true);
+	fiber_start(f, producer_count, window);
+	fiber_join(f);
+	double elapsed = clock_monotonic() - start;
+
+	int total = producer_count * message_count;
+	int completed = 0;
+	for (int i = 0; i < producer_count; i++)
+		completed += producers[i].completed;
+	if (received != total || completed != total) {
+		fprintf(stderr, "%s: lost messages\n", name);
+		exit(EXIT_FAILURE);
+	}
+	printf("%-8s %9d %6d %12.0f %8.2f\n", name, producer_count, window,
+	       total / elapsed, elapsed * 1e6 / total);
+}
+
+static int
+main_f(va_list ap)
+{
+	(void)ap;
+	static const int windows[] = { 1, 1024 };
+	static const int producer_counts[] = { 1, PRODUCER_MAX };
+	printf("%-8s %9s %6s %12s %8s\n",
+	       "queue", "producers", "window", "msg/s", "us/msg");
+	for (size_t i = 0; i < lengthof(producer_counts); i++) {
+		for (size_t j = 0; j < lengthof(windows); j++) {
+			bench_run("cbus", cbus_bench_f,
+				  producer_counts[i], windows[j]);
+			bench_run("mutex", mutex_bench_f,
+				  producer_counts[i], windows[j]);
+		}
+	}
+	ev_break(loop(), EVBREAK_ALL);
+	return 0;
+}
+
+int
+main()
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	cbus_init();
+
+	struct fiber *main_fiber = fiber_new("main", main_f);
+	assert(main_fiber != NULL);
+	fiber_wakeup(main_fiber);
+	ev_run(loop(), 0);
+
+	cbus_free();
+	fiber_free();
+	memory_free();
+	return 0;
+}
@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+/*
+ * Hash table benchmark: light.h versus swiss.h.
+ *
+ * Both tables store 64-bit integers. A run inserts the values
+ * one by one, so the tables go through all resizes, then looks
+ * up all of them and the same number of values that aren't
+ * stored. Comparison is cheap here, so the figures show the cost
+ * of probing rather than that of comparing tuples.
+ *
+ * Correctness of both tables is checked by test/unit/light.cc
+ * and test/unit/swiss.cc.
+ */
+
+/* Number of values stored in a table. */
+static const uint32_t value_count = 1000000;
+
+static const size_t extent_size = 16 * 1024;
+static size_t extent_count = 0;
+
+static uint32_t
+h(uint64_t v)
+{
+	return (v * 0x9E3779B97F4A7C15ULL) >> 32;
+}
+
+#define LIGHT_NAME _bench
+#define LIGHT_DATA_TYPE uint64_t
+#define LIGHT_KEY_TYPE uint64_t
+#define LIGHT_CMP_ARG_TYPE int
+#define LIGHT_EQUAL(a, b, arg) ((a) == (b))
+#define LIGHT_EQUAL_KEY(a, b, arg) ((a) == (b))
+#include "salad/light.h"
+
+#define SWISS_NAME _bench
+#define SWISS_DATA_TYPE uint64_t
+#define SWISS_KEY_TYPE uint64_t
+#define SWISS_CMP_ARG_TYPE int
+#define SWISS_EQUAL(a, b, arg) ((a) == (b))
+#define SWISS_EQUAL_KEY(a, b, arg) ((a) == (b))
+#define SWISS_HASH(a, arg) h(a)
+#include "salad/swiss.h"
+
+static void *
+extent_alloc(void *ctx)
+{
+	(void)ctx;
+	extent_count++;
+	return malloc(extent_size);
+}
+
+static void
+extent_free(void *ctx, void *extent)
+{
+	(void)ctx;
+	extent_count--;
+	free(extent);
+}
+
+static double
+clock_monotonic(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Stored values are even, missing ones are odd. */
+static uint64_t
+value(uint32_t i)
+{
+	return (uint64_t)i * 2;
+}
+
+static void
+report(const char *name, bool is_ok, double insert, double hit, double miss)
+{
+	if (!is_ok) {
+		fprintf(stderr, "%s: lookup returned wrong result\n", name);
+		exit(EXIT_FAILURE);
+	}
+	printf("%-6s %10.1f %7.1f %8.1f %10zu\n", name,
+	       insert * 1e9 / value_count, hit * 1e9 / value_count,
+	       miss * 1e9 / value_count, extent_count * extent_size / 1024);
+}
+
+static void
+bench_light(void)
+{
+	struct light_bench_core ht;
+	light_bench_create(&ht, extent_size, extent_alloc, extent_free,
+			   NULL, 0);
+	bool insert_ok = true;
+	double start = clock_monotonic();
+	for (uint32_t i = 0; i < value_count; i++) {
+		if (light_bench_insert(&ht, h(value(i)), value(i)) ==
+		    light_bench_end)
+			insert_ok = false;
+	}
+	double insert = clock_monotonic() - start;
+
+	uint32_t found = 0;
+	start = clock_monotonic();
+	for (uint32_t i = 0; i < value_count; i++) {
+		if (light_bench_find_key(&ht, h(value(i)), value(i)) !=
+		    light_bench_end)
+			found++;
+	}
+	double hit = clock_monotonic() - start;
+
+	uint32_t false_found = 0;
+	start = clock_monotonic();
+	for (uint32_t i = 0; i < value_count; i++) {
+		if (light_bench_find_key(&ht, h(value(i) + 1), value(i) + 1) !=
+		    light_bench_end)
+			false_found++;
+	}
+	double miss = clock_monotonic() - start;
+
+	report("light", insert_ok && ht.count == value_count &&
+	       found == value_count && false_found == 0, insert, hit, miss);
+	light_bench_destroy(&ht);
+}
+
+static void
+bench_swiss(void)
+{
+	struct swiss_bench_core ht;
+	swiss_bench_create(&ht, extent_size, extent_alloc, extent_free,
+			   NULL, 0);
+	bool insert_ok = true;
+	double start = clock_monotonic();
+	for (uint32_t i = 0; i < value_count; i++) {
+		if (swiss_bench_insert(&ht, h(value(i)), value(i)) ==
+		    swiss_bench_end)
+			insert_ok = false;
+	}
+	double insert = clock_monotonic() - start;
+
+	uint32_t found = 0;
+	start = clock_monotonic();
+	for (uint32_t i = 0; i < value_count; i++) {
+		if (swiss_bench_find_key(&ht, h(value(i)), value(i)) !=
+		    swiss_bench_end)
+			found++;
+	}
+	double hit = clock_monotonic() - start;
+
+	uint32_t false_found = 0;
+	start = clock_monotonic();
+	for (uint32_t i = 0; i < value_count; i++) {
+		if (swiss_bench_find_key(&ht, h(value(i) + 1), value(i) + 1) !=
+		    swiss_bench_end)
+			false_found++;
+	}
+	double miss = clock_monotonic() - start;
+
+	report("swiss", insert_ok && ht.count == value_count &&
+	       found == value_count && false_found == 0, insert, hit, miss);
+	swiss_bench_destroy(&ht);
+}
+
+int
+main(void)
+{
+	printf("%u values, time per operation\n", value_count);
+	printf("%-6s %10s %7s %8s %10s\n", "table", "insert, ns",
+	       "hit, ns", "miss, ns", "memory, KB");
+	bench_light();
+	bench_swiss();
+	return 0;
+}
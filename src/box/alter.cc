@@ -234,6 +234,12 @@ index_opts_decode(struct index_opts *opts, const char *map,
 			 "run_size_ratio must be greater than 1");
 		return -1;
 	}
+	if (opts->compaction_strategy == vy_compaction_strategy_MAX) {
+		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+			 BOX_INDEX_FIELD_OPTS, "compaction_strategy must be "
+			 "either 'leveled' or 'tiered'");
+		return -1;
+	}
 	if (opts->bloom_fpr <= 0 || opts->bloom_fpr > 1) {
 		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
 			 BOX_INDEX_FIELD_OPTS,
@@ -241,6 +247,33 @@ index_opts_decode(struct index_opts *opts, const char *map,
 			 "less than or equal to 1");
 		return -1;
 	}
+	if (opts->compression == vy_compression_MAX) {
+		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+			 BOX_INDEX_FIELD_OPTS, "compression must be "
+			 "either 'none' or 'zstd'");
+		return -1;
+	}
+	if (opts->compression_level < 1 || opts->compression_level > 22) {
+		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+			 BOX_INDEX_FIELD_OPTS,
+			 "compression_level must be between 1 and 22");
+		return -1;
+	}
+	if (opts->compression_dict_size != 0 &&
+	    (opts->compression_dict_size < 1024 ||
+	     opts->compression_dict_size > 1024 * 1024)) {
+		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+			 BOX_INDEX_FIELD_OPTS,
+			 "compression_dict_size must be either 0 or "
+			 "between 1024 and 1048576");
+		return -1;
+	}
+	if (opts->hash_table == hash_index_table_MAX) {
+		diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+			 BOX_INDEX_FIELD_OPTS, "hash_table must be "
+			 "either 'light' or 'swiss'");
+		return -1;
+	}
 	return 0;
 }
 
@@ -668,6 +701,12 @@ space_def_new_from_tuple(struct tuple *tuple, uint32_t errcode,
 			 "local space can't be synchronous");
 		return NULL;
 	}
+	if (opts.compression == space_compression_MAX) {
+		diag_set(ClientError, ER_WRONG_SPACE_OPTIONS,
+			 BOX_SPACE_FIELD_OPTS, "compression must be "
+			 "either 'none' or 'zstd'");
+		return NULL;
+	}
 	struct space_def *def =
 		space_def_new(id, uid, exact_field_count, name, name_len,
 			      engine_name, engine_name_len, &opts, fields,
@@ -2433,6 +2472,15 @@ on_replace_dd_space(struct trigger * /* trigger */, void *event)
 				  "a view and vice versa");
 			return -1;
 		}
+		struct index *old_pk = space_index(old_space, 0);
+		if (def->opts.compression != old_space->def->opts.compression &&
+		    old_pk != NULL && index_size(old_pk) > 0) {
+			diag_set(ClientError, ER_ALTER_SPACE,
+				  space_name(old_space),
+				  "can not change compression of a non-empty "
+				  "space");
+			return -1;
+		}
 		if (strcmp(def->name, old_space->def->name) != 0 &&
 		    old_space->def->view_ref_count > 0) {
 			diag_set(ClientError, ER_ALTER_SPACE,
@@ -51,6 +51,7 @@
 #include "schema.h"
 #include "engine.h"
 #include "memtx_engine.h"
+#include "memtx_tx.h"
 #include "sysview.h"
 #include "blackhole.h"
 #include "service_engine.h"
@@ -63,6 +64,7 @@
 #include "user.h"
 #include "cfg.h"
 #include "coio.h"
+#include "uring.h"
 #include "replication.h" /* replica */
 #include "title.h"
 #include "xrow.h"
@@ -192,6 +194,14 @@ box_process_rw(struct request *request, struct space *space,
 		txn_rollback_stmt(txn);
 		goto rollback;
 	}
+	if (result != NULL && tuple != NULL) {
+		/* Return the tuple with compressed fields expanded. */
+		tuple = tuple_decompress(tuple);
+		if (tuple == NULL) {
+			txn_rollback_stmt(txn);
+			goto rollback;
+		}
+	}
 	if (result != NULL)
 		*result = tuple;
 
@@ -670,6 +680,62 @@ box_check_memory_quota(const char *quota_name)
 	return -1;
 }
 
+static void
+box_check_memtx_sort_threads(int sort_threads)
+{
+	enum { MEMTX_SORT_THREADS_MAX = 256 };
+	if (sort_threads < 0 || sort_threads > MEMTX_SORT_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "memtx_sort_threads",
+			  tt_sprintf("must be >= 0 and <= %d",
+				     MEMTX_SORT_THREADS_MAX));
+	}
+}
+
+static int
+box_check_iproto_threads(void)
+{
+	int threads = cfg_geti("iproto_threads");
+	if (threads <= 0 || threads > IPROTO_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "iproto_threads",
+			  tt_sprintf("must be > 0 and <= %d",
+				     IPROTO_THREADS_MAX));
+	}
+	return threads;
+}
+
+static double
+box_check_wal_max_batch_delay(void)
+{
+	double delay = cfg_getd("wal_max_batch_delay");
+	if (delay < 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_max_batch_delay",
+			  "the value must be greater or equal to 0");
+	}
+	return delay;
+}
+
+static bool
+box_check_io_uring(void)
+{
+	bool use_uring = cfg_geti("io_uring");
+	if (use_uring && !uring_is_supported()) {
+		tnt_raise(ClientError, ER_CFG, "io_uring",
+			  "io_uring is not supported by the build or kernel");
+	}
+	return use_uring;
+}
+
+static void
+box_check_snap_compress_threads(int threads)
+{
+	enum { SNAP_COMPRESS_THREADS_MAX = 256 };
+	if (threads < 0 || threads > SNAP_COMPRESS_THREADS_MAX) {
+		tnt_raise(ClientError, ER_CFG, "snap_compress_threads",
+			  tt_sprintf("must be >= 0 and <= %d",
+				     SNAP_COMPRESS_THREADS_MAX));
+	}
+}
+
 static void
 box_check_vinyl_options(void)
 {
@@ -741,12 +807,17 @@ box_check_config(void)
 		diag_raise();
 	box_check_replication_sync_timeout();
 	box_check_readahead(cfg_geti("readahead"));
+	box_check_iproto_threads();
 	box_check_checkpoint_count(cfg_geti("checkpoint_count"));
 	box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
+	box_check_wal_max_batch_delay();
+	box_check_io_uring();
 	if (box_check_memory_quota("memtx_memory") < 0)
 		diag_raise();
 	box_check_memtx_min_tuple_size(cfg_geti64("memtx_min_tuple_size"));
+	box_check_memtx_sort_threads(cfg_geti("memtx_sort_threads"));
+	box_check_snap_compress_threads(cfg_geti("snap_compress_threads"));
 	box_check_vinyl_options();
 	if (box_check_sql_cache_size(cfg_geti("sql_cache_size")) != 0)
 		diag_raise();
@@ -1039,6 +1110,30 @@ box_set_snap_io_rate_limit(void)
 			cfg_getd("snap_io_rate_limit"));
 }
 
+void
+box_set_snap_compress_threads(void)
+{
+	int threads = cfg_geti("snap_compress_threads");
+	box_check_snap_compress_threads(threads);
+	/*
+	 * Blocks are compressed in the worker thread pool, which
+	 * is shared with other coio tasks, so there's no point in
+	 * having more blocks in flight than there are threads in
+	 * the pool.
+	 */
+	int pool_threads = cfg_geti("worker_pool_threads");
+	if (threads > pool_threads) {
+		say_warn("snap_compress_threads %d exceeds "
+			 "worker_pool_threads %d, using %d",
+			 threads, pool_threads, pool_threads);
+		threads = pool_threads;
+	}
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_snap_compress_threads(memtx, threads);
+}
+
 void
 box_set_memtx_memory(void)
 {
@@ -1101,6 +1196,12 @@ box_set_checkpoint_wal_threshold(void)
 	wal_set_checkpoint_threshold(threshold);
 }
 
+void
+box_set_wal_max_batch_delay(void)
+{
+	wal_set_max_batch_delay(box_check_wal_max_batch_delay());
+}
+
 void
 box_set_vinyl_memory(void)
 {
@@ -1129,6 +1230,22 @@ box_set_vinyl_cache(void)
 	vinyl_engine_set_cache(vinyl, cfg_geti64("vinyl_cache"));
 }
 
+void
+box_set_vinyl_page_cache(void)
+{
+	struct engine *vinyl = engine_by_name("vinyl");
+	assert(vinyl != NULL);
+	vinyl_engine_set_page_cache(vinyl, cfg_geti64("vinyl_page_cache"));
+}
+
+void
+box_set_vinyl_bloom_memory(void)
+{
+	struct engine *vinyl = engine_by_name("vinyl");
+	assert(vinyl != NULL);
+	vinyl_engine_set_bloom_memory(vinyl, cfg_geti64("vinyl_bloom_memory"));
+}
+
 void
 box_set_vinyl_timeout(void)
 {
@@ -1349,11 +1466,11 @@ box_select(uint32_t space_id, uint32_t index_id,
 		return -1;
 	}
 
-	int rc = 0;
+	int rc = iterator_skip(it, &offset);
 	uint32_t found = 0;
 	struct tuple *tuple;
 	port_c_create(port);
-	while (found < limit) {
+	while (rc == 0 && found < limit) {
 		rc = iterator_next(it, &tuple);
 		if (rc != 0 || tuple == NULL)
 			break;
@@ -2149,6 +2266,7 @@ box_free(void)
 		gc_free();
 		engine_shutdown();
 		wal_free();
+		uring_free();
 	}
 }
 
@@ -2162,14 +2280,18 @@ engine_init()
 	 * so it must be registered first.
 	 */
 	struct memtx_engine *memtx;
+	memtx_tx_manager_use_mvcc_engine = cfg_getb("memtx_use_mvcc_engine");
 	memtx = memtx_engine_new_xc(cfg_gets("memtx_dir"),
 				    cfg_geti("force_recovery"),
 				    cfg_getd("memtx_memory"),
 				    cfg_geti("memtx_min_tuple_size"),
 				    cfg_geti("strip_core"),
-				    cfg_getd("slab_alloc_factor"));
+				    cfg_getd("slab_alloc_factor"),
+				    cfg_geti("memtx_sort_threads"));
 	engine_register((struct engine *)memtx);
 	box_set_memtx_max_tuple_size();
+	/* Used for decompressing the snapshot on recovery. */
+	box_set_snap_compress_threads();
 
 	struct sysview_engine *sysview = sysview_engine_new_xc();
 	engine_register((struct engine *)sysview);
@@ -2189,6 +2311,8 @@ engine_init()
 	engine_register((struct engine *)vinyl);
 	box_set_vinyl_max_tuple_size();
 	box_set_vinyl_cache();
+	box_set_vinyl_page_cache();
+	box_set_vinyl_bloom_memory();
 	box_set_vinyl_timeout();
 }
 
@@ -2564,18 +2688,30 @@ box_cfg_xc(void)
 	rmean_box = rmean_new(iproto_type_strs, IPROTO_TYPE_STAT_MAX);
 	rmean_error = rmean_new(rmean_error_strings, RMEAN_ERROR_LAST);
 
+	/*
+	 * Vinyl submits run file reads to the tx io_uring, see
+	 * vy_run_env_enable_coio(). Reads issued by fibers during
+	 * an event loop iteration are submitted in one batch, the
+	 * ring is flushed early if they don't fit.
+	 */
+	enum { IO_URING_ENTRIES = 256 };
+	bool use_uring = box_check_io_uring();
+	if (use_uring && uring_init(IO_URING_ENTRIES, true) != 0)
+		diag_raise();
+
 	gc_init();
 	engine_init();
 	schema_init();
 	replication_init();
 	port_init();
-	iproto_init();
+	iproto_init(box_check_iproto_threads());
 	sql_init();
 
 	int64_t wal_max_size = box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	enum wal_mode wal_mode = box_check_wal_mode(cfg_gets("wal_mode"));
 	if (wal_init(wal_mode, txn_complete_async, cfg_gets("wal_dir"),
-		     wal_max_size, &INSTANCE_UUID, on_wal_garbage_collection,
+		     wal_max_size, &INSTANCE_UUID, use_uring,
+		     on_wal_garbage_collection,
 		     on_wal_checkpoint_threshold) != 0) {
 		diag_raise();
 	}
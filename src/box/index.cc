@@ -177,6 +177,22 @@ check_index(uint32_t space_id, uint32_t index_id,
 	return 0;
 }
 
+/**
+ * Prepare a tuple found by the public API to be returned to
+ * the caller: decompress and bless it.
+ */
+static inline int
+bless_result(struct tuple **result)
+{
+	if (*result == NULL)
+		return 0;
+	struct tuple *tuple = tuple_decompress(*result);
+	if (tuple == NULL)
+		return -1;
+	*result = tuple_bless(tuple);
+	return 0;
+}
+
 /* }}} */
 
 /* {{{ Public API */
@@ -215,9 +231,7 @@ box_index_random(uint32_t space_id, uint32_t index_id, uint32_t rnd,
 	/* No tx management, random() is for approximation anyway. */
 	if (index_random(index, rnd, result) != 0)
 		return -1;
-	if (*result != NULL)
-		tuple_bless(*result);
-	return 0;
+	return bless_result(result);
 }
 
 int
@@ -248,8 +262,64 @@ box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	txn_commit_ro_stmt(txn);
 	/* Count statistics. */
 	rmean_collect(rmean_box, IPROTO_SELECT, 1);
-	if (*result != NULL)
-		tuple_bless(*result);
+	return bless_result(result);
+}
+
+int
+box_index_get_many(uint32_t space_id, uint32_t index_id, const char *keys,
+		   const char *keys_end, box_tuple_t **result)
+{
+	assert(keys != NULL && keys_end != NULL && result != NULL);
+	mp_tuple_assert(keys, keys_end);
+	struct space *space;
+	struct index *index;
+	if (check_index(space_id, index_id, &space, &index) != 0)
+		return -1;
+	if (!index->def->opts.is_unique) {
+		diag_set(ClientError, ER_MORE_THAN_ONE_TUPLE);
+		return -1;
+	}
+	uint32_t key_count = mp_decode_array(&keys);
+	const char *key = keys;
+	for (uint32_t i = 0; i < key_count; i++) {
+		if (mp_typeof(*key) != MP_ARRAY) {
+			diag_set(ClientError, ER_ILLEGAL_PARAMS,
+				 "key must be an array");
+			return -1;
+		}
+		uint32_t part_count = mp_decode_array(&key);
+		if (exact_key_validate(index->def->key_def, key, part_count))
+			return -1;
+		for (uint32_t j = 0; j < part_count; j++)
+			mp_next(&key);
+	}
+	/* Start transaction in the engine. */
+	struct txn *txn;
+	if (txn_begin_ro_stmt(space, &txn) != 0)
+		return -1;
+	if (index_get_many(index, keys, key_count, result) != 0) {
+		txn_rollback_stmt(txn);
+		return -1;
+	}
+	txn_commit_ro_stmt(txn);
+	/* Count statistics. */
+	rmean_collect(rmean_box, IPROTO_SELECT, 1);
+	/* Replace compressed tuples with decompressed copies. */
+	for (uint32_t i = 0; i < key_count; i++) {
+		if (result[i] == NULL)
+			continue;
+		struct tuple *tuple = tuple_decompress(result[i]);
+		if (tuple == NULL) {
+			for (uint32_t j = 0; j < key_count; j++) {
+				if (result[j] != NULL)
+					tuple_unref(result[j]);
+			}
+			return -1;
+		}
+		tuple_ref(tuple);
+		tuple_unref(result[i]);
+		result[i] = tuple;
+	}
 	return 0;
 }
 
@@ -280,9 +350,7 @@ box_index_min(uint32_t space_id, uint32_t index_id, const char *key,
 		return -1;
 	}
 	txn_commit_ro_stmt(txn);
-	if (*result != NULL)
-		tuple_bless(*result);
-	return 0;
+	return bless_result(result);
 }
 
 int
@@ -312,9 +380,7 @@ box_index_max(uint32_t space_id, uint32_t index_id, const char *key,
 		return -1;
 	}
 	txn_commit_ro_stmt(txn);
-	if (*result != NULL)
-		tuple_bless(*result);
-	return 0;
+	return bless_result(result);
 }
 
 ssize_t
@@ -393,9 +459,7 @@ box_iterator_next(box_iterator_t *itr, box_tuple_t **result)
 	assert(result != NULL);
 	if (iterator_next(itr, result) != 0)
 		return -1;
-	if (*result != NULL)
-		tuple_bless(*result);
-	return 0;
+	return bless_result(result);
 }
 
 void
@@ -439,6 +503,7 @@ void
 iterator_create(struct iterator *it, struct index *index)
 {
 	it->next = NULL;
+	it->skip = NULL;
 	it->free = NULL;
 	it->space_cache_version = space_cache_version;
 	it->space_id = index->def->space_id;
@@ -470,6 +535,19 @@ invalidate:
 	return 0;
 }
 
+int
+iterator_skip(struct iterator *it, uint32_t *count)
+{
+	/*
+	 * The schema version is not checked here: if the index
+	 * was altered, it is done by the following iterator_next()
+	 * call anyway.
+	 */
+	if (it->skip == NULL || *count == 0)
+		return 0;
+	return it->skip(it, count);
+}
+
 void
 iterator_delete(struct iterator *it)
 {
@@ -509,6 +587,15 @@ index_delete(struct index *index)
 
 int
 index_build(struct index *index, struct index *pk)
+{
+	if (index_build_fill(index, pk) != 0)
+		return -1;
+	index_end_build(index);
+	return 0;
+}
+
+int
+index_build_fill(struct index *index, struct index *pk)
 {
 	ssize_t n_tuples = index_size(pk);
 	if (n_tuples < 0)
@@ -542,11 +629,7 @@ index_build(struct index *index, struct index *pk)
 			break;
 	}
 	iterator_delete(it);
-	if (rc != 0)
-		return -1;
-
-	index_end_build(index);
-	return 0;
+	return rc != 0 ? -1 : 0;
 }
 
 /* }}} */
@@ -668,6 +751,28 @@ generic_index_get(struct index *index, const char *key,
 	return -1;
 }
 
+int
+generic_index_get_many(struct index *index, const char *keys,
+		       uint32_t key_count, struct tuple **result)
+{
+	const char *key = keys;
+	for (uint32_t i = 0; i < key_count; i++) {
+		uint32_t part_count = mp_decode_array(&key);
+		if (index_get(index, key, part_count, &result[i]) != 0) {
+			for (uint32_t j = 0; j < i; j++) {
+				if (result[j] != NULL)
+					tuple_unref(result[j]);
+			}
+			return -1;
+		}
+		if (result[i] != NULL)
+			tuple_ref(result[i]);
+		for (uint32_t j = 0; j < part_count; j++)
+			mp_next(&key);
+	}
+	return 0;
+}
+
 int
 generic_index_replace(struct index *index, struct tuple *old_tuple,
 		      struct tuple *new_tuple, enum dup_replace_mode mode,
@@ -146,6 +146,31 @@ int
 box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	      const char *key_end, box_tuple_t **result);
 
+/**
+ * Get tuples from index by several keys at once.
+ *
+ * The index may look up the keys concurrently, so this function
+ * can be much faster than calling box_index_get() for each key
+ * if the tuples have to be read from disk.
+ *
+ * \param space_id space identifier
+ * \param index_id index identifier
+ * \param keys encoded keys in MsgPack Array format
+ * ([[part1, part2, ...], [part1, part2, ...], ...]).
+ * \param keys_end the end of encoded \a keys
+ * \param[out] result array with room for as many tuples as there
+ * are keys. The i-th element is set to the tuple matching the
+ * i-th key or NULL if there's no such tuple. Found tuples are
+ * referenced and must be unreferenced with box_tuple_unref().
+ * \retval -1 on error (check box_error_last())
+ * \retval 0 on success
+ * \pre keys != NULL
+ * \sa \code box.space[space_id].index[index_id]:get_many(keys) \endcode
+ */
+int
+box_index_get_many(uint32_t space_id, uint32_t index_id, const char *keys,
+		   const char *keys_end, box_tuple_t **result);
+
 /**
  * Return a first (minimal) tuple matched the provided key.
  *
@@ -242,6 +267,15 @@ struct iterator {
 	 * Returns 0 on success, -1 on error.
 	 */
 	int (*next)(struct iterator *it, struct tuple **ret);
+	/**
+	 * Skip up to @count tuples without returning them, as
+	 * if next() were called that many times. @count is
+	 * decremented by the number of skipped tuples.
+	 * Returns 0 on success, -1 on error.
+	 * Optional: NULL if the iterator can't skip tuples
+	 * faster than by calling next().
+	 */
+	int (*skip)(struct iterator *it, uint32_t *count);
 	/** Destroy the iterator. */
 	void (*free)(struct iterator *);
 	/** Space cache version at the time of the last index lookup. */
@@ -277,6 +311,18 @@ iterator_create(struct iterator *it, struct index *index);
 int
 iterator_next(struct iterator *it, struct tuple **ret);
 
+/**
+ * Try to skip @count tuples at once, without returning them.
+ *
+ * @count is decremented by the number of skipped tuples. It
+ * may stay unchanged if the iterator doesn't support skipping,
+ * in which case the caller has to skip the remaining tuples
+ * with iterator_next().
+ * Returns 0 on success, -1 on error.
+ */
+int
+iterator_skip(struct iterator *it, uint32_t *count);
+
 /**
  * Destroy an iterator instance and free associated memory.
  */
@@ -412,6 +458,14 @@ struct index_vtab {
 			 const char *key, uint32_t part_count);
 	int (*get)(struct index *index, const char *key,
 		   uint32_t part_count, struct tuple **result);
+	/**
+	 * Look up tuples by several full keys. The keys are MsgPack
+	 * arrays stored one after another. Found tuples are returned
+	 * referenced, the i-th element of @a result is set to NULL if
+	 * nothing is found by the i-th key.
+	 */
+	int (*get_many)(struct index *index, const char *keys,
+			uint32_t key_count, struct tuple **result);
 	int (*replace)(struct index *index, struct tuple *old_tuple,
 		       struct tuple *new_tuple, enum dup_replace_mode mode,
 		       struct tuple **result);
@@ -533,6 +587,16 @@ index_unref(struct index *index)
 int
 index_build(struct index *index, struct index *pk);
 
+/**
+ * Begin building this index and feed it all tuples stored in
+ * another index, but don't finish the build. The caller must
+ * call index_end_build() afterwards. This allows the engine to
+ * postpone the final stage of the build, e.g. to do it for many
+ * indexes at once.
+ */
+int
+index_build_fill(struct index *index, struct index *pk);
+
 static inline void
 index_commit_create(struct index *index, int64_t signature)
 {
@@ -622,6 +686,13 @@ index_get(struct index *index, const char *key,
 	return index->vtab->get(index, key, part_count, result);
 }
 
+static inline int
+index_get_many(struct index *index, const char *keys,
+	       uint32_t key_count, struct tuple **result)
+{
+	return index->vtab->get_many(index, keys, key_count, result);
+}
+
 static inline int
 index_replace(struct index *index, struct tuple *old_tuple,
 	      struct tuple *new_tuple, enum dup_replace_mode mode,
@@ -704,6 +775,8 @@ int generic_index_random(struct index *, uint32_t, struct tuple **);
 ssize_t generic_index_count(struct index *, enum iterator_type,
 			    const char *, uint32_t);
 int generic_index_get(struct index *, const char *, uint32_t, struct tuple **);
+int generic_index_get_many(struct index *, const char *, uint32_t,
+			   struct tuple **);
 int generic_index_replace(struct index *, struct tuple *, struct tuple *,
 			  enum dup_replace_mode, struct tuple **);
 struct snapshot_iterator *generic_index_create_snapshot_iterator(struct index *);
@@ -39,6 +39,12 @@ const char *index_type_strs[] = { "HASH", "TREE", "BITSET", "RTREE" };
 
 const char *rtree_index_distance_type_strs[] = { "EUCLID", "MANHATTAN" };
 
+const char *vy_compaction_strategy_strs[] = { "leveled", "tiered" };
+
+const char *vy_compression_strs[] = { "none", "zstd" };
+
+const char *hash_index_table_strs[] = { "light", "swiss" };
+
 const struct index_opts index_opts_default = {
 	/* .unique              = */ true,
 	/* .dimension           = */ 2,
@@ -47,10 +53,16 @@ const struct index_opts index_opts_default = {
 	/* .page_size           = */ 8192,
 	/* .run_count_per_level = */ 2,
 	/* .run_size_ratio      = */ 3.5,
+	/* .compaction_strategy = */ VY_COMPACTION_LEVELED,
 	/* .bloom_fpr           = */ 0.05,
+	/* .compression         = */ VY_COMPRESSION_ZSTD,
+	/* .compression_level   = */ 3,
+	/* .compression_dict_size = */ 0,
 	/* .lsn                 = */ 0,
 	/* .stat                = */ NULL,
 	/* .func                = */ 0,
+	/* .inline_key          = */ false,
+	/* .hash_table          = */ HASH_INDEX_TABLE_LIGHT,
 };
 
 const struct opt_def index_opts_reg[] = {
@@ -62,9 +74,20 @@ const struct opt_def index_opts_reg[] = {
 	OPT_DEF("page_size", OPT_INT64, struct index_opts, page_size),
 	OPT_DEF("run_count_per_level", OPT_INT64, struct index_opts, run_count_per_level),
 	OPT_DEF("run_size_ratio", OPT_FLOAT, struct index_opts, run_size_ratio),
+	OPT_DEF_ENUM("compaction_strategy", vy_compaction_strategy,
+		     struct index_opts, compaction_strategy, NULL),
 	OPT_DEF("bloom_fpr", OPT_FLOAT, struct index_opts, bloom_fpr),
+	OPT_DEF_ENUM("compression", vy_compression, struct index_opts,
+		     compression, NULL),
+	OPT_DEF("compression_level", OPT_INT64, struct index_opts,
+		compression_level),
+	OPT_DEF("compression_dict_size", OPT_INT64, struct index_opts,
+		compression_dict_size),
 	OPT_DEF("lsn", OPT_INT64, struct index_opts, lsn),
 	OPT_DEF("func", OPT_UINT32, struct index_opts, func_id),
+	OPT_DEF("inline_key", OPT_BOOL, struct index_opts, inline_key),
+	OPT_DEF_ENUM("hash_table", hash_index_table, struct index_opts,
+		     hash_table, NULL),
 	OPT_DEF_LEGACY("sql"),
 	OPT_END,
 };
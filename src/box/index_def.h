@@ -58,6 +58,40 @@ enum rtree_index_distance_type {
 };
 extern const char *rtree_index_distance_type_strs[];
 
+enum vy_compaction_strategy {
+	/*
+	 * Keep at most one run at the last LSM tree level.
+	 * Low space amplification, suits update-heavy workloads.
+	 */
+	VY_COMPACTION_LEVELED,
+	/*
+	 * Let the last LSM tree level accumulate up to
+	 * run_count_per_level runs before merging them.
+	 * Low write amplification, suits append-mostly workloads.
+	 */
+	VY_COMPACTION_TIERED,
+	vy_compaction_strategy_MAX
+};
+extern const char *vy_compaction_strategy_strs[];
+
+enum vy_compression {
+	/* Don't compress run pages. */
+	VY_COMPRESSION_NONE,
+	/* Compress run pages with zstd. */
+	VY_COMPRESSION_ZSTD,
+	vy_compression_MAX
+};
+extern const char *vy_compression_strs[];
+
+enum hash_index_table {
+	/* Linear hashing with chains, see salad/light.h. */
+	HASH_INDEX_TABLE_LIGHT,
+	/* Open addressing with tag matching, see salad/swiss.h. */
+	HASH_INDEX_TABLE_SWISS,
+	hash_index_table_MAX
+};
+extern const char *hash_index_table_strs[];
+
 /** Simple alias to represent logarithm metrics. */
 typedef int16_t log_est_t;
 
@@ -151,8 +185,22 @@ struct index_opts {
 	 * previous one.
 	 */
 	double run_size_ratio;
+	/**
+	 * Compaction strategy, see vy_range_update_compaction_priority()
+	 * for details.
+	 */
+	enum vy_compaction_strategy compaction_strategy;
 	/* Bloom filter false positive rate. */
 	double bloom_fpr;
+	/** Algorithm used to compress pages of compacted runs. */
+	enum vy_compression compression;
+	/** zstd compression level. */
+	int64_t compression_level;
+	/**
+	 * Max size of a zstd dictionary trained for each run
+	 * written by compaction. 0 disables dictionaries.
+	 */
+	int64_t compression_dict_size;
 	/**
 	 * LSN from the time of index creation.
 	 */
@@ -165,6 +213,13 @@ struct index_opts {
 	struct index_stat *stat;
 	/** Identifier of the functional index function. */
 	uint32_t func_id;
+	/**
+	 * Store a normalized key prefix in memtx tree index
+	 * elements, see memtx_tree.c.
+	 */
+	bool inline_key;
+	/** Hash table implementation of a memtx HASH index. */
+	enum hash_index_table hash_table;
 };
 
 extern const struct index_opts index_opts_default;
@@ -207,10 +262,25 @@ index_opts_cmp(const struct index_opts *o1, const struct index_opts *o2)
 		       -1 : 1;
 	if (o1->run_size_ratio != o2->run_size_ratio)
 		return o1->run_size_ratio < o2->run_size_ratio ? -1 : 1;
+	if (o1->compaction_strategy != o2->compaction_strategy)
+		return o1->compaction_strategy < o2->compaction_strategy ?
+		       -1 : 1;
 	if (o1->bloom_fpr != o2->bloom_fpr)
 		return o1->bloom_fpr < o2->bloom_fpr ? -1 : 1;
+	if (o1->compression != o2->compression)
+		return o1->compression < o2->compression ? -1 : 1;
+	if (o1->compression_level != o2->compression_level)
+		return o1->compression_level < o2->compression_level ?
+		       -1 : 1;
+	if (o1->compression_dict_size != o2->compression_dict_size)
+		return o1->compression_dict_size < o2->compression_dict_size ?
+		       -1 : 1;
 	if (o1->func_id != o2->func_id)
 		return o1->func_id - o2->func_id;
+	if (o1->inline_key != o2->inline_key)
+		return o1->inline_key < o2->inline_key ? -1 : 1;
+	if (o1->hash_table != o2->hash_table)
+		return o1->hash_table < o2->hash_table ? -1 : 1;
 	return 0;
 }
 
@@ -33,6 +33,8 @@
 
 #include <stddef.h>
 
+#include "rmean.h"
+
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
@@ -52,6 +54,8 @@ enum {
 	 * processing stops until some new fibers are freed up.
 	 */
 	IPROTO_FIBER_POOL_SIZE_FACTOR = 5,
+	/** The maximal number of network threads. */
+	IPROTO_THREADS_MAX = 1000,
 };
 
 extern unsigned iproto_readahead;
@@ -74,6 +78,41 @@ iproto_connection_count(void);
 size_t
 iproto_request_count(void);
 
+/**
+ * Invoke a callback for each network statistics counter,
+ * summed up over all network threads. Stops if the callback
+ * returns non-zero and returns its return value.
+ */
+int
+iproto_rmean_foreach(rmean_cb cb, void *cb_ctx);
+
+/**
+ * Return the number of network threads.
+ */
+int
+iproto_thread_count(void);
+
+/**
+ * Same as iproto_connection_count(), but only counts
+ * connections served by the given network thread.
+ */
+size_t
+iproto_thread_connection_count(int thread_id);
+
+/**
+ * Same as iproto_request_count(), but only counts requests
+ * of the given network thread.
+ */
+size_t
+iproto_thread_request_count(int thread_id);
+
+/**
+ * Same as iproto_rmean_foreach(), but for statistics of the
+ * given network thread.
+ */
+int
+iproto_thread_rmean_foreach(int thread_id, rmean_cb cb, void *cb_ctx);
+
 /**
  * Reset network statistics.
  */
@@ -90,8 +129,13 @@ iproto_bound_address(void);
 #if defined(__cplusplus)
 } /* extern "C" */
 
+/**
+ * Initialize the iproto subsystem and start @a threads_count
+ * network threads. Accepted connections are spread among the
+ * threads.
+ */
 void
-iproto_init(void);
+iproto_init(int threads_count);
 
 void
 iproto_listen(const char *uri);
@@ -218,8 +218,9 @@ const char *vy_run_info_key_strs[VY_RUN_INFO_KEY_MAX] = {
 	"max lsn",
 	"page count",
 	"bloom filter legacy",
-	"bloom filter",
+	"bloom filter legacy v2",
 	"stmt stat",
+	"bloom filter",
 };
 
 const char *vy_row_index_key_strs[VY_ROW_INDEX_KEY_MAX] = {
@@ -245,6 +245,8 @@ enum iproto_type {
 	VY_INDEX_PAGE_INFO = 101,
 	/** Vinyl row index stored in .run file */
 	VY_RUN_ROW_INDEX = 102,
+	/** Vinyl bloom filter stored in .index file */
+	VY_INDEX_BLOOM = 103,
 
 	/** Non-final response type. */
 	IPROTO_CHUNK = 128,
@@ -282,6 +284,8 @@ iproto_type_name(uint32_t type)
 		return "PAGEINFO";
 	case VY_RUN_ROW_INDEX:
 		return "ROWINDEX";
+	case VY_INDEX_BLOOM:
+		return "BLOOM";
 	default:
 		return NULL;
 	}
@@ -372,10 +376,12 @@ enum vy_run_info_key {
 	VY_RUN_INFO_PAGE_COUNT = 5,
 	/** Legacy bloom filter implementation. */
 	VY_RUN_INFO_BLOOM_LEGACY = 6,
-	/** Bloom filter for keys. */
-	VY_RUN_INFO_BLOOM = 7,
+	/** Legacy bloom filter for keys (classic layout). */
+	VY_RUN_INFO_BLOOM_LEGACY_V2 = 7,
 	/** Number of statements of each type (map). */
 	VY_RUN_INFO_STMT_STAT = 8,
+	/** Bloom filter for keys (split block layout). */
+	VY_RUN_INFO_BLOOM = 9,
 	/** The last key in this enum + 1 */
 	VY_RUN_INFO_KEY_MAX
 };
@@ -36,6 +36,8 @@
 #include "box/index.h"
 #include "box/lua/tuple.h"
 #include "box/lua/misc.h" /* lbox_encode_tuple_on_gc() */
+#include "box/tuple.h"
+#include "fiber.h"
 
 /** {{{ box.index Lua library: access to spaces and indexes
  */
@@ -169,6 +171,44 @@ lbox_index_get(lua_State *L)
 	return luaT_pushtupleornil(L, tuple);
 }
 
+static int
+lbox_index_get_many(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2))
+		return luaL_error(L, "Usage index.get_many(space_id, index_id, "
+				  "keys)");
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+	size_t keys_len;
+	const char *keys = lbox_encode_tuple_on_gc(L, 3, &keys_len);
+	const char *keys_end = keys + keys_len;
+
+	const char *pos = keys;
+	uint32_t key_count = mp_decode_array(&pos);
+	size_t size;
+	struct tuple **result = region_alloc_array(&fiber()->gc,
+						   typeof(result[0]),
+						   key_count, &size);
+	if (result == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_array", "result");
+		return luaT_error(L);
+	}
+	if (box_index_get_many(space_id, index_id, keys, keys_end,
+			       result) != 0)
+		return luaT_error(L);
+	lua_createtable(L, key_count, 0);
+	int count = 0;
+	for (uint32_t i = 0; i < key_count; i++) {
+		if (result[i] == NULL)
+			continue;
+		luaT_pushtuple(L, result[i]);
+		lua_rawseti(L, -2, ++count);
+		tuple_unref(result[i]);
+	}
+	return 1;
+}
+
 static int
 lbox_index_min(lua_State *L)
 {
@@ -357,6 +397,7 @@ box_lua_index_init(struct lua_State *L)
 		{"delete",  lbox_index_delete},
 		{"random", lbox_index_random},
 		{"get",  lbox_index_get},
+		{"get_many", lbox_index_get_many},
 		{"min", lbox_index_min},
 		{"max", lbox_index_max},
 		{"count", lbox_index_count},
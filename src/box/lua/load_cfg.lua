@@ -38,10 +38,13 @@ local ifdef_feedback_set_params =
 -- all available options
 local default_cfg = {
     listen              = nil,
+    iproto_threads      = 1,
     memtx_memory        = 256 * 1024 *1024,
     strip_core          = true,
     memtx_min_tuple_size = 16,
     memtx_max_tuple_size = 1024 * 1024,
+    memtx_sort_threads  = 0, -- use all online CPUs
+    memtx_use_mvcc_engine = false,
     slab_alloc_factor   = 1.05,
     work_dir            = nil,
     memtx_dir           = ".",
@@ -50,6 +53,8 @@ local default_cfg = {
     vinyl_dir           = '.',
     vinyl_memory        = 128 * 1024 * 1024,
     vinyl_cache         = 128 * 1024 * 1024,
+    vinyl_page_cache    = 0,
+    vinyl_bloom_memory  = nil, -- no limit
     vinyl_max_tuple_size = 1024 * 1024,
     vinyl_read_threads  = 1,
     vinyl_write_threads = 4,
@@ -67,9 +72,12 @@ local default_cfg = {
     io_collect_interval = nil,
     readahead           = 16320,
     snap_io_rate_limit  = nil, -- no limit
+    snap_compress_threads = 2,
     too_long_threshold  = 0.5,
     wal_mode            = "write",
     wal_max_size        = 256 * 1024 * 1024,
+    wal_max_batch_delay = 0,
+    io_uring            = false,
     wal_dir_rescan_delay= 2,
     force_recovery      = false,
     replication         = nil,
@@ -115,10 +123,13 @@ local module_cfg = {
 -- could be comma separated lua types or 'any' if any type is allowed
 local template_cfg = {
     listen              = 'string, number',
+    iproto_threads      = 'number',
     memtx_memory        = 'number',
     strip_core          = 'boolean',
     memtx_min_tuple_size  = 'number',
     memtx_max_tuple_size  = 'number',
+    memtx_sort_threads    = 'number',
+    memtx_use_mvcc_engine = 'boolean',
     slab_alloc_factor   = 'number',
     work_dir            = 'string',
     memtx_dir            = 'string',
@@ -126,6 +137,8 @@ local template_cfg = {
     vinyl_dir           = 'string',
     vinyl_memory        = 'number',
     vinyl_cache               = 'number',
+    vinyl_page_cache          = 'number',
+    vinyl_bloom_memory        = 'number',
     vinyl_max_tuple_size      = 'number',
     vinyl_read_threads        = 'number',
     vinyl_write_threads       = 'number',
@@ -144,9 +157,12 @@ local template_cfg = {
     io_collect_interval = 'number',
     readahead           = 'number',
     snap_io_rate_limit  = 'number',
+    snap_compress_threads = 'number',
     too_long_threshold  = 'number',
     wal_mode            = 'string',
     wal_max_size        = 'number',
+    wal_max_batch_delay = 'number',
+    io_uring            = 'boolean',
     wal_dir_rescan_delay= 'number',
     force_recovery      = 'boolean',
     replication         = 'string, number, table',
@@ -259,16 +275,20 @@ local dynamic_cfg = {
     readahead               = private.cfg_set_readahead,
     too_long_threshold      = private.cfg_set_too_long_threshold,
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
+    snap_compress_threads   = private.cfg_set_snap_compress_threads,
     read_only               = private.cfg_set_read_only,
     memtx_memory            = private.cfg_set_memtx_memory,
     memtx_max_tuple_size    = private.cfg_set_memtx_max_tuple_size,
     vinyl_memory            = private.cfg_set_vinyl_memory,
     vinyl_max_tuple_size    = private.cfg_set_vinyl_max_tuple_size,
     vinyl_cache             = private.cfg_set_vinyl_cache,
+    vinyl_page_cache        = private.cfg_set_vinyl_page_cache,
+    vinyl_bloom_memory      = private.cfg_set_vinyl_bloom_memory,
     vinyl_timeout           = private.cfg_set_vinyl_timeout,
     checkpoint_count        = private.cfg_set_checkpoint_count,
     checkpoint_interval     = private.cfg_set_checkpoint_interval,
     checkpoint_wal_threshold = private.cfg_set_checkpoint_wal_threshold,
+    wal_max_batch_delay     = private.cfg_set_wal_max_batch_delay,
     worker_pool_threads     = private.cfg_set_worker_pool_threads,
     feedback_enabled        = ifdef_feedback_set_params,
     feedback_host           = ifdef_feedback_set_params,
@@ -313,6 +333,9 @@ ifdef_feedback_set_params = nil -- luacheck: ignore
 -- changed.
 --
 local dynamic_cfg_order = {
+    -- snap_compress_threads is capped by worker_pool_threads.
+    worker_pool_threads     = 50,
+    snap_compress_threads   = 60,
     listen                  = 100,
     -- Order of replication_* options does not matter. The only
     -- rule - apply before replication itself.
@@ -348,6 +371,8 @@ local dynamic_cfg_skip_at_load = {
     vinyl_memory            = true,
     vinyl_max_tuple_size    = true,
     vinyl_cache             = true,
+    vinyl_page_cache        = true,
+    vinyl_bloom_memory      = true,
     vinyl_timeout           = true,
     too_long_threshold      = true,
     replication             = true,
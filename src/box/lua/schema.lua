@@ -412,6 +412,7 @@ box.schema.space.create = function(name, options)
         is_local = 'boolean',
         temporary = 'boolean',
         is_sync = 'boolean',
+        compression = 'string',
     }
     local options_defaults = {
         engine = 'memtx',
@@ -456,7 +457,8 @@ box.schema.space.create = function(name, options)
     local space_options = setmap({
         group_id = options.is_local and 1 or nil,
         temporary = options.temporary and true or nil,
-        is_sync = options.is_sync
+        is_sync = options.is_sync,
+        compression = options.compression,
     })
     _space:insert{id, uid, name, options.engine, options.field_count,
         space_options, format}
@@ -938,10 +940,16 @@ local index_options = {
     distance = 'string',
     run_count_per_level = 'number',
     run_size_ratio = 'number',
+    compaction_strategy = 'string',
     range_size = 'number',
     page_size = 'number',
     bloom_fpr = 'number',
+    compression = 'string',
+    compression_level = 'number',
+    compression_dict_size = 'number',
     func = 'number, string',
+    inline_key = 'boolean',
+    hash_table = 'string',
 }
 
 --
@@ -1055,8 +1063,14 @@ box.schema.index.create = function(space_id, name, options)
             range_size = options.range_size,
             run_count_per_level = options.run_count_per_level,
             run_size_ratio = options.run_size_ratio,
+            compaction_strategy = options.compaction_strategy,
             bloom_fpr = options.bloom_fpr,
+            compression = options.compression,
+            compression_level = options.compression_level,
+            compression_dict_size = options.compression_dict_size,
             func = options.func,
+            inline_key = options.inline_key,
+            hash_table = options.hash_table,
     }
     local field_type_aliases = {
         num = 'unsigned'; -- Deprecated since 1.7.2
@@ -1498,6 +1512,12 @@ base_index_mt.count_luac = function(index, key, opts)
     return internal.count(index.space_id, index.id, itype, key);
 end
 
+-- number of tuples less than the key in the index order
+base_index_mt.rank = function(index, key)
+    check_index_arg(index, 'rank')
+    return index:count(key, {iterator = 'LT'})
+end
+
 base_index_mt.get_ffi = function(index, key)
     check_index_arg(index, 'get')
     local key, key_end = tuple_encode(key)
@@ -1515,6 +1535,20 @@ base_index_mt.get_luac = function(index, key)
     key = keify(key)
     return internal.get(index.space_id, index.id, key)
 end
+-- Returns tuples found by the given keys in the order of keys.
+-- Keys that don't match any tuple are skipped.
+base_index_mt.get_many = function(index, keys)
+    check_index_arg(index, 'get_many')
+    if type(keys) ~= 'table' then
+        box.error(box.error.ILLEGAL_PARAMS,
+                  "Usage: index:get_many({key1, key2, ...})")
+    end
+    local k = {}
+    for i, key in ipairs(keys) do
+        k[i] = keify(key)
+    end
+    return internal.get_many(index.space_id, index.id, k)
+end
 
 local function check_select_opts(opts, key_is_nil)
     local offset = 0
@@ -1635,6 +1669,10 @@ space_mt.get = function(space, key)
     check_space_arg(space, 'get')
     return check_primary_index(space):get(key)
 end
+space_mt.get_many = function(space, keys)
+    check_space_arg(space, 'get_many')
+    return check_primary_index(space):get_many(keys)
+end
 space_mt.select = function(space, key, opts)
     check_space_arg(space, 'select')
     return check_primary_index(space):select(key, opts)
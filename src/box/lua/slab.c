@@ -32,6 +32,7 @@
 
 #include "box/lua/slab.h"
 #include "lua/utils.h"
+#include "lua/error.h"
 
 #include <lua.h>
 #include <lauxlib.h>
@@ -263,6 +264,37 @@ lbox_slab_check(MAYBE_UNUSED struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_slab_defrag(struct lua_State *L)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	if (memtx_engine_defrag(memtx) != 0)
+		return luaT_error(L);
+	return 0;
+}
+
+static int
+lbox_slab_defrag_info(struct lua_State *L)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	lua_newtable(L);
+
+	lua_pushstring(L, "in_progress");
+	lua_pushboolean(L, memtx->defrag_task != NULL);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "tuple_count");
+	luaL_pushint64(L, memtx->defrag_tuple_count);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "tuple_size");
+	luaL_pushint64(L, memtx->defrag_tuple_size);
+	lua_settable(L, -3);
+	return 1;
+}
+
 /** Initialize box.slab package. */
 void
 box_lua_slab_init(struct lua_State *L)
@@ -283,6 +315,14 @@ box_lua_slab_init(struct lua_State *L)
 	lua_pushcfunction(L, lbox_slab_check);
 	lua_settable(L, -3);
 
+	lua_pushstring(L, "defrag");
+	lua_pushcfunction(L, lbox_slab_defrag);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "defrag_info");
+	lua_pushcfunction(L, lbox_slab_defrag_info);
+	lua_settable(L, -3);
+
 	lua_settable(L, -3); /* box.slab */
 
 	lua_pushstring(L, "runtime");
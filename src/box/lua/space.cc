@@ -340,6 +340,15 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 		if (index_def->type == HASH || index_def->type == TREE) {
 			lua_pushboolean(L, index_opts->is_unique);
 			lua_setfield(L, -2, "unique");
+			if (index_opts->inline_key) {
+				lua_pushboolean(L, true);
+				lua_setfield(L, -2, "inline_key");
+			}
+			if (index_opts->hash_table != HASH_INDEX_TABLE_LIGHT) {
+				lua_pushstring(L, hash_index_table_strs[
+					index_opts->hash_table]);
+				lua_setfield(L, -2, "hash_table");
+			}
 		} else if (index_def->type == RTREE) {
 			lua_pushnumber(L, index_opts->dimension);
 			lua_setfield(L, -2, "dimension");
@@ -429,9 +438,34 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 			lua_pushnumber(L, index_opts->run_size_ratio);
 			lua_setfield(L, -2, "run_size_ratio");
 
+			if (index_opts->compaction_strategy !=
+			    VY_COMPACTION_LEVELED) {
+				lua_pushstring(L, vy_compaction_strategy_strs[
+					index_opts->compaction_strategy]);
+				lua_setfield(L, -2, "compaction_strategy");
+			}
+
 			lua_pushnumber(L, index_opts->bloom_fpr);
 			lua_setfield(L, -2, "bloom_fpr");
 
+			if (index_opts->compression != VY_COMPRESSION_ZSTD) {
+				lua_pushstring(L, vy_compression_strs[
+					index_opts->compression]);
+				lua_setfield(L, -2, "compression");
+			}
+
+			if (index_opts->compression_level !=
+			    index_opts_default.compression_level) {
+				lua_pushnumber(L, index_opts->compression_level);
+				lua_setfield(L, -2, "compression_level");
+			}
+
+			if (index_opts->compression_dict_size > 0) {
+				lua_pushnumber(L,
+					index_opts->compression_dict_size);
+				lua_setfield(L, -2, "compression_dict_size");
+			}
+
 			lua_settable(L, -3);
 		}
 		lua_setfield(L, -2, index_def->name);
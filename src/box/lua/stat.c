@@ -42,6 +42,7 @@
 #include "box/iproto.h"
 #include "box/engine.h"
 #include "box/vinyl.h"
+#include "box/wal.h"
 #include "box/sql.h"
 #include "info/info.h"
 #include "lua/info.h"
@@ -49,8 +50,6 @@
 
 extern struct rmean *rmean_box;
 extern struct rmean *rmean_error;
-/** network statistics (iproto & cbus) */
-extern struct rmean *rmean_net;
 extern struct rmean *rmean_tx_wal_bus;
 
 static void
@@ -127,6 +126,15 @@ lbox_stat_vinyl(struct lua_State *L)
 	return 1;
 }
 
+static int
+lbox_stat_wal(struct lua_State *L)
+{
+	struct info_handler h;
+	luaT_info_handler_create(&h, L);
+	wal_stat(&h);
+	return 1;
+}
+
 static int
 lbox_stat_reset(struct lua_State *L)
 {
@@ -148,7 +156,7 @@ static int
 lbox_stat_net_index(struct lua_State *L)
 {
 	const char *key = luaL_checkstring(L, -1);
-	if (rmean_foreach(rmean_net, seek_stat_item, L) == 0)
+	if (iproto_rmean_foreach(seek_stat_item, L) == 0)
 		return 0;
 
 	if (strcmp(key, "CONNECTIONS") == 0) {
@@ -163,6 +171,29 @@ lbox_stat_net_index(struct lua_State *L)
 	return 1;
 }
 
+/**
+ * Set 'current' fields of CONNECTIONS and REQUESTS metrics in
+ * a table of network metrics on top of a Lua stack.
+ */
+static void
+fill_stat_net_current(struct lua_State *L, size_t connections,
+		      size_t requests)
+{
+	lua_pushstring(L, "CONNECTIONS");
+	lua_rawget(L, -2);
+	lua_pushstring(L, "current");
+	lua_pushnumber(L, connections);
+	lua_rawset(L, -3);
+	lua_pop(L, 1);
+
+	lua_pushstring(L, "REQUESTS");
+	lua_rawget(L, -2);
+	lua_pushstring(L, "current");
+	lua_pushnumber(L, requests);
+	lua_rawset(L, -3);
+	lua_pop(L, 1);
+}
+
 /**
  * Push a table of network metrics to a Lua stack.
  *
@@ -183,22 +214,28 @@ static int
 lbox_stat_net_call(struct lua_State *L)
 {
 	lua_newtable(L);
-	rmean_foreach(rmean_net, set_stat_item, L);
-
-	lua_pushstring(L, "CONNECTIONS");
-	lua_rawget(L, -2);
-	lua_pushstring(L, "current");
-	lua_pushnumber(L, iproto_connection_count());
-	lua_rawset(L, -3);
-	lua_pop(L, 1);
-
-	lua_pushstring(L, "REQUESTS");
-	lua_rawget(L, -2);
-	lua_pushstring(L, "current");
-	lua_pushnumber(L, iproto_request_count());
-	lua_rawset(L, -3);
-	lua_pop(L, 1);
+	iproto_rmean_foreach(set_stat_item, L);
+	fill_stat_net_current(L, iproto_connection_count(),
+			      iproto_request_count());
+	return 1;
+}
 
+/**
+ * Push an array of network metrics of each network thread to
+ * a Lua stack. Metrics are the same as in lbox_stat_net_call().
+ */
+static int
+lbox_stat_net_thread(struct lua_State *L)
+{
+	int count = iproto_thread_count();
+	lua_createtable(L, count, 0);
+	for (int i = 0; i < count; i++) {
+		lua_newtable(L);
+		iproto_thread_rmean_foreach(i, set_stat_item, L);
+		fill_stat_net_current(L, iproto_thread_connection_count(i),
+				      iproto_thread_request_count(i));
+		lua_rawseti(L, -2, i + 1);
+	}
 	return 1;
 }
 
@@ -229,6 +266,7 @@ box_lua_stat_init(struct lua_State *L)
 {
 	static const struct luaL_Reg statlib [] = {
 		{"vinyl", lbox_stat_vinyl},
+		{"wal", lbox_stat_wal},
 		{"reset", lbox_stat_reset},
 		{"sql", lbox_stat_sql},
 		{NULL, NULL}
@@ -242,6 +280,7 @@ box_lua_stat_init(struct lua_State *L)
 	lua_pop(L, 1); /* stat module */
 
 	static const struct luaL_Reg netstatlib [] = {
+		{"thread", lbox_stat_net_thread},
 		{NULL, NULL}
 	};
 
@@ -508,6 +508,9 @@ void
 luaT_pushtuple(struct lua_State *L, box_tuple_t *tuple)
 {
 	assert(CTID_STRUCT_TUPLE_REF != 0);
+	tuple = tuple_decompress(tuple);
+	if (tuple == NULL)
+		luaT_error(L);
 	struct tuple **ptr = (struct tuple **)
 		luaL_pushcdata(L, CTID_STRUCT_TUPLE_REF);
 	*ptr = tuple;
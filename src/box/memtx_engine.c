@@ -34,21 +34,29 @@
 #include <small/quota.h>
 #include <small/small.h>
 #include <small/mempool.h>
+#include <small/ibuf.h>
+#include <unistd.h>
 
 #include "fiber.h"
 #include "errinj.h"
 #include "coio_file.h"
+#include "coio_task.h"
 #include "tuple.h"
+#include "tuple_compression.h"
 #include "txn.h"
 #include "memtx_tree.h"
+#include "memtx_tx.h"
 #include "iproto_constants.h"
 #include "xrow.h"
 #include "xstream.h"
+#include "xlog_reader.h"
 #include "bootstrap.h"
 #include "replication.h"
 #include "schema.h"
 #include "gc.h"
 
+#include <pmatomic.h>
+
 /* sync snapshot every 16MB */
 #define SNAP_SYNC_INTERVAL	(1 << 24)
 
@@ -89,17 +97,169 @@ memtx_end_build_primary_key(struct space *space, void *param)
 	return 0;
 }
 
+/**
+ * State of a bulk build of secondary keys. Secondary keys of all
+ * spaces are built at once: first the tx thread fills all of
+ * them from the primary keys, then build arrays of tree indexes
+ * are sorted, and finally the tx thread bulk-loads the trees.
+ *
+ * Build arrays big enough for qsort_arg() to sort them in
+ * several threads are sorted one by one that way. The rest are
+ * distributed among a pool of threads, each of which sorts its
+ * arrays single-threaded, so that the two kinds of parallelism
+ * never oversubscribe CPUs.
+ */
+struct memtx_build {
+	/** Memtx engine. */
+	struct memtx_engine *memtx;
+	/** Secondary keys to build. */
+	struct index **indexes;
+	/** Number of entries in the indexes array. */
+	uint32_t index_count;
+	/** Number of entries allocated for the indexes array. */
+	uint32_t index_count_max;
+	/**
+	 * Position in the indexes array of the next index to
+	 * sort. Incremented atomically by sort threads.
+	 */
+	uint32_t next_index;
+};
+
+static void
+memtx_build_create(struct memtx_build *build, struct memtx_engine *memtx)
+{
+	build->memtx = memtx;
+	build->indexes = NULL;
+	build->index_count = 0;
+	build->index_count_max = 0;
+	build->next_index = 0;
+}
+
+static void
+memtx_build_destroy(struct memtx_build *build)
+{
+	free(build->indexes);
+}
+
+static int
+memtx_build_add_index(struct memtx_build *build, struct index *index)
+{
+	if (build->index_count == build->index_count_max) {
+		uint32_t count_max = MAX(build->index_count_max * 2, 16U);
+		struct index **indexes = realloc(build->indexes,
+						 count_max * sizeof(*indexes));
+		if (indexes == NULL) {
+			diag_set(OutOfMemory, count_max * sizeof(*indexes),
+				 "realloc", "memtx_build");
+			return -1;
+		}
+		build->indexes = indexes;
+		build->index_count_max = count_max;
+	}
+	build->indexes[build->index_count++] = index;
+	return 0;
+}
+
+/**
+ * Return true if the build array of the index should be sorted
+ * by the multithreaded qsort_arg() rather than by a sort thread.
+ */
+static bool
+memtx_build_sort_is_mt(struct index *index)
+{
+	return memtx_tree_index_build_array_is_big(index);
+}
+
+/**
+ * Sort build arrays of small tree indexes until there's no more
+ * indexes left to sort. Runs in a sort thread as well as in
+ * the tx thread.
+ */
+static void
+memtx_build_sort(struct memtx_build *build)
+{
+	while (true) {
+		uint32_t i = pm_atomic_fetch_add(&build->next_index, 1);
+		if (i >= build->index_count)
+			break;
+		struct index *index = build->indexes[i];
+		if (index->def->type == TREE && !memtx_build_sort_is_mt(index))
+			memtx_tree_index_sort_build_array(index, false);
+	}
+}
+
+static void *
+memtx_build_sort_f(void *arg)
+{
+	memtx_build_sort((struct memtx_build *)arg);
+	return NULL;
+}
+
+/**
+ * Sort build arrays of all secondary keys. Small arrays are
+ * sorted by the given number of threads, the tx thread included,
+ * then big arrays are sorted one by one by the multithreaded
+ * qsort_arg(). We don't yield while the sort threads are running,
+ * because secondary keys must not be accessed until they are
+ * built.
+ */
+static void
+memtx_build_sort_parallel(struct memtx_build *build, int thread_count)
+{
+	int small_count = 0;
+	for (uint32_t i = 0; i < build->index_count; i++) {
+		struct index *index = build->indexes[i];
+		if (index->def->type == TREE && !memtx_build_sort_is_mt(index))
+			small_count++;
+	}
+	thread_count = MIN(thread_count, small_count);
+	struct cord *cords = NULL;
+	int cord_count = 0;
+	if (thread_count > 1) {
+		cords = calloc(thread_count - 1, sizeof(*cords));
+		if (cords == NULL)
+			say_warn("failed to allocate sort threads");
+	}
+	for (int i = 0; cords != NULL && i < thread_count - 1; i++) {
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "memtx.sort.%d", i);
+		if (cord_start(&cords[i], name, memtx_build_sort_f,
+			       build) != 0) {
+			/* Sort with as many threads as we could start. */
+			diag_log();
+			break;
+		}
+		cord_count++;
+	}
+	if (cord_count > 0) {
+		say_info("Sorting secondary keys using %d threads...",
+			 cord_count + 1);
+	}
+	memtx_build_sort(build);
+	for (int i = 0; i < cord_count; i++)
+		cord_join(&cords[i]);
+	free(cords);
+
+	for (uint32_t i = 0; i < build->index_count; i++) {
+		struct index *index = build->indexes[i];
+		if (index->def->type == TREE && memtx_build_sort_is_mt(index))
+			memtx_tree_index_sort_build_array(index, true);
+	}
+}
+
 /**
  * Secondary indexes are built in bulk after all data is
- * recovered. This function enables secondary keys on a space.
- * Data dictionary spaces are an exception, they are fully
- * built right from the start.
+ * recovered. This function fills secondary keys of a space and
+ * adds them to the bulk build. Data dictionary spaces are an
+ * exception, they are fully built right from the start.
  */
 static int
 memtx_build_secondary_keys(struct space *space, void *param)
 {
+	struct memtx_build *build = (struct memtx_build *)param;
 	struct memtx_space *memtx_space = (struct memtx_space *)space;
-	if (space->engine != param || space_index(space, 0) == NULL ||
+	if (space->engine != (struct engine *)build->memtx ||
+	    space_index(space, 0) == NULL ||
 	    memtx_space->replace == memtx_space_replace_all_keys)
 		return 0;
 
@@ -114,11 +274,31 @@ memtx_build_secondary_keys(struct space *space, void *param)
 		}
 
 		for (uint32_t j = 1; j < space->index_count; j++) {
-			if (index_build(space->index[j], pk) < 0)
+			if (index_build_fill(space->index[j], pk) < 0)
+				return -1;
+			if (memtx_build_add_index(build, space->index[j]) != 0)
 				return -1;
 		}
+	}
+	return 0;
+}
 
-		if (n_tuples > 0) {
+/**
+ * Finish the bulk build of secondary keys of a space started
+ * by memtx_build_secondary_keys() and enable them.
+ */
+static int
+memtx_end_build_secondary_keys(struct space *space, void *param)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	if (space->engine != param || space_index(space, 0) == NULL ||
+	    memtx_space->replace == memtx_space_replace_all_keys)
+		return 0;
+
+	if (space->index_id_max > 0) {
+		for (uint32_t j = 1; j < space->index_count; j++)
+			index_end_build(space->index[j]);
+		if (index_size(space->index[0]) > 0) {
 			say_info("Space '%s': done", space_name(space));
 		}
 	}
@@ -126,6 +306,25 @@ memtx_build_secondary_keys(struct space *space, void *param)
 	return 0;
 }
 
+/**
+ * Build secondary keys of all memtx spaces. Build arrays of
+ * tree indexes are sorted in parallel by memtx->sort_threads
+ * threads.
+ */
+static int
+memtx_engine_build_secondary_keys(struct memtx_engine *memtx)
+{
+	struct memtx_build build;
+	memtx_build_create(&build, memtx);
+	if (space_foreach(memtx_build_secondary_keys, &build) != 0) {
+		memtx_build_destroy(&build);
+		return -1;
+	}
+	memtx_build_sort_parallel(&build, memtx->sort_threads);
+	memtx_build_destroy(&build);
+	return space_foreach(memtx_end_build_secondary_keys, memtx);
+}
+
 static void
 memtx_engine_shutdown(struct engine *engine)
 {
@@ -134,6 +333,9 @@ memtx_engine_shutdown(struct engine *engine)
 		checkpoint_cancel(memtx->checkpoint);
 	if (memtx->replica_join_cord != NULL)
 		replica_join_cancel(memtx->replica_join_cord);
+	if (memtx->defrag_task != NULL)
+		memtx->defrag_task->vtab->free(memtx->defrag_task);
+	memtx_tx_manager_free();
 	mempool_destroy(&memtx->iterator_pool);
 	if (mempool_is_initialized(&memtx->rtree_iterator_pool))
 		mempool_destroy(&memtx->rtree_iterator_pool);
@@ -161,17 +363,23 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 						    signature, NONE);
 
 	say_info("recovering from `%s'", filename);
-	struct xlog_cursor cursor;
-	if (xlog_cursor_open(&cursor, filename) < 0)
+	/*
+	 * Rows are read by a separate thread and decompressed
+	 * in parallel in the worker pool, as many blocks at once
+	 * as are compressed when a snapshot is written, while tx
+	 * is busy applying them.
+	 */
+	struct xlog_reader reader;
+	if (xlog_reader_open(&reader, filename, memtx->force_recovery,
+			     memtx->snap_compress_threads) < 0)
 		return -1;
 
 	int rc;
-	struct xrow_header row;
+	struct xrow_header *row;
 	uint64_t row_count = 0;
-	while ((rc = xlog_cursor_next(&cursor, &row,
-				      memtx->force_recovery)) == 0) {
-		row.lsn = signature;
-		rc = memtx_engine_recover_snapshot_row(memtx, &row);
+	while ((rc = xlog_reader_next(&reader, &row)) == 0) {
+		row->lsn = signature;
+		rc = memtx_engine_recover_snapshot_row(memtx, row);
 		if (rc < 0) {
 			if (!memtx->force_recovery)
 				break;
@@ -185,7 +393,7 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 			fiber_yield_timeout(0);
 		}
 	}
-	xlog_cursor_close(&cursor, false);
+	xlog_reader_close(&reader);
 	if (rc < 0)
 		return -1;
 
@@ -194,7 +402,7 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 	 * marker - such snapshots are very likely corrupted and
 	 * should not be trusted.
 	 */
-	if (!xlog_cursor_is_eof(&cursor))
+	if (!xlog_reader_is_eof(&reader))
 		panic("snapshot `%s' has no EOF marker", filename);
 
 	return 0;
@@ -271,6 +479,33 @@ memtx_engine_begin_initial_recovery(struct engine *engine,
 	return 0;
 }
 
+/**
+ * Check if tuple defragmentation can't proceed right now.
+ *
+ * Tuples referenced by a read view (checkpoint, replica join)
+ * or by a transaction in progress can't be moved. Note, a
+ * transaction that hasn't been written to WAL yet references
+ * its new tuples from statements without taking a reference.
+ * DDL building a new index is a transaction in progress too.
+ */
+static inline bool
+memtx_defrag_is_blocked(struct memtx_engine *memtx)
+{
+	return memtx->state != MEMTX_OK || memtx->delayed_free_mode > 0 ||
+	       memtx->txn_count > 0;
+}
+
+/**
+ * Wake up the garbage collection fiber if it's waiting for
+ * tuple defragmentation to be unblocked.
+ */
+static inline void
+memtx_defrag_wakeup(struct memtx_engine *memtx)
+{
+	if (memtx->defrag_is_waiting && !memtx_defrag_is_blocked(memtx))
+		fiber_wakeup(memtx->gc_fiber);
+}
+
 static int
 memtx_engine_begin_final_recovery(struct engine *engine)
 {
@@ -298,7 +533,7 @@ memtx_engine_begin_final_recovery(struct engine *engine)
 		 * unique keys.
 		 */
 		memtx->state = MEMTX_OK;
-		if (space_foreach(memtx_build_secondary_keys, memtx) != 0)
+		if (memtx_engine_build_secondary_keys(memtx) != 0)
 			return -1;
 	}
 	return 0;
@@ -317,9 +552,10 @@ memtx_engine_end_recovery(struct engine *engine)
 	if (memtx->state != MEMTX_OK) {
 		assert(memtx->state == MEMTX_FINAL_RECOVERY);
 		memtx->state = MEMTX_OK;
-		if (space_foreach(memtx_build_secondary_keys, memtx) != 0)
+		if (memtx_engine_build_secondary_keys(memtx) != 0)
 			return -1;
 	}
+	memtx_defrag_wakeup(memtx);
 	return 0;
 }
 
@@ -334,17 +570,62 @@ memtx_engine_create_space(struct engine *engine, struct space_def *def,
 static int
 memtx_engine_begin(struct engine *engine, struct txn *txn)
 {
-	(void)engine;
-	txn_can_yield(txn, false);
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	memtx->txn_count++;
+	/*
+	 * Without the transaction manager, changes are visible
+	 * to other transactions immediately, so a transaction
+	 * must not yield.
+	 */
+	if (!memtx_tx_manager_use_mvcc_engine)
+		txn_can_yield(txn, false);
 	return 0;
 }
 
+static int
+memtx_engine_begin_statement(struct engine *engine, struct txn *txn)
+{
+	(void)engine;
+	if (!memtx_tx_manager_use_mvcc_engine)
+		return 0;
+	struct txn_stmt *stmt = txn_current_stmt(txn);
+	return memtx_tx_begin_statement(txn, stmt->space);
+}
+
+static int
+memtx_engine_prepare(struct engine *engine, struct txn *txn)
+{
+	(void)engine;
+	if (!memtx_tx_manager_use_mvcc_engine)
+		return 0;
+	return memtx_tx_prepare(txn);
+}
+
+static void
+memtx_engine_commit(struct engine *engine, struct txn *txn)
+{
+	(void)txn;
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	assert(memtx->txn_count > 0);
+	memtx->txn_count--;
+	memtx_defrag_wakeup(memtx);
+}
+
+static void
+memtx_engine_rollback(struct engine *engine, struct txn *txn)
+{
+	(void)txn;
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	assert(memtx->txn_count > 0);
+	memtx->txn_count--;
+	memtx_defrag_wakeup(memtx);
+}
+
 static void
 memtx_engine_rollback_statement(struct engine *engine, struct txn *txn,
 				struct txn_stmt *stmt)
 {
 	(void)engine;
-	(void)txn;
 	if (stmt->old_tuple == NULL && stmt->new_tuple == NULL)
 		return;
 	struct space *space = stmt->space;
@@ -355,6 +636,17 @@ memtx_engine_rollback_statement(struct engine *engine, struct txn *txn,
 	if (stmt->engine_savepoint == NULL)
 		return;
 
+	if (memtx_tx_manager_use_mvcc_engine) {
+		if (memtx_tx_history_rollback_stmt(stmt))
+			return;
+		/*
+		 * The change has been applied in place, possibly
+		 * overwritten by in-progress transactions since.
+		 * Abort them to restore the old tuple safely.
+		 */
+		memtx_tx_abort_all_for_ddl(txn);
+	}
+
 	if (memtx_space->replace == memtx_space_replace_all_keys)
 		index_count = space->index_count;
 	else if (memtx_space->replace == memtx_space_replace_primary_key)
@@ -407,16 +699,230 @@ memtx_engine_bootstrap(struct engine *engine)
 	return rc < 0 ? -1 : 0;
 }
 
+/**
+ * Snapshot rows are accumulated in blocks of about this size.
+ * Each block is compressed in the worker thread pool and then
+ * written to the snapshot file as a separate xlog tx.
+ */
+#define CHECKPOINT_BLOCK_SIZE	(128 * 1024)
+
+/** A block of rows written to a snapshot as a single xlog tx. */
+struct checkpoint_block {
+	/** Encoded rows. */
+	struct ibuf rows;
+	/** Number of rows in the block. */
+	int64_t row_count;
+	/** The block encoded with xlog_tx_encode(). */
+	struct ibuf data;
+	/** Size of the encoded block or -1 on error. */
+	ssize_t data_size;
+	/** Compression context, NULL if compression is off. */
+	ZSTD_CCtx *zctx;
+	/** Set while the block is being compressed. */
+	bool in_progress;
+	/** Compression error, if any. */
+	struct diag diag;
+};
+
+/**
+ * Snapshot writer. Rows are encoded in the snapshot thread,
+ * while up to block_count - 1 filled blocks are compressed
+ * in parallel in the worker thread pool. Blocks are written
+ * to the file strictly in order, by the snapshot thread, so
+ * the rate limit applies to the file as a whole.
+ */
+struct checkpoint_writer {
+	/** Snapshot file. */
+	struct xlog *snap;
+	/** Ring of blocks. */
+	struct checkpoint_block *blocks;
+	/** Size of the ring. */
+	int block_count;
+	/** The oldest block that hasn't been written yet. */
+	int head;
+	/**
+	 * Number of blocks in use, counting from the head.
+	 * The last one is being filled with rows.
+	 */
+	int used;
+	/** Number of rows in the snapshot. */
+	int64_t row_count;
+	/** Timestamp of all snapshot rows. */
+	double tm;
+	/** Signaled when a block compression completes. */
+	struct fiber_cond cond;
+};
+
+static int
+checkpoint_writer_create(struct checkpoint_writer *writer,
+			 struct xlog *snap, int compress_threads)
+{
+	writer->snap = snap;
+	writer->head = 0;
+	writer->used = 1;
+	writer->row_count = 0;
+	ev_now_update(loop());
+	writer->tm = ev_now(loop());
+	fiber_cond_create(&writer->cond);
+	writer->block_count = compress_threads + 1;
+	writer->blocks = calloc(writer->block_count,
+				sizeof(*writer->blocks));
+	if (writer->blocks == NULL) {
+		diag_set(OutOfMemory,
+			 writer->block_count * sizeof(*writer->blocks),
+			 "calloc", "checkpoint blocks");
+		return -1;
+	}
+	for (int i = 0; i < writer->block_count; i++) {
+		struct checkpoint_block *block = &writer->blocks[i];
+		ibuf_create(&block->rows, &cord()->slabc,
+			    CHECKPOINT_BLOCK_SIZE);
+		ibuf_create(&block->data, &cord()->slabc,
+			    CHECKPOINT_BLOCK_SIZE);
+		diag_create(&block->diag);
+	}
+	if (snap->opts.no_compression)
+		return 0;
+	for (int i = 0; i < writer->block_count; i++) {
+		struct checkpoint_block *block = &writer->blocks[i];
+		block->zctx = ZSTD_createCCtx();
+		if (block->zctx == NULL) {
+			diag_set(ClientError, ER_COMPRESSION,
+				 "failed to create context");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void
+checkpoint_writer_destroy(struct checkpoint_writer *writer)
+{
+	for (int i = 0; writer->blocks != NULL &&
+			i < writer->block_count; i++) {
+		struct checkpoint_block *block = &writer->blocks[i];
+		/* The worker thread may still be using the block. */
+		while (block->in_progress)
+			fiber_cond_wait(&writer->cond);
+		ibuf_destroy(&block->rows);
+		ibuf_destroy(&block->data);
+		diag_destroy(&block->diag);
+		ZSTD_freeCCtx(block->zctx);
+	}
+	free(writer->blocks);
+	fiber_cond_destroy(&writer->cond);
+}
+
+static ssize_t
+checkpoint_block_encode(struct checkpoint_block *block)
+{
+	block->data_size = xlog_tx_encode(block->zctx, block->rows.rpos,
+					  ibuf_used(&block->rows),
+					  block->data.wpos);
+	return block->data_size < 0 ? -1 : 0;
+}
+
+static ssize_t
+checkpoint_block_encode_cb(va_list ap)
+{
+	struct checkpoint_block *block = va_arg(ap, struct checkpoint_block *);
+	return checkpoint_block_encode(block);
+}
+
+static int
+checkpoint_block_compress_f(va_list ap)
+{
+	struct checkpoint_writer *writer =
+		va_arg(ap, struct checkpoint_writer *);
+	struct checkpoint_block *block = va_arg(ap, struct checkpoint_block *);
+	if (coio_call(checkpoint_block_encode_cb, block) != 0) {
+		block->data_size = -1;
+		diag_move(diag_get(), &block->diag);
+	}
+	block->in_progress = false;
+	fiber_cond_broadcast(&writer->cond);
+	return 0;
+}
+
+/** Wait for the head block to be compressed and write it. */
+static int
+checkpoint_writer_write_head(struct checkpoint_writer *writer)
+{
+	assert(writer->used > 0);
+	struct checkpoint_block *block = &writer->blocks[writer->head];
+	while (block->in_progress)
+		fiber_cond_wait(&writer->cond);
+	if (block->data_size < 0) {
+		diag_move(&block->diag, diag_get());
+		return -1;
+	}
+	if (xlog_write_tx(writer->snap, block->data.rpos, block->data_size,
+			  block->row_count) < 0)
+		return -1;
+	ibuf_reset(&block->rows);
+	ibuf_reset(&block->data);
+	block->row_count = 0;
+	writer->head = (writer->head + 1) % writer->block_count;
+	writer->used--;
+	return 0;
+}
+
+/**
+ * Send the block being filled to compression and switch
+ * to the next one, writing the oldest block to the file
+ * if there are no free blocks left.
+ */
 static int
-checkpoint_write_row(struct xlog *l, struct xrow_header *row)
+checkpoint_writer_submit(struct checkpoint_writer *writer)
 {
-	static ev_tstamp last = 0;
-	if (last == 0) {
-		ev_now_update(loop());
-		last = ev_now(loop());
+	int pos = (writer->head + writer->used - 1) % writer->block_count;
+	struct checkpoint_block *block = &writer->blocks[pos];
+	size_t size = ibuf_used(&block->rows);
+	if (size == 0)
+		return 0;
+	size_t data_size = xlog_tx_encode_size_max(size);
+	if (ibuf_reserve(&block->data, data_size) == NULL) {
+		diag_set(OutOfMemory, data_size, "runtime arena",
+			 "checkpoint block");
+		return -1;
+	}
+	if (writer->block_count == 1) {
+		/* No compression threads, encode in place. */
+		if (checkpoint_block_encode(block) != 0)
+			return -1;
+	} else {
+		struct fiber *f = fiber_new("snapshot.compress",
+					    checkpoint_block_compress_f);
+		if (f == NULL)
+			return -1;
+		block->in_progress = true;
+		fiber_start(f, writer, block);
 	}
+	if (writer->used == writer->block_count &&
+	    checkpoint_writer_write_head(writer) != 0)
+		return -1;
+	writer->used++;
+	return 0;
+}
 
-	row->tm = last;
+/** Write all pending blocks to the file. */
+static int
+checkpoint_writer_flush(struct checkpoint_writer *writer)
+{
+	if (checkpoint_writer_submit(writer) != 0)
+		return -1;
+	while (writer->used > 1) {
+		if (checkpoint_writer_write_head(writer) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int
+checkpoint_write_row(struct checkpoint_writer *writer,
+		     struct xrow_header *row)
+{
+	row->tm = writer->tm;
 	row->replica_id = 0;
 	/**
 	 * Rows in snapshot are numbered from 1 to %rows.
@@ -425,23 +931,41 @@ checkpoint_write_row(struct xlog *l, struct xrow_header *row)
 	 * WAL. @sa the place which skips old rows in
 	 * recovery_apply_row().
 	 */
-	row->lsn = l->rows + l->tx_rows;
+	row->lsn = writer->row_count;
 	row->sync = 0; /* don't write sync to wal */
 
-	ssize_t written = xlog_write_row(l, row);
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_header_encode(row, 0, iov, 0);
+	if (iovcnt < 0)
+		goto fail;
+	int pos = (writer->head + writer->used - 1) % writer->block_count;
+	struct checkpoint_block *block = &writer->blocks[pos];
+	for (int i = 0; i < iovcnt; i++) {
+		char *buf = ibuf_alloc(&block->rows, iov[i].iov_len);
+		if (buf == NULL) {
+			diag_set(OutOfMemory, iov[i].iov_len,
+				 "runtime arena", "checkpoint block");
+			goto fail;
+		}
+		memcpy(buf, iov[i].iov_base, iov[i].iov_len);
+	}
 	fiber_gc();
-	if (written < 0)
-		return -1;
+	block->row_count++;
+	writer->row_count++;
 
-	if ((l->rows + l->tx_rows) % 100000 == 0)
-		say_crit("%.1fM rows written", (l->rows + l->tx_rows) / 1000000.0);
+	if (writer->row_count % 100000 == 0)
+		say_crit("%.1fM rows written", writer->row_count / 1000000.0);
+	if (ibuf_used(&block->rows) >= CHECKPOINT_BLOCK_SIZE)
+		return checkpoint_writer_submit(writer);
 	return 0;
-
+fail:
+	fiber_gc();
+	return -1;
 }
 
 static int
-checkpoint_write_tuple(struct xlog *l, uint32_t space_id, uint32_t group_id,
-		       const char *data, uint32_t size)
+checkpoint_write_tuple(struct checkpoint_writer *writer, uint32_t space_id,
+		       uint32_t group_id, const char *data, uint32_t size)
 {
 	struct request_replace_body body;
 	request_replace_body_create(&body, space_id);
@@ -456,7 +980,7 @@ checkpoint_write_tuple(struct xlog *l, uint32_t space_id, uint32_t group_id,
 	row.body[0].iov_len = sizeof(body);
 	row.body[1].iov_base = (char *)data;
 	row.body[1].iov_len = size;
-	return checkpoint_write_row(l, &row);
+	return checkpoint_write_row(writer, &row);
 }
 
 struct checkpoint_entry {
@@ -482,10 +1006,16 @@ struct checkpoint {
 	 * checkpoint already exists.
 	 */
 	bool touch;
+	/**
+	 * Number of snapshot blocks compressed in parallel,
+	 * box.cfg.snap_compress_threads.
+	 */
+	int compress_threads;
 };
 
 static struct checkpoint *
-checkpoint_new(const char *snap_dirname, uint64_t snap_io_rate_limit)
+checkpoint_new(const char *snap_dirname, uint64_t snap_io_rate_limit,
+	       int compress_threads)
 {
 	struct checkpoint *ckpt = malloc(sizeof(*ckpt));
 	if (ckpt == NULL) {
@@ -502,6 +1032,7 @@ checkpoint_new(const char *snap_dirname, uint64_t snap_io_rate_limit)
 	xdir_create(&ckpt->dir, snap_dirname, SNAP, &INSTANCE_UUID, &opts);
 	vclock_create(&ckpt->vclock);
 	ckpt->touch = false;
+	ckpt->compress_threads = compress_threads;
 	return ckpt;
 }
 
@@ -593,6 +1124,12 @@ checkpoint_f(va_list ap)
 
 	say_info("saving snapshot `%s'", snap.filename);
 	ERROR_INJECT_SLEEP(ERRINJ_SNAP_WRITE_DELAY);
+	/* Blocks are compressed in the worker thread pool. */
+	coio_enable();
+	struct checkpoint_writer writer;
+	if (checkpoint_writer_create(&writer, &snap,
+				     ckpt->compress_threads) != 0)
+		goto fail;
 	struct checkpoint_entry *entry;
 	rlist_foreach_entry(entry, &ckpt->entries, link) {
 		int rc;
@@ -600,20 +1137,22 @@ checkpoint_f(va_list ap)
 		const char *data;
 		struct snapshot_iterator *it = entry->iterator;
 		while ((rc = it->next(it, &data, &size)) == 0 && data != NULL) {
-			if (checkpoint_write_tuple(&snap, entry->space_id,
+			if (checkpoint_write_tuple(&writer, entry->space_id,
 					entry->group_id, data, size) != 0)
 				goto fail;
 		}
 		if (rc != 0)
 			goto fail;
 	}
-	if (xlog_flush(&snap) < 0)
+	if (checkpoint_writer_flush(&writer) != 0)
 		goto fail;
 
+	checkpoint_writer_destroy(&writer);
 	xlog_close(&snap, false);
 	say_info("done");
 	return 0;
 fail:
+	checkpoint_writer_destroy(&writer);
 	xlog_close(&snap, false);
 	return -1;
 }
@@ -626,7 +1165,8 @@ memtx_engine_begin_checkpoint(struct engine *engine, bool is_scheduled)
 
 	assert(memtx->checkpoint == NULL);
 	memtx->checkpoint = checkpoint_new(memtx->snap_dir.dirname,
-					   memtx->snap_io_rate_limit);
+					   memtx->snap_io_rate_limit,
+					   memtx->snap_compress_threads);
 	if (memtx->checkpoint == NULL)
 		return -1;
 
@@ -913,11 +1453,11 @@ static const struct engine_vtab memtx_engine_vtab = {
 	/* .join = */ memtx_engine_join,
 	/* .complete_join = */ memtx_engine_complete_join,
 	/* .begin = */ memtx_engine_begin,
-	/* .begin_statement = */ generic_engine_begin_statement,
-	/* .prepare = */ generic_engine_prepare,
-	/* .commit = */ generic_engine_commit,
+	/* .begin_statement = */ memtx_engine_begin_statement,
+	/* .prepare = */ memtx_engine_prepare,
+	/* .commit = */ memtx_engine_commit,
 	/* .rollback_statement = */ memtx_engine_rollback_statement,
-	/* .rollback = */ generic_engine_rollback,
+	/* .rollback = */ memtx_engine_rollback,
 	/* .switch_to_ro = */ generic_engine_switch_to_ro,
 	/* .bootstrap = */ memtx_engine_bootstrap,
 	/* .begin_initial_recovery = */ memtx_engine_begin_initial_recovery,
@@ -955,6 +1495,414 @@ memtx_engine_run_gc(struct memtx_engine *memtx, bool *stop)
 	}
 }
 
+/**
+ * Number of tuples checked by one iteration of defragmentation.
+ * The garbage collection fiber sleeps for MEMTX_DEFRAG_DELAY
+ * seconds after each iteration so as not to affect request
+ * latency.
+ */
+enum { MEMTX_DEFRAG_BATCH_SIZE = 128 };
+
+#define MEMTX_DEFRAG_DELAY	0.001
+
+/** Size class of the tuple allocator. */
+struct memtx_defrag_pool {
+	/** Size of objects allocated from the mempool. */
+	uint32_t objsize;
+	/**
+	 * Set if free chunks of the mempool amount to at least
+	 * one slab, i.e. if moving tuples may free a slab.
+	 */
+	bool is_sparse;
+};
+
+struct memtx_defrag_task {
+	struct memtx_gc_task base;
+	struct memtx_engine *memtx;
+	/**
+	 * ID of the space being defragmented. If the space is
+	 * dropped, defragmentation proceeds to the space with
+	 * the next greater ID.
+	 */
+	uint32_t space_id;
+	/**
+	 * Primary key of the last checked tuple of the space,
+	 * allocated with malloc(). Zero length means that the
+	 * space scan hasn't started yet.
+	 */
+	char *key;
+	uint32_t key_len;
+	uint32_t key_capacity;
+	/** Size classes of the tuple allocator, sorted by size. */
+	struct memtx_defrag_pool *pools;
+	int pool_count;
+	int pool_capacity;
+};
+
+/**
+ * Move a tuple to a newly allocated chunk unless the chunk is
+ * located at a higher address than the tuple. The new tuple
+ * has zero reference count. Return NULL if the tuple wasn't
+ * moved.
+ */
+static struct tuple *
+memtx_tuple_move(struct memtx_engine *memtx, struct tuple *tuple)
+{
+	struct memtx_tuple *old_tuple =
+		container_of(tuple, struct memtx_tuple, base);
+	size_t total = tuple_size(tuple) + offsetof(struct memtx_tuple, base);
+	struct memtx_tuple *new_tuple = smalloc(&memtx->alloc, total);
+	if (new_tuple == NULL)
+		return NULL;
+	if ((uintptr_t)new_tuple > (uintptr_t)old_tuple) {
+		smfree(&memtx->alloc, new_tuple, total);
+		return NULL;
+	}
+	/* Copy the snapshot version, header, field map and data. */
+	memcpy(new_tuple, old_tuple, total);
+	new_tuple->base.refs = 0;
+	tuple_format_ref(tuple_format(tuple));
+	return &new_tuple->base;
+}
+
+static int
+memtx_defrag_add_pool(const struct mempool_stats *stats, void *arg)
+{
+	struct memtx_defrag_task *task = arg;
+	if (task->pool_count == task->pool_capacity) {
+		int capacity = MAX(task->pool_capacity * 2, 64);
+		struct memtx_defrag_pool *pools = realloc(task->pools,
+					capacity * sizeof(*pools));
+		if (pools == NULL) {
+			diag_set(OutOfMemory, capacity * sizeof(*pools),
+				 "realloc", "struct memtx_defrag_pool");
+			return -1;
+		}
+		task->pools = pools;
+		task->pool_capacity = capacity;
+	}
+	struct memtx_defrag_pool *pool = &task->pools[task->pool_count++];
+	pool->objsize = stats->objsize;
+	pool->is_sparse = stats->slabcount > 1 &&
+		stats->totals.total - stats->totals.used >= stats->slabsize;
+	return 0;
+}
+
+static int
+memtx_defrag_pool_cmp(const void *a, const void *b)
+{
+	const struct memtx_defrag_pool *pool_a = a;
+	const struct memtx_defrag_pool *pool_b = b;
+	if (pool_a->objsize != pool_b->objsize)
+		return pool_a->objsize < pool_b->objsize ? -1 : 1;
+	return 0;
+}
+
+/** Refresh the size classes of the tuple allocator. */
+static int
+memtx_defrag_update_pools(struct memtx_defrag_task *task)
+{
+	struct small_stats totals;
+	task->pool_count = 0;
+	if (small_stats(&task->memtx->alloc, &totals,
+			memtx_defrag_add_pool, task) != 0)
+		return -1;
+	qsort(task->pools, task->pool_count, sizeof(*task->pools),
+	      memtx_defrag_pool_cmp);
+	return 0;
+}
+
+/**
+ * Check if a tuple of the given size is allocated from a
+ * sparsely used mempool. Tuples that are too big for any
+ * mempool are never moved.
+ */
+static bool
+memtx_defrag_size_is_sparse(struct memtx_defrag_task *task, size_t size)
+{
+	int begin = 0, end = task->pool_count;
+	while (begin != end) {
+		int mid = begin + (end - begin) / 2;
+		if (task->pools[mid].objsize < size)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return begin < task->pool_count && task->pools[begin].is_sparse;
+}
+
+/**
+ * Check if tuples of a space can be moved. We don't touch
+ * system spaces, because their tuples may be referenced by
+ * the schema cache, spaces that aren't fully built yet, and
+ * spaces with functional indexes, because functional keys are
+ * allocated separately and linked to the tuple address.
+ */
+static bool
+memtx_defrag_space_is_suitable(struct memtx_engine *memtx,
+			       struct space *space)
+{
+	if (space->engine != &memtx->base || space_is_system(space))
+		return false;
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	if (memtx_space->replace != memtx_space_replace_all_keys)
+		return false;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		if (space->index[i]->def->key_def->for_func_index)
+			return false;
+	}
+	return true;
+}
+
+struct memtx_defrag_find_space_arg {
+	struct memtx_engine *memtx;
+	/** Min space ID to look for. */
+	uint32_t min_id;
+	/** Suitable space with the smallest ID >= min_id. */
+	struct space *space;
+};
+
+static int
+memtx_defrag_find_space_cb(struct space *space, void *arg)
+{
+	struct memtx_defrag_find_space_arg *find = arg;
+	uint32_t id = space_id(space);
+	if (id < find->min_id ||
+	    (find->space != NULL && id > space_id(find->space)) ||
+	    !memtx_defrag_space_is_suitable(find->memtx, space))
+		return 0;
+	find->space = space;
+	return 0;
+}
+
+/**
+ * Find the space to defragment: either the one the task
+ * is working on or the next suitable space in ID order.
+ * Returns NULL if all spaces have been processed.
+ */
+static struct space *
+memtx_defrag_find_space(struct memtx_defrag_task *task)
+{
+	struct memtx_engine *memtx = task->memtx;
+	struct space *space = space_by_id(task->space_id);
+	if (space != NULL && memtx_defrag_space_is_suitable(memtx, space))
+		return space;
+	struct memtx_defrag_find_space_arg find;
+	find.memtx = memtx;
+	find.min_id = task->space_id;
+	find.space = NULL;
+	space_foreach(memtx_defrag_find_space_cb, &find);
+	if (find.space != NULL) {
+		task->space_id = space_id(find.space);
+		task->key_len = 0;
+	}
+	return find.space;
+}
+
+/** Proceed to the space with the next ID. */
+static void
+memtx_defrag_next_space(struct memtx_defrag_task *task)
+{
+	task->space_id++;
+	task->key_len = 0;
+}
+
+/** Remember the primary key of the last checked tuple. */
+static int
+memtx_defrag_save_key(struct memtx_defrag_task *task, struct index *pk,
+		      struct tuple *tuple)
+{
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t key_len;
+	const char *key = tuple_extract_key(tuple, pk->def->key_def,
+					    MULTIKEY_NONE, &key_len);
+	if (key == NULL)
+		goto fail;
+	if (key_len > task->key_capacity) {
+		char *buf = realloc(task->key, key_len);
+		if (buf == NULL) {
+			diag_set(OutOfMemory, key_len, "realloc", "key");
+			goto fail;
+		}
+		task->key = buf;
+		task->key_capacity = key_len;
+	}
+	memcpy(task->key, key, key_len);
+	task->key_len = key_len;
+	region_truncate(region, region_svp);
+	return 0;
+fail:
+	region_truncate(region, region_svp);
+	return -1;
+}
+
+/**
+ * Collect up to MEMTX_DEFRAG_BATCH_SIZE tuples of a space
+ * following the last checked one in the primary index.
+ * Returns the number of collected tuples or -1 on error.
+ *
+ * Note, if the primary index is a HASH and the last checked
+ * tuple has been deleted, the scan of the space ends early.
+ */
+static int
+memtx_defrag_collect(struct memtx_defrag_task *task, struct index *pk,
+		     struct tuple **batch)
+{
+	const char *key = task->key;
+	uint32_t part_count = 0;
+	enum iterator_type type = ITER_ALL;
+	if (task->key_len > 0) {
+		part_count = mp_decode_array(&key);
+		type = ITER_GT;
+	}
+	struct iterator *it = index_create_iterator(pk, type, key,
+						    part_count);
+	if (it == NULL)
+		return -1;
+	int count = 0;
+	struct tuple *tuple;
+	while (count < MEMTX_DEFRAG_BATCH_SIZE) {
+		if (iterator_next(it, &tuple) != 0) {
+			iterator_delete(it);
+			return -1;
+		}
+		if (tuple == NULL)
+			break;
+		batch[count++] = tuple;
+	}
+	/* The iterator may reference the last returned tuple. */
+	iterator_delete(it);
+	return count;
+}
+
+static void
+memtx_defrag_task_run(struct memtx_gc_task *base, bool *done)
+{
+	struct memtx_defrag_task *task = (struct memtx_defrag_task *)base;
+	struct memtx_engine *memtx = task->memtx;
+	*done = false;
+	/* Checked by memtx_engine_run_defrag(). */
+	assert(!memtx_defrag_is_blocked(memtx));
+	struct space *space = memtx_defrag_find_space(task);
+	if (space == NULL) {
+		*done = true;
+		return;
+	}
+	struct index *pk = space_index(space, 0);
+	if (pk == NULL) {
+		memtx_defrag_next_space(task);
+		return;
+	}
+	struct tuple *batch[MEMTX_DEFRAG_BATCH_SIZE];
+	int count = memtx_defrag_collect(task, pk, batch);
+	if (count > 0 && memtx_defrag_save_key(task, pk,
+					       batch[count - 1]) != 0)
+		count = -1;
+	if (count < 0 || memtx_defrag_update_pools(task) != 0) {
+		diag_log();
+		say_error("failed to defragment space '%s'",
+			  space_name(space));
+		memtx_defrag_next_space(task);
+		return;
+	}
+	if (count < MEMTX_DEFRAG_BATCH_SIZE)
+		memtx_defrag_next_space(task);
+	for (int i = 0; i < count; i++) {
+		struct tuple *tuple = batch[i];
+		/*
+		 * A tuple referenced by anyone but the primary
+		 * index or having a history in the transaction
+		 * manager is pinned to its address.
+		 */
+		if (tuple->refs != 1 || tuple->is_dirty)
+			continue;
+		size_t size = tuple_size(tuple) +
+			      offsetof(struct memtx_tuple, base);
+		if (!memtx_defrag_size_is_sparse(task, size))
+			continue;
+		struct tuple *new_tuple = memtx_tuple_move(memtx, tuple);
+		if (new_tuple == NULL)
+			continue;
+		struct tuple *old_tuple;
+		if (memtx_space_replace_all_keys(space, tuple, new_tuple,
+						 DUP_REPLACE,
+						 &old_tuple) != 0) {
+			diag_log();
+			memtx_tuple_delete(tuple_format(new_tuple), new_tuple);
+			break;
+		}
+		assert(old_tuple == tuple);
+		tuple_unref(old_tuple);
+		memtx->defrag_tuple_count++;
+		memtx->defrag_tuple_size += size;
+	}
+}
+
+static void
+memtx_defrag_task_free(struct memtx_gc_task *base)
+{
+	struct memtx_defrag_task *task = (struct memtx_defrag_task *)base;
+	free(task->key);
+	free(task->pools);
+	free(task);
+}
+
+static const struct memtx_gc_task_vtab memtx_defrag_task_vtab = {
+	.run = memtx_defrag_task_run,
+	.free = memtx_defrag_task_free,
+};
+
+int
+memtx_engine_defrag(struct memtx_engine *memtx)
+{
+	if (memtx->defrag_task != NULL)
+		return 0;
+	struct memtx_defrag_task *task = calloc(1, sizeof(*task));
+	if (task == NULL) {
+		diag_set(OutOfMemory, sizeof(*task),
+			 "calloc", "struct memtx_defrag_task");
+		return -1;
+	}
+	task->base.vtab = &memtx_defrag_task_vtab;
+	task->memtx = memtx;
+	memtx->defrag_task = &task->base;
+	memtx->defrag_tuple_count = 0;
+	memtx->defrag_tuple_size = 0;
+	fiber_wakeup(memtx->gc_fiber);
+	return 0;
+}
+
+/**
+ * Run one iteration of tuple defragmentation, then sleep to
+ * limit the rate. If defragmentation is blocked, wait until
+ * it's unblocked instead, see memtx_defrag_wakeup().
+ */
+static void
+memtx_engine_run_defrag(struct memtx_engine *memtx)
+{
+	if (memtx_defrag_is_blocked(memtx)) {
+		/*
+		 * The fiber is also woken up when a new garbage
+		 * collection task is queued, so return to the
+		 * main loop after each wakeup.
+		 */
+		memtx->defrag_is_waiting = true;
+		fiber_yield_timeout(TIMEOUT_INFINITY);
+		memtx->defrag_is_waiting = false;
+		return;
+	}
+	struct memtx_gc_task *task = memtx->defrag_task;
+	bool task_done;
+	task->vtab->run(task, &task_done);
+	if (task_done) {
+		memtx->defrag_task = NULL;
+		task->vtab->free(task);
+		return;
+	}
+	fiber_sleep(MEMTX_DEFRAG_DELAY);
+}
+
 static int
 memtx_engine_gc_f(va_list va)
 {
@@ -963,6 +1911,14 @@ memtx_engine_gc_f(va_list va)
 		bool stop;
 		ERROR_INJECT_YIELD(ERRINJ_MEMTX_DELAY_GC);
 		memtx_engine_run_gc(memtx, &stop);
+		if (stop && memtx->defrag_task != NULL) {
+			/*
+			 * Defragmentation only runs when there's
+			 * no garbage to collect.
+			 */
+			memtx_engine_run_defrag(memtx);
+			continue;
+		}
 		if (stop) {
 			fiber_yield_timeout(TIMEOUT_INFINITY);
 			continue;
@@ -979,7 +1935,7 @@ memtx_engine_gc_f(va_list va)
 struct memtx_engine *
 memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		 uint64_t tuple_arena_max_size, uint32_t objsize_min,
-		 bool dontdump, float alloc_factor)
+		 bool dontdump, float alloc_factor, int sort_threads)
 {
 	struct memtx_engine *memtx = calloc(1, sizeof(*memtx));
 	if (memtx == NULL) {
@@ -1045,12 +2001,17 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		       MEMTX_EXTENT_SIZE);
 	mempool_create(&memtx->iterator_pool, cord_slab_cache(),
 		       MEMTX_ITERATOR_SIZE);
+	memtx_tx_manager_init();
 	memtx->num_reserved_extents = 0;
 	memtx->reserved_extents = NULL;
 
 	memtx->state = MEMTX_INITIALIZED;
 	memtx->max_tuple_size = MAX_TUPLE_SIZE;
 	memtx->force_recovery = force_recovery;
+	/* Use all online CPUs unless configured otherwise. */
+	if (sort_threads <= 0)
+		sort_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	memtx->sort_threads = MAX(sort_threads, 1);
 
 	memtx->replica_join_cord = NULL;
 
@@ -1079,6 +2040,13 @@ memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit)
 	memtx->snap_io_rate_limit = limit * 1024 * 1024;
 }
 
+void
+memtx_engine_set_snap_compress_threads(struct memtx_engine *memtx,
+				       int threads)
+{
+	memtx->snap_compress_threads = threads;
+}
+
 int
 memtx_engine_set_memory(struct memtx_engine *memtx, size_t size)
 {
@@ -1109,8 +2077,10 @@ void
 memtx_leave_delayed_free_mode(struct memtx_engine *memtx)
 {
 	assert(memtx->delayed_free_mode > 0);
-	if (--memtx->delayed_free_mode == 0)
+	if (--memtx->delayed_free_mode == 0) {
 		small_alloc_setopt(&memtx->alloc, SMALL_DELAYED_FREE_MODE, false);
+		memtx_defrag_wakeup(memtx);
+	}
 }
 
 struct tuple *
@@ -1122,8 +2092,40 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 	struct region *region = &fiber()->gc;
 	size_t region_svp = region_used(region);
 	struct field_map_builder builder;
-	if (tuple_field_map_create(format, data, true, &builder) != 0)
+	if (format->is_compressed) {
+		/*
+		 * Validate the tuple and build the field map on
+		 * decompressed data. Indexed fields are never
+		 * compressed so the field map is valid for the
+		 * compressed data as well.
+		 *
+		 * The decompressed tuple must fit in the tuple size
+		 * limit too: sizes of compressed fields may come from
+		 * a client, and reads decompress tuples unchecked.
+		 */
+		uint32_t size;
+		const char *plain = tuple_decompress_raw(data, end,
+							 memtx->max_tuple_size,
+							 &size);
+		if (plain == NULL ||
+		    tuple_field_map_create(format, plain, true, &builder) != 0)
+			goto end;
+		size_t plain_total = sizeof(struct memtx_tuple) +
+				     field_map_build_size(&builder) + size;
+		if (unlikely(plain_total > memtx->max_tuple_size)) {
+			diag_set(ClientError, ER_MEMTX_MAX_TUPLE_SIZE,
+				 plain_total);
+			error_log(diag_last_error(diag_get()));
+			goto end;
+		}
+		data = tuple_compress_raw(data, end, format->index_field_count,
+					  &size);
+		if (data == NULL)
+			goto end;
+		end = data + size;
+	} else if (tuple_field_map_create(format, data, true, &builder) != 0) {
 		goto end;
+	}
 	uint32_t field_map_size = field_map_build_size(&builder);
 	/*
 	 * Data offset is calculated from the begin of the struct
@@ -1325,6 +2327,22 @@ memtx_index_def_change_requires_rebuild(struct index *index,
 		return true;
 	if (old_def->opts.func_id != new_def->opts.func_id)
 		return true;
+	if (old_def->opts.inline_key != new_def->opts.inline_key)
+		return true;
+	if (old_def->opts.hash_table != new_def->opts.hash_table)
+		return true;
+	/*
+	 * Inline keys are encoded according to the exact key part
+	 * types, nullability and sort orders of the comparison
+	 * key definition, which also depends on the uniqueness.
+	 */
+	if (new_def->opts.inline_key &&
+	    (old_def->opts.is_unique != new_def->opts.is_unique ||
+	     key_part_cmp(old_def->cmp_def->parts,
+			  old_def->cmp_def->part_count,
+			  new_def->cmp_def->parts,
+			  new_def->cmp_def->part_count) != 0))
+		return true;
 
 	const struct key_def *old_cmp_def, *new_cmp_def;
 	if (index_depends_on_pk(index)) {
@@ -105,7 +105,7 @@ enum memtx_reserve_extents_num {
  * allocated for each iterator (except rtree index iterator that
  * is significantly bigger so has own pool).
  */
-#define MEMTX_ITERATOR_SIZE (152)
+#define MEMTX_ITERATOR_SIZE (184)
 
 struct memtx_engine {
 	struct engine base;
@@ -117,8 +117,20 @@ struct memtx_engine {
 	struct xdir snap_dir;
 	/** Limit disk usage of checkpointing (bytes per second). */
 	uint64_t snap_io_rate_limit;
+	/**
+	 * Number of snapshot blocks compressed in parallel in
+	 * the worker thread pool, box.cfg.snap_compress_threads
+	 * capped by box.cfg.worker_pool_threads. The same number
+	 * of blocks is decompressed in parallel on recovery.
+	 */
+	int snap_compress_threads;
 	/** Skip invalid snapshot records if this flag is set. */
 	bool force_recovery;
+	/**
+	 * Number of threads used to sort secondary keys on
+	 * recovery, box.cfg.memtx_sort_threads.
+	 */
+	int sort_threads;
 	/**
 	 * Cord being currently used to join replica. It is only
 	 * needed to be able to cancel it on shutdown.
@@ -178,6 +190,31 @@ struct memtx_engine {
 	 * memtx_gc_task::link.
 	 */
 	struct stailq gc_queue;
+	/**
+	 * Number of transactions that have begun in the engine,
+	 * but haven't been committed or rolled back yet. Tuples
+	 * can't be relocated while there are any, because
+	 * statements of such transactions reference tuples
+	 * without taking a reference.
+	 */
+	int64_t txn_count;
+	/**
+	 * Tuple defragmentation task, run by the garbage
+	 * collection fiber when gc_queue is empty, or NULL
+	 * if defragmentation isn't in progress.
+	 * @sa memtx_engine_defrag().
+	 */
+	struct memtx_gc_task *defrag_task;
+	/**
+	 * Set while the garbage collection fiber is waiting
+	 * for defragmentation to be unblocked by the end of
+	 * all transactions and read views.
+	 */
+	bool defrag_is_waiting;
+	/** Number of tuples moved by defragmentation. */
+	int64_t defrag_tuple_count;
+	/** Size of tuples moved by defragmentation, in bytes. */
+	int64_t defrag_tuple_size;
 };
 
 struct memtx_gc_task;
@@ -209,11 +246,28 @@ void
 memtx_engine_schedule_gc(struct memtx_engine *memtx,
 			 struct memtx_gc_task *task);
 
+/**
+ * Start background defragmentation of tuple memory unless
+ * it is already in progress.
+ *
+ * The garbage collection fiber scans primary indexes of all
+ * memtx spaces and moves each tuple allocated from a sparsely
+ * used mempool to a lower address, if there's a free chunk
+ * there, then rewrites the tuple pointer in all indexes of
+ * the space. Since a mempool allocates from the slab with the
+ * lowest address first, tuples gather in lower slabs, while
+ * empty upper slabs are returned to the arena.
+ *
+ * Returns -1 on memory allocation error.
+ */
+int
+memtx_engine_defrag(struct memtx_engine *memtx);
+
 struct memtx_engine *
 memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		 uint64_t tuple_arena_max_size,
 		 uint32_t objsize_min, bool dontdump,
-		 float alloc_factor);
+		 float alloc_factor, int sort_threads);
 
 int
 memtx_engine_recover_snapshot(struct memtx_engine *memtx,
@@ -222,6 +276,10 @@ memtx_engine_recover_snapshot(struct memtx_engine *memtx,
 void
 memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit);
 
+void
+memtx_engine_set_snap_compress_threads(struct memtx_engine *memtx,
+				       int threads);
+
 int
 memtx_engine_set_memory(struct memtx_engine *memtx, size_t size);
 
@@ -299,13 +357,13 @@ static inline struct memtx_engine *
 memtx_engine_new_xc(const char *snap_dirname, bool force_recovery,
 		    uint64_t tuple_arena_max_size,
 		    uint32_t objsize_min, bool dontdump,
-		    float alloc_factor)
+		    float alloc_factor, int sort_threads)
 {
 	struct memtx_engine *memtx;
 	memtx = memtx_engine_new(snap_dirname, force_recovery,
 				 tuple_arena_max_size,
 				 objsize_min, dontdump,
-				 alloc_factor);
+				 alloc_factor, sort_threads);
 	if (memtx == NULL)
 		diag_raise();
 	return memtx;
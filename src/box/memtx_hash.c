@@ -34,12 +34,28 @@
 #include "index.h"
 #include "tuple.h"
 #include "memtx_engine.h"
+#include "memtx_tx.h"
+#include "txn.h"
 #include "space.h"
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
 
 #include <small/mempool.h>
 
+/*
+ * If this macro is set, the index is built on salad/swiss.h
+ * rather than on salad/light.h. The file is compiled with it by
+ * memtx_hash_swiss.c, which provides the implementation of HASH
+ * indexes that have the hash_table option set to 'swiss'.
+ */
+#ifndef MEMTX_HASH_SWISS
+#define MEMTX_HASH_SWISS 0
+#endif
+
+#if MEMTX_HASH_SWISS
+#define memtx_hash_index_new memtx_hash_swiss_index_new
+#endif
+
 static inline bool
 memtx_hash_equal(struct tuple *tuple_a, struct tuple *tuple_b,
 		 struct key_def *key_def)
@@ -56,6 +72,30 @@ memtx_hash_equal_key(struct tuple *tuple, const char *key,
 				      HINT_NONE, key_def) == 0;
 }
 
+#if MEMTX_HASH_SWISS
+
+#define SWISS_NAME _index
+#define SWISS_DATA_TYPE struct tuple *
+#define SWISS_KEY_TYPE const char *
+#define SWISS_CMP_ARG_TYPE struct key_def *
+#define SWISS_EQUAL(a, b, c) memtx_hash_equal(a, b, c)
+#define SWISS_EQUAL_KEY(a, b, c) memtx_hash_equal_key(a, b, c)
+#define SWISS_HASH(a, c) tuple_hash(a, c)
+
+#include "salad/swiss.h"
+
+#undef SWISS_NAME
+#undef SWISS_DATA_TYPE
+#undef SWISS_KEY_TYPE
+#undef SWISS_CMP_ARG_TYPE
+#undef SWISS_EQUAL
+#undef SWISS_EQUAL_KEY
+#undef SWISS_HASH
+
+#define HASH_TABLE(name) swiss_index_##name
+
+#else /* !MEMTX_HASH_SWISS */
+
 #define LIGHT_NAME _index
 #define LIGHT_DATA_TYPE struct tuple *
 #define LIGHT_KEY_TYPE const char *
@@ -72,18 +112,22 @@ memtx_hash_equal_key(struct tuple *tuple, const char *key,
 #undef LIGHT_EQUAL
 #undef LIGHT_EQUAL_KEY
 
+#define HASH_TABLE(name) light_index_##name
+
+#endif /* !MEMTX_HASH_SWISS */
+
 struct memtx_hash_index {
 	struct index base;
-	struct light_index_core hash_table;
+	struct HASH_TABLE(core) hash_table;
 	struct memtx_gc_task gc_task;
-	struct light_index_iterator gc_iterator;
+	struct HASH_TABLE(iterator) gc_iterator;
 };
 
 /* {{{ MemtxHash Iterators ****************************************/
 
 struct hash_iterator {
 	struct iterator base; /* Must be the first member. */
-	struct light_index_iterator iterator;
+	struct HASH_TABLE(iterator) iterator;
 	/** Memory pool the iterator was allocated from. */
 	struct mempool *pool;
 };
@@ -101,33 +145,76 @@ hash_iterator_free(struct iterator *iterator)
 }
 
 static int
-hash_iterator_ge(struct iterator *ptr, struct tuple **ret)
+hash_iterator_ge_base(struct iterator *ptr, struct tuple **ret)
 {
 	assert(ptr->free == hash_iterator_free);
 	struct hash_iterator *it = (struct hash_iterator *) ptr;
 	struct memtx_hash_index *index = (struct memtx_hash_index *)ptr->index;
-	struct tuple **res = light_index_iterator_get_and_next(&index->hash_table,
-							       &it->iterator);
+	struct tuple **res =
+		HASH_TABLE(iterator_get_and_next)(&index->hash_table,
+						  &it->iterator);
 	*ret = res != NULL ? *res : NULL;
 	return 0;
 }
 
+/**
+ * Skip tuples invisible to the current transaction and replace
+ * the visible ones with their versions, @sa memtx_tx.h.
+ */
+#define WRAP_ITERATOR_METHOD(name)						\
+static int									\
+name(struct iterator *iterator, struct tuple **ret)				\
+{										\
+	struct txn *txn = in_txn();						\
+	do {									\
+		int rc = name##_base(iterator, ret);				\
+		if (rc != 0 || *ret == NULL)					\
+			return rc;						\
+		*ret = memtx_tx_tuple_clarify(txn, iterator->index, *ret);	\
+	} while (*ret == NULL);							\
+	return 0;								\
+}										\
+struct forgot_to_add_semicolon
+
+/**
+ * Same as WRAP_ITERATOR_METHOD, but for methods that are only
+ * called once and then replace themselves with another one.
+ */
+#define WRAP_START_ITERATOR_METHOD(name)					\
+static int									\
+name(struct iterator *iterator, struct tuple **ret)				\
+{										\
+	int rc = name##_base(iterator, ret);					\
+	if (rc != 0 || *ret == NULL)						\
+		return rc;							\
+	*ret = memtx_tx_tuple_clarify(in_txn(), iterator->index, *ret);		\
+	if (*ret == NULL)							\
+		return iterator->next(iterator, ret);				\
+	return 0;								\
+}										\
+struct forgot_to_add_semicolon
+
+WRAP_ITERATOR_METHOD(hash_iterator_ge);
+
 static int
-hash_iterator_gt(struct iterator *ptr, struct tuple **ret)
+hash_iterator_gt_base(struct iterator *ptr, struct tuple **ret)
 {
 	assert(ptr->free == hash_iterator_free);
 	ptr->next = hash_iterator_ge;
 	struct hash_iterator *it = (struct hash_iterator *) ptr;
 	struct memtx_hash_index *index = (struct memtx_hash_index *)ptr->index;
-	struct tuple **res = light_index_iterator_get_and_next(&index->hash_table,
-							       &it->iterator);
+	struct tuple **res =
+		HASH_TABLE(iterator_get_and_next)(&index->hash_table,
+						  &it->iterator);
 	if (res != NULL)
-		res = light_index_iterator_get_and_next(&index->hash_table,
+		res = HASH_TABLE(iterator_get_and_next)(&index->hash_table,
 							&it->iterator);
 	*ret = res != NULL ? *res : NULL;
 	return 0;
 }
 
+WRAP_START_ITERATOR_METHOD(hash_iterator_gt);
+
 static int
 hash_iterator_eq_next(MAYBE_UNUSED struct iterator *it, struct tuple **ret)
 {
@@ -136,12 +223,17 @@ hash_iterator_eq_next(MAYBE_UNUSED struct iterator *it, struct tuple **ret)
 }
 
 static int
-hash_iterator_eq(struct iterator *it, struct tuple **ret)
+hash_iterator_eq_base(struct iterator *it, struct tuple **ret)
 {
 	it->next = hash_iterator_eq_next;
-	return hash_iterator_ge(it, ret);
+	return hash_iterator_ge_base(it, ret);
 }
 
+WRAP_START_ITERATOR_METHOD(hash_iterator_eq);
+
+#undef WRAP_ITERATOR_METHOD
+#undef WRAP_START_ITERATOR_METHOD
+
 /* }}} */
 
 /* {{{ MemtxHash -- implementation of all hashes. **********************/
@@ -149,7 +241,7 @@ hash_iterator_eq(struct iterator *it, struct tuple **ret)
 static void
 memtx_hash_index_free(struct memtx_hash_index *index)
 {
-	light_index_destroy(&index->hash_table);
+	HASH_TABLE(destroy)(&index->hash_table);
 	free(index);
 }
 
@@ -168,12 +260,12 @@ memtx_hash_index_gc_run(struct memtx_gc_task *task, bool *done)
 
 	struct memtx_hash_index *index = container_of(task,
 			struct memtx_hash_index, gc_task);
-	struct light_index_core *hash = &index->hash_table;
-	struct light_index_iterator *itr = &index->gc_iterator;
+	struct HASH_TABLE(core) *hash = &index->hash_table;
+	struct HASH_TABLE(iterator) *itr = &index->gc_iterator;
 
 	struct tuple **res;
 	unsigned int loops = 0;
-	while ((res = light_index_iterator_get_and_next(hash, itr)) != NULL) {
+	while ((res = HASH_TABLE(iterator_get_and_next)(hash, itr)) != NULL) {
 		tuple_unref(*res);
 		if (++loops >= YIELD_LOOPS) {
 			*done = false;
@@ -208,7 +300,7 @@ memtx_hash_index_destroy(struct index *base)
 		 * background task in order not to block tx thread.
 		 */
 		index->gc_task.vtab = &memtx_hash_index_gc_vtab;
-		light_index_iterator_begin(&index->hash_table,
+		HASH_TABLE(iterator_begin)(&index->hash_table,
 					   &index->gc_iterator);
 		memtx_engine_schedule_gc(memtx, &index->gc_task);
 	} else {
@@ -238,25 +330,35 @@ static ssize_t
 memtx_hash_index_bsize(struct index *base)
 {
 	struct memtx_hash_index *index = (struct memtx_hash_index *)base;
+#if MEMTX_HASH_SWISS
+	return swiss_index_extent_count(&index->hash_table) *
+					MEMTX_EXTENT_SIZE;
+#else
 	return matras_extent_count(&index->hash_table.mtable) *
 					MEMTX_EXTENT_SIZE;
+#endif
 }
 
 static int
 memtx_hash_index_random(struct index *base, uint32_t rnd, struct tuple **result)
 {
 	struct memtx_hash_index *index = (struct memtx_hash_index *)base;
-	struct light_index_core *hash_table = &index->hash_table;
+	struct HASH_TABLE(core) *hash_table = &index->hash_table;
 
 	*result = NULL;
 	if (hash_table->count == 0)
 		return 0;
+#if MEMTX_HASH_SWISS
+	rnd = swiss_index_random(hash_table, rnd);
+#else
 	rnd %= (hash_table->table_size);
-	while (!light_index_pos_valid(hash_table, rnd)) {
+	while (!HASH_TABLE(pos_valid)(hash_table, rnd)) {
 		rnd++;
 		rnd %= (hash_table->table_size);
 	}
-	*result = light_index_get(hash_table, rnd);
+#endif
+	*result = memtx_tx_tuple_clarify(in_txn(), base,
+					 HASH_TABLE(get)(hash_table, rnd));
 	return 0;
 }
 
@@ -264,7 +366,8 @@ static ssize_t
 memtx_hash_index_count(struct index *base, enum iterator_type type,
 		       const char *key, uint32_t part_count)
 {
-	if (type == ITER_ALL)
+	/* With the transaction manager on, see memtx_tree.c. */
+	if (type == ITER_ALL && !memtx_tx_manager_use_mvcc_engine)
 		return memtx_hash_index_size(base); /* optimization */
 	return generic_index_count(base, type, key, part_count);
 }
@@ -277,13 +380,17 @@ memtx_hash_index_get(struct index *base, const char *key,
 
 	assert(base->def->opts.is_unique &&
 	       part_count == base->def->key_def->part_count);
-	(void) part_count;
 
 	*result = NULL;
+	struct txn *txn = in_txn();
 	uint32_t h = key_hash(key, base->def->key_def);
-	uint32_t k = light_index_find_key(&index->hash_table, h, key);
-	if (k != light_index_end)
-		*result = light_index_get(&index->hash_table, k);
+	uint32_t k = HASH_TABLE(find_key)(&index->hash_table, h, key);
+	if (k != HASH_TABLE(end)) {
+		struct tuple *tuple = HASH_TABLE(get)(&index->hash_table, k);
+		*result = memtx_tx_tuple_clarify(txn, base, tuple);
+	}
+	if (*result == NULL)
+		memtx_tx_track_gap(txn, base, ITER_EQ, key, part_count);
 	return 0;
 }
 
@@ -293,23 +400,23 @@ memtx_hash_index_replace(struct index *base, struct tuple *old_tuple,
 			 struct tuple **result)
 {
 	struct memtx_hash_index *index = (struct memtx_hash_index *)base;
-	struct light_index_core *hash_table = &index->hash_table;
+	struct HASH_TABLE(core) *hash_table = &index->hash_table;
 
 	if (new_tuple) {
 		uint32_t h = tuple_hash(new_tuple, base->def->key_def);
 		struct tuple *dup_tuple = NULL;
-		uint32_t pos = light_index_replace(hash_table, h, new_tuple,
+		uint32_t pos = HASH_TABLE(replace)(hash_table, h, new_tuple,
 						   &dup_tuple);
-		if (pos == light_index_end)
-			pos = light_index_insert(hash_table, h, new_tuple);
+		if (pos == HASH_TABLE(end))
+			pos = HASH_TABLE(insert)(hash_table, h, new_tuple);
 
 		ERROR_INJECT(ERRINJ_INDEX_ALLOC,
 		{
-			light_index_delete(hash_table, pos);
-			pos = light_index_end;
+			HASH_TABLE(delete)(hash_table, pos);
+			pos = HASH_TABLE(end);
 		});
 
-		if (pos == light_index_end) {
+		if (pos == HASH_TABLE(end)) {
 			diag_set(OutOfMemory, (ssize_t)hash_table->count,
 				 "hash_table", "key");
 			return -1;
@@ -317,10 +424,10 @@ memtx_hash_index_replace(struct index *base, struct tuple *old_tuple,
 		uint32_t errcode = replace_check_dup(old_tuple,
 						     dup_tuple, mode);
 		if (errcode) {
-			light_index_delete(hash_table, pos);
+			HASH_TABLE(delete)(hash_table, pos);
 			if (dup_tuple) {
-				uint32_t pos = light_index_insert(hash_table, h, dup_tuple);
-				if (pos == light_index_end) {
+				uint32_t pos = HASH_TABLE(insert)(hash_table, h, dup_tuple);
+				if (pos == HASH_TABLE(end)) {
 					panic("Failed to allocate memory in "
 					      "recover of int hash_table");
 				}
@@ -340,7 +447,7 @@ memtx_hash_index_replace(struct index *base, struct tuple *old_tuple,
 
 	if (old_tuple) {
 		uint32_t h = tuple_hash(old_tuple, base->def->key_def);
-		int res = light_index_delete_value(hash_table, h, old_tuple);
+		int res = HASH_TABLE(delete_value)(hash_table, h, old_tuple);
 		assert(res == 0); (void) res;
 	}
 	*result = old_tuple;
@@ -365,26 +472,26 @@ memtx_hash_index_create_iterator(struct index *base, enum iterator_type type,
 	iterator_create(&it->base, base);
 	it->pool = &memtx->iterator_pool;
 	it->base.free = hash_iterator_free;
-	light_index_iterator_begin(&index->hash_table, &it->iterator);
+	HASH_TABLE(iterator_begin)(&index->hash_table, &it->iterator);
 
 	switch (type) {
 	case ITER_GT:
 		if (part_count != 0) {
-			light_index_iterator_key(&index->hash_table, &it->iterator,
+			HASH_TABLE(iterator_key)(&index->hash_table, &it->iterator,
 					key_hash(key, base->def->key_def), key);
 			it->base.next = hash_iterator_gt;
 		} else {
-			light_index_iterator_begin(&index->hash_table, &it->iterator);
+			HASH_TABLE(iterator_begin)(&index->hash_table, &it->iterator);
 			it->base.next = hash_iterator_ge;
 		}
 		break;
 	case ITER_ALL:
-		light_index_iterator_begin(&index->hash_table, &it->iterator);
+		HASH_TABLE(iterator_begin)(&index->hash_table, &it->iterator);
 		it->base.next = hash_iterator_ge;
 		break;
 	case ITER_EQ:
 		assert(part_count > 0);
-		light_index_iterator_key(&index->hash_table, &it->iterator,
+		HASH_TABLE(iterator_key)(&index->hash_table, &it->iterator,
 				key_hash(key, base->def->key_def), key);
 		it->base.next = hash_iterator_eq;
 		break;
@@ -394,13 +501,16 @@ memtx_hash_index_create_iterator(struct index *base, enum iterator_type type,
 		mempool_free(&memtx->iterator_pool, it);
 		return NULL;
 	}
+	memtx_tx_track_gap(in_txn(), base, type, key, part_count);
 	return (struct iterator *)it;
 }
 
 struct hash_snapshot_iterator {
 	struct snapshot_iterator base;
 	struct memtx_hash_index *index;
-	struct light_index_iterator iterator;
+	struct HASH_TABLE(iterator) iterator;
+	/** Filters out changes of in-progress transactions. */
+	struct memtx_tx_snapshot_cleaner cleaner;
 };
 
 /**
@@ -416,8 +526,9 @@ hash_snapshot_iterator_free(struct snapshot_iterator *iterator)
 		(struct hash_snapshot_iterator *) iterator;
 	memtx_leave_delayed_free_mode((struct memtx_engine *)
 				      it->index->base.engine);
-	light_index_iterator_destroy(&it->index->hash_table, &it->iterator);
+	HASH_TABLE(iterator_destroy)(&it->index->hash_table, &it->iterator);
 	index_unref(&it->index->base);
+	memtx_tx_snapshot_cleaner_destroy(&it->cleaner);
 	free(iterator);
 }
 
@@ -433,14 +544,19 @@ hash_snapshot_iterator_next(struct snapshot_iterator *iterator,
 	assert(iterator->free == hash_snapshot_iterator_free);
 	struct hash_snapshot_iterator *it =
 		(struct hash_snapshot_iterator *) iterator;
-	struct light_index_core *hash_table = &it->index->hash_table;
-	struct tuple **res = light_index_iterator_get_and_next(hash_table,
-							       &it->iterator);
-	if (res == NULL) {
-		*data = NULL;
-		return 0;
-	}
-	*data = tuple_data_range(*res, size);
+	struct HASH_TABLE(core) *hash_table = &it->index->hash_table;
+	struct tuple *tuple;
+	do {
+		struct tuple **res =
+			HASH_TABLE(iterator_get_and_next)(hash_table,
+							  &it->iterator);
+		if (res == NULL) {
+			*data = NULL;
+			return 0;
+		}
+		tuple = memtx_tx_snapshot_clarify(&it->cleaner, *res);
+	} while (tuple == NULL);
+	*data = tuple_data_range(tuple, size);
 	return 0;
 }
 
@@ -460,13 +576,19 @@ memtx_hash_index_create_snapshot_iterator(struct index *base)
 			 "memtx_hash_index", "iterator");
 		return NULL;
 	}
+	struct space *space = space_by_id(base->def->space_id);
+	if (memtx_tx_snapshot_cleaner_create(&it->cleaner, space,
+					     "memtx_hash_index") != 0) {
+		free(it);
+		return NULL;
+	}
 
 	it->base.next = hash_snapshot_iterator_next;
 	it->base.free = hash_snapshot_iterator_free;
 	it->index = index;
 	index_ref(base);
-	light_index_iterator_begin(&index->hash_table, &it->iterator);
-	light_index_iterator_freeze(&index->hash_table, &it->iterator);
+	HASH_TABLE(iterator_begin)(&index->hash_table, &it->iterator);
+	HASH_TABLE(iterator_freeze)(&index->hash_table, &it->iterator);
 	memtx_enter_delayed_free_mode((struct memtx_engine *)base->engine);
 	return (struct snapshot_iterator *) it;
 }
@@ -488,6 +610,7 @@ static const struct index_vtab memtx_hash_index_vtab = {
 	/* .random = */ memtx_hash_index_random,
 	/* .count = */ memtx_hash_index_count,
 	/* .get = */ memtx_hash_index_get,
+	/* .get_many = */ generic_index_get_many,
 	/* .replace = */ memtx_hash_index_replace,
 	/* .create_iterator = */ memtx_hash_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -504,6 +627,10 @@ static const struct index_vtab memtx_hash_index_vtab = {
 struct index *
 memtx_hash_index_new(struct memtx_engine *memtx, struct index_def *def)
 {
+#if !MEMTX_HASH_SWISS
+	if (def->opts.hash_table == HASH_INDEX_TABLE_SWISS)
+		return memtx_hash_swiss_index_new(memtx, def);
+#endif
 	struct memtx_hash_index *index =
 		(struct memtx_hash_index *)calloc(1, sizeof(*index));
 	if (index == NULL) {
@@ -517,7 +644,7 @@ memtx_hash_index_new(struct memtx_engine *memtx, struct index_def *def)
 		return NULL;
 	}
 
-	light_index_create(&index->hash_table, MEMTX_EXTENT_SIZE,
+	HASH_TABLE(create)(&index->hash_table, MEMTX_EXTENT_SIZE,
 			   memtx_index_extent_alloc, memtx_index_extent_free,
 			   memtx, index->base.def->key_def);
 	return &index->base;
@@ -42,6 +42,14 @@ struct memtx_engine;
 struct index *
 memtx_hash_index_new(struct memtx_engine *memtx, struct index_def *def);
 
+/**
+ * Implementation of HASH indexes with the hash_table option set
+ * to 'swiss', see memtx_hash_swiss.c. memtx_hash_index_new()
+ * dispatches to it, so it needn't be called directly.
+ */
+struct index *
+memtx_hash_swiss_index_new(struct memtx_engine *memtx, struct index_def *def);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
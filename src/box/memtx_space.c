@@ -40,6 +40,8 @@
 #include "memtx_rtree.h"
 #include "memtx_bitset.h"
 #include "memtx_engine.h"
+#include "memtx_tx.h"
+#include "mp_extension_types.h"
 #include "column_mask.h"
 #include "sequence.h"
 
@@ -61,6 +63,9 @@ enum { MEMTX_DDL_YIELD_LOOPS = 10 };
 static void
 memtx_space_destroy(struct space *space)
 {
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	assert(rlist_empty(&memtx_space->gap_list));
+	(void)memtx_space;
 	free(space);
 }
 
@@ -253,6 +258,18 @@ memtx_space_replace_all_keys(struct space *space, struct tuple *old_tuple,
 				       RESERVE_EXTENTS_BEFORE_DELETE) != 0)
 		return -1;
 
+	if (memtx_tx_manager_use_mvcc_engine) {
+		struct txn *txn = in_txn();
+		struct txn_stmt *stmt =
+			txn == NULL ? NULL : txn_current_stmt(txn);
+		if (stmt != NULL && stmt->space == space &&
+		    memtx_tx_space_is_versioned(space)) {
+			return memtx_tx_history_add_stmt(stmt, old_tuple,
+							 new_tuple, mode,
+							 result);
+		}
+	}
+
 	uint32_t i = 0;
 
 	/* Update the primary key */
@@ -374,10 +391,15 @@ memtx_space_execute_update(struct space *space, struct txn *txn,
 		return 0;
 	}
 
+	/* Update operations need decompressed fields. */
+	struct tuple *plain_tuple = tuple_decompress(old_tuple);
+	if (plain_tuple == NULL)
+		return -1;
+
 	/* Update the tuple; legacy, request ops are in request->tuple */
 	uint32_t new_size = 0, bsize;
 	struct tuple_format *format = space->format;
-	const char *old_data = tuple_data_range(old_tuple, &bsize);
+	const char *old_data = tuple_data_range(plain_tuple, &bsize);
 	const char *new_data =
 		xrow_update_execute(request->tuple, request->tuple_end,
 				    old_data, old_data + bsize, format,
@@ -459,8 +481,11 @@ memtx_space_execute_upsert(struct space *space, struct txn *txn,
 			return -1;
 		tuple_ref(stmt->new_tuple);
 	} else {
+		struct tuple *plain_tuple = tuple_decompress(old_tuple);
+		if (plain_tuple == NULL)
+			return -1;
 		uint32_t new_size = 0, bsize;
-		const char *old_data = tuple_data_range(old_tuple, &bsize);
+		const char *old_data = tuple_data_range(plain_tuple, &bsize);
 		/*
 		 * Update the tuple.
 		 * xrow_upsert_execute() fails on totally wrong
@@ -612,6 +637,22 @@ memtx_space_check_index_def(struct space *space, struct index_def *index_def)
 			 "nullable root field");
 		return -1;
 	}
+	if (index_def->opts.inline_key &&
+	    (index_def->type != TREE || key_def->is_multikey ||
+	     key_def->for_func_index)) {
+		diag_set(ClientError, ER_MODIFY_INDEX,
+			 index_def->name, space_name(space),
+			 "inline_key can only be used with a TREE index "
+			 "that is neither multikey nor functional");
+		return -1;
+	}
+	if (index_def->opts.hash_table != HASH_INDEX_TABLE_LIGHT &&
+	    index_def->type != HASH) {
+		diag_set(ClientError, ER_MODIFY_INDEX,
+			 index_def->name, space_name(space),
+			 "hash_table can only be used with a HASH index");
+		return -1;
+	}
 	switch (index_def->type) {
 	case HASH:
 		if (! index_def->opts.is_unique) {
@@ -855,7 +896,9 @@ memtx_check_on_replace(struct trigger *trigger, void *event)
 			  state->cmp_def) < 0)
 		return 0;
 
-	state->rc = tuple_validate(state->format, stmt->new_tuple);
+	struct tuple *plain_tuple = tuple_decompress(stmt->new_tuple);
+	state->rc = plain_tuple != NULL ?
+		    tuple_validate(state->format, plain_tuple) : -1;
 	if (state->rc != 0)
 		diag_move(diag_get(), &state->diag);
 	return 0;
@@ -879,6 +922,7 @@ memtx_space_check_format(struct space *space, struct tuple_format *format)
 	if (txn_check_singlestatement(txn, "space format check") != 0)
 		return -1;
 
+	memtx_tx_begin_ddl(txn);
 	txn_can_yield(txn, true);
 
 	struct memtx_engine *memtx = (struct memtx_engine *)space->engine;
@@ -898,9 +942,12 @@ memtx_space_check_format(struct space *space, struct tuple_format *format)
 	while ((rc = iterator_next(it, &tuple)) == 0 && tuple != NULL) {
 		/*
 		 * Check that the tuple is OK according to the
-		 * new format.
+		 * new format. Compressed fields must be checked
+		 * too, so look at the decompressed tuple.
 		 */
-		rc = tuple_validate(format, tuple);
+		struct tuple *plain_tuple = tuple_decompress(tuple);
+		rc = plain_tuple != NULL ?
+		     tuple_validate(format, plain_tuple) : -1;
 		if (rc != 0)
 			break;
 
@@ -924,6 +971,7 @@ memtx_space_check_format(struct space *space, struct tuple_format *format)
 	diag_destroy(&state.diag);
 	trigger_clear(&on_replace);
 	txn_can_yield(txn, false);
+	memtx_tx_end_ddl();
 	return rc;
 }
 
@@ -931,6 +979,7 @@ static void
 memtx_space_drop_primary_key(struct space *space)
 {
 	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	memtx_tx_abort_all_for_ddl(in_txn());
 	/*
 	 * Reset 'replace' callback so that:
 	 * - DML returns proper errors rather than crashes the
@@ -955,6 +1004,39 @@ memtx_init_ephemeral_space(struct space *space)
 	memtx_space_add_primary_key(space);
 }
 
+/**
+ * Check that a tuple can be inserted into a new index. Tuples
+ * of a compressed format may store fields that weren't indexed
+ * compressed (see tuple_format::is_compressed), and an index
+ * can't be built over such fields. Besides, compressed fields
+ * must be decompressed to be validated against the new format.
+ */
+static int
+memtx_build_check_tuple(struct tuple *tuple, struct index_def *index_def,
+			struct tuple_format *format)
+{
+	struct tuple *plain_tuple = tuple_decompress(tuple);
+	if (plain_tuple == NULL)
+		return -1;
+	if (plain_tuple != tuple && !index_def->key_def->for_func_index) {
+		struct key_def *key_def = index_def->key_def;
+		for (uint32_t i = 0; i < key_def->part_count; i++) {
+			uint32_t fieldno = key_def->parts[i].fieldno;
+			const char *field = tuple_field(tuple, fieldno);
+			if (field == NULL || mp_typeof(*field) != MP_EXT)
+				continue;
+			int8_t type;
+			mp_decode_extl(&field, &type);
+			if (type == MP_COMPRESSION) {
+				diag_set(ClientError, ER_UNSUPPORTED, "memtx",
+					 "indexing compressed fields");
+				return -1;
+			}
+		}
+	}
+	return tuple_validate(format, plain_tuple);
+}
+
 static int
 memtx_build_on_replace(struct trigger *trigger, void *event)
 {
@@ -973,7 +1055,8 @@ memtx_build_on_replace(struct trigger *trigger, void *event)
 		return 0;
 
 	if (stmt->new_tuple != NULL &&
-	    tuple_validate(state->format, stmt->new_tuple) != 0) {
+	    memtx_build_check_tuple(stmt->new_tuple, state->index->def,
+				    state->format) != 0) {
 		state->rc = -1;
 		diag_move(diag_get(), &state->diag);
 		return 0;
@@ -1037,6 +1120,7 @@ memtx_space_build_index(struct space *src_space, struct index *new_index,
 	if (txn_check_singlestatement(txn, "index build") != 0)
 		return -1;
 
+	memtx_tx_begin_ddl(txn);
 	txn_can_yield(txn, true);
 
 	struct memtx_engine *memtx = (struct memtx_engine *)src_space->engine;
@@ -1067,7 +1151,8 @@ memtx_space_build_index(struct space *src_space, struct index *new_index,
 		 * Check that the tuple is OK according to the
 		 * new format.
 		 */
-		rc = tuple_validate(new_format, tuple);
+		rc = memtx_build_check_tuple(tuple, new_index->def,
+					     new_format);
 		if (rc != 0)
 			break;
 		/*
@@ -1116,6 +1201,7 @@ memtx_space_build_index(struct space *src_space, struct index *new_index,
 	diag_destroy(&state.diag);
 	trigger_clear(&on_replace);
 	txn_can_yield(txn, false);
+	memtx_tx_end_ddl();
 	return rc;
 }
 
@@ -1125,6 +1211,12 @@ memtx_space_prepare_alter(struct space *old_space, struct space *new_space)
 	struct memtx_space *old_memtx_space = (struct memtx_space *)old_space;
 	struct memtx_space *new_memtx_space = (struct memtx_space *)new_space;
 
+	/*
+	 * Versioned tuples refer to the old space, so abort all
+	 * transactions that may have them.
+	 */
+	memtx_tx_abort_all_for_ddl(in_txn());
+
 	if (old_memtx_space->bsize != 0 &&
 	    space_is_temporary(old_space) != space_is_temporary(new_space)) {
 		diag_set(ClientError, ER_ALTER_SPACE, old_space->def->name,
@@ -1189,6 +1281,8 @@ memtx_space_new(struct memtx_engine *memtx,
 		free(memtx_space);
 		return NULL;
 	}
+	format->is_compressed =
+		def->opts.compression != SPACE_COMPRESSION_NONE;
 	tuple_format_ref(format);
 
 	if (space_create((struct space *)memtx_space, (struct engine *)memtx,
@@ -1204,5 +1298,6 @@ memtx_space_new(struct memtx_engine *memtx,
 	memtx_space->bsize = 0;
 	memtx_space->rowid = 0;
 	memtx_space->replace = memtx_space_replace_no_keys;
+	rlist_create(&memtx_space->gap_list);
 	return (struct space *)memtx_space;
 }
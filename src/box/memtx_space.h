@@ -55,6 +55,11 @@ struct memtx_space {
 	 */
 	int (*replace)(struct space *, struct tuple *, struct tuple *,
 		       enum dup_replace_mode, struct tuple **);
+	/**
+	 * Ranges of keys read from the space indexes by
+	 * in-progress transactions, see memtx_tx.h.
+	 */
+	struct rlist gap_list;
 };
 
 /**
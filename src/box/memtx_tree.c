@@ -30,6 +30,8 @@
  */
 #include "memtx_tree.h"
 #include "memtx_engine.h"
+#include "memtx_tx.h"
+#include "txn.h"
 #include "space.h"
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
@@ -40,6 +42,31 @@
 #include <third_party/qsort_arg.h>
 #include <small/mempool.h>
 
+/*
+ * If this macro is set, tree elements store a normalized key
+ * prefix instead of a comparison hint, see memtx_tree_data.
+ * The file is compiled with it by memtx_tree_inline.c, which
+ * provides the implementation of TREE indexes that have the
+ * inline_key option set.
+ */
+#ifndef MEMTX_TREE_INLINE_KEY
+#define MEMTX_TREE_INLINE_KEY 0
+#endif
+
+#if MEMTX_TREE_INLINE_KEY
+#define memtx_tree_index_new memtx_tree_inline_index_new
+#define memtx_tree_index_sort_build_array \
+	memtx_tree_inline_index_sort_build_array
+#define memtx_tree_index_build_array_is_big \
+	memtx_tree_inline_index_build_array_is_big
+
+/**
+ * Size of a normalized key prefix stored in a tree element.
+ * Chosen so that an element takes 32 bytes.
+ */
+enum { MEMTX_TREE_INLINE_KEY_SIZE = 24 };
+#endif
+
 /**
  * Struct that is used as a key in BPS tree definition.
  */
@@ -48,8 +75,20 @@ struct memtx_tree_key_data {
 	const char *key;
 	/** Number of msgpacked search fields. */
 	uint32_t part_count;
+#if MEMTX_TREE_INLINE_KEY
+	/** Length of the normalized key prefix. */
+	uint8_t inline_key_len;
+	/**
+	 * Set if the normalized key prefix encodes all search
+	 * fields, i.e. if it is the full normalized key.
+	 */
+	bool inline_key_is_complete;
+	/** Normalized key prefix, see memtx_tree_key_data_create(). */
+	char inline_key[MEMTX_TREE_INLINE_KEY_SIZE];
+#else
 	/** Comparison hint, see tuple_hint(). */
 	hint_t hint;
+#endif
 };
 
 /**
@@ -58,10 +97,267 @@ struct memtx_tree_key_data {
 struct memtx_tree_data {
 	/* Tuple that this node is represents. */
 	struct tuple *tuple;
+#if MEMTX_TREE_INLINE_KEY
+	/**
+	 * Normalized key prefix, zero-padded. Most comparisons
+	 * are resolved by it without accessing the tuple.
+	 */
+	char inline_key[MEMTX_TREE_INLINE_KEY_SIZE];
+#else
 	/** Comparison hint, see key_hint(). */
 	hint_t hint;
+#endif
 };
 
+#if MEMTX_TREE_INLINE_KEY
+
+/*
+ * A normalized key is a memcmp-comparable encoding of a key:
+ * normalized keys compare with memcmp() in the same order as
+ * the keys do. Key parts are encoded one after another:
+ *
+ * - A nullable part starts with 0x00 if the field is NULL or
+ *   absent, in which case nothing else is written, or with
+ *   0x01 otherwise.
+ * - unsigned: 8 bytes, big endian.
+ * - integer: 0x00 for a negative value, 0x01 otherwise,
+ *   followed by 8 bytes of the value, big endian.
+ * - boolean: 0x00 or 0x01.
+ * - string without collation and varbinary: the bytes, with
+ *   each 0x00 escaped as 0x00 0xFF, followed by 0x00 0x00.
+ *
+ * No part encoding is a prefix of another one, so the order
+ * of concatenated encodings is the order of keys. Encoding
+ * stops at the first part of another type or with a collation.
+ * This happens at the same part for all tuples of the index,
+ * so normalized tuple keys zero-padded to a fixed size still
+ * compare in the order of tuples unless they are equal. The
+ * same is true for normalized keys truncated to a fixed size.
+ * If the normalized keys are equal, the tuples are compared.
+ */
+
+/** Append a byte to a normalized key unless it is full. */
+static inline bool
+inline_key_put(char **pos, const char *end, unsigned char c)
+{
+	if (*pos == end)
+		return false;
+	*(*pos)++ = c;
+	return true;
+}
+
+static inline bool
+inline_key_put_uint64(char **pos, const char *end, uint64_t value)
+{
+	for (int shift = 56; shift >= 0; shift -= 8) {
+		if (!inline_key_put(pos, end, value >> shift))
+			return false;
+	}
+	return true;
+}
+
+static inline bool
+inline_key_put_str(char **pos, const char *end, const char *str,
+		   uint32_t len)
+{
+	for (uint32_t i = 0; i < len; i++) {
+		if (!inline_key_put(pos, end, str[i]))
+			return false;
+		if (str[i] == 0 && !inline_key_put(pos, end, 0xff))
+			return false;
+	}
+	return inline_key_put(pos, end, 0) && inline_key_put(pos, end, 0);
+}
+
+/**
+ * Append a key part to a normalized key. @a field points to
+ * the MsgPack value or is NULL if the field is absent. Return
+ * false if the part wasn't appended completely, because it
+ * can't be encoded or doesn't fit. Nothing may be appended
+ * after such a part.
+ */
+static bool
+inline_key_put_part(char **pos, const char *end,
+		    const struct key_part *part, const char *field)
+{
+	char *begin = *pos;
+	if (part->coll != NULL)
+		return false;
+	switch (part->type) {
+	case FIELD_TYPE_UNSIGNED:
+	case FIELD_TYPE_INTEGER:
+	case FIELD_TYPE_BOOLEAN:
+	case FIELD_TYPE_STRING:
+	case FIELD_TYPE_VARBINARY:
+		break;
+	default:
+		return false;
+	}
+	if (key_part_is_nullable(part)) {
+		bool is_null = field == NULL || mp_typeof(*field) == MP_NIL;
+		if (!inline_key_put(pos, end, is_null ? 0x00 : 0x01))
+			return false;
+		if (is_null)
+			return true;
+	}
+	if (field == NULL)
+		goto unexpected;
+	/*
+	 * Tuple fields are checked by the tuple format, but
+	 * a search key may have a value of another type, e.g.
+	 * a negative number for an unsigned field. Such a key
+	 * is only compared up to the previous part.
+	 */
+	uint32_t len;
+	switch (mp_typeof(*field)) {
+	case MP_UINT:
+		if (part->type == FIELD_TYPE_INTEGER) {
+			if (!inline_key_put(pos, end, 0x01))
+				return false;
+		} else if (part->type != FIELD_TYPE_UNSIGNED) {
+			goto unexpected;
+		}
+		return inline_key_put_uint64(pos, end, mp_decode_uint(&field));
+	case MP_INT:
+		if (part->type != FIELD_TYPE_INTEGER)
+			goto unexpected;
+		int64_t value = mp_decode_int(&field);
+		return inline_key_put(pos, end, value < 0 ? 0x00 : 0x01) &&
+		       inline_key_put_uint64(pos, end, value);
+	case MP_BOOL:
+		if (part->type != FIELD_TYPE_BOOLEAN)
+			goto unexpected;
+		return inline_key_put(pos, end, mp_decode_bool(&field));
+	case MP_STR:
+		if (part->type != FIELD_TYPE_STRING)
+			goto unexpected;
+		field = mp_decode_str(&field, &len);
+		return inline_key_put_str(pos, end, field, len);
+	case MP_BIN:
+		if (part->type != FIELD_TYPE_VARBINARY)
+			goto unexpected;
+		field = mp_decode_bin(&field, &len);
+		return inline_key_put_str(pos, end, field, len);
+	default:
+		break;
+	}
+unexpected:
+	*pos = begin;
+	return false;
+}
+
+/** Initialize a tree element for a tuple. */
+static inline void
+memtx_tree_data_create(struct memtx_tree_data *data, struct tuple *tuple,
+		       struct key_def *cmp_def)
+{
+	data->tuple = tuple;
+	char *pos = data->inline_key;
+	char *end = data->inline_key + MEMTX_TREE_INLINE_KEY_SIZE;
+	for (uint32_t i = 0; i < cmp_def->part_count; i++) {
+		struct key_part *part = &cmp_def->parts[i];
+		const char *field = tuple_field_by_part(tuple, part,
+							MULTIKEY_NONE);
+		if (!inline_key_put_part(&pos, end, part, field))
+			break;
+	}
+	memset(pos, 0, end - pos);
+}
+
+/** Initialize a search key. */
+static inline void
+memtx_tree_key_data_create(struct memtx_tree_key_data *data,
+			   const char *key, uint32_t part_count,
+			   struct key_def *cmp_def)
+{
+	data->key = key;
+	data->part_count = part_count;
+	char *pos = data->inline_key;
+	char *end = data->inline_key + MEMTX_TREE_INLINE_KEY_SIZE;
+	bool is_complete = true;
+	for (uint32_t i = 0; i < part_count; i++) {
+		if (!inline_key_put_part(&pos, end, &cmp_def->parts[i],
+					 key)) {
+			is_complete = false;
+			break;
+		}
+		mp_next(&key);
+	}
+	data->inline_key_len = pos - data->inline_key;
+	data->inline_key_is_complete = is_complete;
+}
+
+static inline int
+memtx_tree_data_compare(const struct memtx_tree_data *a,
+			const struct memtx_tree_data *b,
+			struct key_def *cmp_def)
+{
+	int rc = memcmp(a->inline_key, b->inline_key,
+			MEMTX_TREE_INLINE_KEY_SIZE);
+	if (rc != 0)
+		return rc;
+	return tuple_compare(a->tuple, HINT_NONE, b->tuple, HINT_NONE,
+			     cmp_def);
+}
+
+static inline int
+memtx_tree_data_compare_with_key(const struct memtx_tree_data *data,
+				 const struct memtx_tree_key_data *key,
+				 struct key_def *cmp_def)
+{
+	/*
+	 * The search key may have fewer parts than the tuple,
+	 * so only its own normalized prefix is compared.
+	 */
+	int rc = memcmp(data->inline_key, key->inline_key,
+			key->inline_key_len);
+	if (rc != 0 || key->inline_key_is_complete)
+		return rc;
+	return tuple_compare_with_key(data->tuple, HINT_NONE, key->key,
+				      key->part_count, HINT_NONE, cmp_def);
+}
+
+#else /* !MEMTX_TREE_INLINE_KEY */
+
+/** Initialize a tree element for a tuple. */
+static inline void
+memtx_tree_data_create(struct memtx_tree_data *data, struct tuple *tuple,
+		       struct key_def *cmp_def)
+{
+	data->tuple = tuple;
+	data->hint = tuple_hint(tuple, cmp_def);
+}
+
+/** Initialize a search key. */
+static inline void
+memtx_tree_key_data_create(struct memtx_tree_key_data *data,
+			   const char *key, uint32_t part_count,
+			   struct key_def *cmp_def)
+{
+	data->key = key;
+	data->part_count = part_count;
+	data->hint = key_hint(key, part_count, cmp_def);
+}
+
+static inline int
+memtx_tree_data_compare(const struct memtx_tree_data *a,
+			const struct memtx_tree_data *b,
+			struct key_def *cmp_def)
+{
+	return tuple_compare(a->tuple, a->hint, b->tuple, b->hint, cmp_def);
+}
+
+static inline int
+memtx_tree_data_compare_with_key(const struct memtx_tree_data *data,
+				 const struct memtx_tree_key_data *key,
+				 struct key_def *cmp_def)
+{
+	return tuple_compare_with_key(data->tuple, data->hint, key->key,
+				      key->part_count, key->hint, cmp_def);
+}
+
+#endif /* !MEMTX_TREE_INLINE_KEY */
+
 /**
  * Test whether BPS tree elements are identical i.e. represent
  * the same tuple at the same position in the tree.
@@ -80,13 +376,12 @@ memtx_tree_data_is_equal(const struct memtx_tree_data *a,
 #define BPS_TREE_NAME memtx_tree
 #define BPS_TREE_BLOCK_SIZE (512)
 #define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
-#define BPS_TREE_COMPARE(a, b, arg)\
-	tuple_compare((&a)->tuple, (&a)->hint, (&b)->tuple, (&b)->hint, arg)
+#define BPS_TREE_COMPARE(a, b, arg) memtx_tree_data_compare(&(a), &(b), arg)
 #define BPS_TREE_COMPARE_KEY(a, b, arg)\
-	tuple_compare_with_key((&a)->tuple, (&a)->hint, (b)->key,\
-			       (b)->part_count, (b)->hint, arg)
+	memtx_tree_data_compare_with_key(&(a), (b), arg)
 #define BPS_TREE_IS_IDENTICAL(a, b) memtx_tree_data_is_equal(&a, &b)
 #define BPS_TREE_NO_DEBUG 1
+#define BPS_TREE_INNER_CARD
 #define bps_tree_elem_t struct memtx_tree_data
 #define bps_tree_key_t struct memtx_tree_key_data *
 #define bps_tree_arg_t struct key_def *
@@ -100,6 +395,7 @@ memtx_tree_data_is_equal(const struct memtx_tree_data *a,
 #undef BPS_TREE_COMPARE_KEY
 #undef BPS_TREE_IS_IDENTICAL
 #undef BPS_TREE_NO_DEBUG
+#undef BPS_TREE_INNER_CARD
 #undef bps_tree_elem_t
 #undef bps_tree_key_t
 #undef bps_tree_arg_t
@@ -109,6 +405,11 @@ struct memtx_tree_index {
 	struct memtx_tree tree;
 	struct memtx_tree_data *build_array;
 	size_t build_array_size, build_array_alloc_size;
+	/**
+	 * Set if the build array has already been sorted by
+	 * memtx_tree_index_sort_build_array().
+	 */
+	bool build_array_is_sorted;
 	struct memtx_gc_task gc_task;
 	struct memtx_tree_iterator gc_iterator;
 };
@@ -127,8 +428,7 @@ memtx_tree_qcompare(const void* a, const void *b, void *c)
 	const struct memtx_tree_data *data_a = a;
 	const struct memtx_tree_data *data_b = b;
 	struct key_def *key_def = c;
-	return tuple_compare(data_a->tuple, data_a->hint, data_b->tuple,
-			     data_b->hint, key_def);
+	return memtx_tree_data_compare(data_a, data_b, key_def);
 }
 
 /* {{{ MemtxTree Iterators ****************************************/
@@ -175,7 +475,7 @@ tree_iterator_dummie(struct iterator *iterator, struct tuple **ret)
 }
 
 static int
-tree_iterator_next(struct iterator *iterator, struct tuple **ret)
+tree_iterator_next_base(struct iterator *iterator, struct tuple **ret)
 {
 	struct memtx_tree_index *index =
 		(struct memtx_tree_index *)iterator->index;
@@ -205,7 +505,7 @@ tree_iterator_next(struct iterator *iterator, struct tuple **ret)
 }
 
 static int
-tree_iterator_prev(struct iterator *iterator, struct tuple **ret)
+tree_iterator_prev_base(struct iterator *iterator, struct tuple **ret)
 {
 	struct memtx_tree_index *index =
 		(struct memtx_tree_index *)iterator->index;
@@ -234,7 +534,7 @@ tree_iterator_prev(struct iterator *iterator, struct tuple **ret)
 }
 
 static int
-tree_iterator_next_equal(struct iterator *iterator, struct tuple **ret)
+tree_iterator_next_equal_base(struct iterator *iterator, struct tuple **ret)
 {
 	struct memtx_tree_index *index =
 		(struct memtx_tree_index *)iterator->index;
@@ -253,11 +553,8 @@ tree_iterator_next_equal(struct iterator *iterator, struct tuple **ret)
 		memtx_tree_iterator_get_elem(&index->tree, &it->tree_iterator);
 	/* Use user key def to save a few loops. */
 	if (res == NULL ||
-	    tuple_compare_with_key(res->tuple, res->hint,
-				   it->key_data.key,
-				   it->key_data.part_count,
-				   it->key_data.hint,
-				   index->base.def->key_def) != 0) {
+	    memtx_tree_data_compare_with_key(res, &it->key_data,
+					     index->base.def->key_def) != 0) {
 		iterator->next = tree_iterator_dummie;
 		it->current.tuple = NULL;
 		*ret = NULL;
@@ -270,7 +567,7 @@ tree_iterator_next_equal(struct iterator *iterator, struct tuple **ret)
 }
 
 static int
-tree_iterator_prev_equal(struct iterator *iterator, struct tuple **ret)
+tree_iterator_prev_equal_base(struct iterator *iterator, struct tuple **ret)
 {
 	struct memtx_tree_index *index =
 		(struct memtx_tree_index *)iterator->index;
@@ -288,11 +585,8 @@ tree_iterator_prev_equal(struct iterator *iterator, struct tuple **ret)
 		memtx_tree_iterator_get_elem(&index->tree, &it->tree_iterator);
 	/* Use user key def to save a few loops. */
 	if (res == NULL ||
-	    tuple_compare_with_key(res->tuple, res->hint,
-				   it->key_data.key,
-				   it->key_data.part_count,
-				   it->key_data.hint,
-				   index->base.def->key_def) != 0) {
+	    memtx_tree_data_compare_with_key(res, &it->key_data,
+					     index->base.def->key_def) != 0) {
 		iterator->next = tree_iterator_dummie;
 		it->current.tuple = NULL;
 		*ret = NULL;
@@ -304,6 +598,35 @@ tree_iterator_prev_equal(struct iterator *iterator, struct tuple **ret)
 	return 0;
 }
 
+/**
+ * Iterator methods return tuples as they are stored in the
+ * index. With the transaction manager on, a stored tuple may
+ * be invisible to the current transaction or be a newer
+ * version of a visible one, so the methods are wrapped to
+ * skip or replace such tuples.
+ */
+#define WRAP_ITERATOR_METHOD(name)						\
+static int									\
+name(struct iterator *iterator, struct tuple **ret)				\
+{										\
+	struct txn *txn = in_txn();						\
+	do {									\
+		int rc = name##_base(iterator, ret);				\
+		if (rc != 0 || *ret == NULL)					\
+			return rc;						\
+		*ret = memtx_tx_tuple_clarify(txn, iterator->index, *ret);	\
+	} while (*ret == NULL);							\
+	return 0;								\
+}										\
+struct forgot_to_add_semicolon
+
+WRAP_ITERATOR_METHOD(tree_iterator_next);
+WRAP_ITERATOR_METHOD(tree_iterator_prev);
+WRAP_ITERATOR_METHOD(tree_iterator_next_equal);
+WRAP_ITERATOR_METHOD(tree_iterator_prev_equal);
+
+#undef WRAP_ITERATOR_METHOD
+
 static void
 tree_iterator_set_next_method(struct tree_iterator *it)
 {
@@ -333,7 +656,7 @@ tree_iterator_set_next_method(struct tree_iterator *it)
 }
 
 static int
-tree_iterator_start(struct iterator *iterator, struct tuple **ret)
+tree_iterator_start_base(struct iterator *iterator, struct tuple **ret)
 {
 	*ret = NULL;
 	struct memtx_tree_index *index =
@@ -391,6 +714,94 @@ tree_iterator_start(struct iterator *iterator, struct tuple **ret)
 	return 0;
 }
 
+static int
+tree_iterator_start(struct iterator *iterator, struct tuple **ret)
+{
+	if (tree_iterator_start_base(iterator, ret) != 0 || *ret == NULL)
+		return 0;
+	*ret = memtx_tx_tuple_clarify(in_txn(), iterator->index, *ret);
+	if (*ret == NULL)
+		return iterator->next(iterator, ret);
+	return 0;
+}
+
+/**
+ * Skip the first count tuples of a fresh iterator's range. The
+ * tuple to continue from is looked up by its ordinal position in
+ * the tree instead of stepping over the skipped tuples.
+ */
+static int
+tree_iterator_skip(struct iterator *iterator, uint32_t *count)
+{
+	struct tree_iterator *it = tree_iterator(iterator);
+	/*
+	 * With the transaction manager on, some of the tuples
+	 * may be invisible, so we can't tell how many of them
+	 * to skip without looking at each one.
+	 */
+	if (iterator->next != tree_iterator_start ||
+	    memtx_tx_manager_use_mvcc_engine)
+		return 0;
+	struct memtx_tree_index *index =
+		(struct memtx_tree_index *)iterator->index;
+	struct memtx_tree *tree = &index->tree;
+	/* The range of the iterator is [begin, end) in tree order. */
+	size_t begin = 0;
+	size_t end = memtx_tree_size(tree);
+	if (it->key_data.key != NULL) {
+		switch (it->type) {
+		case ITER_EQ:
+		case ITER_REQ:
+			begin = memtx_tree_lower_bound_offset(tree,
+						&it->key_data, NULL);
+			end = memtx_tree_upper_bound_offset(tree,
+						&it->key_data, NULL);
+			break;
+		case ITER_ALL:
+		case ITER_GE:
+			begin = memtx_tree_lower_bound_offset(tree,
+						&it->key_data, NULL);
+			break;
+		case ITER_GT:
+			begin = memtx_tree_upper_bound_offset(tree,
+						&it->key_data, NULL);
+			break;
+		case ITER_LT:
+			end = memtx_tree_lower_bound_offset(tree,
+						&it->key_data, NULL);
+			break;
+		case ITER_LE:
+			end = memtx_tree_upper_bound_offset(tree,
+						&it->key_data, NULL);
+			break;
+		default:
+			unreachable();
+		}
+	}
+	if (*count >= end - begin) {
+		/* All tuples of the range are skipped. */
+		*count = 0;
+		iterator->next = tree_iterator_dummie;
+		return 0;
+	}
+	/*
+	 * Make the iterator point to the tuple preceding the
+	 * target one in the iteration order, so that next()
+	 * returns the target.
+	 */
+	size_t offset = iterator_type_is_reverse(it->type) ?
+			end - *count : begin + *count - 1;
+	it->tree_iterator = memtx_tree_iterator_at(tree, offset);
+	struct memtx_tree_data *res =
+		memtx_tree_iterator_get_elem(tree, &it->tree_iterator);
+	assert(res != NULL);
+	tuple_ref(res->tuple);
+	it->current = *res;
+	tree_iterator_set_next_method(it);
+	*count = 0;
+	return 0;
+}
+
 /* }}} */
 
 /* {{{ MemtxTree  **********************************************************/
@@ -513,7 +924,8 @@ memtx_tree_index_random(struct index *base, uint32_t rnd, struct tuple **result)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct memtx_tree_data *res = memtx_tree_random(&index->tree, rnd);
-	*result = res != NULL ? res->tuple : NULL;
+	*result = res != NULL ?
+		  memtx_tx_tuple_clarify(in_txn(), base, res->tuple) : NULL;
 	return 0;
 }
 
@@ -521,9 +933,45 @@ static ssize_t
 memtx_tree_index_count(struct index *base, enum iterator_type type,
 		       const char *key, uint32_t part_count)
 {
+	/*
+	 * With the transaction manager on, some of the tuples
+	 * may be invisible, so we have to check each of them.
+	 */
+	if (memtx_tx_manager_use_mvcc_engine)
+		return generic_index_count(base, type, key, part_count);
 	if (type == ITER_ALL)
 		return memtx_tree_index_size(base); /* optimization */
-	return generic_index_count(base, type, key, part_count);
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct memtx_tree *tree = &index->tree;
+	size_t size = memtx_tree_size(tree);
+	if (part_count == 0)
+		return size;
+	/*
+	 * Inner blocks of the tree store the number of tuples in
+	 * their subtrees, so the number of tuples less than a key
+	 * is found in a single descent.
+	 */
+	struct memtx_tree_key_data key_data;
+	memtx_tree_key_data_create(&key_data, key, part_count,
+				   memtx_tree_cmp_def(tree));
+	switch (type) {
+	case ITER_EQ:
+	case ITER_REQ:
+		return memtx_tree_upper_bound_offset(tree, &key_data, NULL) -
+		       memtx_tree_lower_bound_offset(tree, &key_data, NULL);
+	case ITER_GE:
+		return size - memtx_tree_lower_bound_offset(tree, &key_data,
+							    NULL);
+	case ITER_GT:
+		return size - memtx_tree_upper_bound_offset(tree, &key_data,
+							    NULL);
+	case ITER_LT:
+		return memtx_tree_lower_bound_offset(tree, &key_data, NULL);
+	case ITER_LE:
+		return memtx_tree_upper_bound_offset(tree, &key_data, NULL);
+	default:
+		return generic_index_count(base, type, key, part_count);
+	}
 }
 
 static int
@@ -535,11 +983,13 @@ memtx_tree_index_get(struct index *base, const char *key,
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
 	struct memtx_tree_key_data key_data;
-	key_data.key = key;
-	key_data.part_count = part_count;
-	key_data.hint = key_hint(key, part_count, cmp_def);
+	memtx_tree_key_data_create(&key_data, key, part_count, cmp_def);
 	struct memtx_tree_data *res = memtx_tree_find(&index->tree, &key_data);
-	*result = res != NULL ? res->tuple : NULL;
+	struct txn *txn = in_txn();
+	*result = res != NULL ?
+		  memtx_tx_tuple_clarify(txn, base, res->tuple) : NULL;
+	if (*result == NULL)
+		memtx_tx_track_gap(txn, base, ITER_EQ, key, part_count);
 	return 0;
 }
 
@@ -552,8 +1002,7 @@ memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
 	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
 	if (new_tuple) {
 		struct memtx_tree_data new_data;
-		new_data.tuple = new_tuple;
-		new_data.hint = tuple_hint(new_tuple, cmp_def);
+		memtx_tree_data_create(&new_data, new_tuple, cmp_def);
 		struct memtx_tree_data dup_data;
 		dup_data.tuple = NULL;
 
@@ -585,14 +1034,15 @@ memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
 	}
 	if (old_tuple) {
 		struct memtx_tree_data old_data;
-		old_data.tuple = old_tuple;
-		old_data.hint = tuple_hint(old_tuple, cmp_def);
+		memtx_tree_data_create(&old_data, old_tuple, cmp_def);
 		memtx_tree_delete(&index->tree, old_data);
 	}
 	*result = old_tuple;
 	return 0;
 }
 
+#if !MEMTX_TREE_INLINE_KEY
+
 /**
  * Perform tuple insertion by given multikey index.
  * In case of replacement, all old tuple entries are deleted
@@ -972,6 +1422,8 @@ end:
 	return rc;
 }
 
+#endif /* !MEMTX_TREE_INLINE_KEY */
+
 static struct iterator *
 memtx_tree_index_create_iterator(struct index *base, enum iterator_type type,
 				 const char *key, uint32_t part_count)
@@ -1005,13 +1457,13 @@ memtx_tree_index_create_iterator(struct index *base, enum iterator_type type,
 	iterator_create(&it->base, base);
 	it->pool = &memtx->iterator_pool;
 	it->base.next = tree_iterator_start;
+	it->base.skip = tree_iterator_skip;
 	it->base.free = tree_iterator_free;
 	it->type = type;
-	it->key_data.key = key;
-	it->key_data.part_count = part_count;
-	it->key_data.hint = key_hint(key, part_count, cmp_def);
+	memtx_tree_key_data_create(&it->key_data, key, part_count, cmp_def);
 	it->tree_iterator = memtx_tree_invalid_iterator();
 	it->current.tuple = NULL;
+	memtx_tx_track_gap(in_txn(), base, type, key, part_count);
 	return (struct iterator *)it;
 }
 
@@ -1041,10 +1493,10 @@ memtx_tree_index_reserve(struct index *base, uint32_t size_hint)
 	return 0;
 }
 
-/** Initialize the next element of the index build_array. */
+/** Append an element to the index build_array. */
 static int
 memtx_tree_index_build_array_append(struct memtx_tree_index *index,
-				    struct tuple *tuple, hint_t hint)
+				    const struct memtx_tree_data *data)
 {
 	if (index->build_array == NULL) {
 		index->build_array = malloc(MEMTX_EXTENT_SIZE);
@@ -1070,10 +1522,7 @@ memtx_tree_index_build_array_append(struct memtx_tree_index *index,
 		}
 		index->build_array = tmp;
 	}
-	struct memtx_tree_data *elem =
-		&index->build_array[index->build_array_size++];
-	elem->tuple = tuple;
-	elem->hint = hint;
+	index->build_array[index->build_array_size++] = *data;
 	return 0;
 }
 
@@ -1082,20 +1531,25 @@ memtx_tree_index_build_next(struct index *base, struct tuple *tuple)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
-	return memtx_tree_index_build_array_append(index, tuple,
-						   tuple_hint(tuple, cmp_def));
+	struct memtx_tree_data data;
+	memtx_tree_data_create(&data, tuple, cmp_def);
+	return memtx_tree_index_build_array_append(index, &data);
 }
 
+#if !MEMTX_TREE_INLINE_KEY
+
 static int
 memtx_tree_index_build_next_multikey(struct index *base, struct tuple *tuple)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
 	uint32_t multikey_count = tuple_multikey_count(tuple, cmp_def);
+	struct memtx_tree_data data;
+	data.tuple = tuple;
 	for (uint32_t multikey_idx = 0; multikey_idx < multikey_count;
 	     multikey_idx++) {
-		if (memtx_tree_index_build_array_append(index, tuple,
-							multikey_idx) != 0)
+		data.hint = multikey_idx;
+		if (memtx_tree_index_build_array_append(index, &data) != 0)
 			return -1;
 	}
 	return 0;
@@ -1118,9 +1572,11 @@ memtx_tree_func_index_build_next(struct index *base, struct tuple *tuple)
 
 	const char *key;
 	uint32_t insert_idx = index->build_array_size;
+	struct memtx_tree_data data;
+	data.tuple = tuple;
 	while (key_list_iterator_next(&it, &key) == 0 && key != NULL) {
-		if (memtx_tree_index_build_array_append(index, tuple,
-							(hint_t)key) != 0)
+		data.hint = (hint_t)key;
+		if (memtx_tree_index_build_array_append(index, &data) != 0)
 			goto error;
 	}
 	assert(key == NULL);
@@ -1175,13 +1631,52 @@ memtx_tree_index_build_array_deduplicate(struct memtx_tree_index *index,
 	index->build_array_size = w_idx + 1;
 }
 
+#endif /* !MEMTX_TREE_INLINE_KEY */
+
+void
+memtx_tree_index_sort_build_array(struct index *base, bool multithread)
+{
+	assert(base->def->type == TREE);
+#if !MEMTX_TREE_INLINE_KEY
+	if (base->def->opts.inline_key) {
+		memtx_tree_inline_index_sort_build_array(base, multithread);
+		return;
+	}
+#endif
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
+	if (multithread) {
+		qsort_arg(index->build_array, index->build_array_size,
+			  sizeof(index->build_array[0]),
+			  memtx_tree_qcompare, cmp_def);
+	} else {
+		qsort_arg_st(index->build_array, index->build_array_size,
+			     sizeof(index->build_array[0]),
+			     memtx_tree_qcompare, cmp_def);
+	}
+	index->build_array_is_sorted = true;
+}
+
+bool
+memtx_tree_index_build_array_is_big(struct index *base)
+{
+	assert(base->def->type == TREE);
+#if !MEMTX_TREE_INLINE_KEY
+	if (base->def->opts.inline_key)
+		return memtx_tree_inline_index_build_array_is_big(base);
+#endif
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	return qsort_arg_is_mt(index->build_array_size);
+}
+
 static void
 memtx_tree_index_end_build(struct index *base)
 {
 	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
 	struct key_def *cmp_def = memtx_tree_cmp_def(&index->tree);
-	qsort_arg(index->build_array, index->build_array_size,
-		  sizeof(index->build_array[0]), memtx_tree_qcompare, cmp_def);
+	if (!index->build_array_is_sorted)
+		memtx_tree_index_sort_build_array(base, true);
+#if !MEMTX_TREE_INLINE_KEY
 	if (cmp_def->is_multikey) {
 		/*
 		 * Multikey index may have equal(in terms of
@@ -1195,6 +1690,9 @@ memtx_tree_index_end_build(struct index *base)
 		memtx_tree_index_build_array_deduplicate(index,
 							 tuple_chunk_delete);
 	}
+#else
+	(void)cmp_def;
+#endif
 	memtx_tree_build(&index->tree, index->build_array,
 			 index->build_array_size);
 
@@ -1202,12 +1700,15 @@ memtx_tree_index_end_build(struct index *base)
 	index->build_array = NULL;
 	index->build_array_size = 0;
 	index->build_array_alloc_size = 0;
+	index->build_array_is_sorted = false;
 }
 
 struct tree_snapshot_iterator {
 	struct snapshot_iterator base;
 	struct memtx_tree_index *index;
 	struct memtx_tree_iterator tree_iterator;
+	/** Filters out changes of in-progress transactions. */
+	struct memtx_tx_snapshot_cleaner cleaner;
 };
 
 static void
@@ -1220,6 +1721,7 @@ tree_snapshot_iterator_free(struct snapshot_iterator *iterator)
 				      it->index->base.engine);
 	memtx_tree_iterator_destroy(&it->index->tree, &it->tree_iterator);
 	index_unref(&it->index->base);
+	memtx_tx_snapshot_cleaner_destroy(&it->cleaner);
 	free(iterator);
 }
 
@@ -1231,14 +1733,18 @@ tree_snapshot_iterator_next(struct snapshot_iterator *iterator,
 	struct tree_snapshot_iterator *it =
 		(struct tree_snapshot_iterator *)iterator;
 	struct memtx_tree *tree = &it->index->tree;
-	struct memtx_tree_data *res = memtx_tree_iterator_get_elem(tree,
-							&it->tree_iterator);
-	if (res == NULL) {
-		*data = NULL;
-		return 0;
-	}
-	memtx_tree_iterator_next(tree, &it->tree_iterator);
-	*data = tuple_data_range(res->tuple, size);
+	struct tuple *tuple;
+	do {
+		struct memtx_tree_data *res =
+			memtx_tree_iterator_get_elem(tree, &it->tree_iterator);
+		if (res == NULL) {
+			*data = NULL;
+			return 0;
+		}
+		memtx_tree_iterator_next(tree, &it->tree_iterator);
+		tuple = memtx_tx_snapshot_clarify(&it->cleaner, res->tuple);
+	} while (tuple == NULL);
+	*data = tuple_data_range(tuple, size);
 	return 0;
 }
 
@@ -1258,6 +1764,12 @@ memtx_tree_index_create_snapshot_iterator(struct index *base)
 			 "memtx_tree_index", "create_snapshot_iterator");
 		return NULL;
 	}
+	struct space *space = space_by_id(base->def->space_id);
+	if (memtx_tx_snapshot_cleaner_create(&it->cleaner, space,
+					     "memtx_tree_index") != 0) {
+		free(it);
+		return NULL;
+	}
 
 	it->base.free = tree_snapshot_iterator_free;
 	it->base.next = tree_snapshot_iterator_next;
@@ -1286,6 +1798,7 @@ static const struct index_vtab memtx_tree_index_vtab = {
 	/* .random = */ memtx_tree_index_random,
 	/* .count = */ memtx_tree_index_count,
 	/* .get = */ memtx_tree_index_get,
+	/* .get_many = */ generic_index_get_many,
 	/* .replace = */ memtx_tree_index_replace,
 	/* .create_iterator = */ memtx_tree_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -1299,6 +1812,8 @@ static const struct index_vtab memtx_tree_index_vtab = {
 	/* .end_build = */ memtx_tree_index_end_build,
 };
 
+#if !MEMTX_TREE_INLINE_KEY
+
 static const struct index_vtab memtx_tree_index_multikey_vtab = {
 	/* .destroy = */ memtx_tree_index_destroy,
 	/* .commit_create = */ generic_index_commit_create,
@@ -1316,6 +1831,7 @@ static const struct index_vtab memtx_tree_index_multikey_vtab = {
 	/* .random = */ memtx_tree_index_random,
 	/* .count = */ memtx_tree_index_count,
 	/* .get = */ memtx_tree_index_get,
+	/* .get_many = */ generic_index_get_many,
 	/* .replace = */ memtx_tree_index_replace_multikey,
 	/* .create_iterator = */ memtx_tree_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -1346,6 +1862,7 @@ static const struct index_vtab memtx_tree_func_index_vtab = {
 	/* .random = */ memtx_tree_index_random,
 	/* .count = */ memtx_tree_index_count,
 	/* .get = */ memtx_tree_index_get,
+	/* .get_many = */ generic_index_get_many,
 	/* .replace = */ memtx_tree_func_index_replace,
 	/* .create_iterator = */ memtx_tree_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -1382,6 +1899,7 @@ static const struct index_vtab memtx_tree_disabled_index_vtab = {
 	/* .random = */ generic_index_random,
 	/* .count = */ generic_index_count,
 	/* .get = */ generic_index_get,
+	/* .get_many = */ generic_index_get_many,
 	/* .replace = */ disabled_index_replace,
 	/* .create_iterator = */ generic_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -1395,9 +1913,15 @@ static const struct index_vtab memtx_tree_disabled_index_vtab = {
 	/* .end_build = */ generic_index_end_build,
 };
 
+#endif /* !MEMTX_TREE_INLINE_KEY */
+
 struct index *
 memtx_tree_index_new(struct memtx_engine *memtx, struct index_def *def)
 {
+#if !MEMTX_TREE_INLINE_KEY
+	if (def->opts.inline_key)
+		return memtx_tree_inline_index_new(memtx, def);
+#endif
 	struct memtx_tree_index *index =
 		(struct memtx_tree_index *)calloc(1, sizeof(*index));
 	if (index == NULL) {
@@ -1406,6 +1930,10 @@ memtx_tree_index_new(struct memtx_engine *memtx, struct index_def *def)
 		return NULL;
 	}
 	const struct index_vtab *vtab;
+#if MEMTX_TREE_INLINE_KEY
+	assert(!def->key_def->for_func_index && !def->key_def->is_multikey);
+	vtab = &memtx_tree_index_vtab;
+#else
 	if (def->key_def->for_func_index) {
 		if (def->key_def->func_index_func == NULL)
 			vtab = &memtx_tree_disabled_index_vtab;
@@ -1416,6 +1944,7 @@ memtx_tree_index_new(struct memtx_engine *memtx, struct index_def *def)
 	} else {
 		vtab = &memtx_tree_index_vtab;
 	}
+#endif
 	if (index_create(&index->base, (struct engine *)memtx,
 			 vtab, def) != 0) {
 		free(index);
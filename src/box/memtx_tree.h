@@ -30,6 +30,7 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <stdbool.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -42,6 +43,40 @@ struct memtx_engine;
 struct index *
 memtx_tree_index_new(struct memtx_engine *memtx, struct index_def *def);
 
+/**
+ * Sort tuples accumulated by index_build_next() so that the
+ * following index_end_build() only has to bulk-load the tree.
+ * The function doesn't access anything but the build array and
+ * the tuples it refers to, so it may be called from a thread
+ * other than tx. If multithread is set, the array is sorted by
+ * the multithreaded qsort_arg(), otherwise only the calling
+ * thread is used.
+ */
+void
+memtx_tree_index_sort_build_array(struct index *index, bool multithread);
+
+/**
+ * Return true if the build array of the index is big enough for
+ * qsort_arg() to sort it using several threads.
+ */
+bool
+memtx_tree_index_build_array_is_big(struct index *index);
+
+/**
+ * Implementation of TREE indexes with the inline_key option,
+ * see memtx_tree_inline.c. The functions above dispatch to it,
+ * so they needn't be called directly.
+ */
+struct index *
+memtx_tree_inline_index_new(struct memtx_engine *memtx, struct index_def *def);
+
+void
+memtx_tree_inline_index_sort_build_array(struct index *index,
+					 bool multithread);
+
+bool
+memtx_tree_inline_index_build_array_is_big(struct index *index);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -0,0 +1,1017 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_tx.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <msgpuck.h>
+#include <small/mempool.h>
+
+#include "diag.h"
+#include "errcode.h"
+#include "fiber.h"
+#include "index.h"
+#include "memtx_space.h"
+#include "schema.h"
+#include "schema_def.h"
+#include "space.h"
+#include "trivia/util.h"
+#include "tuple.h"
+#include "txn.h"
+
+bool memtx_tx_manager_use_mvcc_engine = false;
+
+/**
+ * Link of a story in a chain of versions of the same key
+ * in an index. The newest version is stored in the index.
+ */
+struct memtx_story_link {
+	/** Version that replaced this one, NULL if in the index. */
+	struct memtx_story *newer;
+	/** Version replaced by this one. */
+	struct memtx_story *older;
+};
+
+/**
+ * History of a dirty tuple.
+ */
+struct memtx_story {
+	/** The tuple. Its is_dirty flag is set. */
+	struct tuple *tuple;
+	/** Space the tuple belongs to. */
+	struct space *space;
+	/**
+	 * Statement that inserted the tuple, NULL if the
+	 * tuple is committed (or prepared).
+	 */
+	struct txn_stmt *add_stmt;
+	/**
+	 * List of statements of in-progress transactions that
+	 * deleted the tuple, linked by next_in_del_list.
+	 */
+	struct txn_stmt *del_stmt;
+	/** Trackers of transactions that read the tuple. */
+	struct rlist reader_list;
+	/** Link in tx_manager::all_stories. */
+	struct rlist in_all_stories;
+	/** Number of indexes of the space. */
+	uint32_t index_count;
+	/** Chain links, one per index. */
+	struct memtx_story_link link[];
+};
+
+/**
+ * Record of a tuple read by an in-progress transaction.
+ */
+struct memtx_tx_read_tracker {
+	/** Transaction that read the tuple. */
+	struct txn *reader;
+	/** Story of the tuple. */
+	struct memtx_story *story;
+	/** Link in memtx_story::reader_list. */
+	struct rlist in_reader_list;
+	/** Link in txn::read_set. */
+	struct rlist in_read_set;
+};
+
+/**
+ * Record of a range of keys read by an in-progress transaction
+ * from an index: all keys matching a search key with an iterator
+ * type. Unlike a read tracker, it also covers keys that weren't
+ * found, so that a tuple inserted into the range by another
+ * transaction conflicts with the reader.
+ */
+struct memtx_tx_gap_tracker {
+	/** Transaction that read the range. */
+	struct txn *reader;
+	/** Index the range was read from. */
+	struct index *index;
+	/** Iterator type. */
+	enum iterator_type type;
+	/** Number of parts in the search key. */
+	uint32_t part_count;
+	/** Size of the search key. */
+	uint32_t key_size;
+	/** Link in memtx_space::gap_list. */
+	struct rlist in_gap_list;
+	/** Link in txn::gap_set. */
+	struct rlist in_gap_set;
+	/** Search key, MsgPack. */
+	char key[0];
+};
+
+static inline uint32_t
+memtx_tx_tuple_hash(const struct tuple *tuple)
+{
+	uintptr_t u = (uintptr_t)tuple;
+#if UINTPTR_MAX == 0xffffffff
+	return u;
+#else
+	return (uint32_t)(u >> 33 ^ u ^ u << 11);
+#endif
+}
+
+/* Map: tuple -> its story. */
+#define mh_name _history
+#define mh_key_t struct tuple *
+#define mh_node_t struct memtx_story *
+#define mh_arg_t int
+#define mh_hash(a, arg) (memtx_tx_tuple_hash((*(a))->tuple))
+#define mh_hash_key(a, arg) (memtx_tx_tuple_hash(a))
+#define mh_cmp(a, b, arg) ((*(a))->tuple != (*(b))->tuple)
+#define mh_cmp_key(a, b, arg) ((a) != (*(b))->tuple)
+#define MH_SOURCE 1
+#include "salad/mhash.h"
+
+struct memtx_tx_snapshot_cleaner_entry {
+	/** Tuple stored in the index. */
+	struct tuple *from;
+	/** Its committed version, NULL if none. */
+	struct tuple *to;
+};
+
+/* Map: dirty tuple -> its committed version. */
+#define mh_name _snapshot_cleaner
+#define mh_key_t struct tuple *
+#define mh_node_t struct memtx_tx_snapshot_cleaner_entry
+#define mh_arg_t int
+#define mh_hash(a, arg) (memtx_tx_tuple_hash((a)->from))
+#define mh_hash_key(a, arg) (memtx_tx_tuple_hash(a))
+#define mh_cmp(a, b, arg) ((a)->from != (b)->from)
+#define mh_cmp_key(a, b, arg) ((a) != (b)->from)
+#define MH_SOURCE 1
+#include "salad/mhash.h"
+
+struct tx_manager {
+	/** Map of all dirty tuples to their stories. */
+	struct mh_history_t *history;
+	/** All stories, linked by memtx_story::in_all_stories. */
+	struct rlist all_stories;
+	/**
+	 * In-progress transactions that changed versioned
+	 * spaces or read from them, linked by txn::in_all_txs.
+	 */
+	struct rlist all_txs;
+	/** Story pools, by the number of indexes. */
+	struct mempool story_pool[BOX_INDEX_MAX + 1];
+	/** Pool of read trackers. */
+	struct mempool read_tracker_pool;
+	/**
+	 * Number of running DDL operations that suspended
+	 * versioning, see memtx_tx_begin_ddl().
+	 */
+	int ddl_in_progress;
+};
+
+static struct tx_manager txm;
+
+void
+memtx_tx_manager_init(void)
+{
+	txm.history = mh_history_new();
+	if (txm.history == NULL)
+		panic("failed to allocate memtx tx history");
+	rlist_create(&txm.all_stories);
+	rlist_create(&txm.all_txs);
+	mempool_create(&txm.read_tracker_pool, cord_slab_cache(),
+		       sizeof(struct memtx_tx_read_tracker));
+	txm.ddl_in_progress = 0;
+}
+
+void
+memtx_tx_manager_free(void)
+{
+	for (int i = 0; i <= BOX_INDEX_MAX; i++) {
+		if (mempool_is_initialized(&txm.story_pool[i]))
+			mempool_destroy(&txm.story_pool[i]);
+	}
+	mempool_destroy(&txm.read_tracker_pool);
+	mh_history_delete(txm.history);
+}
+
+bool
+memtx_tx_space_is_versioned(struct space *space)
+{
+	if (!memtx_tx_manager_use_mvcc_engine || txm.ddl_in_progress > 0)
+		return false;
+	if (space->def->opts.is_ephemeral || space_is_system(space))
+		return false;
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	if (memtx_space->replace != memtx_space_replace_all_keys ||
+	    space->index_count == 0)
+		return false;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct index_def *def = space->index[i]->def;
+		if (def->type != TREE && def->type != HASH)
+			return false;
+		if (def->key_def->is_multikey || def->key_def->for_func_index)
+			return false;
+	}
+	return true;
+}
+
+/** Add a transaction to the list of in-progress ones. */
+static void
+memtx_tx_register_tx(struct txn *txn)
+{
+	if (rlist_empty(&txn->in_all_txs))
+		rlist_add_tail_entry(&txm.all_txs, txn, in_all_txs);
+}
+
+/* {{{ Stories */
+
+static struct memtx_story *
+memtx_tx_story_new(struct space *space, struct tuple *tuple)
+{
+	assert(!tuple->is_dirty);
+	uint32_t index_count = space->index_count;
+	assert(index_count <= BOX_INDEX_MAX);
+	size_t size = sizeof(struct memtx_story) +
+		      index_count * sizeof(struct memtx_story_link);
+	struct mempool *pool = &txm.story_pool[index_count];
+	if (!mempool_is_initialized(pool))
+		mempool_create(pool, cord_slab_cache(), size);
+	struct memtx_story *story = mempool_alloc(pool);
+	if (story == NULL) {
+		diag_set(OutOfMemory, size, "mempool_alloc", "story");
+		return NULL;
+	}
+	story->tuple = tuple;
+	mh_int_t pos = mh_history_put(txm.history,
+				      (const struct memtx_story **)&story,
+				      NULL, 0);
+	if (pos == mh_end(txm.history)) {
+		mempool_free(pool, story);
+		diag_set(OutOfMemory, pos + 1, "mh_history_put",
+			 "mh_history_node");
+		return NULL;
+	}
+	tuple->is_dirty = true;
+	story->space = space;
+	story->add_stmt = NULL;
+	story->del_stmt = NULL;
+	rlist_create(&story->reader_list);
+	rlist_add_tail_entry(&txm.all_stories, story, in_all_stories);
+	story->index_count = index_count;
+	memset(story->link, 0, index_count * sizeof(struct memtx_story_link));
+	return story;
+}
+
+static struct memtx_story *
+memtx_tx_story_get(struct tuple *tuple)
+{
+	assert(tuple->is_dirty);
+	mh_int_t pos = mh_history_find(txm.history, tuple, 0);
+	assert(pos != mh_end(txm.history));
+	return *mh_history_node(txm.history, pos);
+}
+
+/** Get the story of a tuple, creating it if the tuple is clean. */
+static struct memtx_story *
+memtx_tx_story_get_or_new(struct space *space, struct tuple *tuple)
+{
+	if (tuple->is_dirty)
+		return memtx_tx_story_get(tuple);
+	return memtx_tx_story_new(space, tuple);
+}
+
+static void
+memtx_tx_read_tracker_delete(struct memtx_tx_read_tracker *tracker)
+{
+	rlist_del(&tracker->in_reader_list);
+	rlist_del(&tracker->in_read_set);
+	mempool_free(&txm.read_tracker_pool, tracker);
+}
+
+/**
+ * Delete a story and make its tuple clean. The story must not
+ * be linked with other stories.
+ */
+static void
+memtx_tx_story_delete(struct memtx_story *story)
+{
+	assert(story->add_stmt == NULL && story->del_stmt == NULL);
+	struct memtx_tx_read_tracker *tracker, *tmp;
+	rlist_foreach_entry_safe(tracker, &story->reader_list,
+				 in_reader_list, tmp)
+		memtx_tx_read_tracker_delete(tracker);
+	rlist_del(&story->in_all_stories);
+	mh_int_t pos = mh_history_find(txm.history, story->tuple, 0);
+	assert(pos != mh_end(txm.history));
+	mh_history_del(txm.history, pos, 0);
+	story->tuple->is_dirty = false;
+	mempool_free(&txm.story_pool[story->index_count], story);
+}
+
+/**
+ * Delete a story if it's no longer needed: the tuple is
+ * committed, not deleted, not read, and it's the only
+ * version of its keys.
+ */
+static void
+memtx_tx_story_try_gc(struct memtx_story *story)
+{
+	if (story->add_stmt != NULL || story->del_stmt != NULL ||
+	    !rlist_empty(&story->reader_list))
+		return;
+	for (uint32_t i = 0; i < story->index_count; i++) {
+		if (story->link[i].newer != NULL ||
+		    story->link[i].older != NULL)
+			return;
+	}
+	memtx_tx_story_delete(story);
+}
+
+/**
+ * Remove a story from the chain of an index. If the story
+ * is at the top of the chain, the index is updated to hold
+ * the previous version.
+ */
+static void
+memtx_tx_story_unlink(struct memtx_story *story, uint32_t iid)
+{
+	struct memtx_story_link *link = &story->link[iid];
+	if (link->newer != NULL) {
+		link->newer->link[iid].older = link->older;
+	} else {
+		struct tuple *older = link->older != NULL ?
+				      link->older->tuple : NULL;
+		struct index *index = story->space->index[iid];
+		struct tuple *unused;
+		/* Rollback must not fail. */
+		if (index_replace(index, story->tuple, older,
+				  DUP_INSERT, &unused) != 0) {
+			diag_log();
+			unreachable();
+			panic("failed to rollback change");
+		}
+	}
+	if (link->older != NULL)
+		link->older->link[iid].newer = link->newer;
+	link->newer = NULL;
+	link->older = NULL;
+}
+
+static bool
+memtx_tx_story_is_visible(struct memtx_story *story, struct txn *txn)
+{
+	if (story->add_stmt != NULL && story->add_stmt->txn != txn)
+		return false;
+	for (struct txn_stmt *stmt = story->del_stmt; stmt != NULL;
+	     stmt = stmt->next_in_del_list) {
+		if (stmt->txn == txn)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Find the newest version visible to a transaction in the
+ * chain of an index starting from the given story.
+ */
+static struct memtx_story *
+memtx_tx_story_find_visible(struct memtx_story *story, uint32_t iid,
+			    struct txn *txn)
+{
+	while (story != NULL && !memtx_tx_story_is_visible(story, txn))
+		story = story->link[iid].older;
+	return story;
+}
+
+/* }}} */
+
+/* {{{ Reads */
+
+static void
+memtx_tx_track_read(struct txn *txn, struct index *index,
+		    struct memtx_story *story, struct tuple *tuple)
+{
+	/*
+	 * A transaction that can't yield can't be conflicted
+	 * before it's prepared, no need to track its reads.
+	 */
+	if (txn == NULL || !txn_has_flag(txn, TXN_CAN_YIELD) ||
+	    txn_has_flag(txn, TXN_IS_CONFLICTED) ||
+	    txm.ddl_in_progress > 0)
+		return;
+	if (story == NULL) {
+		struct space *space = space_by_id(index->def->space_id);
+		if (space == NULL || !memtx_tx_space_is_versioned(space))
+			return;
+		story = memtx_tx_story_new(space, tuple);
+	} else if (story->add_stmt != NULL) {
+		/* Own uncommitted change, nobody can overwrite it. */
+		return;
+	} else {
+		struct memtx_tx_read_tracker *tracker;
+		rlist_foreach_entry(tracker, &story->reader_list,
+				    in_reader_list) {
+			if (tracker->reader == txn)
+				return;
+		}
+	}
+	struct memtx_tx_read_tracker *tracker = NULL;
+	if (story != NULL)
+		tracker = mempool_alloc(&txm.read_tracker_pool);
+	if (tracker == NULL) {
+		/*
+		 * We can't guarantee serializability without
+		 * the tracker, so abort the transaction.
+		 */
+		if (story == NULL)
+			diag_log();
+		else
+			memtx_tx_story_try_gc(story);
+		txn_set_flag(txn, TXN_IS_CONFLICTED);
+		return;
+	}
+	tracker->reader = txn;
+	tracker->story = story;
+	rlist_add_tail_entry(&story->reader_list, tracker, in_reader_list);
+	rlist_add_tail_entry(&txn->read_set, tracker, in_read_set);
+	memtx_tx_register_tx(txn);
+}
+
+struct tuple *
+memtx_tx_tuple_clarify_slow(struct txn *txn, struct index *index,
+			    struct tuple *tuple)
+{
+	struct memtx_story *story = NULL;
+	if (tuple->is_dirty) {
+		story = memtx_tx_story_get(tuple);
+		story = memtx_tx_story_find_visible(story, index->def->iid,
+						    txn);
+		if (story == NULL)
+			return NULL;
+		tuple = story->tuple;
+	}
+	memtx_tx_track_read(txn, index, story, tuple);
+	return tuple;
+}
+
+void
+memtx_tx_track_gap_slow(struct txn *txn, struct index *index,
+			enum iterator_type type, const char *key,
+			uint32_t part_count)
+{
+	/* Same as memtx_tx_track_read(). */
+	if (!txn_has_flag(txn, TXN_CAN_YIELD) ||
+	    txn_has_flag(txn, TXN_IS_CONFLICTED) ||
+	    txm.ddl_in_progress > 0)
+		return;
+	struct space *space = space_by_id(index->def->space_id);
+	if (space == NULL || !memtx_tx_space_is_versioned(space))
+		return;
+	if (part_count == 0) {
+		/* The key may be NULL. */
+		type = ITER_ALL;
+		key = "";
+	}
+	const char *key_end = key;
+	for (uint32_t i = 0; i < part_count; i++)
+		mp_next(&key_end);
+	uint32_t key_size = key_end - key;
+	struct memtx_tx_gap_tracker *tracker;
+	rlist_foreach_entry(tracker, &txn->gap_set, in_gap_set) {
+		if (tracker->index == index && tracker->type == type &&
+		    tracker->part_count == part_count &&
+		    tracker->key_size == key_size &&
+		    memcmp(tracker->key, key, key_size) == 0)
+			return;
+	}
+	size_t size = sizeof(*tracker) + key_size;
+	tracker = malloc(size);
+	if (tracker == NULL) {
+		/*
+		 * We can't guarantee serializability without
+		 * the tracker, so abort the transaction.
+		 */
+		diag_set(OutOfMemory, size, "malloc", "gap tracker");
+		diag_log();
+		txn_set_flag(txn, TXN_IS_CONFLICTED);
+		return;
+	}
+	tracker->reader = txn;
+	tracker->index = index;
+	tracker->type = type;
+	tracker->part_count = part_count;
+	tracker->key_size = key_size;
+	memcpy(tracker->key, key, key_size);
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	rlist_add_tail_entry(&memtx_space->gap_list, tracker, in_gap_list);
+	rlist_add_tail_entry(&txn->gap_set, tracker, in_gap_set);
+	memtx_tx_register_tx(txn);
+}
+
+/** Check if a tuple falls into a range read by a transaction. */
+static bool
+memtx_tx_gap_has_tuple(struct memtx_tx_gap_tracker *tracker,
+		       struct tuple *tuple)
+{
+	if (tracker->type == ITER_ALL)
+		return true;
+	/* Tuples follow in hash order, which we can't check. */
+	if (tracker->index->def->type == HASH && tracker->type != ITER_EQ)
+		return true;
+	int cmp = tuple_compare_with_key(tuple, HINT_NONE, tracker->key,
+					 tracker->part_count, HINT_NONE,
+					 tracker->index->def->key_def);
+	switch (tracker->type) {
+	case ITER_EQ:
+	case ITER_REQ:
+		return cmp == 0;
+	case ITER_LT:
+		return cmp < 0;
+	case ITER_LE:
+		return cmp <= 0;
+	case ITER_GE:
+		return cmp >= 0;
+	case ITER_GT:
+		return cmp > 0;
+	default:
+		return true;
+	}
+}
+
+void
+memtx_tx_clean_txn(struct txn *txn)
+{
+	struct memtx_tx_read_tracker *tracker, *tmp;
+	rlist_foreach_entry_safe(tracker, &txn->read_set, in_read_set, tmp) {
+		struct memtx_story *story = tracker->story;
+		memtx_tx_read_tracker_delete(tracker);
+		memtx_tx_story_try_gc(story);
+	}
+	struct memtx_tx_gap_tracker *gap, *gap_tmp;
+	rlist_foreach_entry_safe(gap, &txn->gap_set, in_gap_set, gap_tmp) {
+		rlist_del(&gap->in_gap_list);
+		rlist_del(&gap->in_gap_set);
+		free(gap);
+	}
+	rlist_del(&txn->in_all_txs);
+}
+
+/* }}} */
+
+/* {{{ Writes */
+
+int
+memtx_tx_begin_statement(struct txn *txn, struct space *space)
+{
+	if (txn_has_flag(txn, TXN_IS_CONFLICTED)) {
+		diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+		return -1;
+	}
+	/*
+	 * Changes of a space that is not versioned are applied
+	 * in place, so the transaction must not yield until it
+	 * is committed.
+	 */
+	if (!memtx_tx_space_is_versioned(space) &&
+	    txn_has_flag(txn, TXN_CAN_YIELD))
+		txn_can_yield(txn, false);
+	return 0;
+}
+
+/** Link a statement to the list of deleters of a story. */
+static void
+memtx_tx_story_link_deleter(struct memtx_story *story, struct txn_stmt *stmt)
+{
+	assert(stmt->del_story == NULL);
+	stmt->next_in_del_list = story->del_stmt;
+	story->del_stmt = stmt;
+	stmt->del_story = story;
+}
+
+/** Unlink a statement from the list of deleters of a story. */
+static void
+memtx_tx_story_unlink_deleter(struct memtx_story *story, struct txn_stmt *stmt)
+{
+	assert(stmt->del_story == story);
+	struct txn_stmt **prev = &story->del_stmt;
+	while (*prev != stmt) {
+		assert(*prev != NULL);
+		prev = &(*prev)->next_in_del_list;
+	}
+	*prev = stmt->next_in_del_list;
+	stmt->next_in_del_list = NULL;
+	stmt->del_story = NULL;
+}
+
+/**
+ * Remove a story inserted by a statement from all indexes
+ * and delete it. Indexes [0, index_count) are processed.
+ */
+static void
+memtx_tx_story_remove(struct memtx_story *story, uint32_t index_count)
+{
+	for (uint32_t i = index_count; i > 0; i--) {
+		struct memtx_story *older = story->link[i - 1].older;
+		memtx_tx_story_unlink(story, i - 1);
+		if (older != NULL)
+			memtx_tx_story_try_gc(older);
+	}
+	story->add_stmt = NULL;
+	memtx_tx_story_delete(story);
+}
+
+int
+memtx_tx_history_add_stmt(struct txn_stmt *stmt, struct tuple *old_tuple,
+			  struct tuple *new_tuple, enum dup_replace_mode mode,
+			  struct tuple **result)
+{
+	struct txn *txn = stmt->txn;
+	struct space *space = stmt->space;
+	assert(old_tuple != NULL || new_tuple != NULL);
+
+	if (new_tuple == NULL) {
+		/*
+		 * Delete: the tuple stays in the indexes until
+		 * the transaction is prepared.
+		 */
+		struct memtx_story *del_story =
+			memtx_tx_story_get_or_new(space, old_tuple);
+		if (del_story == NULL)
+			return -1;
+		memtx_tx_story_link_deleter(del_story, stmt);
+		memtx_tx_register_tx(txn);
+		memtx_space_update_bsize(space, old_tuple, NULL);
+		/* Referenced by the statement. */
+		tuple_ref(old_tuple);
+		*result = old_tuple;
+		return 0;
+	}
+
+	struct memtx_story *add_story = memtx_tx_story_new(space, new_tuple);
+	if (add_story == NULL)
+		return -1;
+	add_story->add_stmt = stmt;
+
+	/* Put the new tuple on top of the chains. */
+	uint32_t i;
+	for (i = 0; i < space->index_count; i++) {
+		struct index *index = space->index[i];
+		struct tuple *replaced;
+		if (index_replace(index, NULL, new_tuple,
+				  DUP_REPLACE_OR_INSERT, &replaced) != 0)
+			goto fail;
+		if (replaced == NULL)
+			continue;
+		struct memtx_story *older =
+			memtx_tx_story_get_or_new(space, replaced);
+		if (older == NULL) {
+			struct tuple *unused;
+			if (index_replace(index, new_tuple, replaced,
+					  DUP_INSERT, &unused) != 0) {
+				diag_log();
+				unreachable();
+				panic("failed to rollback change");
+			}
+			goto fail;
+		}
+		add_story->link[i].older = older;
+		older->link[i].newer = add_story;
+	}
+
+	/*
+	 * Check for duplicates among the versions visible to the
+	 * transaction, just like memtx_space_replace_all_keys()
+	 * does for the primary key and then for secondary keys.
+	 */
+	struct memtx_story *visible =
+		memtx_tx_story_find_visible(add_story->link[0].older, 0, txn);
+	struct tuple *replaced = visible != NULL ? visible->tuple : NULL;
+	for (i = 0; i < space->index_count; i++) {
+		struct tuple *dup = replaced;
+		if (i > 0) {
+			struct memtx_story *dup_story =
+				memtx_tx_story_find_visible(
+					add_story->link[i].older, i, txn);
+			dup = dup_story != NULL ? dup_story->tuple : NULL;
+		}
+		uint32_t errcode = i == 0 ?
+			replace_check_dup(old_tuple, dup, mode) :
+			replace_check_dup(replaced, dup, DUP_INSERT);
+		if (errcode != 0) {
+			struct index *index = space->index[i];
+			diag_set(ClientError, errcode, index->def->name,
+				 space_name(space));
+			i = space->index_count;
+			goto fail;
+		}
+	}
+
+	if (visible != NULL) {
+		memtx_tx_story_link_deleter(visible, stmt);
+		/* Referenced by the statement. */
+		tuple_ref(replaced);
+	}
+	stmt->add_story = add_story;
+	memtx_tx_register_tx(txn);
+	memtx_space_update_bsize(space, replaced, new_tuple);
+	/* Referenced by the primary key. */
+	tuple_ref(new_tuple);
+	*result = replaced;
+	return 0;
+fail:
+	memtx_tx_story_remove(add_story, i);
+	return -1;
+}
+
+bool
+memtx_tx_history_rollback_stmt(struct txn_stmt *stmt)
+{
+	if (stmt->add_story == NULL && stmt->del_story == NULL)
+		return false;
+	struct space *space = stmt->space;
+	if (stmt->add_story != NULL) {
+		struct memtx_story *story = stmt->add_story;
+		assert(story->add_stmt == stmt);
+		stmt->add_story = NULL;
+		memtx_tx_story_remove(story, story->index_count);
+		/* Was referenced by the primary key. */
+		tuple_unref(stmt->new_tuple);
+	}
+	if (stmt->del_story != NULL) {
+		struct memtx_story *story = stmt->del_story;
+		memtx_tx_story_unlink_deleter(story, stmt);
+		memtx_tx_story_try_gc(story);
+	}
+	memtx_space_update_bsize(space, stmt->new_tuple, stmt->old_tuple);
+	return true;
+}
+
+/**
+ * Undo all versioned changes of an in-progress transaction
+ * and forget its reads. The transaction will fail to commit.
+ */
+static void
+memtx_tx_abort(struct txn *txn)
+{
+	txn_set_flag(txn, TXN_IS_CONFLICTED);
+	struct txn_stmt *stmt;
+	stailq_reverse(&txn->stmts);
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		if (memtx_tx_history_rollback_stmt(stmt)) {
+			/* Nothing to roll back anymore. */
+			stmt->engine_savepoint = NULL;
+		}
+	}
+	stailq_reverse(&txn->stmts);
+	memtx_tx_clean_txn(txn);
+}
+
+static void
+memtx_tx_mark_conflicted(struct txn *txn, struct txn_stmt *stmt,
+			 bool *found)
+{
+	if (stmt != NULL && stmt->txn != txn) {
+		txn_set_flag(stmt->txn, TXN_IS_CONFLICTED);
+		*found = true;
+	}
+}
+
+/**
+ * Mark all transactions that conflict with the given one:
+ * those that wrote the same keys, those that read or deleted
+ * the tuples the transaction overwrites and those that read
+ * ranges the tuples inserted by the transaction fall into.
+ * Return true if there are any.
+ */
+static bool
+memtx_tx_find_conflicts(struct txn *txn)
+{
+	bool found = false;
+	struct txn_stmt *stmt;
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		struct memtx_story *story = stmt->add_story;
+		if (story != NULL) {
+			struct memtx_space *memtx_space =
+				(struct memtx_space *)story->space;
+			struct memtx_tx_gap_tracker *gap;
+			rlist_foreach_entry(gap, &memtx_space->gap_list,
+					    in_gap_list) {
+				if (gap->reader != txn &&
+				    memtx_tx_gap_has_tuple(gap,
+							   story->tuple)) {
+					txn_set_flag(gap->reader,
+						     TXN_IS_CONFLICTED);
+					found = true;
+				}
+			}
+		}
+		for (uint32_t i = 0; story != NULL &&
+		     i < story->index_count; i++) {
+			struct memtx_story *s;
+			for (s = story->link[i].newer; s != NULL;
+			     s = s->link[i].newer)
+				memtx_tx_mark_conflicted(txn, s->add_stmt,
+							 &found);
+			for (s = story->link[i].older; s != NULL;
+			     s = s->link[i].older)
+				memtx_tx_mark_conflicted(txn, s->add_stmt,
+							 &found);
+		}
+		story = stmt->del_story;
+		if (story == NULL)
+			continue;
+		struct txn_stmt *del;
+		for (del = story->del_stmt; del != NULL;
+		     del = del->next_in_del_list)
+			memtx_tx_mark_conflicted(txn, del, &found);
+		struct memtx_tx_read_tracker *tracker;
+		rlist_foreach_entry(tracker, &story->reader_list,
+				    in_reader_list) {
+			if (tracker->reader != txn) {
+				txn_set_flag(tracker->reader,
+					     TXN_IS_CONFLICTED);
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+/**
+ * Apply versioned changes of a transaction in place. All
+ * conflicting transactions must have been aborted.
+ */
+static void
+memtx_tx_collapse(struct txn *txn)
+{
+	struct txn_stmt *stmt;
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		struct memtx_story *story = stmt->del_story;
+		if (story != NULL) {
+			memtx_tx_story_unlink_deleter(story, stmt);
+			assert(story->del_stmt == NULL);
+			for (uint32_t i = 0; i < story->index_count; i++)
+				memtx_tx_story_unlink(story, i);
+			struct tuple *tuple = story->tuple;
+			story->add_stmt = NULL;
+			memtx_tx_story_delete(story);
+			/* Was referenced by the primary key. */
+			tuple_unref(tuple);
+		}
+		story = stmt->add_story;
+		if (story != NULL) {
+			assert(story->add_stmt == stmt);
+			story->add_stmt = NULL;
+			stmt->add_story = NULL;
+			memtx_tx_story_try_gc(story);
+		}
+	}
+}
+
+int
+memtx_tx_prepare(struct txn *txn)
+{
+	if (txn_has_flag(txn, TXN_IS_CONFLICTED)) {
+		diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+		return -1;
+	}
+	if (memtx_tx_find_conflicts(txn)) {
+		struct txn *victim, *tmp;
+		rlist_foreach_entry_safe(victim, &txm.all_txs,
+					 in_all_txs, tmp) {
+			if (victim != txn &&
+			    txn_has_flag(victim, TXN_IS_CONFLICTED))
+				memtx_tx_abort(victim);
+		}
+	}
+	memtx_tx_collapse(txn);
+	memtx_tx_clean_txn(txn);
+	return 0;
+}
+
+void
+memtx_tx_abort_all_for_ddl(struct txn *ddl_owner)
+{
+	if (!memtx_tx_manager_use_mvcc_engine)
+		return;
+	struct txn *txn, *tmp;
+	rlist_foreach_entry_safe(txn, &txm.all_txs, in_all_txs, tmp) {
+		if (txn != ddl_owner)
+			memtx_tx_abort(txn);
+	}
+	if (ddl_owner != NULL) {
+		/*
+		 * Nobody else can see the owner changes now, so
+		 * they may be applied in place.
+		 */
+		memtx_tx_collapse(ddl_owner);
+		memtx_tx_clean_txn(ddl_owner);
+	}
+	assert(rlist_empty(&txm.all_stories));
+}
+
+void
+memtx_tx_begin_ddl(struct txn *ddl_owner)
+{
+	if (!memtx_tx_manager_use_mvcc_engine)
+		return;
+	memtx_tx_abort_all_for_ddl(ddl_owner);
+	txm.ddl_in_progress++;
+}
+
+void
+memtx_tx_end_ddl(void)
+{
+	if (!memtx_tx_manager_use_mvcc_engine)
+		return;
+	assert(txm.ddl_in_progress > 0);
+	txm.ddl_in_progress--;
+}
+
+/* }}} */
+
+/* {{{ Snapshot cleaner */
+
+int
+memtx_tx_snapshot_cleaner_create(struct memtx_tx_snapshot_cleaner *cleaner,
+				 struct space *space, const char *index_name)
+{
+	cleaner->ht = NULL;
+	if (space == NULL || rlist_empty(&txm.all_stories))
+		return 0;
+	struct mh_snapshot_cleaner_t *ht = mh_snapshot_cleaner_new();
+	if (ht == NULL) {
+		diag_set(OutOfMemory, sizeof(*ht), index_name,
+			 "snapshot cleaner");
+		return -1;
+	}
+	struct memtx_story *story;
+	rlist_foreach_entry(story, &txm.all_stories, in_all_stories) {
+		/* Only tuples stored in the primary index matter. */
+		if (story->space != space || story->link[0].newer != NULL)
+			continue;
+		struct memtx_story *committed = story;
+		while (committed != NULL && committed->add_stmt != NULL)
+			committed = committed->link[0].older;
+		struct memtx_tx_snapshot_cleaner_entry entry;
+		entry.from = story->tuple;
+		entry.to = committed != NULL ? committed->tuple : NULL;
+		if (entry.from == entry.to)
+			continue;
+		if (mh_snapshot_cleaner_put(ht, &entry, NULL, 0) ==
+		    mh_end(ht)) {
+			diag_set(OutOfMemory, sizeof(entry), index_name,
+				 "snapshot cleaner entry");
+			mh_snapshot_cleaner_delete(ht);
+			return -1;
+		}
+	}
+	cleaner->ht = ht;
+	return 0;
+}
+
+struct tuple *
+memtx_tx_snapshot_clarify_slow(struct memtx_tx_snapshot_cleaner *cleaner,
+			       struct tuple *tuple)
+{
+	struct mh_snapshot_cleaner_t *ht = cleaner->ht;
+	mh_int_t pos = mh_snapshot_cleaner_find(ht, tuple, 0);
+	if (pos == mh_end(ht))
+		return tuple;
+	return mh_snapshot_cleaner_node(ht, pos)->to;
+}
+
+void
+memtx_tx_snapshot_cleaner_destroy(struct memtx_tx_snapshot_cleaner *cleaner)
+{
+	if (cleaner->ht != NULL)
+		mh_snapshot_cleaner_delete(cleaner->ht);
+	cleaner->ht = NULL;
+}
+
+/* }}} */
@@ -0,0 +1,249 @@
+#ifndef TARANTOOL_BOX_MEMTX_TX_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_TX_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+
+#include "index.h"
+#include "tuple.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Memtx transaction manager.
+ *
+ * When enabled, memtx transactions are not aborted on yield.
+ * Instead, every change of a versioned space is recorded in
+ * a history: a tuple inserted by an in-progress transaction
+ * is put into indexes as usual, but it's marked dirty and
+ * linked with the tuples it replaced (a story). Readers walk
+ * the story chain and pick the newest version visible to
+ * them, i.e. either committed or written by themselves.
+ *
+ * Reads of in-progress transactions are tracked. Besides the
+ * tuples a transaction read, ranges of keys it looked up are
+ * remembered (gaps), so that a tuple inserted into a range
+ * by another transaction (a phantom) is detected too. When a
+ * transaction is prepared, all in-progress transactions that
+ * wrote the same keys, read tuples overwritten by it or read
+ * ranges its new tuples fall into are aborted and then the
+ * prepared changes are applied in place, so that prepared
+ * transactions look exactly the same as in the classic engine
+ * and are rolled back the classic way.
+ *
+ * A range is remembered as a whole when an iterator is
+ * created, even if the reader stops before reaching its end,
+ * so a conflict may be detected where there's none.
+ *
+ * index:len() returns the number of tuples stored in the
+ * index, including uncommitted ones, while index:count()
+ * counts tuples visible to the transaction.
+ */
+
+struct space;
+struct txn;
+struct txn_stmt;
+struct mh_snapshot_cleaner_t;
+
+/** Set if the memtx transaction manager is enabled. */
+extern bool memtx_tx_manager_use_mvcc_engine;
+
+/** Initialize the transaction manager. */
+void
+memtx_tx_manager_init(void);
+
+/** Free the transaction manager. */
+void
+memtx_tx_manager_free(void);
+
+/**
+ * Return true if changes of the given memtx space go through
+ * the transaction manager. The space must have tree or hash
+ * indexes only, without multikey and functional parts, and
+ * must not be a system space.
+ */
+bool
+memtx_tx_space_is_versioned(struct space *space);
+
+/**
+ * Called at the beginning of a memtx statement. Fails if the
+ * transaction has been aborted by a conflict. Disables yields
+ * if the space is not versioned, since its changes are
+ * visible to other transactions immediately.
+ */
+int
+memtx_tx_begin_statement(struct txn *txn, struct space *space);
+
+/**
+ * Apply a change of a versioned space: insert @a new_tuple
+ * into all indexes and/or mark @a old_tuple deleted by the
+ * statement. Duplicates are checked against the versions
+ * visible to the statement transaction. The semantics of the
+ * arguments is the same as for memtx_space_replace_all_keys().
+ */
+int
+memtx_tx_history_add_stmt(struct txn_stmt *stmt, struct tuple *old_tuple,
+			  struct tuple *new_tuple, enum dup_replace_mode mode,
+			  struct tuple **result);
+
+/**
+ * Undo a change made by memtx_tx_history_add_stmt(). Returns
+ * false if the statement has already been applied in place
+ * (the transaction is prepared) and so must be rolled back
+ * the classic way.
+ */
+bool
+memtx_tx_history_rollback_stmt(struct txn_stmt *stmt);
+
+/**
+ * Abort all in-progress transactions that conflict with the
+ * given one and apply its changes in place. Fails if the
+ * transaction itself has been aborted by a conflict.
+ */
+int
+memtx_tx_prepare(struct txn *txn);
+
+/**
+ * Abort all in-progress transactions except @a ddl_owner
+ * and apply the changes of @a ddl_owner in place, so that
+ * no versioned tuples are left. Used before altering a space
+ * and before rolling back changes applied in place.
+ */
+void
+memtx_tx_abort_all_for_ddl(struct txn *ddl_owner);
+
+/**
+ * Same as memtx_tx_abort_all_for_ddl(), but also suspend
+ * versioning until memtx_tx_end_ddl() is called. Used by
+ * DDL operations that yield, such as index build.
+ */
+void
+memtx_tx_begin_ddl(struct txn *ddl_owner);
+
+/** Resume versioning suspended by memtx_tx_begin_ddl(). */
+void
+memtx_tx_end_ddl(void);
+
+/**
+ * Forget all reads of the transaction and unregister it.
+ * Called when the transaction is prepared or freed.
+ */
+void
+memtx_tx_clean_txn(struct txn *txn);
+
+/** @sa memtx_tx_tuple_clarify(). */
+struct tuple *
+memtx_tx_tuple_clarify_slow(struct txn *txn, struct index *index,
+			    struct tuple *tuple);
+
+/**
+ * Given a tuple found in an index, return its version visible
+ * to the transaction, or NULL if there's none. @a txn may be
+ * NULL. The read is remembered for conflict detection.
+ */
+static inline struct tuple *
+memtx_tx_tuple_clarify(struct txn *txn, struct index *index,
+		       struct tuple *tuple)
+{
+	if (!memtx_tx_manager_use_mvcc_engine)
+		return tuple;
+	if (!tuple->is_dirty && txn == NULL)
+		return tuple;
+	return memtx_tx_tuple_clarify_slow(txn, index, tuple);
+}
+
+/** @sa memtx_tx_track_gap(). */
+void
+memtx_tx_track_gap_slow(struct txn *txn, struct index *index,
+			enum iterator_type type, const char *key,
+			uint32_t part_count);
+
+/**
+ * Remember that a transaction read all keys of an index that
+ * match @a key with iterator @a type, so that a tuple inserted
+ * into the range by another transaction conflicts with the
+ * reader. @a txn may be NULL. Called when an iterator is
+ * created and when a point lookup finds nothing.
+ */
+static inline void
+memtx_tx_track_gap(struct txn *txn, struct index *index,
+		   enum iterator_type type, const char *key,
+		   uint32_t part_count)
+{
+	if (!memtx_tx_manager_use_mvcc_engine || txn == NULL)
+		return;
+	memtx_tx_track_gap_slow(txn, index, type, key, part_count);
+}
+
+/**
+ * Map of dirty tuples of a space to their committed versions
+ * at the time a read view is created. Used to filter out
+ * uncommitted changes from snapshots. Once created, it can be
+ * used from any thread.
+ */
+struct memtx_tx_snapshot_cleaner {
+	struct mh_snapshot_cleaner_t *ht;
+};
+
+/** Create a snapshot cleaner for the primary index of a space. */
+int
+memtx_tx_snapshot_cleaner_create(struct memtx_tx_snapshot_cleaner *cleaner,
+				 struct space *space, const char *index_name);
+
+/** @sa memtx_tx_snapshot_clarify(). */
+struct tuple *
+memtx_tx_snapshot_clarify_slow(struct memtx_tx_snapshot_cleaner *cleaner,
+			       struct tuple *tuple);
+
+/**
+ * Return the committed version of a tuple found in a read
+ * view, or NULL if the tuple must be skipped.
+ */
+static inline struct tuple *
+memtx_tx_snapshot_clarify(struct memtx_tx_snapshot_cleaner *cleaner,
+			  struct tuple *tuple)
+{
+	if (cleaner->ht == NULL)
+		return tuple;
+	return memtx_tx_snapshot_clarify_slow(cleaner, tuple);
+}
+
+/** Destroy a snapshot cleaner. */
+void
+memtx_tx_snapshot_cleaner_destroy(struct memtx_tx_snapshot_cleaner *cleaner);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_TX_H_INCLUDED */
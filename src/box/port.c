@@ -110,6 +110,9 @@ int
 port_c_add_tuple(struct port *base, struct tuple *tuple)
 {
 	struct port_c *port = (struct port_c *)base;
+	tuple = tuple_decompress(tuple);
+	if (tuple == NULL)
+		return -1;
 	struct port_c_entry *pe = port_c_new_entry(port);
 	if (pe == NULL)
 		return -1;
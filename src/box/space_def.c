@@ -36,12 +36,15 @@
 #include "msgpuck.h"
 #include "tt_static.h"
 
+const char *space_compression_strs[] = { "none", "zstd" };
+
 const struct space_opts space_opts_default = {
 	/* .group_id = */ 0,
 	/* .is_temporary = */ false,
 	/* .is_ephemeral = */ false,
 	/* .view = */ false,
 	/* .is_sync = */ false,
+	/* .compression = */ SPACE_COMPRESSION_NONE,
 	/* .sql        = */ NULL,
 };
 
@@ -50,6 +53,8 @@ const struct opt_def space_opts_reg[] = {
 	OPT_DEF("temporary", OPT_BOOL, struct space_opts, is_temporary),
 	OPT_DEF("view", OPT_BOOL, struct space_opts, is_view),
 	OPT_DEF("is_sync", OPT_BOOL, struct space_opts, is_sync),
+	OPT_DEF_ENUM("compression", space_compression, struct space_opts,
+		     compression, NULL),
 	OPT_DEF("sql", OPT_STRPTR, struct space_opts, sql),
 	OPT_DEF_LEGACY("checks"),
 	OPT_END,
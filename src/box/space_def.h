@@ -40,6 +40,16 @@
 extern "C" {
 #endif /* defined(__cplusplus) */
 
+/** Compression of memtx tuple fields. */
+enum space_compression {
+	/* Store tuples as is. */
+	SPACE_COMPRESSION_NONE,
+	/* Compress big non-indexed fields with zstd. */
+	SPACE_COMPRESSION_ZSTD,
+	space_compression_MAX
+};
+extern const char *space_compression_strs[];
+
 /** Space options */
 struct space_opts {
 	/**
@@ -73,6 +83,11 @@ struct space_opts {
 	 * until replicated to a quorum of replicas.
 	 */
 	bool is_sync;
+	/**
+	 * Compression of tuple fields that are not used by any
+	 * index. Only supported by memtx.
+	 */
+	enum space_compression compression;
 	/** SQL statement that produced this space. */
 	char *sql;
 };
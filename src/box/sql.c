@@ -938,6 +938,8 @@ cursor_advance(BtCursor *pCur, int *pRes)
 	struct tuple *tuple;
 	if (iterator_next(pCur->iter, &tuple) != 0)
 		return -1;
+	if (tuple != NULL && (tuple = tuple_decompress(tuple)) == NULL)
+		return -1;
 	if (pCur->last_tuple)
 		box_tuple_unref(pCur->last_tuple);
 	if (tuple) {
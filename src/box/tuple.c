@@ -37,6 +37,7 @@
 #include "small/small.h"
 #include "xrow_update.h"
 #include "coll_id_cache.h"
+#include "tuple_compression.h"
 
 static struct mempool tuple_iterator_pool;
 static struct small_alloc runtime_alloc;
@@ -48,6 +49,31 @@ enum {
 
 static const double ALLOC_FACTOR = 1.05;
 
+enum {
+	/** Number of entries in the decompressed tuple cache. */
+	TUPLE_DECOMPRESS_CACHE_SIZE = 64,
+};
+
+/** Decompressed copy of a tuple stored in the cache. */
+struct tuple_decompress_cache_entry {
+	/** Tuple of a compressed format, referenced. */
+	struct tuple *tuple;
+	/**
+	 * Decompressed copy of the tuple, referenced unless it
+	 * is the tuple itself, which happens if the tuple turns
+	 * out to have no compressed fields.
+	 */
+	struct tuple *copy;
+};
+
+/**
+ * Direct-mapped cache of decompressed tuples, so that a hot
+ * tuple doesn't have to be decompressed each time it's read.
+ * \sa tuple_decompress()
+ */
+static struct tuple_decompress_cache_entry
+tuple_decompress_cache[TUPLE_DECOMPRESS_CACHE_SIZE];
+
 /**
  * Last tuple returned by public C API
  * \sa tuple_bless()
@@ -126,6 +152,68 @@ runtime_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 	smfree(&runtime_alloc, tuple, total);
 }
 
+static void
+tuple_decompress_cache_entry_reset(struct tuple_decompress_cache_entry *entry)
+{
+	if (entry->tuple == NULL)
+		return;
+	if (entry->copy != entry->tuple)
+		tuple_unref(entry->copy);
+	tuple_unref(entry->tuple);
+	entry->tuple = NULL;
+	entry->copy = NULL;
+}
+
+struct tuple *
+tuple_decompress_slow(struct tuple *tuple)
+{
+	struct tuple_format *format = tuple_format(tuple);
+	assert(format->is_compressed);
+	struct tuple_decompress_cache_entry *entry =
+		&tuple_decompress_cache[((uintptr_t)tuple >> 4) %
+					TUPLE_DECOMPRESS_CACHE_SIZE];
+	if (entry->tuple == tuple)
+		return entry->copy;
+
+	struct tuple *copy = NULL;
+	struct tuple_format *copy_format;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t bsize, size;
+	const char *data = tuple_data_range(tuple, &bsize);
+	/* The decompressed size was checked when the tuple was created. */
+	const char *plain = tuple_decompress_raw(data, data + bsize,
+						 UINT32_MAX, &size);
+	if (plain == NULL)
+		goto out;
+	if (plain == data) {
+		copy = tuple;
+		goto out;
+	}
+	copy_format = format->decompressed_format;
+	if (copy_format == NULL) {
+		copy_format = tuple_format_new(&tuple_format_runtime_vtab,
+					       NULL, NULL, 0, NULL, 0, 0,
+					       format->dict, false, false);
+		if (copy_format == NULL)
+			goto out;
+		tuple_format_ref(copy_format);
+		format->decompressed_format = copy_format;
+	}
+	copy = runtime_tuple_new(copy_format, plain, plain + size);
+out:
+	region_truncate(region, region_svp);
+	if (copy == NULL)
+		return NULL;
+	tuple_ref(tuple);
+	if (copy != tuple)
+		tuple_ref(copy);
+	tuple_decompress_cache_entry_reset(entry);
+	entry->tuple = tuple;
+	entry->copy = copy;
+	return copy;
+}
+
 int
 tuple_validate_raw(struct tuple_format *format, const char *tuple)
 {
@@ -379,6 +467,9 @@ tuple_free(void)
 		tuple_unref(box_tuple_last);
 		box_tuple_last = NULL;
 	}
+	for (int i = 0; i < TUPLE_DECOMPRESS_CACHE_SIZE; i++)
+		tuple_decompress_cache_entry_reset(&tuple_decompress_cache[i]);
+	tuple_compression_free();
 
 	mempool_destroy(&tuple_iterator_pool);
 	small_alloc_destroy(&runtime_alloc);
@@ -1114,6 +1114,32 @@ tuple_bless(struct tuple *tuple)
 	return tuple;
 }
 
+/**
+ * Decompress a tuple that may have compressed fields.
+ * \sa tuple_decompress()
+ */
+struct tuple *
+tuple_decompress_slow(struct tuple *tuple);
+
+/**
+ * Return a tuple with all compressed fields of the given tuple
+ * decompressed (see tuple_format::is_compressed). Tuples that
+ * don't have compressed fields are returned as is.
+ *
+ * Decompressed copies of recently accessed tuples are cached,
+ * so the returned tuple is only guaranteed to stay alive until
+ * the next call unless the caller references it.
+ *
+ * \retval NULL on error, diag is set.
+ */
+static inline struct tuple *
+tuple_decompress(struct tuple *tuple)
+{
+	if (likely(!tuple_format(tuple)->is_compressed))
+		return tuple;
+	return tuple_decompress_slow(tuple);
+}
+
 /**
  * \copydoc box_tuple_to_buf()
  */
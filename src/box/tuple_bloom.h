@@ -219,6 +219,18 @@ tuple_bloom_encode(const struct tuple_bloom *bloom, char *buf);
 struct tuple_bloom *
 tuple_bloom_decode(const char **data);
 
+/**
+ * Decode a legacy bloom filter from MsgPack.
+ * @param data - pointer to buffer storing encoded bloom filter;
+ *  on success it is advanced by the number of decoded bytes
+ * @return the decoded bloom on success or NULL on OOM
+ * We used to store bloom filters of the classic layout (see
+ * enum bloom_type). This function decodes such a bloom filter
+ * from MsgPack.
+ */
+struct tuple_bloom *
+tuple_bloom_decode_legacy_v2(const char **data);
+
 /**
  * Decode a legacy bloom filter from MsgPack.
  * @param data - pointer to buffer storing encoded bloom filter;
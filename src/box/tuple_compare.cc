@@ -32,6 +32,7 @@
 #include "tuple.h"
 #include "coll/coll.h"
 #include "trivia/util.h" /* NOINLINE */
+#include "bit/bit.h"
 #include <math.h>
 #include "lib/core/decimal.h"
 #include "lib/core/mp_decimal.h"
@@ -352,10 +353,7 @@ mp_compare_str(const char *field_a, const char *field_b)
 {
 	uint32_t size_a = mp_decode_strl(&field_a);
 	uint32_t size_b = mp_decode_strl(&field_b);
-	int r = memcmp(field_a, field_b, MIN(size_a, size_b));
-	if (r != 0)
-		return r;
-	return COMPARE_RESULT(size_a, size_b);
+	return bytes_compare(field_a, size_a, field_b, size_b);
 }
 
 static inline int
@@ -371,10 +369,7 @@ mp_compare_bin(const char *field_a, const char *field_b)
 {
 	uint32_t size_a = mp_decode_binl(&field_a);
 	uint32_t size_b = mp_decode_binl(&field_b);
-	int r = memcmp(field_a, field_b, MIN(size_a, size_b));
-	if (r != 0)
-		return r;
-	return COMPARE_RESULT(size_a, size_b);
+	return bytes_compare(field_a, size_a, field_b, size_b);
 }
 
 static inline int
@@ -996,9 +991,7 @@ field_compare<FIELD_TYPE_STRING>(const char **field_a, const char **field_b)
 	uint32_t size_a, size_b;
 	size_a = mp_decode_strl(field_a);
 	size_b = mp_decode_strl(field_b);
-	int r = memcmp(*field_a, *field_b, MIN(size_a, size_b));
-	if (r == 0)
-		r = size_a < size_b ? -1 : size_a > size_b;
+	int r = bytes_compare(*field_a, size_a, *field_b, size_b);
 	return r;
 }
 
@@ -1025,9 +1018,7 @@ field_compare_and_next<FIELD_TYPE_STRING>(const char **field_a,
 	uint32_t size_a, size_b;
 	size_a = mp_decode_strl(field_a);
 	size_b = mp_decode_strl(field_b);
-	int r = memcmp(*field_a, *field_b, MIN(size_a, size_b));
-	if (r == 0)
-		r = size_a < size_b ? -1 : size_a > size_b;
+	int r = bytes_compare(*field_a, size_a, *field_b, size_b);
 	*field_a += size_a;
 	*field_b += size_b;
 	return r;
@@ -1184,9 +1175,7 @@ field_compare_with_key<FIELD_TYPE_STRING>(const char **field, const char **key)
 	uint32_t size_a, size_b;
 	size_a = mp_decode_strl(field);
 	size_b = mp_decode_strl(key);
-	int r = memcmp(*field, *key, MIN(size_a, size_b));
-	if (r == 0)
-		r = size_a < size_b ? -1 : size_a > size_b;
+	int r = bytes_compare(*field, size_a, *key, size_b);
 	return r;
 }
 
@@ -1213,9 +1202,7 @@ field_compare_with_key_and_next<FIELD_TYPE_STRING>(const char **field_a,
 	uint32_t size_a, size_b;
 	size_a = mp_decode_strl(field_a);
 	size_b = mp_decode_strl(field_b);
-	int r = memcmp(*field_a, *field_b, MIN(size_a, size_b));
-	if (r == 0)
-		r = size_a < size_b ? -1 : size_a > size_b;
+	int r = bytes_compare(*field_a, size_a, *field_b, size_b);
 	*field_a += size_a;
 	*field_b += size_b;
 	return r;
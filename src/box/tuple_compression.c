@@ -0,0 +1,288 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "tuple_compression.h"
+
+#include <zstd.h>
+
+#include "diag.h"
+#include "error.h"
+#include "fiber.h"
+#include "msgpuck.h"
+#include "mp_extension_types.h"
+#include "trivia/util.h"
+#include "tt_static.h"
+
+enum {
+	/** Max size of an MP_EXT header (ext 32). */
+	TUPLE_COMPRESSION_HEADER_MAX = 6,
+};
+
+/**
+ * zstd contexts. Tuples are only created and accessed in the
+ * tx thread, so there's no need to make them thread-local.
+ */
+static ZSTD_CCtx *tuple_zcctx;
+static ZSTD_DCtx *tuple_zdctx;
+
+/** Return true if the given MsgPack value is a compressed field. */
+static inline bool
+tuple_field_is_compressed(const char *field)
+{
+	if (mp_typeof(*field) != MP_EXT)
+		return false;
+	int8_t type;
+	mp_decode_extl(&field, &type);
+	return type == MP_COMPRESSION;
+}
+
+const char *
+tuple_compress_raw(const char *data, const char *data_end,
+		   uint32_t first_fieldno, uint32_t *size)
+{
+	*size = data_end - data;
+	const char *pos = data;
+	uint32_t field_count = mp_decode_array(&pos);
+	if (field_count <= first_fieldno)
+		return data;
+	for (uint32_t i = 0; i < first_fieldno; i++) {
+		if (unlikely(tuple_field_is_compressed(pos))) {
+			/*
+			 * Leading fields must be stored as is, but
+			 * the input was compressed for another format.
+			 * This is rare so simply start over from the
+			 * decompressed data.
+			 */
+			data = tuple_decompress_raw(data, data_end,
+						    UINT32_MAX, size);
+			if (data == NULL)
+				return NULL;
+			return tuple_compress_raw(data, data + *size,
+						  first_fieldno, size);
+		}
+		mp_next(&pos);
+	}
+	/*
+	 * Find out if there's anything to compress and estimate
+	 * the max size of the result.
+	 */
+	const char *tail = pos;
+	size_t bound = tail - data;
+	bool has_candidates = false;
+	for (uint32_t i = first_fieldno; i < field_count; i++) {
+		const char *field = pos;
+		mp_next(&pos);
+		size_t len = pos - field;
+		if (len < TUPLE_COMPRESSION_MIN_FIELD_SIZE ||
+		    tuple_field_is_compressed(field)) {
+			bound += len;
+			continue;
+		}
+		has_candidates = true;
+		bound += MAX(len, TUPLE_COMPRESSION_HEADER_MAX +
+			     ZSTD_compressBound(len));
+	}
+	if (!has_candidates)
+		return data;
+	if (tuple_zcctx == NULL) {
+		tuple_zcctx = ZSTD_createCCtx();
+		if (tuple_zcctx == NULL) {
+			diag_set(OutOfMemory, 0, "ZSTD_createCCtx",
+				 "zstd context");
+			return NULL;
+		}
+	}
+	char *buf = region_alloc(&fiber()->gc, bound);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, bound, "region", "compressed tuple");
+		return NULL;
+	}
+	memcpy(buf, data, tail - data);
+	char *dst = buf + (tail - data);
+	bool is_compressed = false;
+	pos = tail;
+	for (uint32_t i = first_fieldno; i < field_count; i++) {
+		const char *field = pos;
+		mp_next(&pos);
+		size_t len = pos - field;
+		if (len < TUPLE_COMPRESSION_MIN_FIELD_SIZE ||
+		    tuple_field_is_compressed(field))
+			goto copy;
+		/*
+		 * Compress the field leaving room for the longest
+		 * extension header and move the compressed data
+		 * closer once we know the actual header size.
+		 */
+		size_t zsize = ZSTD_compressCCtx(tuple_zcctx,
+				dst + TUPLE_COMPRESSION_HEADER_MAX,
+				ZSTD_compressBound(len), field, len,
+				TUPLE_COMPRESSION_LEVEL);
+		if (ZSTD_isError(zsize)) {
+			diag_set(ClientError, ER_COMPRESSION,
+				 ZSTD_getErrorName(zsize));
+			return NULL;
+		}
+		if (mp_sizeof_ext(zsize) >= len)
+			goto copy;
+		uint32_t header_size = mp_sizeof_ext(zsize) - zsize;
+		memmove(dst + header_size, dst + TUPLE_COMPRESSION_HEADER_MAX,
+			zsize);
+		dst = mp_encode_extl(dst, MP_COMPRESSION, zsize);
+		dst += zsize;
+		is_compressed = true;
+		continue;
+copy:
+		memcpy(dst, field, len);
+		dst += len;
+	}
+	assert(dst <= buf + bound);
+	if (!is_compressed)
+		return data;
+	*size = dst - buf;
+	return buf;
+}
+
+/**
+ * Decode the header of a compressed field and return the size
+ * of the original field or -1 if the field is corrupted.
+ */
+static int64_t
+tuple_field_decompressed_size(const char *zdata, uint32_t zsize)
+{
+	unsigned long long size = ZSTD_getFrameContentSize(zdata, zsize);
+	if (size == ZSTD_CONTENTSIZE_UNKNOWN ||
+	    size == ZSTD_CONTENTSIZE_ERROR || size == 0 ||
+	    size > UINT32_MAX) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 "invalid compressed tuple field");
+		return -1;
+	}
+	return size;
+}
+
+const char *
+tuple_decompress_raw(const char *data, const char *data_end,
+		     size_t max_size, uint32_t *size)
+{
+	*size = data_end - data;
+	const char *pos = data;
+	uint32_t field_count = mp_decode_array(&pos);
+	const char *first = NULL;
+	size_t new_size = data_end - data;
+	for (uint32_t i = 0; i < field_count; i++) {
+		const char *field = pos;
+		if (mp_typeof(*pos) != MP_EXT) {
+			mp_next(&pos);
+			continue;
+		}
+		int8_t type;
+		uint32_t zsize = mp_decode_extl(&pos, &type);
+		if (type == MP_COMPRESSION) {
+			int64_t len = tuple_field_decompressed_size(pos,
+								    zsize);
+			if (len < 0)
+				return NULL;
+			if (first == NULL)
+				first = field;
+			new_size += len;
+			new_size -= pos + zsize - field;
+		}
+		pos += zsize;
+	}
+	if (first == NULL)
+		return data;
+	/*
+	 * The sizes come from the frame headers, which may be
+	 * supplied by a client, so check them before allocating.
+	 */
+	if (new_size > max_size) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 tt_sprintf("tuple size %zu exceeds the limit %zu",
+				    new_size, max_size));
+		return NULL;
+	}
+	if (tuple_zdctx == NULL) {
+		tuple_zdctx = ZSTD_createDCtx();
+		if (tuple_zdctx == NULL) {
+			diag_set(OutOfMemory, 0, "ZSTD_createDCtx",
+				 "zstd context");
+			return NULL;
+		}
+	}
+	char *buf = region_alloc(&fiber()->gc, new_size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, new_size, "region",
+			 "decompressed tuple");
+		return NULL;
+	}
+	memcpy(buf, data, first - data);
+	char *dst = buf + (first - data);
+	pos = first;
+	while (pos < data_end) {
+		const char *field = pos;
+		mp_next(&pos);
+		if (!tuple_field_is_compressed(field)) {
+			memcpy(dst, field, pos - field);
+			dst += pos - field;
+			continue;
+		}
+		int8_t type;
+		uint32_t zsize = mp_decode_extl(&field, &type);
+		size_t len = tuple_field_decompressed_size(field, zsize);
+		size_t rc = ZSTD_decompressDCtx(tuple_zdctx, dst, len,
+						field, zsize);
+		if (ZSTD_isError(rc)) {
+			diag_set(ClientError, ER_DECOMPRESSION,
+				 ZSTD_getErrorName(rc));
+			return NULL;
+		}
+		/* The field must hold exactly one MsgPack value. */
+		const char *check = dst;
+		if (rc != len || mp_check(&check, dst + len) != 0 ||
+		    check != dst + len) {
+			diag_set(ClientError, ER_DECOMPRESSION,
+				 "invalid compressed tuple field");
+			return NULL;
+		}
+		dst += len;
+	}
+	assert(dst == buf + new_size);
+	*size = new_size;
+	return buf;
+}
+
+void
+tuple_compression_free(void)
+{
+	ZSTD_freeCCtx(tuple_zcctx);
+	tuple_zcctx = NULL;
+	ZSTD_freeDCtx(tuple_zdctx);
+	tuple_zdctx = NULL;
+}
@@ -0,0 +1,107 @@
+#ifndef TARANTOOL_BOX_TUPLE_COMPRESSION_H_INCLUDED
+#define TARANTOOL_BOX_TUPLE_COMPRESSION_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * Compression of tuple fields.
+ *
+ * A compressed field is stored as MP_EXT of type MP_COMPRESSION.
+ * The extension payload is a zstd frame that holds the MsgPack
+ * of the original field. Only top-level fields are compressed,
+ * so a compressed tuple has the same field count as the original
+ * one and all fields that precede the first compressed one stay
+ * where they are.
+ */
+
+enum {
+	/** Fields smaller than this are never compressed. */
+	TUPLE_COMPRESSION_MIN_FIELD_SIZE = 64,
+	/** zstd compression level used for tuple fields. */
+	TUPLE_COMPRESSION_LEVEL = 1,
+};
+
+/**
+ * Compress top-level fields of a MsgPack array starting from
+ * @a first_fieldno. Fields smaller than TUPLE_COMPRESSION_MIN_FIELD_SIZE
+ * and fields that don't shrink are left as is, fields that are
+ * already compressed are copied without changes. Fields that
+ * precede @a first_fieldno are never stored compressed, so they
+ * are decompressed if necessary.
+ *
+ * @param data MsgPack array.
+ * @param data_end End of @a data.
+ * @param first_fieldno Number of the first field to compress.
+ * @param[out] size Size of the returned array.
+ *
+ * @retval data If the array doesn't need to be changed.
+ * @retval Compressed array allocated on the fiber region.
+ * @retval NULL Memory error or corrupted field, diag is set.
+ */
+const char *
+tuple_compress_raw(const char *data, const char *data_end,
+		   uint32_t first_fieldno, uint32_t *size);
+
+/**
+ * Decompress all compressed top-level fields of a MsgPack array.
+ * The decompressed size is taken from zstd frame headers, so it's
+ * checked against @a max_size before anything is allocated.
+ *
+ * @param data MsgPack array.
+ * @param data_end End of @a data.
+ * @param max_size Max size of the decompressed array.
+ * @param[out] size Size of the returned array.
+ *
+ * @retval data If there's no compressed fields.
+ * @retval Decompressed array allocated on the fiber region.
+ * @retval NULL Memory error, corrupted field or the decompressed
+ *         array is larger than @a max_size, diag is set.
+ */
+const char *
+tuple_decompress_raw(const char *data, const char *data_end,
+		     size_t max_size, uint32_t *size);
+
+/** Free compression contexts. */
+void
+tuple_compression_free(void);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_TUPLE_COMPRESSION_H_INCLUDED */
@@ -693,6 +693,8 @@ tuple_format_alloc(struct key_def * const *keys, uint16_t key_count,
 	format->refs = 0;
 	format->id = FORMAT_ID_NIL;
 	format->index_field_count = index_field_count;
+	format->is_compressed = false;
+	format->decompressed_format = NULL;
 	format->exact_field_count = 0;
 	format->min_field_count = 0;
 	format->epoch = 0;
@@ -707,6 +709,8 @@ error:
 static inline void
 tuple_format_destroy(struct tuple_format *format)
 {
+	if (format->decompressed_format != NULL)
+		tuple_format_unref(format->decompressed_format);
 	free(format->required_fields);
 	tuple_format_destroy_fields(format);
 	tuple_dictionary_unref(format->dict);
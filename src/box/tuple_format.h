@@ -193,6 +193,17 @@ struct tuple_format {
 	 * be shared with other ephemeral spaces.
 	 */
 	bool is_ephemeral;
+	/**
+	 * Tuples of this format may store fields that aren't
+	 * indexed compressed, see tuple_decompress().
+	 */
+	bool is_compressed;
+	/**
+	 * Runtime format of decompressed copies of tuples of
+	 * this format. Shares the dictionary with this format
+	 * so that field names keep working. Created on demand.
+	 */
+	struct tuple_format *decompressed_format;
 	/**
 	 * Size of minimal field map of tuple where each indexed
 	 * field has own offset slot (in bytes). The real tuple
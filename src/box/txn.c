@@ -37,6 +37,7 @@
 #include "xrow.h"
 #include "errinj.h"
 #include "iproto_constants.h"
+#include "memtx_tx.h"
 
 double too_long_threshold;
 
@@ -116,6 +117,9 @@ txn_stmt_new(struct region *region)
 	stmt->engine_savepoint = NULL;
 	stmt->row = NULL;
 	stmt->has_triggers = false;
+	stmt->add_story = NULL;
+	stmt->del_story = NULL;
+	stmt->next_in_del_list = NULL;
 	return stmt;
 }
 
@@ -205,6 +209,8 @@ txn_new(void)
 inline static void
 txn_free(struct txn *txn)
 {
+	if (memtx_tx_manager_use_mvcc_engine)
+		memtx_tx_clean_txn(txn);
 	struct txn_stmt *stmt;
 	stailq_foreach_entry(stmt, &txn->stmts, next)
 		txn_stmt_destroy(stmt);
@@ -236,6 +242,9 @@ txn_begin(void)
 	txn->engine_tx = NULL;
 	txn->fk_deferred_count = 0;
 	rlist_create(&txn->savepoints);
+	rlist_create(&txn->read_set);
+	rlist_create(&txn->gap_set);
+	rlist_create(&txn->in_all_txs);
 	txn->fiber = NULL;
 	fiber_set_txn(fiber(), txn);
 	/* fiber_on_yield is initialized by engine on demand */
@@ -640,6 +649,10 @@ txn_prepare(struct txn *txn)
 		diag_log();
 		return -1;
 	}
+	if (txn_has_flag(txn, TXN_IS_CONFLICTED)) {
+		diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+		return -1;
+	}
 	/*
 	 * If transaction has been started in SQL, deferred
 	 * foreign key constraints must not be violated.
@@ -657,6 +670,9 @@ txn_prepare(struct txn *txn)
 		if (engine_prepare(txn->engine, txn) != 0)
 			return -1;
 	}
+	/* Reads of a prepared transaction can't conflict. */
+	if (memtx_tx_manager_use_mvcc_engine)
+		memtx_tx_clean_txn(txn);
 	trigger_clear(&txn->fiber_on_stop);
 	if (!txn_has_flag(txn, TXN_CAN_YIELD))
 		trigger_clear(&txn->fiber_on_yield);
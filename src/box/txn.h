@@ -46,6 +46,7 @@ extern struct rmean *rmean_box;
 
 struct journal_entry;
 struct engine;
+struct memtx_story;
 struct space;
 struct tuple;
 struct xrow_header;
@@ -87,6 +88,12 @@ enum txn_flag {
 	 * example, when applier receives snapshot from master.
 	 */
 	TXN_FORCE_ASYNC,
+	/**
+	 * Transaction has been aborted by the memtx transaction
+	 * manager because of a conflict with another transaction
+	 * so should be rolled back at commit.
+	 */
+	TXN_IS_CONFLICTED,
 };
 
 enum {
@@ -144,6 +151,15 @@ struct txn_stmt {
 	/** Commit/rollback triggers associated with this statement. */
 	struct rlist on_commit;
 	struct rlist on_rollback;
+	/**
+	 * Memtx transaction manager: story of the tuple inserted
+	 * by the statement and story of the tuple deleted by it.
+	 * Set until the transaction is prepared.
+	 */
+	struct memtx_story *add_story;
+	struct memtx_story *del_story;
+	/** Next statement that deleted the same tuple. */
+	struct txn_stmt *next_in_del_list;
 };
 
 /**
@@ -276,6 +292,12 @@ struct txn {
 	uint32_t fk_deferred_count;
 	/** List of savepoints to find savepoint by name. */
 	struct rlist savepoints;
+	/** Tuples read by the transaction, see memtx_tx.h. */
+	struct rlist read_set;
+	/** Ranges of keys read by the transaction, see memtx_tx.h. */
+	struct rlist gap_set;
+	/** Link in the list of transactions of memtx_tx.h. */
+	struct rlist in_all_txs;
 };
 
 static inline bool
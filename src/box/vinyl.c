@@ -300,6 +300,19 @@ vy_info_append_memory(struct vy_env *env, struct info_handler *h)
 	info_table_end(h); /* memory */
 }
 
+static void
+vy_info_append_page_cache(struct vy_env *env, struct info_handler *h)
+{
+	struct vy_page_cache *cache = &env->run_env.page_cache;
+
+	info_table_begin(h, "page_cache");
+	info_append_int(h, "memory", cache->mem_used);
+	info_append_int(h, "hit", cache->hit);
+	info_append_int(h, "miss", cache->miss);
+	info_append_int(h, "evict", cache->evict);
+	info_table_end(h); /* page_cache */
+}
+
 static void
 vy_info_append_disk(struct vy_env *env, struct info_handler *h)
 {
@@ -310,6 +323,18 @@ vy_info_append_disk(struct vy_env *env, struct info_handler *h)
 	info_table_end(h); /* disk */
 }
 
+static void
+vy_info_append_vylog(struct info_handler *h)
+{
+	const struct vy_log_stat *stat = vy_log_get_stat();
+
+	info_table_begin(h, "vylog");
+	info_append_double(h, "recovery_time", stat->recovery_time);
+	info_append_int(h, "records", stat->records);
+	info_append_int(h, "compaction_count", stat->compaction_count);
+	info_table_end(h); /* vylog */
+}
+
 void
 vinyl_engine_stat(struct engine *engine, struct info_handler *h)
 {
@@ -319,8 +344,10 @@ vinyl_engine_stat(struct engine *engine, struct info_handler *h)
 	vy_info_append_tx(env, h);
 	vy_info_append_memory(env, h);
 	vy_info_append_disk(env, h);
+	vy_info_append_page_cache(env, h);
 	vy_info_append_scheduler(env, h);
 	vy_info_append_regulator(env, h);
+	vy_info_append_vylog(h);
 	info_end(h);
 }
 
@@ -455,6 +482,23 @@ vinyl_index_stat(struct index *index, struct info_handler *h)
 	info_append_int(h, "dumps_per_compaction",
 			vy_lsm_dumps_per_compaction(lsm));
 
+	int64_t dump_output = 0, compaction_output = 0;
+	double max_write_amplification = 0;
+	struct vy_range *range = vy_range_tree_first(&lsm->range_tree);
+	for (; range != NULL;
+	     range = vy_range_tree_next(&lsm->range_tree, range)) {
+		dump_output += range->dump_output;
+		compaction_output += range->compaction_output;
+		max_write_amplification = MAX(max_write_amplification,
+					vy_range_write_amplification(range));
+	}
+	info_table_begin(h, "write_amplification");
+	info_append_double(h, "avg", dump_output == 0 ? 0 :
+			   (double)(dump_output + compaction_output) /
+			   dump_output);
+	info_append_double(h, "max", max_write_amplification);
+	info_table_end(h); /* write_amplification */
+
 	info_end(h);
 }
 
@@ -582,6 +626,12 @@ vinyl_engine_check_space_def(struct space_def *def)
 			 def->name, "engine does not support temporary flag");
 		return -1;
 	}
+	if (def->opts.compression != SPACE_COMPRESSION_NONE) {
+		diag_set(ClientError, ER_ALTER_SPACE, def->name,
+			 "engine does not support space compression, "
+			 "use index compression instead");
+		return -1;
+	}
 	return 0;
 }
 
@@ -683,6 +733,16 @@ vinyl_space_check_index_def(struct space *space, struct index_def *index_def)
 			 "functional index");
 		return -1;
 	}
+	if (index_def->opts.inline_key) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Vinyl",
+			 "inline_key index option");
+		return -1;
+	}
+	if (index_def->opts.hash_table != HASH_INDEX_TABLE_LIGHT) {
+		diag_set(ClientError, ER_UNSUPPORTED, "Vinyl",
+			 "hash_table index option");
+		return -1;
+	}
 	return 0;
 }
 
@@ -2690,6 +2750,20 @@ vinyl_engine_set_cache(struct engine *engine, size_t quota)
 	vy_cache_env_set_quota(&env->cache_env, quota);
 }
 
+void
+vinyl_engine_set_page_cache(struct engine *engine, size_t quota)
+{
+	struct vy_env *env = vy_env(engine);
+	vy_run_env_set_page_cache(&env->run_env, quota);
+}
+
+void
+vinyl_engine_set_bloom_memory(struct engine *engine, size_t quota)
+{
+	struct vy_env *env = vy_env(engine);
+	vy_lsm_env_set_bloom_quota(&env->lsm_env, quota);
+}
+
 int
 vinyl_engine_set_memory(struct engine *engine, size_t size)
 {
@@ -3788,6 +3862,164 @@ vinyl_index_get(struct index *index, const char *key,
 	return 0;
 }
 
+/** Max number of fibers used by vinyl_index_get_many(). */
+enum { VY_GET_MANY_MAX_FIBERS = 32 };
+
+/** State shared by fibers looking up keys for get_many(). */
+struct vy_get_many_ctx {
+	/** LSM tree to look up keys in. */
+	struct vy_lsm *lsm;
+	/** Current transaction or NULL. */
+	struct vy_tx *tx;
+	/** Read view. */
+	const struct vy_read_view **rv;
+	/** Array of pointers to keys (MsgPack arrays). */
+	const char **keys;
+	/** Number of keys. */
+	uint32_t key_count;
+	/** Index of the next key to look up. */
+	uint32_t next_key;
+	/** Array of found tuples, one per key. */
+	struct tuple **result;
+	/** Set if a lookup failed. */
+	bool is_failed;
+};
+
+/**
+ * Look up keys one by one until all keys are looked up.
+ * Several fibers may run this function concurrently, in which
+ * case disk reads of different keys are performed in parallel.
+ */
+static int
+vy_get_many_run(struct vy_get_many_ctx *ctx)
+{
+	while (!ctx->is_failed && ctx->next_key < ctx->key_count) {
+		/*
+		 * The transaction may be aborted while we are
+		 * waiting for a disk read, in which case there's
+		 * no point in looking up the remaining keys.
+		 */
+		if (ctx->tx != NULL && ctx->tx->state == VINYL_TX_ABORT) {
+			diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+			ctx->is_failed = true;
+			return -1;
+		}
+		uint32_t i = ctx->next_key++;
+		const char *key = ctx->keys[i];
+		uint32_t part_count = mp_decode_array(&key);
+		if (vy_get_by_raw_key(ctx->lsm, ctx->tx, ctx->rv, key,
+				      part_count, &ctx->result[i]) != 0) {
+			ctx->is_failed = true;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+vy_get_many_f(va_list ap)
+{
+	struct vy_get_many_ctx *ctx = va_arg(ap, struct vy_get_many_ctx *);
+	return vy_get_many_run(ctx);
+}
+
+static int
+vinyl_index_get_many(struct index *index, const char *keys,
+		     uint32_t key_count, struct tuple **result)
+{
+	assert(index->def->opts.is_unique);
+
+	struct vy_lsm *lsm = vy_lsm(index);
+	struct vy_env *env = vy_env(index->engine);
+	struct vy_tx *tx = in_txn() ? in_txn()->engine_tx : NULL;
+	const struct vy_read_view **rv = (tx != NULL ? vy_tx_read_view(tx) :
+					  &env->xm->p_global_read_view);
+
+	if (tx != NULL && tx->state == VINYL_TX_ABORT) {
+		diag_set(ClientError, ER_TRANSACTION_CONFLICT);
+		return -1;
+	}
+
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	size_t size;
+	const char **key_array = region_alloc_array(region, typeof(keys),
+						    key_count, &size);
+	if (key_array == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_array", "keys");
+		return -1;
+	}
+	struct fiber **fibers = region_alloc_array(region, typeof(fibers[0]),
+						   VY_GET_MANY_MAX_FIBERS,
+						   &size);
+	if (fibers == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc_array", "fibers");
+		region_truncate(region, region_svp);
+		return -1;
+	}
+	for (uint32_t i = 0; i < key_count; i++) {
+		key_array[i] = keys;
+		result[i] = NULL;
+		mp_next(&keys);
+	}
+
+	struct vy_get_many_ctx ctx;
+	ctx.lsm = lsm;
+	ctx.tx = tx;
+	ctx.rv = rv;
+	ctx.keys = key_array;
+	ctx.key_count = key_count;
+	ctx.next_key = 0;
+	ctx.result = result;
+	ctx.is_failed = false;
+
+	/*
+	 * Make sure the LSM tree isn't deleted while we are
+	 * reading from it.
+	 */
+	vy_lsm_ref(lsm);
+	/*
+	 * Lookups that are served from memory don't yield so
+	 * a fiber only switches to the next key when it has to
+	 * wait for a disk read. Start helper fibers so that
+	 * reads of different keys are sent to reader threads
+	 * at once rather than one by one. The current fiber
+	 * looks up keys too.
+	 */
+	int fiber_count = 0;
+	int max_fiber_count = (int)MIN(key_count,
+				      (uint32_t)VY_GET_MANY_MAX_FIBERS) - 1;
+	while (fiber_count < max_fiber_count &&
+	       !ctx.is_failed && ctx.next_key < ctx.key_count) {
+		struct fiber *f = fiber_new("vinyl.get_many", vy_get_many_f);
+		if (f == NULL) {
+			/* Look up the remaining keys in this fiber. */
+			diag_clear(diag_get());
+			break;
+		}
+		fiber_set_joinable(f, true);
+		fibers[fiber_count++] = f;
+		fiber_start(f, &ctx);
+	}
+	int rc = vy_get_many_run(&ctx);
+	for (int i = 0; i < fiber_count; i++) {
+		if (fiber_join(fibers[i]) != 0)
+			rc = -1;
+	}
+	vy_lsm_unref(lsm);
+	region_truncate(region, region_svp);
+	if (rc != 0) {
+		for (uint32_t i = 0; i < key_count; i++) {
+			if (result[i] != NULL) {
+				tuple_unref(result[i]);
+				result[i] = NULL;
+			}
+		}
+		return -1;
+	}
+	return 0;
+}
+
 /*** }}} Cursor */
 
 /* {{{ Index build */
@@ -4568,6 +4800,7 @@ static const struct index_vtab vinyl_index_vtab = {
 	/* .random = */ generic_index_random,
 	/* .count = */ generic_index_count,
 	/* .get = */ vinyl_index_get,
+	/* .get_many = */ vinyl_index_get_many,
 	/* .replace = */ generic_index_replace,
 	/* .create_iterator = */ vinyl_index_create_iterator,
 	/* .create_snapshot_iterator = */
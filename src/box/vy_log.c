@@ -32,6 +32,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -129,6 +130,7 @@ static const char *vy_log_type_name[] = {
 	[VY_LOG_PREPARE_LSM]		= "prepare_lsm",
 	[VY_LOG_REBOOTSTRAP]		= "rebootstrap",
 	[VY_LOG_ABORT_REBOOTSTRAP]	= "abort_rebootstrap",
+	[VY_LOG_COMPACT]		= "compact",
 };
 
 /** Batch of vylog records that must be written in one go. */
@@ -198,9 +200,29 @@ struct vy_log {
 	 * only relevant if @tx_failed is set.
 	 */
 	struct diag tx_diag;
+	/**
+	 * Number of records after the last snapshot that triggers
+	 * log compaction, see vy_log_compact().
+	 */
+	int64_t compaction_threshold;
+	/** Log statistics. */
+	struct vy_log_stat stat;
 };
 static struct vy_log vy_log;
 
+/**
+ * Don't compact the log until it has at least this many records
+ * written after the last snapshot, because loading a small log
+ * is fast anyway.
+ */
+static const int64_t VY_LOG_COMPACT_MIN_RECORDS = 100000;
+
+/**
+ * Compact the log when the number of records written after the
+ * last snapshot exceeds the size of the snapshot this many times.
+ */
+static const int64_t VY_LOG_COMPACT_RATIO = 2;
+
 static int
 vy_log_flusher_f(va_list va);
 
@@ -217,6 +239,9 @@ vy_log_create(const struct vclock *vclock, struct vy_recovery *recovery);
 int
 vy_log_rotate(const struct vclock *vclock);
 
+static void
+vy_log_compact(void);
+
 /**
  * Return the name of the vylog file that has the given signature.
  */
@@ -765,6 +790,7 @@ vy_log_init(const char *dir)
 		       sizeof(struct vy_log_tx));
 	stailq_create(&vy_log.pending_tx);
 	diag_create(&vy_log.tx_diag);
+	vy_log.compaction_threshold = VY_LOG_COMPACT_MIN_RECORDS;
 	wal_init_vy_log();
 	fiber_cond_create(&vy_log.flusher_cond);
 	vy_log.flusher = fiber_new("vinyl.vylog_flusher",
@@ -853,6 +879,10 @@ vy_log_tx_flush(struct vy_log_tx *tx)
 		goto err;
 
 	region_truncate(&fiber()->gc, used);
+
+	vy_log.stat.records += tx_size;
+	if (vy_log.stat.records >= vy_log.compaction_threshold)
+		fiber_cond_signal(&vy_log.flusher_cond);
 	return 0;
 err:
 	region_truncate(&fiber()->gc, used);
@@ -891,6 +921,16 @@ vy_log_flush(void)
 	return rc;
 }
 
+/** Return true if it's time to compact the log. */
+static bool
+vy_log_needs_compaction(void)
+{
+	ERROR_INJECT(ERRINJ_VY_LOG_COMPACT, {
+		return vy_log.stat.records > 0;
+	});
+	return vy_log.stat.records >= vy_log.compaction_threshold;
+}
+
 static int
 vy_log_flusher_f(va_list va)
 {
@@ -901,7 +941,8 @@ vy_log_flusher_f(va_list va)
 		 * See vy_log_tx_commit().
 		 */
 		if (vy_log.recovery != NULL ||
-		    stailq_empty(&vy_log.pending_tx)) {
+		    (stailq_empty(&vy_log.pending_tx) &&
+		     !vy_log_needs_compaction())) {
 			fiber_cond_wait(&vy_log.flusher_cond);
 			continue;
 		}
@@ -917,7 +958,10 @@ vy_log_flusher_f(va_list va)
 			 * as well. Instead wait for the next signal.
 			 */
 			fiber_cond_wait(&vy_log.flusher_cond);
+			continue;
 		}
+		if (vy_log_needs_compaction())
+			vy_log_compact();
 	}
 	return 0;
 }
@@ -1026,6 +1070,26 @@ vy_log_bootstrap(void)
 	return 0;
 }
 
+/** Return the number of objects stored in a recovery context. */
+static int64_t
+vy_recovery_object_count(struct vy_recovery *recovery)
+{
+	return mh_size(recovery->lsm_hash) + mh_size(recovery->range_hash) +
+	       mh_size(recovery->run_hash) + mh_size(recovery->slice_hash);
+}
+
+/**
+ * Set the number of records after which the log is compacted
+ * next time given the number of objects in the current state.
+ */
+static void
+vy_log_update_compaction_threshold(int64_t object_count)
+{
+	vy_log.compaction_threshold = vy_log.stat.records +
+		MAX(VY_LOG_COMPACT_MIN_RECORDS,
+		    VY_LOG_COMPACT_RATIO * object_count);
+}
+
 struct vy_recovery *
 vy_log_begin_recovery(const struct vclock *vclock)
 {
@@ -1078,12 +1142,17 @@ vy_log_begin_recovery(const struct vclock *vclock)
 	 * rebootstrap section, checkpoint (and hence rebootstrap)
 	 * failed, and we need to mark rebootstrap as aborted.
 	 */
+	double start_time = ev_monotonic_time();
 	struct vy_recovery *recovery;
 	recovery = vy_recovery_new(vclock_sum(&vy_log.last_checkpoint),
 				   VY_RECOVERY_ABORT_REBOOTSTRAP);
 	if (recovery == NULL)
 		return NULL;
 
+	vy_log.stat.recovery_time = ev_monotonic_time() - start_time;
+	vy_log.stat.records = recovery->tail_record_count;
+	vy_log_update_compaction_threshold(vy_recovery_object_count(recovery));
+
 	if (recovery->in_rebootstrap) {
 		struct vy_log_record record;
 		vy_log_record_init(&record);
@@ -1175,6 +1244,7 @@ vy_log_rotate(const struct vclock *vclock)
 
 	/* Do actual work from coio so as not to stall tx thread. */
 	int rc = coio_call(vy_log_rotate_f, recovery, vclock);
+	int64_t object_count = vy_recovery_object_count(recovery);
 	vy_recovery_delete(recovery);
 	if (rc < 0) {
 		diag_log();
@@ -1192,6 +1262,9 @@ vy_log_rotate(const struct vclock *vclock)
 	/* Add the new vclock to the xdir so that we can track it. */
 	xdir_add_vclock(&vy_log.dir, vclock);
 
+	vy_log.stat.records = 0;
+	vy_log_update_compaction_threshold(object_count);
+
 	latch_unlock(&vy_log.latch);
 	say_verbose("done rotating vylog");
 	return 0;
@@ -1219,6 +1292,12 @@ vy_log_signature(void)
 	return vclock_sum(&vy_log.last_checkpoint);
 }
 
+const struct vy_log_stat *
+vy_log_get_stat(void)
+{
+	return &vy_log.stat;
+}
+
 const char *
 vy_log_backup_path(const struct vclock *vclock)
 {
@@ -2292,20 +2371,15 @@ vy_recovery_build_index_id_hash(struct vy_recovery *recovery)
 	return 0;
 }
 
-static ssize_t
-vy_recovery_new_f(va_list ap)
+/** Allocate an empty recovery context. */
+static struct vy_recovery *
+vy_recovery_alloc(void)
 {
-	int64_t signature = va_arg(ap, int64_t);
-	int flags = va_arg(ap, int);
-	struct vy_recovery **p_recovery = va_arg(ap, struct vy_recovery **);
-
-	say_verbose("loading vylog %lld", (long long)signature);
-
 	struct vy_recovery *recovery = malloc(sizeof(*recovery));
 	if (recovery == NULL) {
 		diag_set(OutOfMemory, sizeof(*recovery),
 			 "malloc", "struct vy_recovery");
-		goto fail;
+		return NULL;
 	}
 
 	rlist_create(&recovery->lsms);
@@ -2316,6 +2390,7 @@ vy_recovery_new_f(va_list ap)
 	recovery->slice_hash = NULL;
 	recovery->max_id = -1;
 	recovery->in_rebootstrap = false;
+	recovery->tail_record_count = 0;
 
 	recovery->index_id_hash = mh_i64ptr_new();
 	recovery->lsm_hash = mh_i64ptr_new();
@@ -2328,8 +2403,24 @@ vy_recovery_new_f(va_list ap)
 	    recovery->run_hash == NULL ||
 	    recovery->slice_hash == NULL) {
 		diag_set(OutOfMemory, 0, "mh_i64ptr_new", "mh_i64ptr_t");
-		goto fail_free;
+		vy_recovery_delete(recovery);
+		return NULL;
 	}
+	return recovery;
+}
+
+static ssize_t
+vy_recovery_new_f(va_list ap)
+{
+	int64_t signature = va_arg(ap, int64_t);
+	int flags = va_arg(ap, int);
+	struct vy_recovery **p_recovery = va_arg(ap, struct vy_recovery **);
+
+	say_verbose("loading vylog %lld", (long long)signature);
+
+	struct vy_recovery *recovery = vy_recovery_alloc();
+	if (recovery == NULL)
+		goto fail;
 
 	/*
 	 * We don't create a log file if there are no objects to
@@ -2356,11 +2447,30 @@ vy_recovery_new_f(va_list ap)
 		if (record.type == VY_LOG_SNAPSHOT) {
 			if ((flags & VY_RECOVERY_LOAD_CHECKPOINT) != 0)
 				break;
+			recovery->tail_record_count = 0;
+			continue;
+		}
+		if (record.type == VY_LOG_COMPACT) {
+			/*
+			 * The following records describe the current
+			 * state from scratch, see vy_log_compact().
+			 * Preserve the max ID so as not to reuse IDs
+			 * of forgotten objects.
+			 */
+			struct vy_recovery *new_recovery = vy_recovery_alloc();
+			if (new_recovery == NULL) {
+				rc = -1;
+				break;
+			}
+			new_recovery->max_id = recovery->max_id;
+			vy_recovery_delete(recovery);
+			recovery = new_recovery;
 			continue;
 		}
 		rc = vy_recovery_process_record(recovery, &record);
 		if (rc < 0)
 			break;
+		recovery->tail_record_count++;
 		fiber_gc();
 	}
 	fiber_gc();
@@ -2631,3 +2741,158 @@ err_write_xlog:
 err_create_xlog:
 	return -1;
 }
+
+static ssize_t
+vy_log_compact_f(va_list ap)
+{
+	struct vy_recovery *checkpoint = va_arg(ap, struct vy_recovery *);
+	struct vy_recovery *recovery = va_arg(ap, struct vy_recovery *);
+	const struct vclock *vclock = va_arg(ap, const struct vclock *);
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s",
+		 vy_log_filename(vclock_sum(vclock)));
+	say_verbose("compacting vylog %lld", (long long)vclock_sum(vclock));
+
+	/*
+	 * We can't use xdir_create_xlog(), because it refuses
+	 * to overwrite an existing file. Write the new log to
+	 * a temporary file instead and then rename it over the
+	 * current one. The temporary file has .inprogress suffix
+	 * so it's removed on recovery if we fail.
+	 */
+	char name[PATH_MAX];
+	snprintf(name, sizeof(name), "%s.compact", path);
+	struct xlog_meta meta;
+	xlog_meta_create(&meta, vy_log.dir.filetype, vy_log.dir.instance_uuid,
+			 vclock, NULL);
+	struct xlog xlog;
+	if (xlog_create(&xlog, name, 0, &meta, &vy_log.dir.opts) != 0)
+		return -1;
+
+	/*
+	 * Keep the checkpoint snapshot so that we can still
+	 * load the checkpoint state for backup.
+	 */
+	struct vy_lsm_recovery_info *lsm;
+	rlist_foreach_entry(lsm, &checkpoint->lsms, in_recovery) {
+		if (vy_log_append_lsm(&xlog, lsm) != 0)
+			goto err;
+	}
+	struct vy_log_record record;
+	vy_log_record_init(&record);
+	record.type = VY_LOG_SNAPSHOT;
+	if (vy_log_append_record(&xlog, &record) != 0)
+		goto err;
+
+	/* Append a snapshot of the current state. */
+	vy_log_record_init(&record);
+	record.type = VY_LOG_COMPACT;
+	if (vy_log_append_record(&xlog, &record) != 0)
+		goto err;
+	rlist_foreach_entry(lsm, &recovery->lsms, in_recovery) {
+		if (vy_log_append_lsm(&xlog, lsm) != 0)
+			goto err;
+	}
+	vy_log_record_init(&record);
+	record.type = VY_LOG_SNAPSHOT;
+	if (vy_log_append_record(&xlog, &record) != 0)
+		goto err;
+
+	if (xlog_flush(&xlog) < 0 || xlog_sync(&xlog) < 0)
+		goto err;
+	if (rename(xlog.filename, path) != 0) {
+		diag_set(SystemError, "failed to rename '%s' file",
+			 xlog.filename);
+		goto err;
+	}
+	xlog_close(&xlog, false);
+	/*
+	 * Records are appended to the new file right after we
+	 * return, so make sure the rename is persistent. Otherwise
+	 * we could recover from the old file after a crash and
+	 * lose everything written to the new one.
+	 */
+	int dir_fd = open(vy_log.dir.dirname, O_RDONLY);
+	if (dir_fd < 0) {
+		diag_set(SystemError, "failed to open directory '%s'",
+			 vy_log.dir.dirname);
+		return -1;
+	}
+	if (fsync(dir_fd) != 0) {
+		diag_set(SystemError, "failed to sync directory '%s'",
+			 vy_log.dir.dirname);
+		close(dir_fd);
+		return -1;
+	}
+	close(dir_fd);
+	say_verbose("done compacting vylog");
+	return 0;
+err:
+	if (unlink(xlog.filename) < 0)
+		say_syserror("failed to delete file '%s'", xlog.filename);
+	xlog_close(&xlog, false);
+	return -1;
+}
+
+/**
+ * Rewrite the current log file so that it stores a snapshot
+ * of the current state instead of all records written since
+ * the last checkpoint. This speeds up recovery in case dumps
+ * and compactions are frequent. Errors are logged.
+ */
+static void
+vy_log_compact(void)
+{
+	int64_t signature = vy_log_signature();
+	struct vy_recovery *checkpoint = NULL;
+	struct vy_recovery *recovery = NULL;
+	int64_t object_count = 0;
+
+	/*
+	 * Lock out all concurrent log writers so that we don't
+	 * lose any records, see also vy_log_rotate().
+	 */
+	latch_lock(&vy_log.latch);
+
+	checkpoint = vy_recovery_new_locked(signature,
+					    VY_RECOVERY_LOAD_CHECKPOINT);
+	if (checkpoint == NULL)
+		goto out;
+	recovery = vy_recovery_new_locked(signature, 0);
+	if (recovery == NULL)
+		goto out;
+	object_count = vy_recovery_object_count(recovery);
+	/*
+	 * Objects created during rebootstrap are committed on
+	 * checkpoint, so we can't snapshot the state until then.
+	 */
+	if (recovery->in_rebootstrap)
+		goto out;
+
+	/* Do actual work from coio so as not to stall tx thread. */
+	int rc = coio_call(vy_log_compact_f, checkpoint, recovery,
+			   &vy_log.last_checkpoint);
+	/*
+	 * Close the old log. The new one will be opened
+	 * automatically on the first write. Do it even on
+	 * failure, because the file may have been replaced
+	 * before we failed to sync the directory.
+	 */
+	wal_rotate_vy_log();
+	if (rc != 0) {
+		diag_log();
+		say_error("failed to compact `%s'", vy_log_filename(signature));
+		goto out;
+	}
+	vy_log.stat.records = 0;
+	vy_log.stat.compaction_count++;
+out:
+	/* Don't retry until enough new records are written. */
+	vy_log_update_compaction_threshold(object_count);
+	latch_unlock(&vy_log.latch);
+	if (recovery != NULL)
+		vy_recovery_delete(recovery);
+	if (checkpoint != NULL)
+		vy_recovery_delete(checkpoint);
+}
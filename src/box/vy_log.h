@@ -217,6 +217,25 @@ enum vy_log_record_type {
 	 * See also VY_LOG_REBOOTSTRAP.
 	 */
 	VY_LOG_ABORT_REBOOTSTRAP	= 17,
+	/**
+	 * This record marks the beginning of a snapshot of the
+	 * current state written by background log compaction.
+	 * The snapshot follows the checkpoint snapshot and ends
+	 * with VY_LOG_SNAPSHOT marker. The state loaded before
+	 * a record of this type is discarded on recovery.
+	 *
+	 * Since we don't create a new log file until checkpoint,
+	 * the log may grow large if dumps and compactions are
+	 * frequent. To speed up recovery, we periodically rewrite
+	 * the log file so that it stores the checkpoint snapshot
+	 * (needed for backup), a snapshot of the current state,
+	 * and records written after it.
+	 *
+	 * Note, versions that don't know this record type fail
+	 * to load a compacted log, so downgrade isn't possible
+	 * once the log has been compacted.
+	 */
+	VY_LOG_COMPACT			= 18,
 
 	vy_log_record_type_MAX
 };
@@ -315,6 +334,8 @@ struct vy_recovery {
 	 * seen matching VY_LOG_ABORT_REBOOTSTRAP.
 	 */
 	bool in_rebootstrap;
+	/** Number of records following the last snapshot. */
+	int64_t tail_record_count;
 };
 
 /** LSM tree info stored in a recovery context. */
@@ -480,6 +501,20 @@ vy_log_collect_garbage(const struct vclock *vclock);
 int64_t
 vy_log_signature(void);
 
+/** Metadata log statistics. */
+struct vy_log_stat {
+	/** Time spent loading the log on recovery, in seconds. */
+	double recovery_time;
+	/** Number of records written after the last snapshot. */
+	int64_t records;
+	/** Number of times the log was compacted. */
+	int64_t compaction_count;
+};
+
+/** Return metadata log statistics. */
+const struct vy_log_stat *
+vy_log_get_stat(void);
+
 /**
  * Return the path to the log file that needs to be backed up
  * in order to recover to checkpoint @vclock.
@@ -45,6 +45,7 @@
 #include "say.h"
 #include "schema.h"
 #include "tuple.h"
+#include "tuple_bloom.h"
 #include "trigger.h"
 #include "vy_log.h"
 #include "vy_mem.h"
@@ -88,6 +89,8 @@ vy_lsm_env_create(struct vy_lsm_env *env, const char *path,
 	env->upsert_thresh_arg = upsert_thresh_arg;
 	env->too_long_threshold = TIMEOUT_INFINITY;
 	env->lsm_count = 0;
+	env->bloom_quota = 0;
+	rlist_create(&env->bloom_lru);
 	mempool_create(&env->history_node_pool, cord_slab_cache(),
 		       sizeof(struct vy_history_node));
 	return 0;
@@ -729,6 +732,51 @@ vy_lsm_range_size(struct vy_lsm *lsm)
 	return range_size;
 }
 
+/**
+ * Free the bloom filter of a run linked in vy_lsm_env::bloom_lru.
+ * It will be reloaded from the run index file on the next lookup.
+ */
+static void
+vy_lsm_evict_bloom(struct vy_run *run)
+{
+	struct vy_lsm *lsm = run->bloom_lsm;
+	struct vy_lsm_env *env = lsm->env;
+	size_t bloom_size = vy_run_bloom_size(run);
+
+	assert(run->bloom_offset != 0);
+	rlist_del_entry(run, in_bloom_lru);
+	run->bloom_lsm = NULL;
+	tuple_bloom_delete(run->info.bloom);
+	run->info.bloom = NULL;
+
+	lsm->bloom_size -= bloom_size;
+	env->bloom_size -= bloom_size;
+	env->disk_index_size -= bloom_size;
+}
+
+/**
+ * Evict bloom filters of the least recently used runs until
+ * the memory used for bloom filters fits in the quota.
+ */
+static void
+vy_lsm_env_shrink_bloom(struct vy_lsm_env *env)
+{
+	while (env->bloom_quota > 0 && env->bloom_size > env->bloom_quota &&
+	       !rlist_empty(&env->bloom_lru)) {
+		struct vy_run *run = rlist_last_entry(&env->bloom_lru,
+						      struct vy_run,
+						      in_bloom_lru);
+		vy_lsm_evict_bloom(run);
+	}
+}
+
+void
+vy_lsm_env_set_bloom_quota(struct vy_lsm_env *env, size_t quota)
+{
+	env->bloom_quota = quota;
+	vy_lsm_env_shrink_bloom(env);
+}
+
 void
 vy_lsm_add_run(struct vy_lsm *lsm, struct vy_run *run)
 {
@@ -755,6 +803,18 @@ vy_lsm_add_run(struct vy_lsm *lsm, struct vy_run *run)
 	env->disk_index_size += bloom_size + page_index_size;
 	if (lsm->index_id > 0)
 		env->disk_index_size += run->count.bytes;
+
+	/*
+	 * The index file of a run written by this version stores
+	 * the bloom filter in a separate tx so it can be evicted
+	 * and reloaded.
+	 */
+	if (run->info.bloom != NULL && run->bloom_offset != 0) {
+		assert(run->bloom_lsm == NULL);
+		run->bloom_lsm = lsm;
+		rlist_add_entry(&env->bloom_lru, run, in_bloom_lru);
+		vy_lsm_env_shrink_bloom(env);
+	}
 }
 
 void
@@ -767,6 +827,11 @@ vy_lsm_remove_run(struct vy_lsm *lsm, struct vy_run *run)
 	assert(lsm->run_count > 0);
 	assert(!rlist_empty(&run->in_lsm));
 	rlist_del_entry(run, in_lsm);
+	if (run->bloom_lsm != NULL) {
+		assert(run->bloom_lsm == lsm);
+		rlist_del_entry(run, in_bloom_lru);
+		run->bloom_lsm = NULL;
+	}
 	lsm->run_count--;
 	vy_disk_stmt_counter_sub(&lsm->stat.disk.count, &run->count);
 	vy_stmt_stat_sub(&lsm->stat.disk.stmt, &run->info.stmt_stat);
@@ -786,6 +851,69 @@ vy_lsm_remove_run(struct vy_lsm *lsm, struct vy_run *run)
 		env->disk_index_size -= run->count.bytes;
 }
 
+static int
+vy_lsm_load_bloom_f(va_list ap)
+{
+	struct vy_lsm *lsm = va_arg(ap, struct vy_lsm *);
+	struct vy_run *run = va_arg(ap, struct vy_run *);
+	struct vy_lsm_env *env = lsm->env;
+
+	struct tuple_bloom *bloom;
+	if (vy_run_load_bloom(run, run->bloom_offset, env->path,
+			      lsm->space_id, lsm->index_id, &bloom) != 0) {
+		/* Don't retry, proceed without the bloom filter. */
+		diag_log();
+		say_error("%s: failed to load bloom filter of run %lld",
+			  vy_lsm_name(lsm), (long long)run->id);
+		run->bloom_offset = 0;
+		goto out;
+	}
+	if (rlist_empty(&run->in_lsm)) {
+		/* The run was compacted while we were reading. */
+		tuple_bloom_delete(bloom);
+		goto out;
+	}
+	assert(run->info.bloom == NULL);
+	assert(run->bloom_lsm == NULL);
+	run->info.bloom = bloom;
+	run->bloom_lsm = lsm;
+	rlist_add_entry(&env->bloom_lru, run, in_bloom_lru);
+	size_t bloom_size = tuple_bloom_size(bloom);
+	lsm->bloom_size += bloom_size;
+	env->bloom_size += bloom_size;
+	env->disk_index_size += bloom_size;
+	vy_lsm_env_shrink_bloom(env);
+out:
+	run->is_bloom_loading = false;
+	vy_run_unref(run);
+	vy_lsm_unref(lsm);
+	return 0;
+}
+
+void
+vy_lsm_load_bloom(struct vy_lsm *lsm, struct vy_run *run)
+{
+	if (likely(run->bloom_offset == 0))
+		return;
+	if (run->bloom_lsm != NULL) {
+		assert(run->bloom_lsm == lsm);
+		rlist_move_entry(&lsm->env->bloom_lru, run, in_bloom_lru);
+		return;
+	}
+	if (run->info.bloom != NULL || run->is_bloom_loading)
+		return;
+	struct fiber *f = fiber_new("vinyl.bloom", vy_lsm_load_bloom_f);
+	if (f == NULL) {
+		/* Retry on the next lookup. */
+		diag_log();
+		return;
+	}
+	run->is_bloom_loading = true;
+	vy_lsm_ref(lsm);
+	vy_run_ref(run);
+	fiber_start(f, lsm, run);
+}
+
 void
 vy_lsm_add_range(struct vy_lsm *lsm, struct vy_range *range)
 {
@@ -1118,31 +1246,31 @@ vy_lsm_find_range_intersection(struct vy_lsm *lsm,
 }
 
 bool
-vy_lsm_split_range(struct vy_lsm *lsm, struct vy_range *range)
+vy_lsm_split_range(struct vy_lsm *lsm, struct vy_range *range, int max_parts)
 {
 	struct tuple_format *key_format = lsm->env->key_format;
 
-	const char *split_key_raw;
-	if (!vy_range_needs_split(range, vy_lsm_range_size(lsm),
-				  &split_key_raw))
+	const char *split_keys_raw[VY_RANGE_SPLIT_PARTS_MAX - 1];
+	int n_parts = vy_range_needs_split(range, vy_lsm_range_size(lsm),
+					   max_parts, split_keys_raw);
+	if (n_parts == 0)
 		return false;
 
-	/* Split a range in two parts. */
-	const int n_parts = 2;
-	struct vy_range *parts[2] = { NULL, NULL };
+	struct vy_range *parts[VY_RANGE_SPLIT_PARTS_MAX] = { NULL };
 	/*
 	 * Determine new ranges' boundaries.
 	 */
-	struct vy_entry split_key;
-	split_key = vy_entry_key_from_msgpack(key_format, lsm->cmp_def,
-					      split_key_raw);
-	if (split_key.stmt == NULL)
-		goto fail;
-
-	struct vy_entry keys[3];
+	struct vy_entry keys[VY_RANGE_SPLIT_PARTS_MAX + 1];
 	keys[0] = range->begin;
-	keys[1] = split_key;
-	keys[2] = range->end;
+	for (int i = 1; i < n_parts; i++)
+		keys[i] = vy_entry_none();
+	keys[n_parts] = range->end;
+	for (int i = 1; i < n_parts; i++) {
+		keys[i] = vy_entry_key_from_msgpack(key_format, lsm->cmp_def,
+						    split_keys_raw[i - 1]);
+		if (keys[i].stmt == NULL)
+			goto fail;
+	}
 
 	/*
 	 * Allocate new ranges and create slices of
@@ -1170,6 +1298,8 @@ vy_lsm_split_range(struct vy_lsm *lsm, struct vy_range *range)
 				vy_range_add_slice(part, new_slice);
 		}
 		part->needs_compaction = range->needs_compaction;
+		part->dump_output = range->dump_output / n_parts;
+		part->compaction_output = range->compaction_output / n_parts;
 		vy_range_update_compaction_priority(part, &lsm->opts);
 		vy_range_update_dumps_per_compaction(part);
 	}
@@ -1207,21 +1337,29 @@ vy_lsm_split_range(struct vy_lsm *lsm, struct vy_range *range)
 	}
 	lsm->range_tree_version++;
 
-	say_info("%s: split range %s by key %s", vy_lsm_name(lsm),
-		 vy_range_str(range), tuple_str(split_key.stmt));
+	if (n_parts == 2) {
+		say_info("%s: split range %s by key %s", vy_lsm_name(lsm),
+			 vy_range_str(range), tuple_str(keys[1].stmt));
+	} else {
+		say_info("%s: split range %s in %d parts", vy_lsm_name(lsm),
+			 vy_range_str(range), n_parts);
+	}
 
 	rlist_foreach_entry(slice, &range->slices, in_range)
 		vy_slice_wait_pinned(slice);
 	vy_range_delete(range);
-	tuple_unref(split_key.stmt);
+	for (int i = 1; i < n_parts; i++)
+		tuple_unref(keys[i].stmt);
 	return true;
 fail:
 	for (int i = 0; i < n_parts; i++) {
 		if (parts[i] != NULL)
 			vy_range_delete(parts[i]);
 	}
-	if (split_key.stmt != NULL)
-		tuple_unref(split_key.stmt);
+	for (int i = 1; i < n_parts; i++) {
+		if (keys[i].stmt != NULL)
+			tuple_unref(keys[i].stmt);
+	}
 
 	diag_log();
 	say_error("%s: failed to split range %s",
@@ -1279,6 +1417,8 @@ vy_lsm_coalesce_range(struct vy_lsm *lsm, struct vy_range *range)
 		rlist_splice(&result->slices, &it->slices);
 		result->slice_count += it->slice_count;
 		vy_disk_stmt_counter_add(&result->count, &it->count);
+		result->dump_output += it->dump_output;
+		result->compaction_output += it->compaction_output;
 		if (it->needs_compaction)
 			result->needs_compaction = true;
 		vy_range_delete(it);
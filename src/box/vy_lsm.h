@@ -90,6 +90,18 @@ struct vy_lsm_env {
 	int lsm_count;
 	/** Size of memory used for bloom filters. */
 	size_t bloom_size;
+	/**
+	 * Max size of memory that may be used for bloom filters
+	 * or 0 if unlimited. Only bloom filters linked in bloom_lru
+	 * can be evicted to fit in the limit.
+	 */
+	size_t bloom_quota;
+	/**
+	 * Runs whose bloom filters are loaded and can be evicted,
+	 * linked by vy_run::in_bloom_lru. The first element is
+	 * the most recently used.
+	 */
+	struct rlist bloom_lru;
 	/** Size of memory used for page index. */
 	size_t page_index_size;
 	/**
@@ -139,6 +151,15 @@ vy_lsm_env_create(struct vy_lsm_env *env, const char *path,
 void
 vy_lsm_env_destroy(struct vy_lsm_env *env);
 
+/**
+ * Set the max size of memory that may be used for bloom filters.
+ * Zero means unlimited. Bloom filters of the least recently used
+ * runs are evicted right away if the new limit is less than the
+ * size of memory currently used by bloom filters.
+ */
+void
+vy_lsm_env_set_bloom_quota(struct vy_lsm_env *env, size_t quota);
+
 /**
  * A struct for primary and secondary Vinyl indexes.
  * Named after the data structure used for organizing
@@ -468,6 +489,16 @@ vy_lsm_add_run(struct vy_lsm *lsm, struct vy_run *run);
 void
 vy_lsm_remove_run(struct vy_lsm *lsm, struct vy_run *run);
 
+/**
+ * Start loading the bloom filter of a run of an LSM tree in
+ * the background if it was skipped on recovery or evicted.
+ * Until it is loaded, lookups in the run go without the bloom
+ * filter. If the bloom filter is loaded, mark it as recently
+ * used so that it is evicted last.
+ */
+void
+vy_lsm_load_bloom(struct vy_lsm *lsm, struct vy_run *run);
+
 /**
  * Add a range to both the range tree and the range heap
  * of an LSM tree.
@@ -557,9 +588,15 @@ vy_lsm_find_range_intersection(struct vy_lsm *lsm,
  * by the original range, adding them to new ranges, and reflecting
  * the change in the metadata log, i.e. it doesn't involve heavy
  * operations, like writing a run file, and is done immediately.
+ *
+ * @max_parts is the number of workers that can compact the parts
+ * of the range in parallel. A range that is several times bigger
+ * than the target range size is split in up to @max_parts parts,
+ * see vy_range_needs_split().
  */
 bool
-vy_lsm_split_range(struct vy_lsm *lsm, struct vy_range *range);
+vy_lsm_split_range(struct vy_lsm *lsm, struct vy_range *range,
+		   int max_parts);
 
 /**
  * Coalesce a range with one or more its neighbors if it is too small,
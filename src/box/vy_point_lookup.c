@@ -136,6 +136,7 @@ vy_point_lookup_scan_slice(struct vy_lsm *lsm, struct vy_slice *slice,
 			   const struct vy_read_view **rv, struct vy_entry key,
 			   struct vy_history *history)
 {
+	vy_lsm_load_bloom(lsm, slice->run);
 	/*
 	 * The format of the statement must be exactly the space
 	 * format with the same identifier to fully match the
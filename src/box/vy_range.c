@@ -42,6 +42,7 @@
 #include <small/rlist.h>
 
 #include "diag.h"
+#include "errinj.h"
 #include "iterator_type.h"
 #include "key_def.h"
 #include "trivia/util.h"
@@ -280,6 +281,17 @@ vy_range_remove_slice(struct vy_range *range, struct vy_slice *slice)
  * compaction is relatively cheap, because of the level size
  * ratio.
  *
+ * With the leveled compaction strategy (default) the last level
+ * may hold only one run, which keeps space amplification low, but
+ * makes the whole range get rewritten each time an upper level is
+ * compacted into the last one. The tiered strategy treats the last
+ * level as any other one, i.e. lets it accumulate up to
+ * run_count_per_level runs, which reduces write amplification of
+ * append-mostly workloads at the cost of keeping more overwritten
+ * statements on disk. Read amplification is bounded in both cases,
+ * because the number of levels grows logarithmically with the range
+ * size and each level holds at most run_count_per_level runs.
+ *
  * Given a range, this function computes the maximal level that needs
  * to be compacted and sets @compaction_priority to the number of runs
  * in this level and all preceding levels.
@@ -415,7 +427,8 @@ vy_range_update_compaction_priority(struct vy_range *range,
 		}
 	}
 
-	if (level_run_count > 1) {
+	if (opts->compaction_strategy == VY_COMPACTION_LEVELED &&
+	    level_run_count > 1) {
 		/*
 		 * Do not store more than one run at the last level
 		 * to keep space amplification low.
@@ -438,8 +451,15 @@ vy_range_update_dumps_per_compaction(struct vy_range *range)
 }
 
 /**
- * Return true and set split_key accordingly if the range needs to be
- * split in two.
+ * Compacting a range smaller than that takes a few seconds so
+ * there's no point in splitting it to compact the parts in
+ * parallel.
+ */
+static const int64_t VY_RANGE_SPLIT_PARALLEL_MIN = 128 * 1024 * 1024;
+
+/**
+ * Return the number of parts and set split_keys accordingly if
+ * the range needs to be split, otherwise return 0.
  *
  * - We should never split a range until it was merged at least once
  *   (actually, it should be a function of run_count_per_level/number
@@ -449,70 +469,98 @@ vy_range_update_dumps_per_compaction(struct vy_range *range)
  * - We should split around the last run middle key.
  * - We should only split if the last run size is greater than
  *   4/3 * range_size.
+ * - A range that is several times bigger than range_size (and at
+ *   least VY_RANGE_SPLIT_PARALLEL_MIN) is split in up to max_parts
+ *   parts, each of at least range_size, so that the parts can be
+ *   compacted in parallel. Such a range is split even if it hasn't
+ *   been merged yet, because otherwise its first compaction would
+ *   be done by one worker thread.
  */
-bool
+int
 vy_range_needs_split(struct vy_range *range, int64_t range_size,
-		     const char **p_split_key)
+		     int max_parts, const char **split_keys)
 {
 	struct vy_slice *slice;
 
-	/* The range hasn't been merged yet - too early to split it. */
-	if (range->n_compactions < 1)
-		return false;
+	assert(max_parts <= VY_RANGE_SPLIT_PARTS_MAX);
 
 	/* Find the oldest run. */
 	assert(!rlist_empty(&range->slices));
 	slice = rlist_last_entry(&range->slices, struct vy_slice, in_range);
 
-	/* The range is too small to be split. */
-	if (slice->count.bytes < range_size * 4 / 3)
-		return false;
-
-	/* Find the median key in the oldest run (approximately). */
-	struct vy_page_info *mid_page;
-	mid_page = vy_run_page_info(slice->run, slice->first_page_no +
-				    (slice->last_page_no -
-				     slice->first_page_no) / 2);
-
-	struct vy_page_info *first_page = vy_run_page_info(slice->run,
-						slice->first_page_no);
+	int64_t parallel_min = VY_RANGE_SPLIT_PARALLEL_MIN;
+	struct errinj *inj = errinj(ERRINJ_VY_RANGE_SPLIT_PARALLEL_MIN,
+				    ERRINJ_INT);
+	if (inj != NULL && inj->iparam >= 0)
+		parallel_min = inj->iparam;
+
+	/* Number of parts that can be compacted in parallel. */
+	int part_count = 1;
+	if (slice->count.bytes >= parallel_min)
+		part_count = MIN(slice->count.bytes / range_size, max_parts);
+	if (range->n_compactions < 1) {
+		/* The range hasn't been merged yet - too early to split it. */
+		if (part_count < 2)
+			return 0;
+	} else {
+		/* The range is too small to be split. */
+		if (slice->count.bytes < range_size * 4 / 3)
+			return 0;
+		part_count = MAX(part_count, 2);
+	}
 
-	/* No point in splitting if a new range is going to be empty. */
-	if (key_compare(first_page->min_key, first_page->min_key_hint,
-			mid_page->min_key, mid_page->min_key_hint,
-			range->cmp_def) == 0)
-		return false;
 	/*
-	 * In extreme cases the median key can be < the beginning
-	 * of the slice, e.g.
-	 *
-	 * RUN:
-	 * ... |---- page N ----|-- page N + 1 --|-- page N + 2 --
-	 *     | min_key = [10] | min_key = [50] | min_key = [100]
-	 *
-	 * SLICE:
-	 * begin = [30], end = [70]
-	 * first_page_no = N, last_page_no = N + 1
-	 *
-	 * which makes mid_page_no = N and mid_page->min_key = [10].
-	 *
-	 * In such cases there's no point in splitting the range.
-	 */
-	if (slice->begin.stmt != NULL &&
-	    vy_entry_compare_with_raw_key(slice->begin, mid_page->min_key,
-					  mid_page->min_key_hint,
-					  range->cmp_def) >= 0)
-		return false;
-	/*
-	 * The median key can't be >= the end of the slice as we
-	 * take the min key of a page for the median key.
+	 * Split the oldest run evenly by pages (approximately).
+	 * Use the min key of the first page of each part as
+	 * a split key.
 	 */
-	assert(slice->end.stmt == NULL ||
-	       vy_entry_compare_with_raw_key(slice->end, mid_page->min_key,
-					     mid_page->min_key_hint,
-					     range->cmp_def) > 0);
-	*p_split_key = mid_page->min_key;
-	return true;
+	struct vy_page_info *prev_page = vy_run_page_info(slice->run,
+						slice->first_page_no);
+	uint64_t page_count = slice->last_page_no - slice->first_page_no;
+	int key_count = 0;
+	for (int i = 1; i < part_count; i++) {
+		struct vy_page_info *page = vy_run_page_info(slice->run,
+				slice->first_page_no + page_count * i /
+							part_count);
+		/* No point in splitting if a new range is going to be empty. */
+		if (key_compare(prev_page->min_key, prev_page->min_key_hint,
+				page->min_key, page->min_key_hint,
+				range->cmp_def) >= 0)
+			continue;
+		/*
+		 * In extreme cases the split key can be < the beginning
+		 * of the slice, e.g.
+		 *
+		 * RUN:
+		 * ... |---- page N ----|-- page N + 1 --|-- page N + 2 --
+		 *     | min_key = [10] | min_key = [50] | min_key = [100]
+		 *
+		 * SLICE:
+		 * begin = [30], end = [70]
+		 * first_page_no = N, last_page_no = N + 1
+		 *
+		 * which makes mid_page_no = N and mid_page->min_key = [10].
+		 *
+		 * In such cases there's no point in splitting the range
+		 * by this key.
+		 */
+		if (slice->begin.stmt != NULL &&
+		    vy_entry_compare_with_raw_key(slice->begin, page->min_key,
+						  page->min_key_hint,
+						  range->cmp_def) >= 0)
+			continue;
+		/*
+		 * The split key can't be >= the end of the slice as we
+		 * take the min key of a page for the split key.
+		 */
+		assert(slice->end.stmt == NULL ||
+		       vy_entry_compare_with_raw_key(slice->end, page->min_key,
+						     page->min_key_hint,
+						     range->cmp_def) > 0);
+		split_keys[key_count++] = page->min_key;
+		prev_page = page;
+	}
+	return key_count > 0 ? key_count + 1 : 0;
 }
 
 /**
@@ -124,6 +124,13 @@ struct vy_range {
 	 * this range, see vy_run::dump_count for more details.
 	 */
 	int dumps_per_compaction;
+	/**
+	 * Number of bytes dumped to this range and written by
+	 * compaction of this range since the server start, see
+	 * vy_range_write_amplification().
+	 */
+	int64_t dump_output;
+	int64_t compaction_output;
 	/** Link in vy_lsm->tree. */
 	rb_node(struct vy_range) tree_node;
 	/** Link in vy_lsm->range_heap. */
@@ -254,17 +261,39 @@ void
 vy_range_update_dumps_per_compaction(struct vy_range *range);
 
 /**
- * Check if a range needs to be split in two.
+ * Return write amplification of a range, i.e. the ratio of
+ * the number of bytes written to disk by dumps and compaction
+ * of this range to the number of bytes dumped to it, or 0 if
+ * nothing has been dumped to the range yet.
+ */
+static inline double
+vy_range_write_amplification(struct vy_range *range)
+{
+	if (range->dump_output == 0)
+		return 0;
+	return (double)(range->dump_output + range->compaction_output) /
+		range->dump_output;
+}
+
+/** Max number of parts a range can be split in at once. */
+enum { VY_RANGE_SPLIT_PARTS_MAX = 16 };
+
+/**
+ * Check if a range needs to be split.
  *
  * @param range             The range.
  * @param range_size        Target range size.
- * @param[out] p_split_key  Key to split the range by.
+ * @param max_parts         Max number of parts that can be compacted
+ *                          in parallel, <= VY_RANGE_SPLIT_PARTS_MAX.
+ * @param[out] split_keys   Keys to split the range by, must have
+ *                          room for VY_RANGE_SPLIT_PARTS_MAX - 1 keys.
  *
- * @retval true             If the range needs to be split.
+ * @retval                  Number of parts to split the range in
+ *                          or 0 if the range needn't be split.
  */
-bool
+int
 vy_range_needs_split(struct vy_range *range, int64_t range_size,
-		     const char **p_split_key);
+		     int max_parts, const char **split_keys);
 
 /**
  * Check if a range needs to be coalesced with adjacent
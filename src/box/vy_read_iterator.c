@@ -577,6 +577,29 @@ vy_read_iterator_add_disk(struct vy_read_iterator *itr)
 	 * format in vy_mem.
 	 */
 	rlist_foreach_entry(slice, &itr->curr_range->slices, in_range) {
+		/*
+		 * Skip runs that can't contain the search key so
+		 * that a short range scan over a deep LSM tree
+		 * doesn't read a page from each of them. Since
+		 * the key only gets more selective as the iterator
+		 * advances, it's fine to use the original key even
+		 * if the iterator is restored after a range change.
+		 */
+		if (!vy_slice_may_contain(slice, itr->iterator_type,
+					  itr->key, lsm->cmp_def))
+			continue;
+		vy_lsm_load_bloom(lsm, slice->run);
+		/*
+		 * The run iterator checks the bloom filter only
+		 * for EQ, because it handles REQ as LE, so check
+		 * it for REQ here.
+		 */
+		struct tuple_bloom *bloom = slice->run->info.bloom;
+		if (itr->iterator_type == ITER_REQ && bloom != NULL &&
+		    !vy_bloom_maybe_has(bloom, itr->key, lsm->key_def)) {
+			lsm->stat.disk.iterator.bloom_hit++;
+			continue;
+		}
 		struct vy_read_src *sub_src = vy_read_iterator_add_src(itr);
 		vy_run_iterator_open(&sub_src->run_iterator,
 				     &lsm->stat.disk.iterator, slice,
@@ -30,7 +30,9 @@
  */
 #include "vy_run.h"
 
+#include <fcntl.h>
 #include <zstd.h>
+#include <zdict.h>
 
 #include "fiber.h"
 #include "fiber_cond.h"
@@ -38,6 +40,7 @@
 #include "cbus.h"
 #include "memory.h"
 #include "coio_file.h"
+#include "uring.h"
 
 #include "replication.h"
 #include "tuple_bloom.h"
@@ -109,6 +112,48 @@ struct vy_page_read_task {
 	bool equal_found;
 	/** [out] resulting vinyl page */
 	struct vy_page *page;
+	/**
+	 * Raw page data read by tx via io_uring or NULL if the
+	 * page has to be read by the reader thread.
+	 */
+	const char *data;
+};
+
+enum {
+	/**
+	 * Number of pages a run iterator has to read one after
+	 * another before it starts reading ahead.
+	 */
+	VY_RUN_READAHEAD_TRIGGER = 2,
+	/** Max number of pages a run iterator reads ahead. */
+	VY_RUN_READAHEAD_MAX = 8,
+	/**
+	 * Ratio of the size of statements a run writer buffers
+	 * to train a zstd dictionary on to the dictionary size.
+	 */
+	VY_RUN_DICT_SAMPLE_RATIO = 100,
+};
+
+/** A page read ahead by a run iterator in a background fiber. */
+struct vy_page_prefetch {
+	/** Read task. The page it reads is owned by the prefetch. */
+	struct vy_page_read_task task;
+	/** Link in vy_run_iterator::readahead. */
+	struct rlist in_readahead;
+	/** Number of the page in the run. */
+	uint32_t page_no;
+	/** Set when the read completes. */
+	bool is_done;
+	/** Set if the read failed. Valid only if is_done is set. */
+	bool is_failed;
+	/**
+	 * Set if the iterator that started the read doesn't
+	 * need it anymore. The fiber frees such a prefetch when
+	 * the read completes.
+	 */
+	bool is_orphan;
+	/** Signaled when the read completes. */
+	struct fiber_cond done_cond;
 };
 
 /** Destructor for env->zdctx_key thread-local variable */
@@ -183,6 +228,7 @@ vy_run_env_create(struct vy_run_env *env, int read_threads)
 	tt_pthread_key_create(&env->zdctx_key, vy_free_zdctx);
 	mempool_create(&env->read_task_pool, cord_slab_cache(),
 		       sizeof(struct vy_page_read_task));
+	rlist_create(&env->page_cache.lru);
 }
 
 /**
@@ -193,6 +239,11 @@ vy_run_env_destroy(struct vy_run_env *env)
 {
 	if (env->reader_pool != NULL)
 		vy_run_env_stop_readers(env);
+	/*
+	 * Pages are dropped from the cache as runs are deleted,
+	 * but runs may be leaked on shutdown, so don't bother
+	 * freeing cached pages here.
+	 */
 	mempool_destroy(&env->read_task_pool);
 	tt_pthread_key_delete(env->zdctx_key);
 }
@@ -205,6 +256,7 @@ vy_run_env_enable_coio(struct vy_run_env *env)
 {
 	if (env->reader_pool != NULL)
 		return; /* already enabled */
+	env->use_uring = uring_is_enabled();
 	vy_run_env_start_readers(env);
 }
 
@@ -286,6 +338,7 @@ vy_run_new(struct vy_run_env *env, int64_t id)
 	run->refs = 1;
 	rlist_create(&run->in_lsm);
 	rlist_create(&run->in_unused);
+	rlist_create(&run->in_bloom_lru);
 	return run;
 }
 
@@ -309,14 +362,33 @@ vy_run_clear(struct vy_run *run)
 	run->info.min_key = NULL;
 	free(run->info.max_key);
 	run->info.max_key = NULL;
+	ZSTD_freeDDict(run->zddict);
+	run->zddict = NULL;
+}
+
+/**
+ * Take the dictionary pages of a run were compressed with, if
+ * any, from a cursor opened over the run file. The cursor loads
+ * it on open, see xlog_write_zdict().
+ */
+static void
+vy_run_take_zddict(struct vy_run *run, struct xlog_cursor *cursor)
+{
+	assert(run->zddict == NULL);
+	run->zddict = cursor->zddict;
+	cursor->zddict = NULL;
 }
 
+static void
+vy_page_cache_purge_run(struct vy_page_cache *cache, struct vy_run *run);
+
 void
 vy_run_delete(struct vy_run *run)
 {
 	assert(run->refs == 0);
 	if (run->fd >= 0 && close(run->fd) < 0)
 		say_syserror("close failed");
+	vy_page_cache_purge_run(&run->env->page_cache, run);
 	vy_run_clear(run);
 	TRASH(run);
 	free(run);
@@ -526,6 +598,43 @@ vy_slice_cut(struct vy_slice *slice, int64_t id, struct vy_entry begin,
 	return 0;
 }
 
+bool
+vy_slice_may_contain(struct vy_slice *slice, enum iterator_type type,
+		     struct vy_entry key, struct key_def *cmp_def)
+{
+	struct vy_run_info *info = &slice->run->info;
+	if (vy_stmt_is_empty_key(key.stmt) ||
+	    info->min_key == NULL || info->max_key == NULL)
+		return true;
+	/*
+	 * A partial key compares equal to all keys it is
+	 * a prefix of so the checks below never skip a run
+	 * that has a statement matching a prefix lookup.
+	 */
+	switch (type) {
+	case ITER_EQ:
+	case ITER_REQ:
+		return vy_entry_compare_with_raw_key(key, info->min_key,
+						     HINT_NONE, cmp_def) >= 0 &&
+		       vy_entry_compare_with_raw_key(key, info->max_key,
+						     HINT_NONE, cmp_def) <= 0;
+	case ITER_GE:
+		return vy_entry_compare_with_raw_key(key, info->max_key,
+						     HINT_NONE, cmp_def) <= 0;
+	case ITER_GT:
+		return vy_entry_compare_with_raw_key(key, info->max_key,
+						     HINT_NONE, cmp_def) < 0;
+	case ITER_LE:
+		return vy_entry_compare_with_raw_key(key, info->min_key,
+						     HINT_NONE, cmp_def) >= 0;
+	case ITER_LT:
+		return vy_entry_compare_with_raw_key(key, info->min_key,
+						     HINT_NONE, cmp_def) > 0;
+	default:
+		return true;
+	}
+}
+
 /**
  * Decode page information from xrow.
  *
@@ -678,6 +787,11 @@ vy_run_info_decode(struct vy_run_info *run_info,
 			if (run_info->bloom == NULL)
 				return -1;
 			break;
+		case VY_RUN_INFO_BLOOM_LEGACY_V2:
+			run_info->bloom = tuple_bloom_decode_legacy_v2(&pos);
+			if (run_info->bloom == NULL)
+				return -1;
+			break;
 		case VY_RUN_INFO_BLOOM:
 			run_info->bloom = tuple_bloom_decode(&pos);
 			if (run_info->bloom == NULL)
@@ -729,6 +843,9 @@ vy_page_new(const struct vy_page_info *page_info)
 		free(page);
 		return NULL;
 	}
+	page->refs = 1;
+	page->run = NULL;
+	rlist_create(&page->in_lru);
 	return page;
 }
 
@@ -747,6 +864,141 @@ vy_page_delete(struct vy_page *page)
 	free(page);
 }
 
+static inline void
+vy_page_ref(struct vy_page *page)
+{
+	assert(page->refs > 0);
+	page->refs++;
+}
+
+static inline void
+vy_page_unref(struct vy_page *page)
+{
+	assert(page->refs > 0);
+	if (--page->refs == 0)
+		vy_page_delete(page);
+}
+
+/* {{{ vy_page_cache */
+
+/** Size of memory occupied by a page. */
+static inline size_t
+vy_page_mem_used(struct vy_page *page)
+{
+	return sizeof(*page) + page->row_count * sizeof(uint32_t) +
+	       page->unpacked_size;
+}
+
+/** Remove a page from the cache and drop the cache's reference. */
+static void
+vy_page_cache_evict(struct vy_page_cache *cache, struct vy_page *page)
+{
+	struct vy_run *run = page->run;
+	assert(run != NULL);
+	assert(run->cached_pages[page->page_no] == page);
+	run->cached_pages[page->page_no] = NULL;
+	rlist_del_entry(page, in_lru);
+	page->run = NULL;
+	assert(cache->mem_used >= vy_page_mem_used(page));
+	cache->mem_used -= vy_page_mem_used(page);
+	cache->evict++;
+	vy_page_unref(page);
+}
+
+/** Evict the oldest pages until the cache fits in the given size. */
+static void
+vy_page_cache_shrink(struct vy_page_cache *cache, size_t size)
+{
+	while (cache->mem_used > size) {
+		assert(!rlist_empty(&cache->lru));
+		struct vy_page *page = rlist_last_entry(&cache->lru,
+							struct vy_page,
+							in_lru);
+		vy_page_cache_evict(cache, page);
+	}
+}
+
+/**
+ * Look up a page in the cache. Returns NULL if the page
+ * isn't cached. The page isn't referenced.
+ */
+static struct vy_page *
+vy_page_cache_get(struct vy_page_cache *cache, struct vy_run *run,
+		  uint32_t page_no)
+{
+	if (cache->mem_quota == 0)
+		return NULL; /* Cache is disabled. */
+	struct vy_page *page = NULL;
+	if (run->cached_pages != NULL)
+		page = run->cached_pages[page_no];
+	if (page == NULL) {
+		cache->miss++;
+		return NULL;
+	}
+	cache->hit++;
+	/* Move the page to the head of the LRU list. */
+	rlist_move_entry(&cache->lru, page, in_lru);
+	return page;
+}
+
+/**
+ * Add a page read from a run to the cache. The cache is
+ * best-effort, so the function silently returns if the page
+ * can't be cached.
+ */
+static void
+vy_page_cache_put(struct vy_page_cache *cache, struct vy_run *run,
+		  struct vy_page *page)
+{
+	assert(page->run == NULL);
+	size_t mem_used = vy_page_mem_used(page);
+	if (mem_used > cache->mem_quota)
+		return;
+	if (run->cached_pages == NULL) {
+		run->cached_pages = calloc(run->info.page_count,
+					   sizeof(*run->cached_pages));
+		if (run->cached_pages == NULL)
+			return;
+	}
+	/*
+	 * The page could have been cached by another fiber
+	 * while we were waiting for it to be read.
+	 */
+	if (run->cached_pages[page->page_no] != NULL)
+		return;
+	vy_page_cache_shrink(cache, cache->mem_quota - mem_used);
+	run->cached_pages[page->page_no] = page;
+	page->run = run;
+	rlist_add_entry(&cache->lru, page, in_lru);
+	cache->mem_used += mem_used;
+	vy_page_ref(page);
+}
+
+/** Evict all pages of a run from the cache. */
+static void
+vy_page_cache_purge_run(struct vy_page_cache *cache, struct vy_run *run)
+{
+	if (run->cached_pages == NULL)
+		return;
+	for (uint32_t page_no = 0; page_no < run->info.page_count; page_no++) {
+		struct vy_page *page = run->cached_pages[page_no];
+		if (page != NULL)
+			vy_page_cache_evict(cache, page);
+	}
+	free(run->cached_pages);
+	run->cached_pages = NULL;
+}
+
+void
+vy_run_env_set_page_cache(struct vy_run_env *env, size_t quota)
+{
+	struct vy_page_cache *cache = &env->page_cache;
+	cache->mem_quota = quota;
+	vy_page_cache_shrink(cache, quota);
+}
+
+/* }}} vy_page_cache */
+
 static int
 vy_page_xrow(struct vy_page *page, uint32_t stmt_no,
 	     struct xrow_header *xrow)
@@ -833,9 +1085,9 @@ vy_run_iterator_stop(struct vy_run_iterator *itr)
 		itr->curr = vy_entry_none();
 	}
 	if (itr->curr_page != NULL) {
-		vy_page_delete(itr->curr_page);
+		vy_page_unref(itr->curr_page);
 		if (itr->prev_page != NULL)
-			vy_page_delete(itr->prev_page);
+			vy_page_unref(itr->prev_page);
 		itr->curr_page = itr->prev_page = NULL;
 	}
 }
@@ -882,35 +1134,90 @@ vy_run_filename(struct vy_run *run)
 }
 
 /**
- * Read a page requests from vinyl xlog data file.
+ * Read data from a run file. Use io_uring if enabled so as not
+ * to block tx. Dump and compaction threads don't have io_uring
+ * instances and always use plain pread().
+ */
+static ssize_t
+vy_run_env_pread(struct vy_run_env *env, int fd, void *buf, size_t count,
+		 off_t offset)
+{
+	if (env->use_uring && uring_is_enabled())
+		return uring_pread(fd, buf, count, offset);
+	return fio_pread(fd, buf, count, offset);
+}
+
+static ssize_t
+vy_run_pread(struct vy_run *run, void *buf, size_t count, off_t offset)
+{
+	return vy_run_env_pread(run->env, run->fd, buf, count, offset);
+}
+
+/** Log an error that occurred while reading a page. */
+static void
+vy_page_read_error(struct vy_run *run, const struct vy_page_info *page_info)
+{
+	diag_log();
+	say_error("error reading %s@%llu:%u", vy_run_filename(run),
+		  (unsigned long long)page_info->offset,
+		  (unsigned)page_info->size);
+}
+
+/**
+ * Read raw page data from vinyl xlog data file to the given
+ * buffer, which must be at least page_info->size long.
  *
  * @retval 0 on success
  * @retval -1 on error, check diag
  */
 static int
-vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
-	     struct vy_run *run, ZSTD_DStream *zdctx)
+vy_page_read_data(const struct vy_page_info *page_info, struct vy_run *run,
+		  char *data)
 {
-	/* read xlog tx from xlog file */
-	size_t region_svp = region_used(&fiber()->gc);
-	char *data = (char *)region_alloc(&fiber()->gc, page_info->size);
-	if (data == NULL) {
-		diag_set(OutOfMemory, page_info->size, "region gc", "page");
-		return -1;
-	}
-	ssize_t readen = fio_pread(run->fd, data, page_info->size,
-				   page_info->offset);
+	ssize_t readen = vy_run_pread(run, data, page_info->size,
+				      page_info->offset);
 	ERROR_INJECT(ERRINJ_VYRUN_DATA_READ, {
 		readen = -1;
 		errno = EIO;});
 	if (readen < 0) {
 		diag_set(SystemError, "failed to read from file");
-		goto error;
+		return -1;
 	}
 	if (readen != (ssize_t)page_info->size) {
 		diag_set(ClientError, ER_INVALID_RUN_FILE,
 			 "Unexpected end of file");
-		goto error;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Read a page requests from vinyl xlog data file.
+ *
+ * If @a data isn't NULL, it's the raw page data that has
+ * already been read from the file, see vy_page_read_data(),
+ * and only has to be decoded.
+ *
+ * @retval 0 on success
+ * @retval -1 on error, check diag
+ */
+static int
+vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
+	     struct vy_run *run, const char *data, ZSTD_DStream *zdctx)
+{
+	/* read xlog tx from xlog file */
+	size_t region_svp = region_used(&fiber()->gc);
+	if (data == NULL) {
+		char *buf = (char *)region_alloc(&fiber()->gc,
+						 page_info->size);
+		if (buf == NULL) {
+			diag_set(OutOfMemory, page_info->size,
+				 "region gc", "page");
+			return -1;
+		}
+		if (vy_page_read_data(page_info, run, buf) != 0)
+			goto error;
+		data = buf;
 	}
 
 	struct errinj *inj = errinj(ERRINJ_VY_READ_PAGE_TIMEOUT, ERRINJ_DOUBLE);
@@ -921,10 +1228,11 @@ vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
 
 	/* decode xlog tx */
 	const char *data_pos = data;
-	const char *data_end = data + readen;
+	const char *data_end = data + page_info->size;
 	char *rows = page->data;
 	char *rows_end = rows + page_info->unpacked_size;
-	if (xlog_tx_decode(data, data_end, rows, rows_end, zdctx) != 0)
+	if (xlog_tx_decode(data, data_end, rows, rows_end,
+			   zdctx, run->zddict) != 0)
 		goto error;
 
 	struct xrow_header xrow;
@@ -948,10 +1256,7 @@ vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
 	return 0;
 error:
 	region_truncate(&fiber()->gc, region_svp);
-	diag_log();
-	say_error("error reading %s@%llu:%u", vy_run_filename(run),
-		  (unsigned long long)page_info->offset,
-		  (unsigned)page_info->size);
+	vy_page_read_error(run, page_info);
 	return -1;
 }
 
@@ -984,7 +1289,8 @@ vy_page_read_cb(struct cbus_call_msg *base)
 	ZSTD_DStream *zdctx = vy_env_get_zdctx(task->run->env);
 	if (zdctx == NULL)
 		return -1;
-	if (vy_page_read(task->page, task->page_info, task->run, zdctx) != 0)
+	if (vy_page_read(task->page, task->page_info, task->run,
+			 task->data, zdctx) != 0)
 		return -1;
 	if (task->key.stmt != NULL) {
 		task->pos_in_page = vy_page_find_key(task->page, task->key,
@@ -995,9 +1301,381 @@ vy_page_read_cb(struct cbus_call_msg *base)
 	return 0;
 }
 
+/**
+ * Execute a page read task on behalf of a reader thread. If tx
+ * has io_uring, the raw page data is read by tx, which doesn't
+ * block it, and the reader thread only decompresses and decodes
+ * the page.
+ */
+static int
+vy_run_env_read_page(struct vy_run_env *env, struct vy_page_read_task *task)
+{
+	if (!env->use_uring || env->reader_pool == NULL)
+		return vy_run_env_coio_call(env, &task->base, vy_page_read_cb);
+
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	char *data = (char *)region_alloc(region, task->page_info->size);
+	if (data == NULL) {
+		diag_set(OutOfMemory, task->page_info->size,
+			 "region gc", "page");
+		return -1;
+	}
+	int rc = vy_page_read_data(task->page_info, task->run, data);
+	if (rc == 0) {
+		task->data = data;
+		rc = vy_run_env_coio_call(env, &task->base, vy_page_read_cb);
+		task->data = NULL;
+	} else {
+		vy_page_read_error(task->run, task->page_info);
+	}
+	region_truncate(region, region_svp);
+	return rc;
+}
+
+/** Task to read a bloom filter skipped on recovery. */
+struct vy_bloom_read_task {
+	/** parent */
+	struct cbus_call_msg base;
+	/** vy_run the bloom filter belongs to - ref. counted */
+	struct vy_run *run;
+	/** Path to the run index file. */
+	const char *path;
+	/** Offset of the bloom filter tx in the index file. */
+	off_t offset;
+	/** [out] loaded bloom filter */
+	struct tuple_bloom *bloom;
+};
+
+/**
+ * Read and decode the bloom filter tx written by
+ * vy_run_write_bloom().
+ */
+static int
+vy_bloom_read(struct vy_bloom_read_task *task, int fd)
+{
+	struct vy_run_env *env = task->run->env;
+	char header[XLOG_FIXHEADER_SIZE];
+	ssize_t readen = vy_run_env_pread(env, fd, header, sizeof(header),
+					  task->offset);
+	if (readen < 0) {
+		diag_set(SystemError, "failed to read '%s' file", task->path);
+		return -1;
+	}
+	bool is_compressed;
+	ssize_t size = xlog_tx_size(header, header + readen, &is_compressed);
+	if (size < 0)
+		return -1;
+	if (is_compressed) {
+		diag_set(ClientError, ER_INVALID_INDEX_FILE, task->path,
+			 "Compressed bloom filter");
+		return -1;
+	}
+	struct region *region = &fiber()->gc;
+	size_t rows_size = size - XLOG_FIXHEADER_SIZE;
+	char *data = region_alloc(region, size + rows_size);
+	if (data == NULL) {
+		diag_set(OutOfMemory, size + rows_size, "region",
+			 "bloom filter");
+		return -1;
+	}
+	readen = vy_run_env_pread(env, fd, data, size, task->offset);
+	if (readen < 0) {
+		diag_set(SystemError, "failed to read '%s' file", task->path);
+		return -1;
+	}
+	if (readen != size) {
+		diag_set(ClientError, ER_INVALID_INDEX_FILE, task->path,
+			 "Unexpected end of file");
+		return -1;
+	}
+	char *rows = data + size;
+	char *rows_end = rows + rows_size;
+	if (xlog_tx_decode(data, data + size, rows, rows_end,
+			   NULL, NULL) != 0)
+		return -1;
+
+	struct xrow_header xrow;
+	const char *pos = rows;
+	if (xrow_header_decode(&xrow, &pos, rows_end, true) != 0)
+		return -1;
+	if (xrow.type != VY_INDEX_BLOOM || xrow.bodycnt != 1) {
+		diag_set(ClientError, ER_INVALID_INDEX_FILE, task->path,
+			 tt_sprintf("Wrong xrow type (expected %d, got %u)",
+				    VY_INDEX_BLOOM, (unsigned)xrow.type));
+		return -1;
+	}
+	pos = xrow.body->iov_base;
+	uint32_t map_size = mp_decode_map(&pos);
+	for (uint32_t i = 0; i < map_size; i++) {
+		uint32_t key = mp_decode_uint(&pos);
+		if (key != VY_RUN_INFO_BLOOM || task->bloom != NULL) {
+			mp_next(&pos); /* unknown key, ignore */
+			continue;
+		}
+		task->bloom = tuple_bloom_decode(&pos);
+		if (task->bloom == NULL)
+			return -1;
+	}
+	if (task->bloom == NULL) {
+		diag_set(ClientError, ER_INVALID_INDEX_FILE, task->path,
+			 "Missing bloom filter");
+		return -1;
+	}
+	return 0;
+}
+
+/** Bloom filter read task callback. */
+static int
+vy_bloom_read_cb(struct cbus_call_msg *base)
+{
+	struct vy_bloom_read_task *task = (struct vy_bloom_read_task *)base;
+	int fd = open(task->path, O_RDONLY);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to open '%s' file", task->path);
+		return -1;
+	}
+	size_t region_svp = region_used(&fiber()->gc);
+	int rc = vy_bloom_read(task, fd);
+	region_truncate(&fiber()->gc, region_svp);
+	close(fd);
+	return rc;
+}
+
+int
+vy_run_load_bloom(struct vy_run *run, off_t offset, const char *dir,
+		  uint32_t space_id, uint32_t iid, struct tuple_bloom **bloom)
+{
+	char path[PATH_MAX];
+	vy_run_snprint_path(path, sizeof(path), dir,
+			    space_id, iid, run->id, VY_FILE_INDEX);
+	struct vy_bloom_read_task task;
+	memset(&task, 0, sizeof(task));
+	task.run = run;
+	task.path = path;
+	task.offset = offset;
+	if (vy_run_env_coio_call(run->env, &task.base,
+				 vy_bloom_read_cb) != 0) {
+		if (task.bloom != NULL)
+			tuple_bloom_delete(task.bloom);
+		return -1;
+	}
+	*bloom = task.bloom;
+	return 0;
+}
+
+/**
+ * Make a page the current page of a run iterator.
+ * The page must be referenced by the caller.
+ */
+static void
+vy_run_iterator_set_page(struct vy_run_iterator *itr, struct vy_page *page)
+{
+	if (itr->prev_page != NULL)
+		vy_page_unref(itr->prev_page);
+	itr->prev_page = itr->curr_page;
+	itr->curr_page = page;
+}
+
+/** Free a prefetch and the page it read unless the page was taken. */
+static void
+vy_page_prefetch_delete(struct vy_page_prefetch *prefetch)
+{
+	assert(prefetch->is_done);
+	if (prefetch->task.page != NULL)
+		vy_page_delete(prefetch->task.page);
+	vy_run_unref(prefetch->task.run);
+	fiber_cond_destroy(&prefetch->done_cond);
+	free(prefetch);
+}
+
+static int
+vy_page_prefetch_f(va_list ap)
+{
+	struct vy_page_prefetch *prefetch = va_arg(ap,
+						   struct vy_page_prefetch *);
+	struct vy_run_env *env = prefetch->task.run->env;
+	if (vy_run_env_read_page(env, &prefetch->task) != 0) {
+		/*
+		 * The error was logged by the reader. The iterator
+		 * will retry the read and report it if it needs
+		 * the page.
+		 */
+		diag_clear(diag_get());
+		prefetch->is_failed = true;
+	}
+	prefetch->is_done = true;
+	if (prefetch->is_orphan)
+		vy_page_prefetch_delete(prefetch);
+	else
+		fiber_cond_broadcast(&prefetch->done_cond);
+	return 0;
+}
+
+/**
+ * Start reading a page in a background fiber.
+ * Read-ahead is best-effort so errors are ignored.
+ */
+static void
+vy_run_iterator_prefetch(struct vy_run_iterator *itr, uint32_t page_no)
+{
+	struct vy_run *run = itr->slice->run;
+	struct vy_page_info *page_info = vy_run_page_info(run, page_no);
+	struct vy_page_prefetch *prefetch = malloc(sizeof(*prefetch));
+	if (prefetch == NULL)
+		return;
+	struct vy_page *page = vy_page_new(page_info);
+	if (page == NULL) {
+		diag_clear(diag_get());
+		free(prefetch);
+		return;
+	}
+	struct fiber *fiber = fiber_new("vinyl.readahead", vy_page_prefetch_f);
+	if (fiber == NULL) {
+		diag_clear(diag_get());
+		vy_page_delete(page);
+		free(prefetch);
+		return;
+	}
+	memset(&prefetch->task, 0, sizeof(prefetch->task));
+	prefetch->task.run = run;
+	prefetch->task.page_info = page_info;
+	prefetch->task.page = page;
+	prefetch->task.key = vy_entry_none();
+	prefetch->page_no = page_no;
+	prefetch->is_done = false;
+	prefetch->is_failed = false;
+	prefetch->is_orphan = false;
+	fiber_cond_create(&prefetch->done_cond);
+	vy_run_ref(run);
+	rlist_add_tail_entry(&itr->readahead, prefetch, in_readahead);
+	fiber_start(fiber, prefetch);
+}
+
+/**
+ * Drop a page read ahead by a run iterator. If the read is still
+ * in progress, the prefetch will be freed when it completes.
+ */
+static void
+vy_run_iterator_drop_prefetch(struct vy_page_prefetch *prefetch)
+{
+	rlist_del_entry(prefetch, in_readahead);
+	if (prefetch->is_done)
+		vy_page_prefetch_delete(prefetch);
+	else
+		prefetch->is_orphan = true;
+}
+
+/** Look up a page read ahead by a run iterator. */
+static struct vy_page_prefetch *
+vy_run_iterator_find_prefetch(struct vy_run_iterator *itr, uint32_t page_no)
+{
+	struct vy_page_prefetch *prefetch;
+	rlist_foreach_entry(prefetch, &itr->readahead, in_readahead) {
+		if (prefetch->page_no == page_no)
+			return prefetch;
+	}
+	return NULL;
+}
+
+/** Drop all pages read ahead by a run iterator. */
+static void
+vy_run_iterator_drop_readahead(struct vy_run_iterator *itr)
+{
+	struct vy_page_prefetch *prefetch, *tmp;
+	rlist_foreach_entry_safe(prefetch, &itr->readahead,
+				 in_readahead, tmp)
+		vy_run_iterator_drop_prefetch(prefetch);
+}
+
+/**
+ * Called after a run iterator reads a page that isn't the current
+ * or the previous one. If the iterator reads pages one after another,
+ * start reading the next pages in the iteration direction in
+ * background so that a long scan doesn't wait for the disk on each
+ * page. The read-ahead window doubles on each sequential read up to
+ * VY_RUN_READAHEAD_MAX pages. Pages that are behind the iterator
+ * position are dropped.
+ */
+static void
+vy_run_iterator_readahead(struct vy_run_iterator *itr, uint32_t page_no)
+{
+	struct vy_slice *slice = itr->slice;
+	struct vy_run *run = slice->run;
+	struct vy_run_env *env = run->env;
+	int dir = iterator_direction(itr->iterator_type);
+
+	bool is_seq = (int64_t)page_no == (int64_t)itr->last_page_no + dir;
+	itr->last_page_no = page_no;
+	if (!is_seq) {
+		itr->seq_page_count = 0;
+		vy_run_iterator_drop_readahead(itr);
+		return;
+	}
+	itr->seq_page_count++;
+
+	struct vy_page_prefetch *prefetch, *tmp;
+	rlist_foreach_entry_safe(prefetch, &itr->readahead,
+				 in_readahead, tmp) {
+		if ((int64_t)prefetch->page_no * dir <= (int64_t)page_no * dir)
+			vy_run_iterator_drop_prefetch(prefetch);
+	}
+
+	/* There's no point in reading ahead if reads don't yield. */
+	if (env->reader_pool == NULL)
+		return;
+	if (itr->seq_page_count < VY_RUN_READAHEAD_TRIGGER)
+		return;
+
+	uint32_t shift = MIN(itr->seq_page_count - VY_RUN_READAHEAD_TRIGGER,
+			     16U);
+	uint32_t window = MIN(1U << shift, (uint32_t)VY_RUN_READAHEAD_MAX);
+	for (uint32_t i = 1; i <= window; i++) {
+		int64_t next_page_no = (int64_t)page_no + (int64_t)i * dir;
+		if (next_page_no < slice->first_page_no ||
+		    next_page_no > slice->last_page_no)
+			break;
+		if (run->cached_pages != NULL &&
+		    run->cached_pages[next_page_no] != NULL)
+			continue;
+		if (vy_run_iterator_find_prefetch(itr, next_page_no) == NULL)
+			vy_run_iterator_prefetch(itr, next_page_no);
+	}
+}
+
+/**
+ * Take a page read ahead by a run iterator, waiting for the read
+ * to complete if necessary. Returns NULL if the page wasn't read
+ * ahead or the read failed. The returned page is referenced.
+ */
+static struct vy_page *
+vy_run_iterator_take_prefetched(struct vy_run_iterator *itr,
+				uint32_t page_no)
+{
+	struct vy_page_prefetch *prefetch;
+	prefetch = vy_run_iterator_find_prefetch(itr, page_no);
+	if (prefetch == NULL)
+		return NULL;
+	bool cancellable = fiber_set_cancellable(false);
+	while (!prefetch->is_done)
+		fiber_cond_wait(&prefetch->done_cond);
+	fiber_set_cancellable(cancellable);
+	struct vy_page *page = NULL;
+	if (!prefetch->is_failed) {
+		page = prefetch->task.page;
+		prefetch->task.page = NULL;
+		page->page_no = page_no;
+	}
+	vy_run_iterator_drop_prefetch(prefetch);
+	return page;
+}
+
 /**
  * Read a page from disk given its number.
- * The function caches two most recently read pages.
+ * The function keeps two most recently read pages and
+ * looks up pages in the page cache before reading them.
+ * Sequentially read pages are read ahead, see
+ * vy_run_iterator_readahead().
  *
  * @retval 0 success
  * @retval -1 critical error
@@ -1030,8 +1708,38 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 		return 0;
 	}
 
-	/* Allocate buffers */
+	/* Check the page cache */
+	page = vy_page_cache_get(&env->page_cache, slice->run, page_no);
+	if (page != NULL) {
+		vy_page_ref(page);
+		vy_run_iterator_set_page(itr, page);
+		if (key.stmt != NULL)
+			*pos_in_page = vy_page_find_key(page, key, itr->cmp_def,
+							itr->format, iterator_type,
+							equal_found);
+		vy_run_iterator_readahead(itr, page_no);
+		*result = page;
+		return 0;
+	}
+
 	struct vy_page_info *page_info = vy_run_page_info(slice->run, page_no);
+
+	/* Check pages read ahead */
+	page = vy_run_iterator_take_prefetched(itr, page_no);
+	if (page != NULL) {
+		if (fiber_is_cancelled()) {
+			vy_page_delete(page);
+			diag_set(FiberIsCancelled);
+			return -1;
+		}
+		if (key.stmt != NULL)
+			*pos_in_page = vy_page_find_key(page, key, itr->cmp_def,
+							itr->format, iterator_type,
+							equal_found);
+		goto done;
+	}
+
+	/* Allocate buffers */
 	page = vy_page_new(page_info);
 	if (page == NULL)
 		return -1;
@@ -1053,8 +1761,9 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	task->format = itr->format;
 	task->pos_in_page = 0;
 	task->equal_found = false;
+	task->data = NULL;
 
-	int rc = vy_run_env_coio_call(env, &task->base, vy_page_read_cb);
+	int rc = vy_run_env_read_page(env, task);
 
 	*pos_in_page = task->pos_in_page;
 	*equal_found = task->equal_found;
@@ -1065,12 +1774,11 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 		return -1;
 	}
 
-	/* Update cache */
-	if (itr->prev_page != NULL)
-		vy_page_delete(itr->prev_page);
-	itr->prev_page = itr->curr_page;
-	itr->curr_page = page;
 	page->page_no = page_no;
+done:
+	/* Update cache */
+	vy_run_iterator_set_page(itr, page);
+	vy_page_cache_put(&env->page_cache, slice->run, page);
 
 	/* Update read statistics. */
 	itr->stat->read.rows += page_info->row_count;
@@ -1078,6 +1786,8 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	itr->stat->read.bytes_compressed += page_info->size;
 	itr->stat->read.pages++;
 
+	vy_run_iterator_readahead(itr, page_no);
+
 	*result = page;
 	return 0;
 }
@@ -1482,6 +2192,9 @@ vy_run_iterator_open(struct vy_run_iterator *itr,
 	itr->curr_pos.page_no = slice->run->info.page_count;
 	itr->curr_page = NULL;
 	itr->prev_page = NULL;
+	rlist_create(&itr->readahead);
+	itr->last_page_no = UINT32_MAX;
+	itr->seq_page_count = 0;
 	itr->search_started = false;
 
 	/*
@@ -1635,6 +2348,7 @@ void
 vy_run_iterator_close(struct vy_run_iterator *itr)
 {
 	vy_run_iterator_stop(itr);
+	vy_run_iterator_drop_readahead(itr);
 	tuple_format_unref(itr->format);
 	TRASH(itr);
 }
@@ -1752,6 +2466,25 @@ vy_run_recover(struct vy_run *run, const char *dir,
 		vy_run_acct_page(run, page);
 	}
 
+	/*
+	 * Unless the index file was written by an older version,
+	 * the bloom filter is stored in a separate tx following
+	 * the page index. Don't load it now, because bloom filters
+	 * of all runs may take long to read and a lot of memory to
+	 * store. Remember where it is so that it can be loaded on
+	 * the first lookup in the run instead.
+	 *
+	 * Note, the page index is always loaded, because it is
+	 * needed right away to create slices and account ranges.
+	 */
+	if (run->info.bloom == NULL) {
+		rc = xlog_cursor_has_next_tx(&cursor);
+		if (rc < 0)
+			goto fail_close;
+		if (rc > 0)
+			run->bloom_offset = xlog_cursor_pos(&cursor);
+	}
+
 	/* We don't need to keep metadata file open any longer. */
 	xlog_cursor_close(&cursor, false);
 
@@ -1766,6 +2499,7 @@ vy_run_recover(struct vy_run *run, const char *dir,
 			 XLOG_META_TYPE_RUN, meta->filetype);
 		goto fail_close;
 	}
+	vy_run_take_zddict(run, &cursor);
 	run->fd = cursor.fd;
 	xlog_cursor_close(&cursor, true);
 	return 0;
@@ -1988,8 +2722,6 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	size_t max_key_size = tmp - run_info->max_key;
 
 	uint32_t key_count = 6;
-	if (run_info->bloom != NULL)
-		key_count++;
 
 	size_t size = mp_sizeof_map(key_count);
 	size += mp_sizeof_uint(VY_RUN_INFO_MIN_KEY) + min_key_size;
@@ -2000,9 +2732,6 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 		mp_sizeof_uint(run_info->max_lsn);
 	size += mp_sizeof_uint(VY_RUN_INFO_PAGE_COUNT) +
 		mp_sizeof_uint(run_info->page_count);
-	if (run_info->bloom != NULL)
-		size += mp_sizeof_uint(VY_RUN_INFO_BLOOM) +
-			tuple_bloom_size(run_info->bloom);
 	size += mp_sizeof_uint(VY_RUN_INFO_STMT_STAT) +
 		vy_stmt_stat_sizeof(&run_info->stmt_stat);
 
@@ -2027,10 +2756,6 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	pos = mp_encode_uint(pos, run_info->max_lsn);
 	pos = mp_encode_uint(pos, VY_RUN_INFO_PAGE_COUNT);
 	pos = mp_encode_uint(pos, run_info->page_count);
-	if (run_info->bloom != NULL) {
-		pos = mp_encode_uint(pos, VY_RUN_INFO_BLOOM);
-		pos = tuple_bloom_encode(run_info->bloom, pos);
-	}
 	pos = mp_encode_uint(pos, VY_RUN_INFO_STMT_STAT);
 	pos = vy_stmt_stat_encode(&run_info->stmt_stat, pos);
 	xrow->body->iov_len = (void *)pos - xrow->body->iov_base;
@@ -2041,6 +2766,57 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 
 /* vy_run_info }}} */
 
+/**
+ * Write a bloom filter to a separate tx of a run index file
+ * so that recovery can skip it, see vy_run_recover(). Bloom
+ * filter bits don't compress, so the tx is stored plain, which
+ * also lets vy_run_load_bloom() decode it without knowing its
+ * unpacked size. The offset of the tx is returned in @offset.
+ */
+static int
+vy_run_write_bloom(struct xlog *xlog, const struct tuple_bloom *bloom,
+		   off_t *offset)
+{
+	/* Make sure the page index goes to its own tx. */
+	if (xlog_flush(xlog) < 0)
+		return -1;
+	*offset = xlog->offset;
+
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	size_t size = mp_sizeof_map(1) + mp_sizeof_uint(VY_RUN_INFO_BLOOM) +
+		      tuple_bloom_size(bloom);
+	char *buf = region_alloc(region, size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "region", "bloom filter");
+		return -1;
+	}
+	char *pos = buf;
+	pos = mp_encode_map(pos, 1);
+	pos = mp_encode_uint(pos, VY_RUN_INFO_BLOOM);
+	pos = tuple_bloom_encode(bloom, pos);
+	assert(pos == buf + size);
+
+	struct xrow_header xrow;
+	memset(&xrow, 0, sizeof(xrow));
+	xrow.type = VY_INDEX_BLOOM;
+	xrow.body->iov_base = buf;
+	xrow.body->iov_len = size;
+	xrow.bodycnt = 1;
+
+	xlog->opts.no_compression = true;
+	xlog_tx_begin(xlog);
+	int rc = 0;
+	if (xlog_write_row(xlog, &xrow) < 0) {
+		xlog_tx_rollback(xlog);
+		rc = -1;
+	} else if (xlog_tx_commit(xlog) < 0) {
+		rc = -1;
+	}
+	region_truncate(region, region_svp);
+	return rc;
+}
+
 /**
  * Write run index to file.
  */
@@ -2086,6 +2862,11 @@ vy_run_write_index(struct vy_run *run, const char *dirpath,
 	if (xlog_tx_commit(&index_xlog) < 0)
 		goto fail;
 
+	if (run->info.bloom != NULL &&
+	    vy_run_write_bloom(&index_xlog, run->info.bloom,
+			       &run->bloom_offset) != 0)
+		goto fail;
+
 	ERROR_INJECT(ERRINJ_VY_INDEX_FILE_RENAME, {
 		diag_set(ClientError, ER_INJECTION, "vinyl index file rename");
 		xlog_close(&index_xlog, false);
@@ -2112,7 +2893,8 @@ int
 vy_run_writer_create(struct vy_run_writer *writer, struct vy_run *run,
 		     const char *dirpath, uint32_t space_id, uint32_t iid,
 		     struct key_def *cmp_def, struct key_def *key_def,
-		     uint64_t page_size, double bloom_fpr, bool no_compression)
+		     uint64_t page_size, double bloom_fpr, bool no_compression,
+		     int compression_level, uint32_t dict_size)
 {
 	memset(writer, 0, sizeof(*writer));
 	writer->run = run;
@@ -2124,6 +2906,8 @@ vy_run_writer_create(struct vy_run_writer *writer, struct vy_run *run,
 	writer->page_size = page_size;
 	writer->bloom_fpr = bloom_fpr;
 	writer->no_compression = no_compression;
+	writer->compression_level = compression_level;
+	writer->dict_size = no_compression ? 0 : dict_size;
 	if (bloom_fpr < 1) {
 		writer->bloom = tuple_bloom_builder_new(key_def->part_count);
 		if (writer->bloom == NULL)
@@ -2132,6 +2916,8 @@ vy_run_writer_create(struct vy_run_writer *writer, struct vy_run *run,
 	xlog_clear(&writer->data_xlog);
 	ibuf_create(&writer->row_index_buf, &cord()->slabc,
 		    4096 * sizeof(uint32_t));
+	ibuf_create(&writer->dict_samples, &cord()->slabc,
+		    1024 * sizeof(struct vy_entry));
 	run->info.min_lsn = INT64_MAX;
 	run->info.max_lsn = -1;
 	assert(run->page_info == NULL);
@@ -2160,8 +2946,14 @@ vy_run_writer_create_xlog(struct vy_run_writer *writer)
 	opts.rate_limit = writer->run->env->snap_io_rate_limit;
 	opts.sync_interval = VY_RUN_SYNC_INTERVAL;
 	opts.no_compression = writer->no_compression;
+	opts.compression_level = writer->compression_level;
+	opts.zdict = writer->zcdict;
 	if (xlog_create(&writer->data_xlog, path, 0, &meta, &opts) != 0)
 		return -1;
+	if (writer->zdict != NULL &&
+	    xlog_write_zdict(&writer->data_xlog, writer->zdict,
+			     writer->zdict_size) != 0)
+		return -1;
 	return 0;
 }
 
@@ -2278,8 +3070,12 @@ vy_run_writer_end_page(struct vy_run_writer *writer)
 	return 0;
 }
 
-int
-vy_run_writer_append_stmt(struct vy_run_writer *writer, struct vy_entry entry)
+/**
+ * Write a statement to the run file, creating the file if it
+ * hasn't been created yet.
+ */
+static int
+vy_run_writer_write_stmt(struct vy_run_writer *writer, struct vy_entry entry)
 {
 	int rc = -1;
 	size_t region_svp = region_used(&fiber()->gc);
@@ -2300,6 +3096,136 @@ out:
 	return rc;
 }
 
+/** Release statements buffered to train the dictionary on. */
+static void
+vy_run_writer_drop_dict_samples(struct vy_run_writer *writer)
+{
+	struct vy_entry *samples = (struct vy_entry *)writer->dict_samples.rpos;
+	size_t count = ibuf_used(&writer->dict_samples) / sizeof(*samples);
+	for (size_t i = 0; i < count; i++)
+		vy_stmt_unref_if_possible(samples[i].stmt);
+	ibuf_reset(&writer->dict_samples);
+	writer->dict_sample_size = 0;
+}
+
+/**
+ * Train a zstd dictionary on the buffered statements and store
+ * it in the run info. Failure to train a dictionary, e.g. due to
+ * too few samples, isn't an error: the run is compressed without
+ * a dictionary then.
+ *
+ * @retval -1 Memory error.
+ * @retval  0 Success.
+ */
+static int
+vy_run_writer_train_dict(struct vy_run_writer *writer)
+{
+	struct vy_entry *samples = (struct vy_entry *)writer->dict_samples.rpos;
+	size_t count = ibuf_used(&writer->dict_samples) / sizeof(*samples);
+	if (count == 0)
+		return 0;
+
+	int rc = -1;
+	size_t sizes_size = count * sizeof(size_t);
+	size_t *sizes = malloc(sizes_size);
+	char *data = malloc(writer->dict_sample_size);
+	char *dict = malloc(writer->dict_size);
+	if (sizes == NULL || data == NULL || dict == NULL) {
+		diag_set(OutOfMemory, sizes_size + writer->dict_sample_size +
+			 writer->dict_size, "malloc", "zstd dictionary");
+		goto out;
+	}
+	char *pos = data;
+	for (size_t i = 0; i < count; i++) {
+		uint32_t size;
+		const char *stmt_data = tuple_data_range(samples[i].stmt,
+							 &size);
+		memcpy(pos, stmt_data, size);
+		pos += size;
+		sizes[i] = size;
+	}
+	assert(pos == data + writer->dict_sample_size);
+
+	size_t dict_size = ZDICT_trainFromBuffer(dict, writer->dict_size,
+						 data, sizes, count);
+	if (ZDICT_isError(dict_size)) {
+		say_verbose("not using a zstd dictionary for run %lld: %s",
+			    (long long)writer->run->id,
+			    ZDICT_getErrorName(dict_size));
+		rc = 0;
+		goto out;
+	}
+	writer->zcdict = ZSTD_createCDict(dict, dict_size,
+					  writer->compression_level);
+	if (writer->zcdict == NULL) {
+		diag_set(OutOfMemory, dict_size, "zstd",
+			 "compression dictionary");
+		goto out;
+	}
+	struct vy_run *run = writer->run;
+	assert(run->zddict == NULL);
+	run->zddict = ZSTD_createDDict(dict, dict_size);
+	if (run->zddict == NULL) {
+		diag_set(OutOfMemory, dict_size, "zstd",
+			 "decompression dictionary");
+		goto out;
+	}
+	writer->zdict = dict;
+	writer->zdict_size = dict_size;
+	dict = NULL;
+	rc = 0;
+out:
+	free(dict);
+	free(data);
+	free(sizes);
+	return rc;
+}
+
+/**
+ * Train the dictionary and write statements buffered for training
+ * to the run file.
+ */
+static int
+vy_run_writer_flush_dict_samples(struct vy_run_writer *writer)
+{
+	assert(!xlog_is_open(&writer->data_xlog));
+	int rc = vy_run_writer_train_dict(writer);
+	/* Don't try to train the dictionary again. */
+	writer->dict_size = 0;
+	struct vy_entry *samples = (struct vy_entry *)writer->dict_samples.rpos;
+	size_t count = ibuf_used(&writer->dict_samples) / sizeof(*samples);
+	for (size_t i = 0; i < count && rc == 0; i++)
+		rc = vy_run_writer_write_stmt(writer, samples[i]);
+	vy_run_writer_drop_dict_samples(writer);
+	return rc;
+}
+
+int
+vy_run_writer_append_stmt(struct vy_run_writer *writer, struct vy_entry entry)
+{
+	if (writer->dict_size == 0)
+		return vy_run_writer_write_stmt(writer, entry);
+	/*
+	 * Collect statements to train the dictionary on. zstd
+	 * recommends about 100 times more sample data than the
+	 * dictionary size.
+	 */
+	struct vy_entry *sample = (struct vy_entry *)
+		ibuf_alloc(&writer->dict_samples, sizeof(*sample));
+	if (sample == NULL) {
+		diag_set(OutOfMemory, sizeof(*sample), "ibuf",
+			 "dictionary samples");
+		return -1;
+	}
+	*sample = entry;
+	vy_stmt_ref_if_possible(entry.stmt);
+	writer->dict_sample_size += entry.stmt->bsize;
+	if (writer->dict_sample_size < VY_RUN_DICT_SAMPLE_RATIO *
+					(size_t)writer->dict_size)
+		return 0;
+	return vy_run_writer_flush_dict_samples(writer);
+}
+
 /**
  * Destroy a run writer.
  * @param writer Writer to destroy.
@@ -2315,7 +3241,11 @@ vy_run_writer_destroy(struct vy_run_writer *writer, bool reuse_fd)
 		xlog_close(&writer->data_xlog, reuse_fd);
 	if (writer->bloom != NULL)
 		tuple_bloom_builder_delete(writer->bloom);
+	vy_run_writer_drop_dict_samples(writer);
+	ibuf_destroy(&writer->dict_samples);
 	ibuf_destroy(&writer->row_index_buf);
+	ZSTD_freeCDict(writer->zcdict);
+	free(writer->zdict);
 }
 
 int
@@ -2324,6 +3254,10 @@ vy_run_writer_commit(struct vy_run_writer *writer)
 	int rc = -1;
 	size_t region_svp = region_used(&fiber()->gc);
 
+	if (ibuf_used(&writer->dict_samples) != 0 &&
+	    vy_run_writer_flush_dict_samples(writer) != 0)
+		goto out;
+
 	if (ibuf_used(&writer->row_index_buf) != 0 &&
 	    vy_run_writer_end_page(writer) != 0)
 		goto out;
@@ -2505,6 +3439,7 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 		prev_tuple = NULL;
 	}
 	region_truncate(region, mem_used);
+	vy_run_take_zddict(run, &cursor);
 	run->fd = cursor.fd;
 	xlog_cursor_close(&cursor, true);
 
@@ -2586,7 +3521,7 @@ vy_slice_stream_read_page(struct vy_slice_stream *stream)
 	if (stream->page == NULL)
 		return -1;
 
-	if (vy_page_read(stream->page, page_info, run, zdctx) != 0) {
+	if (vy_page_read(stream->page, page_info, run, NULL, zdctx) != 0) {
 		vy_page_delete(stream->page);
 		stream->page = NULL;
 		return -1;
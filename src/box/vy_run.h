@@ -44,14 +44,36 @@
 #include "xlog.h"
 
 #include "small/mempool.h"
+#include "small/rlist.h"
 
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
 
 struct vy_history;
+struct vy_lsm;
 struct vy_run_reader;
 
+/**
+ * Cache of decompressed run pages shared by all run iterators.
+ * Saves point lookups that miss the tuple cache from reading
+ * and decompressing the same hot page over and over again.
+ */
+struct vy_page_cache {
+	/** LRU list of cached pages. The first element is the newest. */
+	struct rlist lru;
+	/** Size of memory occupied by cached pages. */
+	size_t mem_used;
+	/** Max memory size that can be used for the cache. */
+	size_t mem_quota;
+	/** Number of page lookups that found the page in the cache. */
+	int64_t hit;
+	/** Number of page lookups that had to read the page. */
+	int64_t miss;
+	/** Number of pages evicted from the cache. */
+	int64_t evict;
+};
+
 /** Part of vinyl environment for run read/write */
 struct vy_run_env {
 	/** Write rate limit, in bytes per second. */
@@ -69,6 +91,14 @@ struct vy_run_env {
 	 * processing the next read request.
 	 */
 	int next_reader;
+	/**
+	 * Set if tx reads run pages via io_uring and leaves
+	 * only decoding to reader threads, see
+	 * vy_run_env_enable_coio().
+	 */
+	bool use_uring;
+	/** Cache of decompressed pages. */
+	struct vy_page_cache page_cache;
 };
 
 /**
@@ -121,6 +151,32 @@ struct vy_run {
 	struct vy_run_info info;
 	/** Info about the run pages stored in the index file. */
 	struct vy_page_info *page_info;
+	/**
+	 * zstd dictionary used to decompress pages or NULL.
+	 * The dictionary is stored in the run file right after
+	 * the header, see xlog_write_zdict(). It is read-only
+	 * and so shared by all reader threads.
+	 */
+	ZSTD_DDict *zddict;
+	/**
+	 * Offset of the bloom filter in the run index file or 0
+	 * if the index file was written by an older version that
+	 * stored the bloom filter in the run info or the bloom
+	 * filter failed to load. A bloom filter stored separately
+	 * isn't loaded on recovery and may be evicted from memory.
+	 * It is (re)loaded on the first lookup in the run, see
+	 * vy_lsm_load_bloom().
+	 */
+	off_t bloom_offset;
+	/** Set while the bloom filter is being loaded. */
+	bool is_bloom_loading;
+	/**
+	 * LSM tree the run belongs to if its bloom filter is
+	 * loaded and may be evicted, NULL otherwise.
+	 */
+	struct vy_lsm *bloom_lsm;
+	/** Link in vy_lsm_env::bloom_lru. */
+	struct rlist in_bloom_lru;
 	/** Run data file. */
 	int fd;
 	/** Unique ID of this run. */
@@ -168,6 +224,12 @@ struct vy_run {
 	struct rlist in_unused;
 	/** Link in vy_lsm::runs list. */
 	struct rlist in_lsm;
+	/**
+	 * Pages of this run stored in the page cache, indexed
+	 * by page number. Allocated when the first page of the
+	 * run is cached.
+	 */
+	struct vy_page **cached_pages;
 };
 
 /**
@@ -279,6 +341,16 @@ struct vy_run_iterator {
 	 */
 	struct vy_page *curr_page;
 	struct vy_page *prev_page;
+	/**
+	 * Pages being read ahead in background, linked by
+	 * vy_page_prefetch::in_readahead. See
+	 * vy_run_iterator_readahead().
+	 */
+	struct rlist readahead;
+	/** Number of the last page read by the iterator. */
+	uint32_t last_page_no;
+	/** Number of pages read sequentially in a row. */
+	uint32_t seq_page_count;
 	/** Is false until first .._get or .._next_.. method is called */
 	bool search_started;
 };
@@ -297,6 +369,16 @@ struct vy_page {
 	uint32_t *row_index;
 	/** Pointer to the page data. */
 	char *data;
+	/**
+	 * Reference counter. A page is referenced by each run
+	 * iterator that keeps it as the current or the previous
+	 * page and by the page cache.
+	 */
+	int refs;
+	/** Run the page belongs to if the page is cached, NULL otherwise. */
+	struct vy_run *run;
+	/** Link in vy_page_cache::lru. */
+	struct rlist in_lru;
 };
 
 /**
@@ -325,17 +407,49 @@ vy_run_env_destroy(struct vy_run_env *env);
  * The number of background reader threads is configured when
  * the environment is created, see vy_run_env_create().
  *
+ * If the calling thread has an io_uring instance (see uring.h),
+ * the run iterator reads pages via io_uring in the calling
+ * thread, and reader threads only decompress and decode them.
+ *
  * Subsequent calls to this function will silently return.
  */
 void
 vy_run_env_enable_coio(struct vy_run_env *env);
 
+/**
+ * Set memory limit for the page cache of a vinyl run environment.
+ * Zero disables the cache.
+ *
+ * Cached pages are evicted right away if the new limit is less
+ * than the size of memory currently used by the cache.
+ */
+void
+vy_run_env_set_page_cache(struct vy_run_env *env, size_t quota);
+
 /**
  * Return the size of a run bloom filter.
  */
 size_t
 vy_run_bloom_size(struct vy_run *run);
 
+/**
+ * Read the bloom filter of a run that was skipped on recovery
+ * or evicted from the run index file. Yields.
+ *
+ * @param run Run to load the bloom filter for.
+ * @param offset vy_run::bloom_offset.
+ * @param dir Directory of the LSM tree the run belongs to.
+ * @param space_id Space id of the LSM tree.
+ * @param iid Index id of the LSM tree.
+ * @param[out] bloom Loaded bloom filter.
+ *
+ * @retval  0 Success.
+ * @retval -1 IO or memory error.
+ */
+int
+vy_run_load_bloom(struct vy_run *run, off_t offset, const char *dir,
+		  uint32_t space_id, uint32_t iid, struct tuple_bloom **bloom);
+
 static inline struct vy_page_info *
 vy_run_page_info(struct vy_run *run, uint32_t pos)
 {
@@ -510,6 +624,16 @@ vy_slice_cut(struct vy_slice *slice, int64_t id, struct vy_entry begin,
 	     struct vy_entry end, struct key_def *cmp_def,
 	     struct vy_slice **result);
 
+/**
+ * Check if a slice may contain statements matching the given
+ * search criteria judging by the min and max keys of its run.
+ * Returns false if the slice can be skipped by a read iterator
+ * without a lookup in the page index.
+ */
+bool
+vy_slice_may_contain(struct vy_slice *slice, enum iterator_type type,
+		     struct vy_entry key, struct key_def *cmp_def);
+
 /**
  * Open an iterator over on-disk run.
  *
@@ -614,6 +738,30 @@ struct vy_run_writer {
 	uint32_t page_info_capacity;
 	/** Don't use compression while writing xlog files. */
 	bool no_compression;
+	/** zstd compression level. */
+	int compression_level;
+	/**
+	 * Max size of a zstd dictionary to train on the first
+	 * statements of the run, 0 if dictionaries are disabled.
+	 */
+	uint32_t dict_size;
+	/**
+	 * Statements buffered to train the dictionary on, an
+	 * array of struct vy_entry. They are written to the run
+	 * once the dictionary is ready.
+	 */
+	struct ibuf dict_samples;
+	/** Total size of buffered statements, in bytes. */
+	size_t dict_sample_size;
+	/**
+	 * Dictionary trained on the first statements or NULL.
+	 * It is written to the run file before the first page.
+	 */
+	char *zdict;
+	/** Size of the trained dictionary. */
+	size_t zdict_size;
+	/** Digested zdict used to compress pages. */
+	ZSTD_CDict *zcdict;
 	/** Xlog to write data. */
 	struct xlog data_xlog;
 	/** Bloom filter false positive rate. */
@@ -634,7 +782,8 @@ int
 vy_run_writer_create(struct vy_run_writer *writer, struct vy_run *run,
 		     const char *dirpath, uint32_t space_id, uint32_t iid,
 		     struct key_def *cmp_def, struct key_def *key_def,
-		     uint64_t page_size, double bloom_fpr, bool no_compression);
+		     uint64_t page_size, double bloom_fpr, bool no_compression,
+		     int compression_level, uint32_t dict_size);
 
 /**
  * Write a specified statement into a run.
@@ -204,6 +204,9 @@ struct vy_task {
 	 */
 	double bloom_fpr;
 	int64_t page_size;
+	enum vy_compression compression;
+	int compression_level;
+	uint32_t compression_dict_size;
 	/**
 	 * Deferred DELETE handler passed to the write iterator.
 	 * It sends deferred DELETE statements generated during
@@ -410,6 +413,19 @@ vy_worker_pool_get(struct vy_worker_pool *pool)
 	return worker;
 }
 
+/**
+ * Return the number of idle workers in a pool.
+ */
+static int
+vy_worker_pool_idle_count(struct vy_worker_pool *pool)
+{
+	int count = 0;
+	struct vy_worker *worker;
+	stailq_foreach_entry(worker, &pool->idle_workers, in_idle)
+		count++;
+	return count;
+}
+
 /**
  * Put a worker back to the pool it was allocated from once
  * it's done its job.
@@ -1067,7 +1083,8 @@ vy_task_write_run(struct vy_task *task, bool no_compression)
 				 lsm->space_id, lsm->index_id,
 				 task->cmp_def, task->key_def,
 				 task->page_size, task->bloom_fpr,
-				 no_compression) != 0)
+				 no_compression, task->compression_level,
+				 task->compression_dict_size) != 0)
 		goto fail;
 
 	if (wi->iface->start(wi) != 0)
@@ -1218,6 +1235,7 @@ vy_task_dump_complete(struct vy_task *task)
 		slice = new_slices[i];
 		vy_lsm_unacct_range(lsm, range);
 		vy_range_add_slice(range, slice);
+		range->dump_output += slice->count.bytes;
 		vy_range_update_compaction_priority(range, &lsm->opts);
 		vy_range_update_dumps_per_compaction(range);
 		vy_lsm_acct_range(lsm, range);
@@ -1397,6 +1415,9 @@ vy_task_dump_new(struct vy_scheduler *scheduler, struct vy_worker *worker,
 	task->wi = wi;
 	task->bloom_fpr = lsm->opts.bloom_fpr;
 	task->page_size = lsm->opts.page_size;
+	task->compression = lsm->opts.compression;
+	task->compression_level = lsm->opts.compression_level;
+	task->compression_dict_size = lsm->opts.compression_dict_size;
 
 	lsm->is_dumping = true;
 	vy_scheduler_update_lsm(scheduler, lsm);
@@ -1435,7 +1456,8 @@ static int
 vy_task_compaction_execute(struct vy_task *task)
 {
 	ERROR_INJECT_SLEEP(ERRINJ_VY_COMPACTION_DELAY);
-	return vy_task_write_run(task, false);
+	return vy_task_write_run(task,
+			task->compression == VY_COMPRESSION_NONE);
 }
 
 static int
@@ -1561,6 +1583,7 @@ vy_task_compaction_complete(struct vy_task *task)
 			break;
 	}
 	range->n_compactions++;
+	range->compaction_output += compaction_output.bytes;
 	vy_range_update_compaction_priority(range, &lsm->opts);
 	vy_range_update_dumps_per_compaction(range);
 	vy_lsm_acct_range(lsm, range);
@@ -1629,7 +1652,16 @@ vy_task_compaction_new(struct vy_scheduler *scheduler, struct vy_worker *worker,
 	assert(range != NULL);
 	assert(range->compaction_priority > 1);
 
-	if (vy_lsm_split_range(lsm, range) ||
+	/*
+	 * A big range is split in as many parts as there are
+	 * workers that can compact them in parallel: the worker
+	 * assigned to this task and idle workers. The parts are
+	 * picked from the range heap one by one as this function
+	 * is called again by the scheduler.
+	 */
+	int max_parts = 1 + vy_worker_pool_idle_count(worker->pool);
+	max_parts = MIN(max_parts, VY_RANGE_SPLIT_PARTS_MAX);
+	if (vy_lsm_split_range(lsm, range, max_parts) ||
 	    vy_lsm_coalesce_range(lsm, range)) {
 		vy_scheduler_update_lsm(scheduler, lsm);
 		return 0;
@@ -1692,6 +1724,9 @@ vy_task_compaction_new(struct vy_scheduler *scheduler, struct vy_worker *worker,
 	task->wi = wi;
 	task->bloom_fpr = lsm->opts.bloom_fpr;
 	task->page_size = lsm->opts.page_size;
+	task->compression = lsm->opts.compression;
+	task->compression_level = lsm->opts.compression_level;
+	task->compression_dict_size = lsm->opts.compression_dict_size;
 
 	/*
 	 * Remove the range we are going to compact from the heap
@@ -43,6 +43,9 @@
 #include "cbus.h"
 #include "coio_task.h"
 #include "replication.h"
+#include "histogram.h"
+#include "info/info.h"
+#include "uring.h"
 
 enum {
 	/**
@@ -54,6 +57,19 @@ enum {
 	 * latency. 1 MB seems to be a well balanced choice.
 	 */
 	WAL_FALLOCATE_LEN = 1024 * 1024,
+	/**
+	 * In fsync mode, sync the WAL without waiting for the
+	 * batch delay to expire as soon as that many bytes or
+	 * rows have been written since the last sync.
+	 */
+	WAL_GROUP_SIZE_MAX = 1024 * 1024,
+	WAL_GROUP_ROWS_MAX = 16384,
+	/**
+	 * Size of the WAL thread io_uring. The WAL thread waits
+	 * for each write to complete, so it never has more than
+	 * a write and a sync in flight.
+	 */
+	WAL_URING_ENTRIES = 8,
 };
 
 const char *wal_mode_STRS[] = { "none", "write", "fsync", NULL };
@@ -109,6 +125,8 @@ struct wal_writer
 	int64_t wal_max_size;
 	/** Another one - wal_mode */
 	enum wal_mode wal_mode;
+	/** And wal_max_batch_delay. */
+	double max_batch_delay;
 	/** wal_dir, from the configuration file. */
 	struct xdir wal_dir;
 	/** 'wal' thread doing the writes. */
@@ -167,6 +185,29 @@ struct wal_writer
 	 * Used for replication relays.
 	 */
 	struct rlist watchers;
+	/**
+	 * Batches written to the current WAL, but neither synced
+	 * nor sent back to tx yet (fsync mode only). They are
+	 * synced with a single fsync, see wal_group_commit().
+	 */
+	struct stailq group;
+	/** Number of rows written by the pending group. */
+	int64_t group_rows;
+	/** WAL offset before the pending group was written. */
+	off_t group_offset;
+	/** WAL writer vclock before the pending group. */
+	struct vclock group_vclock;
+	/** Timer to sync the pending group on batch delay. */
+	struct ev_timer group_timer;
+	/** Moving average of fsync latency, in seconds. */
+	double fsync_latency;
+	/**
+	 * Histograms of the number of rows synced by one fsync
+	 * and of fsync latency, in microseconds. Accessed only
+	 * by the WAL thread, see wal_stat().
+	 */
+	struct histogram *group_rows_hist;
+	struct histogram *fsync_latency_hist;
 };
 
 struct wal_msg {
@@ -207,8 +248,16 @@ wal_write_to_disk(struct cmsg *msg);
 static void
 tx_complete_batch(struct cmsg *msg);
 
+static void
+wal_group_commit(struct wal_writer *writer);
+
+/**
+ * A batch doesn't go back to tx right after it's written: in
+ * fsync mode it has to wait for a sync. The WAL thread sends
+ * it further explicitly, see wal_msg_dispatch().
+ */
 static struct cmsg_hop wal_request_route[] = {
-	{wal_write_to_disk, &wal_writer_singleton.tx_prio_pipe},
+	{wal_write_to_disk, NULL},
 	{tx_complete_batch, NULL},
 };
 
@@ -228,6 +277,15 @@ wal_msg(struct cmsg *msg)
 	return msg->route == wal_request_route ? (struct wal_msg *) msg : NULL;
 }
 
+/** Send a processed batch back to tx. */
+static void
+wal_msg_dispatch(struct wal_writer *writer, struct wal_msg *batch)
+{
+	assert(batch->base.hop == &wal_request_route[0]);
+	batch->base.hop++;
+	cpipe_push(&writer->tx_prio_pipe, &batch->base);
+}
+
 /** Write a request to a log in a single transaction. */
 static ssize_t
 xlog_write_entry(struct xlog *l, struct journal_entry *entry)
@@ -396,19 +454,44 @@ tx_notify_checkpoint(struct cmsg *msg)
 	free(msg);
 }
 
+static void
+wal_group_timer_cb(ev_loop *loop, ev_timer *timer, int events);
+
 /**
  * Initialize WAL writer context. Even though it's a singleton,
  * encapsulate the details just in case we may use
  * more writers in the future.
  */
-static void
+static int
 wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 		  void (*wall_async_cb)(struct journal_entry *entry),
 		  const char *wal_dirname,
 		  int64_t wal_max_size, const struct tt_uuid *instance_uuid,
+		  bool use_uring,
 		  wal_on_garbage_collection_f on_garbage_collection,
 		  wal_on_checkpoint_threshold_f on_checkpoint_threshold)
 {
+	static const int64_t group_rows_buckets[] = {
+		1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048,
+		4096, 8192, 16384, 32768, 65536,
+	};
+	static const int64_t fsync_latency_buckets[] = {
+		10, 20, 50, 100, 200, 500, 1000, 2000, 5000,
+		10000, 20000, 50000, 100000, 200000, 500000, 1000000,
+	};
+	writer->group_rows_hist = histogram_new(group_rows_buckets,
+						lengthof(group_rows_buckets));
+	writer->fsync_latency_hist = histogram_new(fsync_latency_buckets,
+					lengthof(fsync_latency_buckets));
+	if (writer->group_rows_hist == NULL ||
+	    writer->fsync_latency_hist == NULL) {
+		histogram_delete(writer->group_rows_hist);
+		histogram_delete(writer->fsync_latency_hist);
+		diag_set(OutOfMemory, sizeof(struct histogram),
+			 "malloc", "struct histogram");
+		return -1;
+	}
+
 	writer->wal_mode = wal_mode;
 	writer->wal_max_size = wal_max_size;
 
@@ -421,10 +504,9 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 
 	struct xlog_opts opts = xlog_opts_default;
 	opts.sync_is_async = true;
+	opts.use_uring = use_uring;
 	xdir_create(&writer->wal_dir, wal_dirname, XLOG, instance_uuid, &opts);
 	xlog_clear(&writer->current_wal);
-	if (wal_mode == WAL_FSYNC)
-		writer->wal_dir.open_wflags |= O_SYNC;
 
 	stailq_create(&writer->rollback);
 	writer->is_in_rollback = false;
@@ -442,6 +524,16 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 
 	mempool_create(&writer->msg_pool, &cord()->slabc,
 		       sizeof(struct wal_msg));
+
+	writer->max_batch_delay = 0;
+	stailq_create(&writer->group);
+	writer->group_rows = 0;
+	writer->group_offset = 0;
+	vclock_create(&writer->group_vclock);
+	ev_timer_init(&writer->group_timer, wal_group_timer_cb, 0, 0);
+	writer->group_timer.data = writer;
+	writer->fsync_latency = 0;
+	return 0;
 }
 
 /** Destroy a WAL writer structure. */
@@ -449,6 +541,8 @@ static void
 wal_writer_destroy(struct wal_writer *writer)
 {
 	xdir_destroy(&writer->wal_dir);
+	histogram_delete(writer->group_rows_hist);
+	histogram_delete(writer->fsync_latency_hist);
 }
 
 /** WAL writer thread routine. */
@@ -527,14 +621,16 @@ wal_open(struct wal_writer *writer)
 int
 wal_init(enum wal_mode wal_mode, void (*wall_async_cb)(struct journal_entry *entry),
 	 const char *wal_dirname, int64_t wal_max_size, const struct tt_uuid *instance_uuid,
-	 wal_on_garbage_collection_f on_garbage_collection,
+	 bool use_uring, wal_on_garbage_collection_f on_garbage_collection,
 	 wal_on_checkpoint_threshold_f on_checkpoint_threshold)
 {
 	/* Initialize the state. */
 	struct wal_writer *writer = &wal_writer_singleton;
-	wal_writer_create(writer, wal_mode, wall_async_cb, wal_dirname,
-			  wal_max_size, instance_uuid, on_garbage_collection,
-			  on_checkpoint_threshold);
+	if (wal_writer_create(writer, wal_mode, wall_async_cb, wal_dirname,
+			      wal_max_size, instance_uuid, use_uring,
+			      on_garbage_collection,
+			      on_checkpoint_threshold) != 0)
+		return -1;
 
 	/* Start WAL thread. */
 	if (cord_costart(&writer->cord, "wal", wal_writer_f, NULL) != 0)
@@ -596,6 +692,7 @@ wal_sync_f(struct cbus_call_msg *data)
 {
 	struct wal_vclock_msg *msg = (struct wal_vclock_msg *) data;
 	struct wal_writer *writer = &wal_writer_singleton;
+	wal_group_commit(writer);
 	if (writer->is_in_rollback) {
 		/* We're rolling back a failed write. */
 		diag_set(ClientError, ER_WAL_IO);
@@ -639,6 +736,7 @@ wal_begin_checkpoint_f(struct cbus_call_msg *data)
 {
 	struct wal_checkpoint *msg = (struct wal_checkpoint *) data;
 	struct wal_writer *writer = &wal_writer_singleton;
+	wal_group_commit(writer);
 	if (writer->is_in_rollback) {
 		/*
 		 * We're rolling back a failed write and so
@@ -762,6 +860,77 @@ wal_set_checkpoint_threshold(int64_t threshold)
 	fiber_set_cancellable(cancellable);
 }
 
+struct wal_set_max_batch_delay_msg {
+	struct cbus_call_msg base;
+	double max_batch_delay;
+};
+
+static int
+wal_set_max_batch_delay_f(struct cbus_call_msg *data)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	struct wal_set_max_batch_delay_msg *msg;
+	msg = (struct wal_set_max_batch_delay_msg *)data;
+	writer->max_batch_delay = msg->max_batch_delay;
+	if (writer->max_batch_delay == 0)
+		wal_group_commit(writer);
+	return 0;
+}
+
+void
+wal_set_max_batch_delay(double delay)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (writer->wal_mode == WAL_NONE)
+		return;
+	struct wal_set_max_batch_delay_msg msg;
+	msg.max_batch_delay = delay;
+	bool cancellable = fiber_set_cancellable(false);
+	cbus_call(&writer->wal_pipe, &writer->tx_prio_pipe,
+		  &msg.base, wal_set_max_batch_delay_f, NULL,
+		  TIMEOUT_INFINITY);
+	fiber_set_cancellable(cancellable);
+}
+
+struct wal_stat_msg {
+	struct cbus_call_msg base;
+	int64_t fsync_count;
+	char batch_rows[512];
+	char fsync_latency[512];
+};
+
+static int
+wal_stat_f(struct cbus_call_msg *data)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	struct wal_stat_msg *msg = (struct wal_stat_msg *)data;
+	msg->fsync_count = writer->fsync_latency_hist->total;
+	histogram_snprint(msg->batch_rows, sizeof(msg->batch_rows),
+			  writer->group_rows_hist);
+	histogram_snprint(msg->fsync_latency, sizeof(msg->fsync_latency),
+			  writer->fsync_latency_hist);
+	return 0;
+}
+
+void
+wal_stat(struct info_handler *h)
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	info_begin(h);
+	if (writer->wal_mode != WAL_NONE) {
+		/* The histograms are updated by the WAL thread. */
+		struct wal_stat_msg msg;
+		bool cancellable = fiber_set_cancellable(false);
+		cbus_call(&writer->wal_pipe, &writer->tx_prio_pipe,
+			  &msg.base, wal_stat_f, NULL, TIMEOUT_INFINITY);
+		fiber_set_cancellable(cancellable);
+		info_append_int(h, "fsync_count", msg.fsync_count);
+		info_append_str(h, "batch_rows", msg.batch_rows);
+		info_append_str(h, "fsync_latency", msg.fsync_latency);
+	}
+	info_end(h);
+}
+
 struct wal_gc_msg
 {
 	struct cbus_call_msg base;
@@ -836,6 +1005,8 @@ wal_opt_rotate(struct wal_writer *writer)
 	 */
 	if (xlog_is_open(&writer->current_wal) &&
 	    writer->current_wal.offset >= writer->wal_max_size) {
+		/* Rows pending sync must stay in this WAL. */
+		wal_group_commit(writer);
 		/*
 		 * We can not handle xlog_close()
 		 * failure in any reasonable way.
@@ -887,8 +1058,10 @@ wal_fallocate(struct wal_writer *writer, size_t len)
 	 * The actual write size can be greater than the sum size
 	 * of encoded rows (compression, fixheaders). Double the
 	 * given length to get a rough upper bound estimate.
+	 * Rows left buffered by the previous batches of the group
+	 * pending sync are going to be written too.
 	 */
-	len *= 2;
+	len = 2 * len + obuf_size(&l->obuf);
 
 retry:
 	if (errinj == NULL || errinj->iparam == 0) {
@@ -1013,6 +1186,143 @@ wal_assign_lsn(struct vclock *vclock_diff, struct vclock *base,
 		(*row)->tsn = tsn;
 }
 
+/** Account a WAL sync that took @a latency and synced @a rows. */
+static void
+wal_sync_stat(struct wal_writer *writer, double latency, int64_t rows)
+{
+	writer->fsync_latency = writer->fsync_latency == 0 ? latency :
+				(7 * writer->fsync_latency + latency) / 8;
+	histogram_collect(writer->fsync_latency_hist, latency * 1000000);
+	histogram_collect(writer->group_rows_hist, rows);
+}
+
+/**
+ * Sync the WAL and send all batches written since the last sync
+ * back to tx. If fsync fails, the batches are cut off the WAL
+ * and rolled back.
+ */
+static void
+wal_group_commit(struct wal_writer *writer)
+{
+	ev_timer_stop(loop(), &writer->group_timer);
+	if (stailq_empty(&writer->group))
+		return;
+
+	struct xlog *l = &writer->current_wal;
+	double start = ev_monotonic_time();
+	struct errinj *inj = errinj(ERRINJ_WAL_SYNC_DELAY, ERRINJ_DOUBLE);
+	if (inj != NULL && inj->dparam > 0)
+		usleep(inj->dparam * 1000000);
+	int rc;
+	if (l->opts.use_uring) {
+		/*
+		 * Rows of the group may still be buffered, see
+		 * wal_write_to_disk(). Submit the last write along
+		 * with the sync.
+		 */
+		ssize_t written = xlog_flush_sync(l);
+		if (written >= 0)
+			writer->checkpoint_wal_size += written;
+		rc = written < 0 ? -1 : 0;
+	} else {
+		rc = fdatasync(l->fd);
+		if (rc != 0) {
+			diag_set(SystemError, "failed to sync '%s' file",
+				 l->filename);
+		}
+	}
+	wal_sync_stat(writer, ev_monotonic_time() - start,
+		      writer->group_rows);
+
+	struct stailq group;
+	stailq_create(&group);
+	stailq_concat(&group, &writer->group);
+	writer->group_rows = 0;
+
+	struct cmsg *msg, *next;
+	if (rc != 0) {
+		diag_log();
+		diag_clear(diag_get());
+		/*
+		 * The page cache may have dropped the pages that
+		 * failed to reach the disk, so the rows can't be
+		 * trusted: remove them and roll back.
+		 */
+		if (lseek(l->fd, writer->group_offset, SEEK_SET) < 0 ||
+		    ftruncate(l->fd, writer->group_offset) != 0)
+			panic_syserror("failed to truncate WAL after "
+				       "fsync error");
+		writer->checkpoint_wal_size -= l->offset - writer->group_offset;
+		l->offset = writer->group_offset;
+		l->allocated = 0;
+		vclock_copy(&writer->vclock, &writer->group_vclock);
+		stailq_foreach_entry(msg, &group, fifo) {
+			struct wal_msg *batch = (struct wal_msg *)msg;
+			struct journal_entry *entry;
+			stailq_foreach_entry(entry, &batch->commit, fifo)
+				entry->res = -1;
+			stailq_concat(&batch->commit, &batch->rollback);
+			stailq_concat(&batch->rollback, &batch->commit);
+			vclock_copy(&batch->vclock, &writer->vclock);
+		}
+		wal_begin_rollback();
+	}
+	stailq_foreach_entry_safe(msg, next, &group, fifo)
+		wal_msg_dispatch(writer, (struct wal_msg *)msg);
+	if (rc == 0)
+		wal_notify_watchers(writer, WAL_EVENT_WRITE);
+}
+
+static void
+wal_group_timer_cb(ev_loop *loop, ev_timer *timer, int events)
+{
+	(void)loop;
+	(void)events;
+	wal_group_commit((struct wal_writer *)timer->data);
+}
+
+/**
+ * Add a written batch to the group pending sync. Sync the group
+ * right away if it is large enough or the batch delay is off,
+ * otherwise make sure the sync is scheduled.
+ *
+ * The sync is delayed by no more than the average fsync latency:
+ * waiting longer would cost more than the fsync it could save.
+ */
+static void
+wal_group_add(struct wal_writer *writer, struct wal_msg *batch,
+	      int64_t rows)
+{
+	stailq_add_tail_entry(&writer->group, &batch->base, fifo);
+	writer->group_rows += rows;
+	struct xlog *l = &writer->current_wal;
+	off_t size = l->offset + obuf_size(&l->obuf) - writer->group_offset;
+	if (writer->is_in_rollback || writer->max_batch_delay == 0 ||
+	    writer->group_rows >= WAL_GROUP_ROWS_MAX ||
+	    size >= WAL_GROUP_SIZE_MAX) {
+		wal_group_commit(writer);
+		return;
+	}
+	if (!ev_is_active(&writer->group_timer)) {
+		double delay = MIN(writer->max_batch_delay,
+				   writer->fsync_latency);
+		ev_timer_set(&writer->group_timer, delay, 0);
+		ev_timer_start(loop(), &writer->group_timer);
+	}
+}
+
+/**
+ * Send a batch that can't be written back to tx, preserving
+ * the order of batches pending sync.
+ */
+static void
+wal_msg_complete(struct wal_writer *writer, struct wal_msg *batch)
+{
+	wal_group_commit(writer);
+	vclock_copy(&batch->vclock, &writer->vclock);
+	wal_msg_dispatch(writer, batch);
+}
+
 static void
 wal_write_to_disk(struct cmsg *msg)
 {
@@ -1033,22 +1343,21 @@ wal_write_to_disk(struct cmsg *msg)
 	if (writer->is_in_rollback) {
 		/* We're rolling back a failed write. */
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
-		vclock_copy(&wal_msg->vclock, &writer->vclock);
-		return;
+		return wal_msg_complete(writer, wal_msg);
 	}
 
 	/* Xlog is only rotated between queue processing  */
 	if (wal_opt_rotate(writer) != 0) {
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
-		vclock_copy(&wal_msg->vclock, &writer->vclock);
-		return wal_begin_rollback();
+		wal_begin_rollback();
+		return wal_msg_complete(writer, wal_msg);
 	}
 
 	/* Ensure there's enough disk space before writing anything. */
 	if (wal_fallocate(writer, wal_msg->approx_len) != 0) {
 		stailq_concat(&wal_msg->rollback, &wal_msg->commit);
-		vclock_copy(&wal_msg->vclock, &writer->vclock);
-		return wal_begin_rollback();
+		wal_begin_rollback();
+		return wal_msg_complete(writer, wal_msg);
 	}
 
 	/*
@@ -1073,6 +1382,11 @@ wal_write_to_disk(struct cmsg *msg)
 	 */
 
 	struct xlog *l = &writer->current_wal;
+	if (stailq_empty(&writer->group)) {
+		/* Remember where to cut the WAL if fsync fails. */
+		writer->group_offset = l->offset;
+		vclock_copy(&writer->group_vclock, &writer->vclock);
+	}
 
 	/*
 	 * Iterate over requests (transactions)
@@ -1095,7 +1409,17 @@ wal_write_to_disk(struct cmsg *msg)
 		}
 		/* rc == 0: the write is buffered in xlog_tx */
 	}
-	rc = xlog_flush(l);
+	/*
+	 * With io_uring, the last write of a group pending sync
+	 * is submitted along with the sync, so leave the rows
+	 * buffered: wal_group_commit() will flush them. If the
+	 * write fails, the whole group is rolled back, just like
+	 * on sync failure.
+	 */
+	if (writer->wal_mode == WAL_FSYNC && l->opts.use_uring)
+		rc = 0;
+	else
+		rc = xlog_flush(l);
 	if (rc < 0)
 		goto done;
 
@@ -1157,7 +1481,15 @@ done:
 		wal_begin_rollback();
 	}
 	fiber_gc();
-	wal_notify_watchers(writer, WAL_EVENT_WRITE);
+	if (writer->wal_mode == WAL_FSYNC) {
+		int64_t rows = 0;
+		stailq_foreach_entry(entry, &wal_msg->commit, fifo)
+			rows += entry->n_rows;
+		wal_group_add(writer, wal_msg, rows);
+	} else {
+		wal_notify_watchers(writer, WAL_EVENT_WRITE);
+		wal_msg_dispatch(writer, wal_msg);
+	}
 	ERROR_INJECT_SLEEP(ERRINJ_RELAY_FASTER_THAN_TX);
 }
 
@@ -1171,6 +1503,14 @@ wal_writer_f(va_list ap)
 	/** Initialize eio in this thread */
 	coio_enable();
 
+	if (writer->wal_dir.opts.use_uring &&
+	    uring_init(WAL_URING_ENTRIES, false) != 0) {
+		diag_log();
+		say_warn("failed to set up io_uring for WAL, "
+			 "falling back on plain system calls");
+		writer->wal_dir.opts.use_uring = false;
+	}
+
 	struct cbus_endpoint endpoint;
 	cbus_endpoint_create(&endpoint, "wal", fiber_schedule_cb, fiber());
 	/*
@@ -1182,6 +1522,8 @@ wal_writer_f(va_list ap)
 
 	cbus_loop(&endpoint);
 
+	wal_group_commit(writer);
+
 	/*
 	 * Create a new empty WAL on shutdown so that we don't
 	 * have to rescan the last WAL to find the instance vclock.
@@ -1206,6 +1548,7 @@ wal_writer_f(va_list ap)
 		xlog_close(&vy_log_writer.xlog, false);
 
 	cpipe_destroy(&writer->tx_prio_pipe);
+	uring_free();
 	return 0;
 }
 
@@ -40,6 +40,7 @@
 struct fiber;
 struct wal_writer;
 struct tt_uuid;
+struct info_handler;
 
 enum wal_mode { WAL_NONE = 0, WAL_WRITE, WAL_FSYNC, WAL_MODE_MAX };
 
@@ -79,11 +80,12 @@ typedef void (*wal_on_checkpoint_threshold_f)(void);
 
 /**
  * Start WAL thread and initialize WAL writer.
+ * If @a use_uring is set, the WAL thread writes via io_uring.
  */
 int
 wal_init(enum wal_mode wal_mode, void (*wall_async_cb)(struct journal_entry *entry),
 	 const char *wal_dirname, int64_t wal_max_size, const struct tt_uuid *instance_uuid,
-	 wal_on_garbage_collection_f on_garbage_collection,
+	 bool use_uring, wal_on_garbage_collection_f on_garbage_collection,
 	 wal_on_checkpoint_threshold_f on_checkpoint_threshold);
 
 /**
@@ -230,6 +232,24 @@ wal_commit_checkpoint(struct wal_checkpoint *checkpoint);
 void
 wal_set_checkpoint_threshold(int64_t threshold);
 
+/**
+ * Set the max time the WAL thread may wait for more requests
+ * before syncing the WAL in fsync mode, so that requests written
+ * during this time share one fsync (group commit). The delay is
+ * further capped by the average fsync latency. Zero means sync
+ * after writing each batch.
+ */
+void
+wal_set_max_batch_delay(double delay);
+
+/**
+ * Report WAL statistics: the number of rows synced by one fsync
+ * and fsync latency histograms. Yields, because the statistics
+ * are collected by the WAL thread.
+ */
+void
+wal_stat(struct info_handler *h);
+
 /**
  * Remove WAL files that are not needed by consumers reading
  * rows at @vclock or newer.
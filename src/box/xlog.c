@@ -41,6 +41,7 @@
 #include <msgpuck.h>
 
 #include "coio_file.h"
+#include "uring.h"
 #include "tt_static.h"
 #include "error.h"
 #include "xrow.h"
@@ -69,6 +70,7 @@ typedef uint32_t log_magic_t;
 
 static const log_magic_t row_marker = mp_bswap_u32(0xd5ba0bab); /* host byte order */
 static const log_magic_t zrow_marker = mp_bswap_u32(0xd5ba0bba); /* host byte order */
+static const log_magic_t zdict_marker = mp_bswap_u32(0xd5ba0bd1); /* host byte order */
 static const log_magic_t eof_marker = mp_bswap_u32(0xd510aded); /* host byte order */
 
 enum {
@@ -96,6 +98,9 @@ const struct xlog_opts xlog_opts_default = {
 	.free_cache = false,
 	.sync_is_async = false,
 	.no_compression = false,
+	.compression_level = 3,
+	.zdict = NULL,
+	.use_uring = false,
 };
 
 /* {{{ struct xlog_meta */
@@ -1035,6 +1040,53 @@ xlog_fallocate(struct xlog *log, size_t len)
 #endif /* HAVE_FALLOCATE */
 }
 
+/**
+ * Encode a fixed size header of an xlog tx block.
+ *
+ * @param fixheader buffer of XLOG_FIXHEADER_SIZE bytes
+ * @param magic row_marker, zrow_marker or zdict_marker
+ * @param len size of the block body following the header
+ * @param crc32c checksum of the block body
+ */
+static void
+xlog_encode_fixheader(char *fixheader, log_magic_t magic,
+		      size_t len, uint32_t crc32c)
+{
+	*(log_magic_t *)fixheader = magic;
+	char *data = fixheader + sizeof(log_magic_t);
+	data = mp_encode_uint(data, len);
+	/* Encode crc32 for previous row */
+	data = mp_encode_uint(data, 0);
+	/* Encode crc32 for current row */
+	data = mp_encode_uint(data, crc32c);
+	/*
+	 * Encode a padding, to ensure the resulting
+	 * fixheader always has the same size.
+	 */
+	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
+	if (padding > 0) {
+		data = mp_encode_strl(data, padding - 1);
+		if (padding > 1) {
+			memset(data, 0, padding - 1);
+			data += padding - 1;
+		}
+	}
+}
+
+/**
+ * Write a vector of buffers at the current file position.
+ * Like fio, returns -1 and sets errno on failure.
+ */
+static ssize_t
+xlog_writev(struct xlog *log, struct iovec *iov, int iovcnt)
+{
+	if (!log->opts.use_uring)
+		return fio_writevn(log->fd, iov, iovcnt);
+	bool sync = log->is_sync_write;
+	log->is_sync_write = false;
+	return uring_writevn(log->fd, iov, iovcnt, sync);
+}
+
 /**
  * Write a sequence of uncompressed xrow objects.
  *
@@ -1049,14 +1101,6 @@ xlog_tx_write_plain(struct xlog *log)
 	 * now populate it with data.
 	 */
 	char *fixheader = (char *)log->obuf.iov[0].iov_base;
-	*(log_magic_t *)fixheader = row_marker;
-	char *data = fixheader + sizeof(log_magic_t);
-
-	data = mp_encode_uint(data,
-			      obuf_size(&log->obuf) - XLOG_FIXHEADER_SIZE);
-	/* Encode crc32 for previous row */
-	data = mp_encode_uint(data, 0);
-	/* Encode crc32 for current row */
 	uint32_t crc32c = 0;
 	struct iovec *iov;
 	size_t offset = XLOG_FIXHEADER_SIZE;
@@ -1066,26 +1110,16 @@ xlog_tx_write_plain(struct xlog *log)
 				    iov->iov_len - offset);
 		offset = 0;
 	}
-	data = mp_encode_uint(data, crc32c);
-	/*
-	 * Encode a padding, to ensure the resulting
-	 * fixheader always has the same size.
-	 */
-	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
-	if (padding > 0) {
-		data = mp_encode_strl(data, padding - 1);
-		if (padding > 1) {
-			memset(data, 0, padding - 1);
-			data += padding - 1;
-		}
-	}
+	xlog_encode_fixheader(fixheader, row_marker,
+			      obuf_size(&log->obuf) - XLOG_FIXHEADER_SIZE,
+			      crc32c);
 
 	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
 		return -1;
 	});
 
-	ssize_t written = fio_writevn(log->fd, log->obuf.iov, log->obuf.pos + 1);
+	ssize_t written = xlog_writev(log, log->obuf.iov, log->obuf.pos + 1);
 	if (written < 0) {
 		diag_set(SystemError, "failed to write to '%s' file",
 			 log->filename);
@@ -1107,8 +1141,10 @@ xlog_tx_write_zstd(struct xlog *log)
 
 	uint32_t crc32c = 0;
 	struct iovec *iov;
-	/* 3 is compression level. */
-	ZSTD_compressBegin(log->zctx, 3);
+	if (log->opts.zdict != NULL)
+		ZSTD_compressBegin_usingCDict(log->zctx, log->opts.zdict);
+	else
+		ZSTD_compressBegin(log->zctx, log->opts.compression_level);
 	size_t offset = XLOG_FIXHEADER_SIZE;
 	for (iov = log->obuf.iov; iov->iov_len; ++iov) {
 		/* Estimate max output buffer size. */
@@ -1148,25 +1184,9 @@ xlog_tx_write_zstd(struct xlog *log)
 		offset = 0;
 	}
 
-	*(log_magic_t *)fixheader = zrow_marker;
-	char *data;
-	data = fixheader + sizeof(log_magic_t);
-	data = mp_encode_uint(data,
-			      obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE);
-	/* Encode crc32 for previous row */
-	data = mp_encode_uint(data, 0);
-	/* Encode crc32 for current row */
-	data = mp_encode_uint(data, crc32c);
-	/* Encode padding */
-	ssize_t padding;
-	padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
-	if (padding > 0) {
-		data = mp_encode_strl(data, padding - 1);
-		if (padding > 1) {
-			memset(data, 0, padding - 1);
-			data += padding - 1;
-		}
-	}
+	xlog_encode_fixheader(fixheader, zrow_marker,
+			      obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE,
+			      crc32c);
 
 	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
@@ -1175,8 +1195,7 @@ xlog_tx_write_zstd(struct xlog *log)
 	});
 
 	ssize_t written;
-	written = fio_writevn(log->fd, log->zbuf.iov,
-			      log->zbuf.pos + 1);
+	written = xlog_writev(log, log->zbuf.iov, log->zbuf.pos + 1);
 	if (written < 0) {
 		diag_set(SystemError, "failed to write to '%s' file",
 			 log->filename);
@@ -1195,27 +1214,14 @@ error:
 #define SYNC_ROUND_UP(size)	(SYNC_ROUND_DOWN(size + SYNC_MASK))
 
 /**
- * Writes xlog batch to file
+ * Account a tx block written to the file at the current
+ * offset: advance the offset, sync and throttle if needed.
+ * On write failure, truncate the file to the last known
+ * good position.
  */
 static ssize_t
-xlog_tx_write(struct xlog *log)
+xlog_tx_complete(struct xlog *log, ssize_t written)
 {
-	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
-		return 0;
-	ssize_t written;
-
-	if (!log->opts.no_compression &&
-	    obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
-		written = xlog_tx_write_zstd(log);
-	} else {
-		written = xlog_tx_write_plain(log);
-	}
-	ERROR_INJECT(ERRINJ_WAL_WRITE, {
-		diag_set(ClientError, ER_INJECTION, "xlog write injection");
-		written = -1;
-	});
-
-	obuf_reset(&log->obuf);
 	/*
 	 * Simplify recovery after a temporary write failure:
 	 * truncate the file to the best known good write
@@ -1276,6 +1282,31 @@ xlog_tx_write(struct xlog *log)
 	return written;
 }
 
+/**
+ * Writes xlog batch to file
+ */
+static ssize_t
+xlog_tx_write(struct xlog *log)
+{
+	if (obuf_size(&log->obuf) == XLOG_FIXHEADER_SIZE)
+		return 0;
+	ssize_t written;
+
+	if (!log->opts.no_compression &&
+	    obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
+		written = xlog_tx_write_zstd(log);
+	} else {
+		written = xlog_tx_write_plain(log);
+	}
+	ERROR_INJECT(ERRINJ_WAL_WRITE, {
+		diag_set(ClientError, ER_INJECTION, "xlog write injection");
+		written = -1;
+	});
+
+	obuf_reset(&log->obuf);
+	return xlog_tx_complete(log, written);
+}
+
 /*
  * Add a row to a log and possibly flush the log.
  *
@@ -1338,6 +1369,26 @@ xlog_write_row(struct xlog *log, const struct xrow_header *packet)
 	return row_size;
 }
 
+int
+xlog_write_zdict(struct xlog *log, const char *dict, size_t size)
+{
+	assert(obuf_size(&log->obuf) == 0);
+	assert(log->rows == 0);
+	char fixheader[XLOG_FIXHEADER_SIZE];
+	xlog_encode_fixheader(fixheader, zdict_marker, size,
+			      crc32_calc(0, dict, size));
+	struct iovec iov[2] = {
+		{ fixheader, XLOG_FIXHEADER_SIZE },
+		{ (void *)dict, size },
+	};
+	ssize_t written = xlog_writev(log, iov, lengthof(iov));
+	if (written < 0) {
+		diag_set(SystemError, "failed to write to '%s' file",
+			 log->filename);
+	}
+	return xlog_tx_complete(log, written) < 0 ? -1 : 0;
+}
+
 /**
  * Begin a multi-statement xlog transaction. All xrow objects
  * of a single transaction share the same header and checksum
@@ -1391,6 +1442,79 @@ xlog_flush(struct xlog *log)
 	return xlog_tx_write(log);
 }
 
+ssize_t
+xlog_flush_sync(struct xlog *log)
+{
+	assert(log->is_autocommit);
+	log->is_sync_write = true;
+	ssize_t written = xlog_flush(log);
+	/* The flag is cleared if the sync was linked to the write. */
+	bool need_sync = log->is_sync_write;
+	log->is_sync_write = false;
+	if (written >= 0 && need_sync && fdatasync(log->fd) != 0) {
+		diag_set(SystemError, "failed to sync '%s' file",
+			 log->filename);
+		return -1;
+	}
+	return written;
+}
+
+size_t
+xlog_tx_encode_size_max(size_t size)
+{
+	return XLOG_FIXHEADER_SIZE + ZSTD_compressBound(size);
+}
+
+ssize_t
+xlog_tx_encode(ZSTD_CCtx *zctx, const char *rows, size_t size, char *out)
+{
+	char *data = out + XLOG_FIXHEADER_SIZE;
+	size_t data_size;
+	log_magic_t magic;
+	if (zctx != NULL && size >= XLOG_TX_COMPRESS_THRESHOLD) {
+		/* 3 is compression level. */
+		data_size = ZSTD_compressCCtx(zctx, data,
+					      ZSTD_compressBound(size),
+					      rows, size, 3);
+		if (ZSTD_isError(data_size)) {
+			diag_set(ClientError, ER_COMPRESSION,
+				 ZSTD_getErrorName(data_size));
+			return -1;
+		}
+		magic = zrow_marker;
+	} else {
+		memcpy(data, rows, size);
+		data_size = size;
+		magic = row_marker;
+	}
+	xlog_encode_fixheader(out, magic, data_size,
+			      crc32_calc(0, data, data_size));
+	return XLOG_FIXHEADER_SIZE + data_size;
+}
+
+ssize_t
+xlog_write_tx(struct xlog *log, const char *data, size_t size,
+	      int64_t row_count)
+{
+	assert(log->is_autocommit && obuf_size(&log->obuf) == 0);
+	ssize_t written = size;
+	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
+		diag_set(ClientError, ER_INJECTION, "xlog write injection");
+		written = -1;
+	});
+	if (written >= 0 && fio_writen(log->fd, data, size) < 0) {
+		diag_set(SystemError, "failed to write to '%s' file",
+			 log->filename);
+		written = -1;
+	}
+	ERROR_INJECT(ERRINJ_WAL_WRITE, {
+		diag_set(ClientError, ER_INJECTION, "xlog write injection");
+		written = -1;
+	});
+	log->tx_rows = row_count;
+	return xlog_tx_complete(log, written);
+}
+
 static int
 sync_cb(eio_req *req)
 {
@@ -1493,7 +1617,7 @@ xlog_atfork(struct xlog *xlog)
 
 /* {{{ struct xlog_cursor */
 
-#define XLOG_READ_AHEAD		(1 << 14)
+#define XLOG_READ_AHEAD		(1 << 17)
 
 /**
  * Ensure that at least count bytes are in read buffer
@@ -1593,15 +1717,17 @@ struct xlog_fixheader {
 };
 
 /**
- * Decode xlog tx header, set up magic, crc32c and len
+ * Decode a block header, set up magic, crc32c and len.
+ * Unlike xlog_fixheader_decode(), accepts a dictionary
+ * block header.
  *
  * @retval 0 for success
  * @retval -1 for error
  * @retval count of bytes left to parse header
  */
 static ssize_t
-xlog_fixheader_decode(struct xlog_fixheader *fixheader,
-		      const char **data, const char *data_end)
+xlog_block_fixheader_decode(struct xlog_fixheader *fixheader,
+			    const char **data, const char *data_end)
 {
 	if (data_end - *data < (ptrdiff_t)XLOG_FIXHEADER_SIZE)
 		return XLOG_FIXHEADER_SIZE - (data_end - *data);
@@ -1611,7 +1737,8 @@ xlog_fixheader_decode(struct xlog_fixheader *fixheader,
 	/* Decode magic */
 	fixheader->magic = load_u32(pos);
 	if (fixheader->magic != row_marker &&
-	    fixheader->magic != zrow_marker) {
+	    fixheader->magic != zrow_marker &&
+	    fixheader->magic != zdict_marker) {
 		diag_set(XlogError, "invalid magic: 0x%x", fixheader->magic);
 		return -1;
 	}
@@ -1660,9 +1787,45 @@ xlog_fixheader_decode(struct xlog_fixheader *fixheader,
 	return 0;
 }
 
+/**
+ * Decode xlog tx header, set up magic, crc32c and len
+ *
+ * @retval 0 for success
+ * @retval -1 for error
+ * @retval count of bytes left to parse header
+ */
+static ssize_t
+xlog_fixheader_decode(struct xlog_fixheader *fixheader,
+		      const char **data, const char *data_end)
+{
+	ssize_t rc = xlog_block_fixheader_decode(fixheader, data, data_end);
+	if (rc == 0 && fixheader->magic == zdict_marker) {
+		diag_set(XlogError, "unexpected zstd dictionary block");
+		return -1;
+	}
+	return rc;
+}
+
+ssize_t
+xlog_tx_size(const char *data, const char *data_end, bool *is_compressed)
+{
+	struct xlog_fixheader fixheader;
+	const char *pos = data;
+	ssize_t rc = xlog_fixheader_decode(&fixheader, &pos, data_end);
+	if (rc > 0) {
+		diag_set(XlogError, "truncated fixheader");
+		return -1;
+	}
+	if (rc < 0)
+		return -1;
+	*is_compressed = fixheader.magic == zrow_marker;
+	return XLOG_FIXHEADER_SIZE + fixheader.len;
+}
+
 int
 xlog_tx_decode(const char *data, const char *data_end,
-	       char *rows, char *rows_end, ZSTD_DStream *zdctx)
+	       char *rows, char *rows_end, ZSTD_DStream *zdctx,
+	       const ZSTD_DDict *zddict)
 {
 	/* Decode fixheader */
 	struct xlog_fixheader fixheader;
@@ -1701,7 +1864,10 @@ xlog_tx_decode(const char *data, const char *data_end,
 
 	/* Decompress zstd rows */
 	assert(fixheader.magic == zrow_marker);
-	ZSTD_initDStream(zdctx);
+	if (zddict != NULL)
+		ZSTD_initDStream_usingDDict(zdctx, zddict);
+	else
+		ZSTD_initDStream(zdctx);
 	int rc = xlog_cursor_decompress(&rows, rows_end, &data, data_end,
 					zdctx);
 	if (rc < 0) {
@@ -1725,7 +1891,7 @@ xlog_tx_decode(const char *data, const char *data_end,
 ssize_t
 xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 		      const char **data, const char *data_end,
-		      ZSTD_DStream *zdctx)
+		      ZSTD_DStream *zdctx, const ZSTD_DDict *zddict)
 {
 	const char *rpos = *data;
 	struct xlog_fixheader fixheader;
@@ -1767,7 +1933,10 @@ xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 	};
 
 	assert(fixheader.magic == zrow_marker);
-	ZSTD_initDStream(zdctx);
+	if (zddict != NULL)
+		ZSTD_initDStream_usingDDict(zdctx, zddict);
+	else
+		ZSTD_initDStream(zdctx);
 	int rc;
 	do {
 		if (ibuf_reserve(&tx_cursor->rows,
@@ -1780,8 +1949,10 @@ xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 	} while ((rc = xlog_cursor_decompress(&tx_cursor->rows.wpos,
 					      tx_cursor->rows.end, &rpos,
 					      data_end, zdctx)) == 1);
-	if (rc != 0)
+	if (rc != 0) {
+		ibuf_destroy(&tx_cursor->rows);
 		return -1;
+	}
 
 	*data = rpos;
 	assert(*data <= data_end);
@@ -1844,6 +2015,29 @@ xlog_cursor_find_tx_magic(struct xlog_cursor *i)
 	return 0;
 }
 
+/**
+ * Called when the cursor has read the eof marker. Checks that
+ * there's no more data in the file.
+ *
+ * @retval 1 eof
+ * @retval -1 error
+ */
+static int
+xlog_cursor_eof(struct xlog_cursor *i)
+{
+	int rc = xlog_cursor_ensure(i, sizeof(log_magic_t) + sizeof(char));
+	if (rc < 0)
+		return -1;
+	if (rc == 0) {
+		diag_set(XlogError, "%s: has some data after "
+			  "eof marker at %lld", i->name,
+			  xlog_cursor_pos(i));
+		return -1;
+	}
+	i->state = XLOG_CURSOR_EOF;
+	return 1;
+}
+
 int
 xlog_cursor_next_tx(struct xlog_cursor *i)
 {
@@ -1858,13 +2052,14 @@ xlog_cursor_next_tx(struct xlog_cursor *i)
 		return 1;
 	if (load_u32(i->rbuf.rpos) == eof_marker) {
 		/* eof marker found */
-		goto eof_found;
+		return xlog_cursor_eof(i);
 	}
 
 	ssize_t to_load;
 	while ((to_load = xlog_tx_cursor_create(&i->tx_cursor,
 						(const char **)&i->rbuf.rpos,
-						i->rbuf.wpos, i->zdctx)) > 0) {
+						i->rbuf.wpos, i->zdctx,
+						i->zddict)) > 0) {
 		/* not enough data in read buffer */
 		int rc = xlog_cursor_ensure(i, ibuf_used(&i->rbuf) + to_load);
 		if (rc < 0)
@@ -1877,23 +2072,57 @@ xlog_cursor_next_tx(struct xlog_cursor *i)
 
 	i->state = XLOG_CURSOR_TX;
 	return 0;
-eof_found:
-	/*
-	 * A eof marker is read, check that there is no
-	 * more data in the file.
-	 */
-	rc = xlog_cursor_ensure(i, sizeof(log_magic_t) + sizeof(char));
+}
 
+int
+xlog_cursor_read_tx(struct xlog_cursor *i, const char **data, size_t *size)
+{
+	assert(xlog_cursor_is_open(i));
+	assert(i->state != XLOG_CURSOR_TX);
+
+	/* load at least magic to check eof */
+	int rc = xlog_cursor_ensure(i, sizeof(log_magic_t));
 	if (rc < 0)
 		return -1;
-	if (rc == 0) {
-		diag_set(XlogError, "%s: has some data after "
-			  "eof marker at %lld", i->name,
-			  xlog_cursor_pos(i));
-		return -1;
+	if (rc > 0)
+		return 1;
+	if (load_u32(i->rbuf.rpos) == eof_marker)
+		return xlog_cursor_eof(i);
+
+	struct xlog_fixheader fixheader;
+	while (true) {
+		const char *pos = i->rbuf.rpos;
+		ssize_t to_load = xlog_fixheader_decode(&fixheader, &pos,
+							i->rbuf.wpos);
+		if (to_load < 0)
+			return -1;
+		if (to_load == 0) {
+			size_t tx_size = XLOG_FIXHEADER_SIZE + fixheader.len;
+			if (ibuf_used(&i->rbuf) >= tx_size)
+				break;
+			to_load = tx_size - ibuf_used(&i->rbuf);
+		}
+		/* not enough data in read buffer */
+		rc = xlog_cursor_ensure(i, ibuf_used(&i->rbuf) + to_load);
+		if (rc < 0)
+			return -1;
+		if (rc > 0)
+			return 1;
 	}
-	i->state = XLOG_CURSOR_EOF;
-	return 1;
+	*data = i->rbuf.rpos;
+	*size = XLOG_FIXHEADER_SIZE + fixheader.len;
+	i->rbuf.rpos += *size;
+	return 0;
+}
+
+int
+xlog_cursor_has_next_tx(struct xlog_cursor *cursor)
+{
+	assert(xlog_cursor_is_open(cursor));
+	int rc = xlog_cursor_ensure(cursor, sizeof(log_magic_t));
+	if (rc != 0)
+		return rc < 0 ? -1 : 0;
+	return load_u32(cursor->rbuf.rpos) != eof_marker;
 }
 
 int
@@ -1944,6 +2173,71 @@ xlog_cursor_next(struct xlog_cursor *cursor,
 	return 0;
 }
 
+/**
+ * Load the zstd dictionary written right after the file meta,
+ * if any. The dictionary is used to decompress all tx blocks
+ * of the file, see xlog_write_zdict().
+ *
+ * @retval 0 success
+ * @retval -1 error, check diag
+ */
+static int
+xlog_cursor_read_zdict(struct xlog_cursor *i)
+{
+	int rc = xlog_cursor_ensure(i, sizeof(log_magic_t));
+	if (rc < 0)
+		return -1;
+	if (rc > 0 || load_u32(i->rbuf.rpos) != zdict_marker)
+		return 0;
+	struct xlog_fixheader fixheader;
+	const char *pos;
+	while (true) {
+		pos = i->rbuf.rpos;
+		ssize_t to_load = xlog_block_fixheader_decode(&fixheader, &pos,
+							      i->rbuf.wpos);
+		if (to_load < 0)
+			return -1;
+		if (to_load == 0) {
+			size_t size = XLOG_FIXHEADER_SIZE + fixheader.len;
+			if (ibuf_used(&i->rbuf) >= size)
+				break;
+			to_load = size - ibuf_used(&i->rbuf);
+		}
+		rc = xlog_cursor_ensure(i, ibuf_used(&i->rbuf) + to_load);
+		if (rc < 0)
+			return -1;
+		if (rc > 0) {
+			diag_set(XlogError, "%s: truncated zstd dictionary",
+				 i->name);
+			return -1;
+		}
+	}
+	if (crc32_calc(0, pos, fixheader.len) != fixheader.crc32c) {
+		diag_set(XlogError, "%s: zstd dictionary checksum mismatch",
+			 i->name);
+		return -1;
+	}
+	char *zdict = (char *)malloc(fixheader.len);
+	if (zdict == NULL) {
+		diag_set(OutOfMemory, fixheader.len, "malloc",
+			 "zstd dictionary");
+		return -1;
+	}
+	memcpy(zdict, pos, fixheader.len);
+	ZSTD_DDict *zddict = ZSTD_createDDict(zdict, fixheader.len);
+	if (zddict == NULL) {
+		free(zdict);
+		diag_set(OutOfMemory, fixheader.len, "zstd",
+			 "decompression dictionary");
+		return -1;
+	}
+	i->zdict = zdict;
+	i->zdict_size = fixheader.len;
+	i->zddict = zddict;
+	i->rbuf.rpos = (char *)pos + fixheader.len;
+	return 0;
+}
+
 int
 xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
 {
@@ -1970,6 +2264,8 @@ xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
 		goto error;
 	}
 	snprintf(i->name, sizeof(i->name), "%s", name);
+	if (xlog_cursor_read_zdict(i) != 0)
+		goto error;
 	i->zdctx = ZSTD_createDStream();
 	if (i->zdctx == NULL) {
 		diag_set(ClientError, ER_DECOMPRESSION,
@@ -1979,6 +2275,8 @@ xlog_cursor_openfd(struct xlog_cursor *i, int fd, const char *name)
 	i->state = XLOG_CURSOR_ACTIVE;
 	return 0;
 error:
+	ZSTD_freeDDict(i->zddict);
+	free(i->zdict);
 	ibuf_destroy(&i->rbuf);
 	return -1;
 }
@@ -2027,6 +2325,8 @@ xlog_cursor_openmem(struct xlog_cursor *i, const char *data, size_t size,
 		goto error;
 	}
 	snprintf(i->name, sizeof(i->name), "%s", name);
+	if (xlog_cursor_read_zdict(i) != 0)
+		goto error;
 	i->zdctx = ZSTD_createDStream();
 	if (i->zdctx == NULL) {
 		diag_set(ClientError, ER_DECOMPRESSION,
@@ -2036,6 +2336,8 @@ xlog_cursor_openmem(struct xlog_cursor *i, const char *data, size_t size,
 	i->state = XLOG_CURSOR_ACTIVE;
 	return 0;
 error:
+	ZSTD_freeDDict(i->zddict);
+	free(i->zdict);
 	ibuf_destroy(&i->rbuf);
 	return -1;
 }
@@ -2051,6 +2353,10 @@ xlog_cursor_close(struct xlog_cursor *i, bool reuse_fd)
 	if (i->state == XLOG_CURSOR_TX)
 		xlog_tx_cursor_destroy(&i->tx_cursor);
 	ZSTD_freeDStream(i->zdctx);
+	ZSTD_freeDDict(i->zddict);
+	i->zddict = NULL;
+	free(i->zdict);
+	i->zdict = NULL;
 	i->state = (i->state == XLOG_CURSOR_EOF ?
 		    XLOG_CURSOR_EOF_CLOSED : XLOG_CURSOR_CLOSED);
 	/*
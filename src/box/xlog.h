@@ -82,6 +82,22 @@ struct xlog_opts {
 	 * to be read frequently, e.g. L1 run files in Vinyl.
 	 */
 	bool no_compression;
+	/** zstd compression level. */
+	int compression_level;
+	/**
+	 * Prepared zstd dictionary to compress tx blocks with.
+	 * If set, it overrides compression_level, which is baked
+	 * into the dictionary. The dictionary must outlive the
+	 * xlog and be written to the file with xlog_write_zdict()
+	 * so that the file can be read back.
+	 */
+	const ZSTD_CDict *zdict;
+	/**
+	 * If this flag is set, the xlog writer submits writes to
+	 * the io_uring instance of the current thread, which must
+	 * be created beforehand, see uring_init().
+	 */
+	bool use_uring;
 };
 
 extern const struct xlog_opts xlog_opts_default;
@@ -393,6 +409,11 @@ struct xlog {
 	uint64_t synced_size;
 	/** Time when xlog wast synced last time */
 	double sync_time;
+	/**
+	 * Set if the next write must be synced along with the
+	 * data, see xlog_flush_sync().
+	 */
+	bool is_sync_write;
 };
 
 /**
@@ -501,6 +522,19 @@ xlog_fallocate(struct xlog *log, size_t size);
 ssize_t
 xlog_write_row(struct xlog *log, const struct xrow_header *packet);
 
+/**
+ * Write a zstd dictionary block to xlog. It must be done right
+ * after the xlog is created, before any rows are written. The
+ * xlog cursor loads the dictionary when it opens the file and
+ * uses it to decompress all tx blocks, so it must be the one
+ * xlog_opts::zdict was created from.
+ *
+ * @retval 0 for ok
+ * @retval -1 for error
+ */
+int
+xlog_write_zdict(struct xlog *log, const char *dict, size_t size);
+
 /**
  * Prevent xlog row buffer offloading, should be use
  * at transaction start to write transaction in one xlog tx
@@ -530,6 +564,59 @@ xlog_tx_rollback(struct xlog *log);
 ssize_t
 xlog_flush(struct xlog *log);
 
+/**
+ * Flush buffered rows and make sure they reach the disk.
+ * If the xlog writes via io_uring, the write and fdatasync are
+ * linked and submitted to the kernel with one system call.
+ * Note, if the sync fails, the written rows are discarded.
+ *
+ * @retval -1 error, check diag
+ * @retval >= 0 the number of bytes written
+ */
+ssize_t
+xlog_flush_sync(struct xlog *log);
+
+/**
+ * Return the max size of a tx block produced by
+ * xlog_tx_encode() from @a size bytes of encoded rows.
+ */
+size_t
+xlog_tx_encode_size_max(size_t size);
+
+/**
+ * Encode a tx block out of a sequence of encoded rows,
+ * i.e. prepend it with a fixheader and compress it if
+ * @a zctx is not NULL and the block is big enough.
+ * The function doesn't depend on any xlog and so may be
+ * called from any thread, which allows to spread block
+ * compression among several threads.
+ *
+ * @param zctx compression context or NULL
+ * @param rows encoded rows
+ * @param size size of @a rows
+ * @param[out] out output buffer of at least
+ *             xlog_tx_encode_size_max(@a size) bytes
+ *
+ * @retval >= 0 size of the encoded block
+ * @retval -1 compression error, check diag
+ */
+ssize_t
+xlog_tx_encode(ZSTD_CCtx *zctx, const char *rows, size_t size, char *out);
+
+/**
+ * Write a tx block encoded with xlog_tx_encode() to xlog.
+ * The xlog row buffer must be empty. Syncing and rate
+ * limiting work the same way as for xlog_write_row().
+ *
+ * @param row_count number of rows in the block
+ *
+ * @retval >= 0 the number of bytes written
+ * @retval -1 error, check diag
+ */
+ssize_t
+xlog_write_tx(struct xlog *log, const char *data, size_t size,
+	      int64_t row_count);
+
 
 /**
  * Sync a log file. The exact action is defined
@@ -573,6 +660,7 @@ struct xlog_tx_cursor
 /**
  * Create xlog tx iterator from memory data.
  * *data will be adjusted to end of tx
+ * @a zddict is the dictionary the tx was compressed with or NULL.
  *
  * @retval 0 for Ok
  * @retval -1 for error
@@ -581,7 +669,7 @@ struct xlog_tx_cursor
 ssize_t
 xlog_tx_cursor_create(struct xlog_tx_cursor *cursor,
 		      const char **data, const char *data_end,
-		      ZSTD_DStream *zdctx);
+		      ZSTD_DStream *zdctx, const ZSTD_DDict *zddict);
 
 /**
  * Destroy xlog tx cursor and free all associated memory
@@ -611,6 +699,19 @@ xlog_tx_cursor_pos(struct xlog_tx_cursor *tx_cursor)
 	return tx_cursor->size - ibuf_used(&tx_cursor->rows);
 }
 
+/**
+ * Return the size of the tx stored in a raw buffer, including
+ * the fixheader. The buffer must hold at least the fixheader.
+ *
+ * @param data a buffer with the raw tx data
+ * @param data_end the end of @a data buffer
+ * @param[out] is_compressed set if the tx rows are compressed
+ * @retval >0 tx size
+ * @retval -1 error, check diag
+ */
+ssize_t
+xlog_tx_size(const char *data, const char *data_end, bool *is_compressed);
+
 /**
  * A conventional helper to decode rows from the raw tx buffer.
  * Decodes fixheader, checks crc32 and length, decompresses rows.
@@ -619,13 +720,15 @@ xlog_tx_cursor_pos(struct xlog_tx_cursor *tx_cursor)
  * @param data_end the end of @a data buffer
  * @param[out] rows a buffer to store decoded rows
  * @param[out] rows_end the end of @a rows buffer
+ * @param zdctx decompression context
+ * @param zddict dictionary the data was compressed with or NULL
  * @retval  0 success
  * @retval -1 error, check diag
  */
 int
 xlog_tx_decode(const char *data, const char *data_end,
 	       char *rows, char *rows_end,
-	       ZSTD_DStream *zdctx);
+	       ZSTD_DStream *zdctx, const ZSTD_DDict *zddict);
 
 /* }}} */
 
@@ -666,6 +769,15 @@ struct xlog_cursor {
 	struct xlog_tx_cursor tx_cursor;
 	/** ZSTD context for decompression */
 	ZSTD_DStream *zdctx;
+	/**
+	 * zstd dictionary stored in the file or NULL,
+	 * see xlog_write_zdict().
+	 */
+	char *zdict;
+	/** Size of the zstd dictionary. */
+	uint32_t zdict_size;
+	/** Digested zdict used to decompress tx blocks. */
+	ZSTD_DDict *zddict;
 };
 
 /**
@@ -742,6 +854,34 @@ xlog_cursor_close(struct xlog_cursor *cursor, bool reuse_fd);
 int
 xlog_cursor_next_tx(struct xlog_cursor *cursor);
 
+/**
+ * Read next tx from xlog without decompressing it. The tx
+ * (fixheader included) may be decoded later with
+ * xlog_tx_cursor_create(), possibly in another thread.
+ * The cursor must not have an open tx.
+ * @param cursor cursor
+ * @param[out] data tx data, valid until the next cursor call
+ * @param[out] size tx size
+ * @retval 0 succes
+ * @retval 1 eof
+ * retval -1 error, check diag
+ */
+int
+xlog_cursor_read_tx(struct xlog_cursor *cursor, const char **data,
+		    size_t *size);
+
+/**
+ * Check if there is another tx after the current one without
+ * decoding it. On success, xlog_cursor_pos() returns the offset
+ * of the next tx.
+ * @param cursor cursor
+ * @retval 1 there is another tx
+ * @retval 0 eof
+ * @retval -1 error, check diag
+ */
+int
+xlog_cursor_has_next_tx(struct xlog_cursor *cursor);
+
 /**
  * Fetch next xrow from current xlog tx
  *
@@ -0,0 +1,480 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "xlog_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coio_task.h"
+#include "error.h"
+#include "say.h"
+#include "trivia/util.h"
+#include "xrow.h"
+
+/**
+ * Log the error set in diag and return true if it may be
+ * skipped, i.e. it's an xlog format error and force_recovery
+ * is set.
+ */
+static bool
+xlog_reader_skip_error(struct xlog_reader *reader, const char *what)
+{
+	struct error *e = diag_last_error(diag_get());
+	if (!reader->force_recovery || e->type != &type_XlogError)
+		return false;
+	say_error("%s: %s", what, e->errmsg);
+	return true;
+}
+
+/**
+ * Make room for size more bytes in the data buffer of a batch.
+ * Row bodies point to the buffer, so they are relocated if the
+ * buffer moves.
+ */
+static int
+xlog_reader_batch_reserve_data(struct xlog_reader_batch *batch, size_t size)
+{
+	size_t needed = batch->data_size + size;
+	if (needed <= batch->data_capacity)
+		return 0;
+	size_t capacity = MAX(batch->data_capacity * 2, needed);
+	uintptr_t old_data = (uintptr_t)batch->data;
+	char *data = realloc(batch->data, capacity);
+	if (data == NULL) {
+		diag_set(OutOfMemory, capacity, "realloc",
+			 "xlog reader batch");
+		return -1;
+	}
+	for (int i = 0; i < batch->row_count; i++) {
+		struct xrow_header *row = &batch->rows[i];
+		for (int j = 0; j < row->bodycnt; j++) {
+			uintptr_t offset = (uintptr_t)row->body[j].iov_base -
+					   old_data;
+			row->body[j].iov_base = data + offset;
+		}
+	}
+	batch->data = data;
+	batch->data_capacity = capacity;
+	return 0;
+}
+
+/** Make room for one more row in a batch. */
+static int
+xlog_reader_batch_reserve_row(struct xlog_reader_batch *batch)
+{
+	if (batch->row_count < batch->row_capacity)
+		return 0;
+	int capacity = MAX(batch->row_capacity * 2, 1024);
+	size_t size = capacity * sizeof(*batch->rows);
+	struct xrow_header *rows = realloc(batch->rows, size);
+	if (rows == NULL) {
+		diag_set(OutOfMemory, size, "realloc", "xlog reader batch");
+		return -1;
+	}
+	batch->rows = rows;
+	batch->row_capacity = capacity;
+	return 0;
+}
+
+/**
+ * Decompress tx blocks read into a batch and decode rows.
+ * The function doesn't access anything but the batch and
+ * reader options, so it may be called from any thread.
+ */
+static int
+xlog_reader_batch_decode(struct xlog_reader_batch *batch)
+{
+	struct xlog_reader *reader = batch->reader;
+	const char *pos = batch->raw.rpos;
+	const char *end = batch->raw.wpos;
+	while (pos < end) {
+		/* The size was checked when the tx was read. */
+		bool is_compressed;
+		ssize_t tx_size = xlog_tx_size(pos, end, &is_compressed);
+		assert(tx_size > 0 && pos + tx_size <= end);
+		const char *tx = pos;
+		pos += tx_size;
+
+		struct xlog_tx_cursor tx_cursor;
+		ssize_t rc = xlog_tx_cursor_create(&tx_cursor, &tx, pos,
+						   batch->zdctx, NULL);
+		assert(rc <= 0);
+		if (rc < 0) {
+			if (xlog_reader_skip_error(reader, "can't open tx"))
+				continue;
+			return -1;
+		}
+		size_t size = ibuf_used(&tx_cursor.rows);
+		if (xlog_reader_batch_reserve_data(batch, size) != 0) {
+			xlog_tx_cursor_destroy(&tx_cursor);
+			return -1;
+		}
+		const char *data = batch->data + batch->data_size;
+		const char *data_end = data + size;
+		memcpy(batch->data + batch->data_size,
+		       tx_cursor.rows.rpos, size);
+		batch->data_size += size;
+		xlog_tx_cursor_destroy(&tx_cursor);
+
+		while (data < data_end) {
+			if (xlog_reader_batch_reserve_row(batch) != 0)
+				return -1;
+			struct xrow_header *row = &batch->rows[batch->row_count];
+			if (xrow_header_decode(row, &data, data_end,
+					       false) != 0) {
+				diag_set(XlogError, "can't parse row");
+				/* Skip the rest of the tx. */
+				if (xlog_reader_skip_error(reader,
+							   "can't decode row"))
+					break;
+				return -1;
+			}
+			batch->row_count++;
+		}
+	}
+	return 0;
+}
+
+static ssize_t
+xlog_reader_batch_decode_cb(va_list ap)
+{
+	struct xlog_reader_batch *batch =
+		va_arg(ap, struct xlog_reader_batch *);
+	return xlog_reader_batch_decode(batch);
+}
+
+/**
+ * Read the next tx from the file without decoding it. Broken
+ * tx headers are skipped if force_recovery is set.
+ */
+static int
+xlog_reader_read_tx(struct xlog_reader *reader, const char **data,
+		    size_t *size)
+{
+	int rc;
+	while ((rc = xlog_cursor_read_tx(&reader->cursor, data, size)) < 0) {
+		if (!xlog_reader_skip_error(reader, "can't open tx"))
+			return -1;
+		rc = xlog_cursor_find_tx_magic(&reader->cursor);
+		if (rc != 0)
+			return rc;
+	}
+	return rc;
+}
+
+/**
+ * Read raw tx blocks from the file into a batch. Called in the
+ * reader thread.
+ */
+static int
+xlog_reader_batch_read(struct xlog_reader_batch *batch)
+{
+	struct xlog_reader *reader = batch->reader;
+	if (!xlog_cursor_is_open(&reader->cursor) &&
+	    xlog_cursor_open(&reader->cursor, reader->filename) != 0)
+		return -1;
+	while (ibuf_used(&batch->raw) < XLOG_READER_BATCH_SIZE) {
+		const char *data;
+		size_t size;
+		int rc = xlog_reader_read_tx(reader, &data, &size);
+		if (rc < 0)
+			return -1;
+		if (rc > 0) {
+			reader->cursor_rc = batch->rc = 1;
+			break;
+		}
+		/*
+		 * The tx points to the cursor read buffer, which
+		 * is reused for the next read, so copy it to the
+		 * batch.
+		 */
+		void *raw = ibuf_alloc(&batch->raw, size);
+		if (raw == NULL) {
+			diag_set(OutOfMemory, size, "ibuf_alloc",
+				 "xlog reader batch");
+			return -1;
+		}
+		memcpy(raw, data, size);
+	}
+	return 0;
+}
+
+/**
+ * Decode a batch and send it to tx. Called in the reader
+ * thread. If use_coio is set, the batch is decoded in the
+ * worker pool, so the calling fiber yields.
+ */
+static void
+xlog_reader_batch_complete(struct xlog_reader_batch *batch, bool use_coio)
+{
+	struct xlog_reader *reader = batch->reader;
+	int rc = 0;
+	if (ibuf_used(&batch->raw) > 0) {
+		rc = use_coio ?
+		     coio_call(xlog_reader_batch_decode_cb, batch) :
+		     xlog_reader_batch_decode(batch);
+	}
+	if (rc != 0) {
+		/*
+		 * A decoding error precedes any error the batch
+		 * may have got while reading the file.
+		 */
+		diag_move(diag_get(), &batch->diag);
+		reader->cursor_rc = batch->rc = -1;
+	}
+	cmsg_init(&batch->base, reader->ready_route);
+	cpipe_push(&reader->tx_pipe, &batch->base);
+}
+
+static int
+xlog_reader_batch_decode_f(va_list ap)
+{
+	struct xlog_reader_batch *batch =
+		va_arg(ap, struct xlog_reader_batch *);
+	xlog_reader_batch_complete(batch, true);
+	return 0;
+}
+
+/**
+ * Read a batch and pass it on to decoding. Called in the
+ * reader thread.
+ */
+static void
+xlog_reader_batch_fill(struct cmsg *msg)
+{
+	struct xlog_reader_batch *batch = (struct xlog_reader_batch *)msg;
+	struct xlog_reader *reader = batch->reader;
+
+	ibuf_reset(&batch->raw);
+	batch->data_size = 0;
+	batch->row_count = 0;
+	batch->row_pos = 0;
+	batch->seq = reader->read_seq++;
+	batch->rc = reader->cursor_rc;
+	if (batch->rc == 0 && xlog_reader_batch_read(batch) != 0) {
+		diag_move(diag_get(), &batch->diag);
+		reader->cursor_rc = batch->rc = -1;
+	}
+	/*
+	 * Tx blocks are compressed independently, so batches
+	 * may be decoded in parallel while the reader thread
+	 * reads the next one.
+	 */
+	if (reader->decode_threads > 0 && ibuf_used(&batch->raw) > 0) {
+		struct fiber *f = fiber_new("xlog_reader.decode",
+					    xlog_reader_batch_decode_f);
+		if (f != NULL) {
+			fiber_start(f, batch);
+			return;
+		}
+		diag_log();
+	}
+	xlog_reader_batch_complete(batch, false);
+}
+
+/**
+ * Put a decoded batch to the array of ready batches. Called in
+ * tx.
+ */
+static void
+xlog_reader_batch_ready(struct cmsg *msg)
+{
+	struct xlog_reader_batch *batch = (struct xlog_reader_batch *)msg;
+	struct xlog_reader *reader = batch->reader;
+	assert(reader->in_progress > 0);
+	reader->in_progress--;
+	int slot = batch->seq % reader->batch_count;
+	assert(reader->ready[slot] == NULL);
+	reader->ready[slot] = batch;
+	fiber_cond_signal(&reader->cond);
+}
+
+/** Send a batch to the reader thread to be filled. */
+static void
+xlog_reader_batch_submit(struct xlog_reader_batch *batch)
+{
+	struct xlog_reader *reader = batch->reader;
+	cmsg_init(&batch->base, reader->read_route);
+	reader->in_progress++;
+	cpipe_push(&reader->reader_pipe, &batch->base);
+}
+
+/** Reader thread function. */
+static int
+xlog_reader_f(va_list ap)
+{
+	struct xlog_reader *reader = va_arg(ap, struct xlog_reader *);
+	for (int i = 0; i < reader->batch_count; i++) {
+		ibuf_create(&reader->batches[i].raw, &cord()->slabc,
+			    XLOG_READER_BATCH_SIZE);
+	}
+	/* Batches are decoded in the worker thread pool. */
+	coio_enable();
+
+	struct cbus_endpoint endpoint;
+	cpipe_create(&reader->tx_pipe, "tx_prio");
+	cbus_endpoint_create(&endpoint, cord_name(cord()),
+			     fiber_schedule_cb, fiber());
+	cbus_loop(&endpoint);
+
+	if (xlog_cursor_is_open(&reader->cursor))
+		xlog_cursor_close(&reader->cursor, false);
+	for (int i = 0; i < reader->batch_count; i++)
+		ibuf_destroy(&reader->batches[i].raw);
+
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&reader->tx_pipe);
+	return 0;
+}
+
+static void
+xlog_reader_free_batches(struct xlog_reader *reader)
+{
+	for (int i = 0; reader->batches != NULL &&
+			i < reader->batch_count; i++) {
+		struct xlog_reader_batch *batch = &reader->batches[i];
+		ZSTD_freeDStream(batch->zdctx);
+		free(batch->data);
+		free(batch->rows);
+		diag_destroy(&batch->diag);
+	}
+	free(reader->batches);
+	free(reader->ready);
+}
+
+int
+xlog_reader_open(struct xlog_reader *reader, const char *filename,
+		 bool force_recovery, int decode_threads)
+{
+	memset(reader, 0, sizeof(*reader));
+	snprintf(reader->filename, sizeof(reader->filename), "%s", filename);
+	reader->force_recovery = force_recovery;
+	reader->decode_threads = decode_threads;
+	reader->read_route[0].f = xlog_reader_batch_fill;
+	reader->read_route[0].pipe = NULL;
+	reader->ready_route[0].f = xlog_reader_batch_ready;
+	reader->ready_route[0].pipe = NULL;
+	fiber_cond_create(&reader->cond);
+	reader->batch_count = XLOG_READER_BATCH_COUNT + decode_threads;
+	reader->batches = calloc(reader->batch_count,
+				 sizeof(*reader->batches));
+	reader->ready = calloc(reader->batch_count, sizeof(*reader->ready));
+	if (reader->batches == NULL || reader->ready == NULL) {
+		diag_set(OutOfMemory,
+			 reader->batch_count * sizeof(*reader->batches),
+			 "calloc", "xlog reader batches");
+		goto fail;
+	}
+	for (int i = 0; i < reader->batch_count; i++) {
+		struct xlog_reader_batch *batch = &reader->batches[i];
+		batch->reader = reader;
+		diag_create(&batch->diag);
+		batch->zdctx = ZSTD_createDStream();
+		if (batch->zdctx == NULL) {
+			diag_set(ClientError, ER_DECOMPRESSION,
+				 "failed to create context");
+			goto fail;
+		}
+	}
+	if (cord_costart(&reader->cord, "xlog_reader",
+			 xlog_reader_f, reader) != 0)
+		goto fail;
+	cpipe_create(&reader->reader_pipe, "xlog_reader");
+	/*
+	 * Send all batches to the reader thread at once so
+	 * that it reads ahead while tx is applying rows.
+	 */
+	for (int i = 0; i < reader->batch_count; i++)
+		xlog_reader_batch_submit(&reader->batches[i]);
+	return 0;
+fail:
+	xlog_reader_free_batches(reader);
+	fiber_cond_destroy(&reader->cond);
+	return -1;
+}
+
+int
+xlog_reader_next(struct xlog_reader *reader, struct xrow_header **row)
+{
+	while (true) {
+		struct xlog_reader_batch *batch = reader->current;
+		if (batch != NULL) {
+			if (batch->row_pos < batch->row_count) {
+				*row = &batch->rows[batch->row_pos++];
+				return 0;
+			}
+			if (batch->rc != 0) {
+				if (batch->rc < 0)
+					diag_move(&batch->diag, diag_get());
+				return batch->rc;
+			}
+			/* All rows are consumed, refill the batch. */
+			reader->current = NULL;
+			xlog_reader_batch_submit(batch);
+		}
+		/* Batches may be decoded out of order. */
+		int slot = reader->next_seq % reader->batch_count;
+		while (reader->ready[slot] == NULL)
+			fiber_cond_wait(&reader->cond);
+		reader->current = reader->ready[slot];
+		reader->ready[slot] = NULL;
+		assert(reader->current->seq == reader->next_seq);
+		reader->next_seq++;
+	}
+}
+
+void
+xlog_reader_close(struct xlog_reader *reader)
+{
+	/*
+	 * Wait for batches that are being filled, because they
+	 * are going to be delivered to tx.
+	 */
+	while (reader->in_progress > 0)
+		fiber_cond_wait(&reader->cond);
+	/*
+	 * cord_cojoin() clears the diagnostics area, but the
+	 * caller may still need the error returned by
+	 * xlog_reader_next().
+	 */
+	struct diag diag;
+	diag_create(&diag);
+	diag_move(diag_get(), &diag);
+	cbus_stop_loop(&reader->reader_pipe);
+	cpipe_destroy(&reader->reader_pipe);
+	if (cord_cojoin(&reader->cord) != 0)
+		diag_log();
+	diag_move(&diag, diag_get());
+	diag_destroy(&diag);
+	xlog_reader_free_batches(reader);
+	fiber_cond_destroy(&reader->cond);
+}
@@ -0,0 +1,221 @@
+#ifndef TARANTOOL_BOX_XLOG_READER_H_INCLUDED
+#define TARANTOOL_BOX_XLOG_READER_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cbus.h"
+#include "diag.h"
+#include "fiber.h"
+#include "fiber_cond.h"
+#include "small/ibuf.h"
+#include "xlog.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct xrow_header;
+struct xlog_reader;
+
+enum {
+	/**
+	 * Number of row batches circulating between threads
+	 * in addition to those decoded in the worker pool.
+	 */
+	XLOG_READER_BATCH_COUNT = 4,
+	/** Max size of raw tx blocks read into a batch. */
+	XLOG_READER_BATCH_SIZE = 256 * 1024,
+};
+
+/**
+ * A batch of rows read from the file. The reader thread reads
+ * raw tx blocks into the batch, then they are decompressed and
+ * decoded, either in the reader thread or in the worker pool,
+ * and the batch is passed to tx, which consumes the rows.
+ */
+struct xlog_reader_batch {
+	/** Message used to send the batch between threads. */
+	struct cmsg base;
+	/** Reader this batch belongs to. */
+	struct xlog_reader *reader;
+	/**
+	 * Sequence number of the batch in the file. Batches
+	 * may be decoded out of order, but tx consumes them
+	 * in the order they were read.
+	 */
+	int64_t seq;
+	/**
+	 * Raw tx blocks read from the file. Owned by the reader
+	 * thread, because it uses the thread's slab cache.
+	 */
+	struct ibuf raw;
+	/** Decompression context. */
+	ZSTD_DStream *zdctx;
+	/**
+	 * Decompressed rows, which row bodies point to.
+	 * Allocated with malloc, because the batch may be
+	 * decoded by any thread.
+	 */
+	char *data;
+	/** Number of bytes used in the data buffer. */
+	size_t data_size;
+	/** Number of bytes allocated for the data buffer. */
+	size_t data_capacity;
+	/** Rows decoded from the batch. */
+	struct xrow_header *rows;
+	/** Number of rows stored in the batch. */
+	int row_count;
+	/** Number of rows allocated for the rows array. */
+	int row_capacity;
+	/** Position of the next row to return to tx. */
+	int row_pos;
+	/**
+	 * Status of the read following the last row in the
+	 * batch: 0 if there may be more rows in the file, 1 if
+	 * the end of the file was reached, -1 on error.
+	 */
+	int rc;
+	/** Error that stopped the reader if rc is -1. */
+	struct diag diag;
+};
+
+/**
+ * Xlog reader reads rows from an xlog file in a separate
+ * thread. The thread reads raw tx blocks from the file in
+ * batches. Tx blocks are compressed independently of each
+ * other, so batches are decompressed and decoded in parallel
+ * in the worker thread pool, while tx applies rows of the
+ * previous batches in the order they were read.
+ */
+struct xlog_reader {
+	/** Reader thread. */
+	struct cord cord;
+	/** Pipe from tx to the reader thread. */
+	struct cpipe reader_pipe;
+	/** Pipe from the reader thread to tx. */
+	struct cpipe tx_pipe;
+	/** Route of a batch to the reader thread. */
+	struct cmsg_hop read_route[1];
+	/** Route of a decoded batch back to tx. */
+	struct cmsg_hop ready_route[1];
+	/** Path to the file to read. */
+	char filename[PATH_MAX];
+	/** Skip broken rows and tx blocks if set. */
+	bool force_recovery;
+	/**
+	 * Max number of batches decoded in parallel in the
+	 * worker pool. If 0, the reader thread decodes batches
+	 * itself.
+	 */
+	int decode_threads;
+	/**
+	 * Cursor used to read the file. It may only be accessed
+	 * by the reader thread until the reader is closed.
+	 */
+	struct xlog_cursor cursor;
+	/**
+	 * Status of the last read done by the reader thread,
+	 * see xlog_reader_batch::rc. Once it's not 0, the
+	 * reader thread stops accessing the cursor.
+	 */
+	int cursor_rc;
+	/**
+	 * Sequence number of the next batch read from the file.
+	 * Accessed only by the reader thread.
+	 */
+	int64_t read_seq;
+	/** Batches of rows. */
+	struct xlog_reader_batch *batches;
+	/** Number of entries in the batches array. */
+	int batch_count;
+	/**
+	 * Decoded batches received by tx, indexed by sequence
+	 * number modulo batch_count. Since there are only so
+	 * many batches, the batches in flight never collide.
+	 */
+	struct xlog_reader_batch **ready;
+	/** Sequence number of the next batch to consume in tx. */
+	int64_t next_seq;
+	/** Batch rows are currently returned from. */
+	struct xlog_reader_batch *current;
+	/** Number of batches sent to the reader thread. */
+	int in_progress;
+	/** Signalled when a decoded batch is received by tx. */
+	struct fiber_cond cond;
+};
+
+/**
+ * Start a reader thread for the given xlog file. The file is
+ * opened by the reader thread, so a failure to open it is
+ * reported by the first xlog_reader_next() call. Up to
+ * decode_threads batches are decoded in parallel in the
+ * worker pool.
+ *
+ * Returns 0 on success, -1 on failure (diag is set).
+ */
+int
+xlog_reader_open(struct xlog_reader *reader, const char *filename,
+		 bool force_recovery, int decode_threads);
+
+/**
+ * Get the next row read from the file. Yields while waiting
+ * for the reader thread. The row stays valid until the next
+ * call to this function.
+ *
+ * Returns 0 on success, 1 on EOF, -1 on error (diag is set).
+ */
+int
+xlog_reader_next(struct xlog_reader *reader, struct xrow_header **row);
+
+/**
+ * Stop the reader thread and close the file.
+ */
+void
+xlog_reader_close(struct xlog_reader *reader);
+
+/**
+ * Return true if the reader has reached the EOF marker of the
+ * file. May only be called after the reader is closed.
+ */
+static inline bool
+xlog_reader_is_eof(struct xlog_reader *reader)
+{
+	return xlog_cursor_is_eof(&reader->cursor);
+}
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_XLOG_READER_H_INCLUDED */
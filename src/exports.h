@@ -20,6 +20,7 @@ EXPORT(box_error_type)
 EXPORT(box_index_bsize)
 EXPORT(box_index_count)
 EXPORT(box_index_get)
+EXPORT(box_index_get_many)
 EXPORT(box_index_id_by_name)
 EXPORT(box_index_iterator)
 EXPORT(box_index_len)
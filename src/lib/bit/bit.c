@@ -118,6 +118,9 @@ bswap_u32(uint32_t x);
 extern inline uint64_t
 bswap_u64(uint64_t x);
 
+extern inline int
+bytes_compare(const char *a, uint32_t size_a, const char *b, uint32_t size_b);
+
 #define BITINDEX_NAIVE(type, x, bitsize) {				\
 	/* naive generic implementation, worst case */			\
 	type bit = 1;							\
@@ -520,6 +520,58 @@ bswap_u64(uint64_t x)
 #endif
 }
 
+/**
+ * Max length of a common prefix of two byte strings that is
+ * compared by bytes_compare() a word at a time. Longer strings
+ * are passed to memcmp(), which is vectorized by the C library.
+ */
+enum { BYTES_COMPARE_WORD_MAX = 32 };
+
+/**
+ * @brief Compare two byte strings: bytewise as memcmp() does,
+ * then by length. Typical keys are short, so instead of calling
+ * memcmp() they are compared in 8-byte words loaded in big-endian
+ * order, so that an unsigned comparison of words gives the same
+ * result as a bytewise comparison. The tail is compared with
+ * a word that overlaps the previous one, which is fine, because
+ * the overlapping bytes are equal.
+ * @param a first string
+ * @param size_a length of the first string
+ * @param b second string
+ * @param size_b length of the second string
+ * @retval <0, 0, >0 if @a a is less than, equal to or greater
+ * than @a b
+ */
+inline int
+bytes_compare(const char *a, uint32_t size_a, const char *b, uint32_t size_b)
+{
+	uint32_t size = MIN(size_a, size_b);
+	if (size < sizeof(uint64_t) || size > BYTES_COMPARE_WORD_MAX) {
+		int r = memcmp(a, b, size);
+		if (r != 0)
+			return r;
+		return COMPARE_RESULT(size_a, size_b);
+	}
+	uint32_t offset = 0;
+	while (true) {
+		if (offset + sizeof(uint64_t) > size)
+			offset = size - sizeof(uint64_t);
+		uint64_t word_a = load_u64(a + offset);
+		uint64_t word_b = load_u64(b + offset);
+		if (word_a != word_b) {
+#if !defined(HAVE_BYTE_ORDER_BIG_ENDIAN)
+			word_a = bswap_u64(word_a);
+			word_b = bswap_u64(word_b);
+#endif
+			return word_a < word_b ? -1 : 1;
+		}
+		offset += sizeof(uint64_t);
+		if (offset >= size)
+			break;
+	}
+	return COMPARE_RESULT(size_a, size_b);
+}
+
 /**
  * @brief Index bits in the @a x, i.e. find all positions where bits are set.
  * This method fills @a indexes array with found positions in increasing order.
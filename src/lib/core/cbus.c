@@ -31,9 +31,22 @@
 #include "cbus.h"
 
 #include <limits.h>
+#include <unistd.h>
+#include <pmatomic.h>
 #include "fiber.h"
 #include "trigger.h"
 
+enum {
+	/**
+	 * Bounds of cbus_endpoint::spin_budget. The lower
+	 * bound is low enough to be negligible when messages
+	 * are rare, the upper one caps the time a consumer may
+	 * burn waiting for a message to microseconds.
+	 */
+	CBUS_SPIN_MIN = 16,
+	CBUS_SPIN_MAX = 1024,
+};
+
 /**
  * Cord interconnect.
  */
@@ -46,6 +59,12 @@ struct cbus {
 	pthread_cond_t cond;
 	/** Connected endpoints */
 	struct rlist endpoints;
+	/**
+	 * Whether consumers should busy-poll their queues.
+	 * Spinning is pointless on a single CPU, since it
+	 * only delays the producer.
+	 */
+	bool spin_enabled;
 };
 
 /** A singleton for all cords. */
@@ -87,6 +106,105 @@ static void
 cpipe_flush_cb(ev_loop * /* loop */, struct ev_async *watcher,
 	       int /* events */);
 
+/** Hint the CPU that we are in a busy-wait loop. */
+static inline void
+cbus_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+/**
+ * Push a batch of messages to the endpoint queue. Never blocks:
+ * the batch is linked in reverse order and attached to the top
+ * of the queue stack with a single compare-and-swap. Empties
+ * the batch.
+ *
+ * @retval true if the queue was empty, i.e. the consumer may be
+ *         sleeping and needs to be woken up.
+ */
+static bool
+cbus_endpoint_push(struct cbus_endpoint *endpoint, struct stailq *batch)
+{
+	assert(!stailq_empty(batch));
+	struct stailq_entry *last = batch->first;
+	struct stailq_entry *first = NULL;
+	struct stailq_entry *item = batch->first;
+	while (item != NULL) {
+		struct stailq_entry *next = item->next;
+		item->next = first;
+		first = item;
+		item = next;
+	}
+	stailq_create(batch);
+
+	struct stailq_entry *top = pm_atomic_load_explicit(&endpoint->output,
+						pm_memory_order_relaxed);
+	do {
+		last->next = top;
+	} while (!pm_atomic_compare_exchange_weak(&endpoint->output,
+						  &top, first));
+	return top == NULL;
+}
+
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
+{
+	struct stailq_entry *item = pm_atomic_exchange(&endpoint->output,
+						       NULL);
+	/* Reverse the stack back to the order of arrival. */
+	struct stailq batch;
+	stailq_create(&batch);
+	while (item != NULL) {
+		struct stailq_entry *next = item->next;
+		stailq_add(&batch, item);
+		item = next;
+	}
+	stailq_concat(output, &batch);
+}
+
+/**
+ * Busy-poll the endpoint queue for a while. Producers don't
+ * wake up the consumer while it's polling, see cpipe_flush_cb().
+ * @retval true if a message arrived.
+ */
+static bool
+cbus_endpoint_spin(struct cbus_endpoint *endpoint)
+{
+	int budget = endpoint->spin_budget;
+	if (budget == 0)
+		return false;
+	pm_atomic_store(&endpoint->is_polling, true);
+	bool found = false;
+	for (int i = 0; i < budget && !found; i++) {
+		found = pm_atomic_load_explicit(&endpoint->output,
+						pm_memory_order_relaxed) != NULL;
+		if (!found)
+			cbus_cpu_relax();
+	}
+	pm_atomic_store(&endpoint->is_polling, false);
+	/*
+	 * A producer that pushed after the last check could have
+	 * skipped the wakeup, because we were still polling, so
+	 * check the queue once again after clearing the flag.
+	 * Both this store-load pair and the push-load pair in
+	 * cpipe_flush_cb() are sequentially consistent, so either
+	 * the producer sees the flag cleared or we see the message.
+	 */
+	if (!found)
+		found = pm_atomic_load(&endpoint->output) != NULL;
+	if (found) {
+		/* Spinning paid off, allow more next time. */
+		endpoint->spin_budget = MIN(budget * 2, CBUS_SPIN_MAX);
+	} else {
+		endpoint->spin_budget = MAX(budget / 2, CBUS_SPIN_MIN);
+	}
+	return found;
+}
+
 void
 cpipe_create(struct cpipe *pipe, const char *consumer)
 {
@@ -156,11 +274,11 @@ cpipe_destroy(struct cpipe *pipe)
 	 * delivered.
 	 */
 	tt_pthread_mutex_lock(&endpoint->mutex);
+	/* Add the pipe shutdown message as the last one. */
+	stailq_add_tail_entry(&pipe->input, poison, msg.fifo);
 	/* Flush input */
-	stailq_concat(&endpoint->output, &pipe->input);
+	cbus_endpoint_push(endpoint, &pipe->input);
 	pipe->n_input = 0;
-	/* Add the pipe shutdown message as the last one. */
-	stailq_add_tail_entry(&endpoint->output, poison, msg.fifo);
 	/* Count statistics */
 	rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
 	/*
@@ -190,6 +308,8 @@ cbus_create(struct cbus *bus)
 	(void) tt_pthread_cond_init(&bus->cond, NULL);
 
 	rlist_create(&bus->endpoints);
+
+	bus->spin_enabled = sysconf(_SC_NPROCESSORS_ONLN) > 1;
 }
 
 static void
@@ -227,7 +347,9 @@ cbus_endpoint_create(struct cbus_endpoint *endpoint, const char *name,
 	endpoint->n_pipes = 0;
 	fiber_cond_create(&endpoint->cond);
 	tt_pthread_mutex_init(&endpoint->mutex, NULL);
-	stailq_create(&endpoint->output);
+	endpoint->output = NULL;
+	endpoint->spin_budget = cbus.spin_enabled ? CBUS_SPIN_MIN : 0;
+	endpoint->is_polling = false;
 	ev_async_init(&endpoint->async,
 		      (void (*)(ev_loop *, struct ev_async *, int)) fetch_cb);
 	endpoint->async.data = fetch_data;
@@ -261,14 +383,15 @@ cbus_endpoint_destroy(struct cbus_endpoint *endpoint,
 	while (true) {
 		if (process_cb)
 			process_cb(endpoint);
-		if (endpoint->n_pipes == 0 && stailq_empty(&endpoint->output))
+		if (endpoint->n_pipes == 0 &&
+		    pm_atomic_load(&endpoint->output) == NULL)
 			break;
 		 fiber_cond_wait(&endpoint->cond);
 	}
 
 	/*
-	 * Pipe flush func can still lock mutex, so just lock and unlock
-	 * it.
+	 * Pipe destroy func can still lock mutex, so just lock and
+	 * unlock it.
 	 */
 	tt_pthread_mutex_lock(&endpoint->mutex);
 	tt_pthread_mutex_unlock(&endpoint->mutex);
@@ -304,14 +427,15 @@ cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 	int old_cancel_state;
 	tt_pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancel_state);
 
-	tt_pthread_mutex_lock(&endpoint->mutex);
-	output_was_empty = stailq_empty(&endpoint->output);
 	/** Flush input */
-	stailq_concat(&endpoint->output, &pipe->input);
-	tt_pthread_mutex_unlock(&endpoint->mutex);
+	output_was_empty = cbus_endpoint_push(endpoint, &pipe->input);
 
 	pipe->n_input = 0;
-	if (output_was_empty) {
+	/*
+	 * The consumer busy-polling the queue will notice the
+	 * messages without a wakeup, see cbus_endpoint_spin().
+	 */
+	if (output_was_empty && !pm_atomic_load(&endpoint->is_polling)) {
 		/* Count statistics */
 		rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
 
@@ -664,6 +788,14 @@ cbus_loop(struct cbus_endpoint *endpoint)
 		cbus_process(endpoint);
 		if (fiber_is_cancelled())
 			break;
+		if (cbus_endpoint_spin(endpoint)) {
+			/*
+			 * Let other fibers of the cord run, but
+			 * don't sleep waiting for a wakeup.
+			 */
+			fiber_reschedule();
+			continue;
+		}
 		fiber_yield();
 	}
 }
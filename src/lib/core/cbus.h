@@ -118,7 +118,8 @@ struct cpipe {
 	/**
 	 * When pushing messages, keep the staged input size under
 	 * this limit (speeds up message delivery and reduces
-	 * latency, while still keeping the bus mutex cold enough).
+	 * latency, while still keeping the endpoint queue cold
+	 * enough).
 	 */
 	int max_input;
 	/**
@@ -166,7 +167,7 @@ cpipe_destroy(struct cpipe *pipe);
  * Otherwise, the messages flushed once per event loop iteration.
  *
  * @todo: collect bus stats per second and adjust max_input once
- * a second to keep the mutex cold regardless of the message load,
+ * a second to keep the queue cold regardless of the message load,
  * while still keeping the latency low if there are few
  * long-to-process messages.
  */
@@ -255,10 +256,31 @@ struct cbus_endpoint {
 	char name[FIBER_NAME_MAX];
 	/** Member of cbus->endpoints */
 	struct rlist in_cbus;
-	/** The lock around the pipe. */
+	/**
+	 * The lock serializing pipe destruction with endpoint
+	 * destruction. Message delivery doesn't take it.
+	 */
 	pthread_mutex_t mutex;
-	/** A queue with incoming messages. */
-	struct stailq output;
+	/**
+	 * Incoming messages: a lock-free stack, which producers
+	 * push whole batches to and the consumer drains at once.
+	 * A batch is pushed in reverse order, so reversing the
+	 * whole stack on fetch restores the FIFO order.
+	 */
+	struct stailq_entry *output;
+	/**
+	 * How many times the consumer polls the queue before
+	 * going to sleep in the event loop. Adapts to the load:
+	 * doubles when polling catches a message and halves
+	 * when it doesn't.
+	 */
+	int spin_budget;
+	/**
+	 * Set while the consumer is busy-polling the queue.
+	 * Producers don't wake up a polling consumer, which
+	 * saves them an eventfd write per flush.
+	 */
+	bool is_polling;
 	/** Consumer cord loop */
 	ev_loop *consumer;
 	/** Async to notify the consumer */
@@ -272,13 +294,8 @@ struct cbus_endpoint {
 /**
  * Fetch incomming messages to output
  */
-static inline void
-cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
-{
-	tt_pthread_mutex_lock(&endpoint->mutex);
-	stailq_concat(output, &endpoint->output);
-	tt_pthread_mutex_unlock(&endpoint->mutex);
-}
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output);
 
 /** Initialize the global singleton bus. */
 void
@@ -306,7 +323,10 @@ cbus_process(struct cbus_endpoint *endpoint);
 
 /**
  * Run the message delivery loop until the current fiber is
- * cancelled.
+ * cancelled. When the queue is drained, the loop busy-polls
+ * it for a while before going to sleep, which saves the
+ * producer an eventfd write and the consumer a wakeup under
+ * a steady message flow.
  */
 void
 cbus_loop(struct cbus_endpoint *endpoint);
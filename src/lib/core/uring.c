@@ -0,0 +1,461 @@
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "uring.h"
+
+#include "trivia/config.h"
+#include "trivia/util.h"
+#include "diag.h"
+
+#if defined(HAVE_LIBURING)
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <liburing.h>
+
+#include "fiber.h"
+#include "say.h"
+
+/** Completion of a single io_uring request. */
+struct uring_op {
+	/** Fiber to wake up on completion, NULL in blocking mode. */
+	struct fiber *fiber;
+	/** Request result: -errno on failure. */
+	int res;
+	/** Set when the request completes. */
+	bool is_done;
+};
+
+/** io_uring instance of a cord. */
+struct uring {
+	struct io_uring ring;
+	/** See uring_init(). */
+	bool is_async;
+	/** Number of prepared, but not yet submitted requests. */
+	unsigned unsubmitted;
+	/** Eventfd signalled on completion (async mode only). */
+	int efd;
+	/** Reaps completions when the eventfd is signalled. */
+	struct ev_io efd_watcher;
+	/** Submits batched requests before the event loop blocks. */
+	struct ev_prepare submit_watcher;
+};
+
+enum {
+	/** Max number of iovecs submitted with one write request. */
+	URING_IOV_MAX = 64,
+};
+
+static __thread struct uring *uring;
+
+bool
+uring_is_supported(void)
+{
+	/* 0 - unknown, 1 - supported, -1 - not supported. */
+	static int is_supported = 0;
+	if (is_supported != 0)
+		return is_supported > 0;
+	struct io_uring ring;
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	is_supported = -1;
+	if (io_uring_queue_init_params(1, &ring, &params) != 0)
+		return false;
+	/*
+	 * Writes at the current file position are needed by
+	 * xlog, which relies on the file position.
+	 */
+	if ((params.features & IORING_FEAT_RW_CUR_POS) != 0 &&
+	    (params.features & IORING_FEAT_NODROP) != 0)
+		is_supported = 1;
+	io_uring_queue_exit(&ring);
+	return is_supported > 0;
+}
+
+static void
+uring_op_create(struct uring_op *op, struct uring *u)
+{
+	op->fiber = u->is_async ? fiber() : NULL;
+	op->res = 0;
+	op->is_done = false;
+}
+
+/** Process completed requests, wake up waiting fibers. */
+static void
+uring_reap(struct uring *u)
+{
+	struct io_uring_cqe *cqe;
+	while (io_uring_peek_cqe(&u->ring, &cqe) == 0) {
+		struct uring_op *op = io_uring_cqe_get_data(cqe);
+		op->res = cqe->res;
+		op->is_done = true;
+		io_uring_cqe_seen(&u->ring, cqe);
+		if (op->fiber != NULL)
+			fiber_wakeup(op->fiber);
+	}
+}
+
+/** Submit all prepared requests to the kernel. */
+static void
+uring_submit(struct uring *u)
+{
+	while (u->unsubmitted > 0) {
+		int rc = io_uring_submit(&u->ring);
+		if (rc >= 0) {
+			u->unsubmitted -= MIN((unsigned)rc, u->unsubmitted);
+			continue;
+		}
+		if (rc == -EBUSY || rc == -EAGAIN) {
+			/* Completion queue is full, make room. */
+			uring_reap(u);
+		} else if (rc != -EINTR) {
+			errno = -rc;
+			panic_syserror("io_uring_submit");
+		}
+	}
+}
+
+/**
+ * Make sure the submission queue has room for @a count
+ * requests so that linked requests get submitted together.
+ */
+static void
+uring_reserve(struct uring *u, unsigned count)
+{
+	if (io_uring_sq_space_left(&u->ring) < count)
+		uring_submit(u);
+}
+
+static struct io_uring_sqe *
+uring_get_sqe(struct uring *u, struct uring_op *op)
+{
+	struct io_uring_sqe *sqe = io_uring_get_sqe(&u->ring);
+	assert(sqe != NULL);
+	io_uring_sqe_set_data(sqe, op);
+	u->unsubmitted++;
+	return sqe;
+}
+
+/** Wait for a request to complete. */
+static void
+uring_wait(struct uring *u, struct uring_op *op)
+{
+	if (u->is_async) {
+		/*
+		 * The request is submitted by the prepare watcher.
+		 * It may not be abandoned, because the kernel is
+		 * going to access the buffers, so ignore spurious
+		 * wakeups and cancellation.
+		 */
+		while (!op->is_done)
+			fiber_yield();
+		return;
+	}
+	uring_submit(u);
+	while (!op->is_done) {
+		struct io_uring_cqe *cqe;
+		int rc = io_uring_wait_cqe(&u->ring, &cqe);
+		if (rc != 0 && rc != -EINTR) {
+			errno = -rc;
+			panic_syserror("io_uring_wait_cqe");
+		}
+		uring_reap(u);
+	}
+}
+
+static void
+uring_efd_cb(ev_loop *loop, struct ev_io *watcher, int events)
+{
+	(void)loop;
+	(void)events;
+	struct uring *u = watcher->data;
+	eventfd_t value;
+	(void)eventfd_read(u->efd, &value);
+	uring_reap(u);
+}
+
+static void
+uring_submit_cb(ev_loop *loop, struct ev_prepare *watcher, int events)
+{
+	(void)loop;
+	(void)events;
+	uring_submit(watcher->data);
+}
+
+int
+uring_init(unsigned entries, bool is_async)
+{
+	assert(uring == NULL);
+	if (!uring_is_supported()) {
+		diag_set(IllegalParams, "io_uring is not supported");
+		return -1;
+	}
+	struct uring *u = malloc(sizeof(*u));
+	if (u == NULL) {
+		diag_set(OutOfMemory, sizeof(*u), "malloc", "struct uring");
+		return -1;
+	}
+	int rc = io_uring_queue_init(entries, &u->ring, 0);
+	if (rc != 0) {
+		errno = -rc;
+		diag_set(SystemError, "failed to create io_uring");
+		free(u);
+		return -1;
+	}
+	u->is_async = is_async;
+	u->unsubmitted = 0;
+	u->efd = -1;
+	if (is_async) {
+		u->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (u->efd < 0) {
+			diag_set(SystemError, "failed to create eventfd");
+			goto fail;
+		}
+		rc = io_uring_register_eventfd(&u->ring, u->efd);
+		if (rc != 0) {
+			errno = -rc;
+			diag_set(SystemError, "failed to register eventfd");
+			goto fail;
+		}
+		ev_io_init(&u->efd_watcher, uring_efd_cb, u->efd, EV_READ);
+		u->efd_watcher.data = u;
+		ev_io_start(loop(), &u->efd_watcher);
+		ev_prepare_init(&u->submit_watcher, uring_submit_cb);
+		u->submit_watcher.data = u;
+		ev_prepare_start(loop(), &u->submit_watcher);
+	}
+	uring = u;
+	return 0;
+fail:
+	if (u->efd >= 0)
+		close(u->efd);
+	io_uring_queue_exit(&u->ring);
+	free(u);
+	return -1;
+}
+
+void
+uring_free(void)
+{
+	struct uring *u = uring;
+	if (u == NULL)
+		return;
+	assert(u->unsubmitted == 0);
+	if (u->is_async) {
+		ev_prepare_stop(loop(), &u->submit_watcher);
+		ev_io_stop(loop(), &u->efd_watcher);
+		close(u->efd);
+	}
+	io_uring_queue_exit(&u->ring);
+	free(u);
+	uring = NULL;
+}
+
+bool
+uring_is_enabled(void)
+{
+	return uring != NULL;
+}
+
+ssize_t
+uring_pread(int fd, void *buf, size_t count, off_t offset)
+{
+	struct uring *u = uring;
+	assert(u != NULL);
+	assert(!u->is_async || fiber() != &cord()->sched);
+	size_t n = 0;
+	do {
+		struct uring_op op;
+		uring_op_create(&op, u);
+		struct io_uring_sqe *sqe;
+		uring_reserve(u, 1);
+		sqe = uring_get_sqe(u, &op);
+		io_uring_prep_read(sqe, fd, (char *)buf + n, count - n,
+				   offset + n);
+		uring_wait(u, &op);
+		if (op.res < 0) {
+			if (op.res == -EINTR || op.res == -EAGAIN)
+				continue;
+			errno = -op.res;
+			say_syserror("io_uring read, fd=%d", fd);
+			return -1;
+		} else if (op.res == 0) {
+			break; /* EOF */
+		}
+		n += op.res;
+	} while (n < count);
+	assert(n <= count);
+	return n;
+}
+
+ssize_t
+uring_writevn(int fd, const struct iovec *iov, int iovcnt, bool sync)
+{
+	struct uring *u = uring;
+	assert(u != NULL);
+	assert(!u->is_async || fiber() != &cord()->sched);
+	assert(iov != NULL && iovcnt >= 0);
+	ssize_t nwr = 0;
+	/* Index of the first iovec and the part of it written so far. */
+	int pos = 0;
+	size_t skip = 0;
+	while (true) {
+		struct iovec vec[URING_IOV_MAX];
+		int cnt = 0;
+		for (int i = pos; i < iovcnt && cnt < URING_IOV_MAX; i++) {
+			vec[cnt] = iov[i];
+			if (i == pos) {
+				vec[cnt].iov_base = (char *)iov[i].iov_base + skip;
+				vec[cnt].iov_len -= skip;
+			}
+			cnt++;
+		}
+		/*
+		 * Link the sync to the write only if the rest of
+		 * the vector fits in one request.
+		 */
+		bool do_sync = sync && pos + cnt == iovcnt;
+		if (cnt == 0 && !do_sync)
+			break;
+		struct uring_op write_op, sync_op;
+		uring_op_create(&write_op, u);
+		uring_op_create(&sync_op, u);
+		uring_reserve(u, 2);
+		struct io_uring_sqe *sqe;
+		if (cnt > 0) {
+			sqe = uring_get_sqe(u, &write_op);
+			/* Offset -1 means the current file position. */
+			io_uring_prep_writev(sqe, fd, vec, cnt, -1);
+			if (do_sync)
+				sqe->flags |= IOSQE_IO_LINK;
+		} else {
+			write_op.is_done = true;
+		}
+		if (do_sync) {
+			sqe = uring_get_sqe(u, &sync_op);
+			io_uring_prep_fsync(sqe, fd, IORING_FSYNC_DATASYNC);
+		} else {
+			sync_op.is_done = true;
+		}
+		uring_wait(u, &write_op);
+		uring_wait(u, &sync_op);
+		if (write_op.res < 0) {
+			if (write_op.res == -EINTR || write_op.res == -EAGAIN)
+				continue;
+			errno = -write_op.res;
+			say_syserror("io_uring writev, fd=%d", fd);
+			return -1;
+		}
+		/* Advance the position past the written data. */
+		size_t written = write_op.res;
+		nwr += written;
+		written += skip;
+		while (pos < iovcnt && written >= iov[pos].iov_len) {
+			written -= iov[pos].iov_len;
+			pos++;
+		}
+		skip = written;
+		if (!do_sync)
+			continue;
+		/*
+		 * A short write breaks the link, in which case
+		 * the sync is cancelled and needs to be resubmitted
+		 * after the rest of the data.
+		 */
+		if (sync_op.res == -ECANCELED && pos < iovcnt)
+			continue;
+		if (sync_op.res < 0) {
+			errno = -sync_op.res;
+			say_syserror("io_uring fdatasync, fd=%d", fd);
+			return -1;
+		}
+		break;
+	}
+	return nwr;
+}
+
+#else /* !defined(HAVE_LIBURING) */
+
+#include <errno.h>
+
+bool
+uring_is_supported(void)
+{
+	return false;
+}
+
+int
+uring_init(unsigned entries, bool is_async)
+{
+	(void)entries;
+	(void)is_async;
+	diag_set(IllegalParams, "io_uring is not supported");
+	return -1;
+}
+
+void
+uring_free(void)
+{
+}
+
+bool
+uring_is_enabled(void)
+{
+	return false;
+}
+
+ssize_t
+uring_pread(int fd, void *buf, size_t count, off_t offset)
+{
+	(void)fd;
+	(void)buf;
+	(void)count;
+	(void)offset;
+	unreachable();
+	errno = ENOSYS;
+	return -1;
+}
+
+ssize_t
+uring_writevn(int fd, const struct iovec *iov, int iovcnt, bool sync)
+{
+	(void)fd;
+	(void)iov;
+	(void)iovcnt;
+	(void)sync;
+	unreachable();
+	errno = ENOSYS;
+	return -1;
+}
+
+#endif /* defined(HAVE_LIBURING) */
@@ -0,0 +1,124 @@
+#ifndef TARANTOOL_LIB_CORE_URING_H_INCLUDED
+#define TARANTOOL_LIB_CORE_URING_H_INCLUDED
+/*
+ * Copyright 2010-2020, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * File I/O via Linux io_uring.
+ *
+ * Every cord that wants to use io_uring creates its own ring
+ * with uring_init(). A ring works in one of two modes:
+ *
+ * - Asynchronous: the fiber issuing a request yields until the
+ *   request completes, letting other fibers of the cord run.
+ *   Requests issued by different fibers during the same event
+ *   loop iteration are submitted to the kernel in one batch.
+ *   Completions are delivered via an eventfd watched by the
+ *   cord event loop. Must not be used from the scheduler fiber.
+ *
+ * - Blocking: the calling thread waits for the request
+ *   completion. This still allows to submit several linked
+ *   requests, e.g. a write and a sync, with one system call.
+ *
+ * Like fio, the I/O functions return -1 and set errno on
+ * failure, but don't touch the diagnostics area. None of them
+ * supports cancellation.
+ *
+ * If Tarantool is built without liburing, uring_init() always
+ * fails.
+ */
+
+/**
+ * Return true if io_uring can be used, i.e. Tarantool is built
+ * with liburing and the kernel supports all the features we
+ * need.
+ */
+bool
+uring_is_supported(void);
+
+/**
+ * Create an io_uring instance for the current cord.
+ *
+ * @param entries     Submission queue size.
+ * @param is_async    Yield the calling fiber rather than block
+ *                    the thread while waiting for completion.
+ *
+ * @retval  0 success
+ * @retval -1 error, check diag
+ */
+int
+uring_init(unsigned entries, bool is_async);
+
+/**
+ * Destroy the io_uring instance of the current cord.
+ * There must be no requests in flight.
+ */
+void
+uring_free(void);
+
+/** Return true if the current cord has an io_uring instance. */
+bool
+uring_is_enabled(void);
+
+/**
+ * pread(2) via io_uring.
+ * Returns the number of bytes read, which may be less than
+ * requested on EOF.
+ */
+ssize_t
+uring_pread(int fd, void *buf, size_t count, off_t offset);
+
+/**
+ * Write all data from the given vector at the current file
+ * position and advance it, like fio_writevn().
+ *
+ * If @a sync is set, the data is also synced with fdatasync,
+ * which is linked to the write so that both are submitted to
+ * the kernel at once. If the sync fails, the function fails,
+ * although the data may have been written.
+ *
+ * Returns the number of bytes written.
+ */
+ssize_t
+uring_writevn(int fd, const struct iovec *iov, int iovcnt, bool sync);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_LIB_CORE_URING_H_INCLUDED */
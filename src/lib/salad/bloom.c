@@ -39,6 +39,53 @@
 #include <assert.h>
 #include <string.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+bloom_split_maybe_has_f bloom_split_maybe_has = bloom_split_maybe_has_generic;
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * Lookup in a split block bloom filter that tests all words of
+ * a block at once. It is compiled for AVX2 regardless of build
+ * flags, so it may only be called if the CPU supports AVX2.
+ */
+__attribute__((target("avx2"))) static bool
+bloom_split_maybe_has_avx2(const struct bloom *bloom, bloom_hash_t hash)
+{
+	const struct bloom_split_block *block =
+		&bloom->split_table[bloom_split_pos(bloom, hash)];
+	__m256i salt = _mm256_loadu_si256((const __m256i *)bloom_split_salt);
+	__m256i key = _mm256_set1_epi32(bloom_split_key(hash));
+	__m256i bit_no = _mm256_srli_epi32(_mm256_mullo_epi32(key, salt), 27);
+	__m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), bit_no);
+	/* Clear bits in words not used by the value, see bloom_split_mask */
+	__m256i word_no = _mm256_sub_epi32(_mm256_setr_epi32(0, 1, 2, 3,
+							     4, 5, 6, 7),
+				_mm256_set1_epi32(hash % BLOOM_SPLIT_WORDS));
+	word_no = _mm256_and_si256(word_no,
+				   _mm256_set1_epi32(BLOOM_SPLIT_WORDS - 1));
+	mask = _mm256_and_si256(mask, _mm256_cmpgt_epi32(
+		_mm256_set1_epi32(bloom->hash_count), word_no));
+	/* The table is cache line aligned, see bloom_create_split */
+	__m256i bits = _mm256_load_si256((const __m256i *)block->words);
+	return _mm256_testc_si256(bits, mask);
+}
+
+#endif /* defined(__x86_64__) || defined(__i386__) */
+
+void
+bloom_init(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		bloom_split_maybe_has = bloom_split_maybe_has_avx2;
+#endif
+}
+
 int
 bloom_create(struct bloom *bloom, uint32_t number_of_values,
 	     double false_positive_rate)
@@ -55,6 +102,68 @@ bloom_create(struct bloom *bloom, uint32_t number_of_values,
 
 	bloom->table_size = block_count;
 	bloom->hash_count = hash_count;
+	bloom->type = BLOOM_CLASSIC;
+	return 0;
+}
+
+/**
+ * Return the size of a block of the given bloom filter, in bytes.
+ */
+static size_t
+bloom_block_size(const struct bloom *bloom)
+{
+	return bloom->type == BLOOM_SPLIT ? sizeof(struct bloom_split_block) :
+	       sizeof(struct bloom_block);
+}
+
+/**
+ * Allocate a cache line aligned table for a split block bloom
+ * filter so that a block never spans two cache lines.
+ */
+static struct bloom_split_block *
+bloom_split_table_new(uint32_t block_count)
+{
+	void *table;
+	size_t size = block_count * sizeof(struct bloom_split_block);
+	if (posix_memalign(&table, BLOOM_CACHE_LINE, size) != 0)
+		return NULL;
+	return table;
+}
+
+int
+bloom_create_split(struct bloom *bloom, uint32_t number_of_values,
+		   double false_positive_rate)
+{
+	uint16_t hash_count = ceil(log(false_positive_rate) / log(0.5));
+	uint64_t bit_count;
+	if (hash_count <= BLOOM_SPLIT_WORDS) {
+		/* Same optimal bit count as for classic bloom filter */
+		bit_count = ceil(number_of_values * hash_count / log(2));
+	} else {
+		/*
+		 * A value can't set more bits than there are words
+		 * in a block, so use more bits per value instead:
+		 * (1 - exp(-k * n / m)) ** k = fpr, solved for m.
+		 */
+		hash_count = BLOOM_SPLIT_WORDS;
+		bit_count = ceil(-(double)number_of_values * hash_count /
+				 log(1 - pow(false_positive_rate,
+					     1.0 / hash_count)));
+	}
+	uint32_t block_bits = CHAR_BIT * sizeof(struct bloom_split_block);
+	uint32_t block_count = (bit_count + block_bits - 1) / block_bits;
+	if (block_count == 0)
+		block_count = 1;
+
+	bloom->split_table = bloom_split_table_new(block_count);
+	if (bloom->split_table == NULL)
+		return -1;
+	memset(bloom->split_table, 0,
+	       block_count * sizeof(struct bloom_split_block));
+
+	bloom->table_size = block_count;
+	bloom->hash_count = hash_count;
+	bloom->type = BLOOM_SPLIT;
 	return 0;
 }
 
@@ -70,7 +179,7 @@ bloom_fpr(const struct bloom *bloom, uint32_t number_of_values)
 	/* Number of hash functions. */
 	uint16_t k = bloom->hash_count;
 	/* Number of bits. */
-	uint64_t m = bloom->table_size * sizeof(struct bloom_block) * CHAR_BIT;
+	uint64_t m = bloom->table_size * bloom_block_size(bloom) * CHAR_BIT;
 	/* Number of elements. */
 	uint32_t n = number_of_values;
 	/* False positive rate. */
@@ -80,7 +189,7 @@ bloom_fpr(const struct bloom *bloom, uint32_t number_of_values)
 size_t
 bloom_store_size(const struct bloom *bloom)
 {
-	return bloom->table_size * sizeof(struct bloom_block);
+	return bloom->table_size * bloom_block_size(bloom);
 }
 
 char *
@@ -94,8 +203,11 @@ bloom_store(const struct bloom *bloom, char *table)
 int
 bloom_load_table(struct bloom *bloom, const char *table)
 {
-	size_t size = bloom->table_size * sizeof(struct bloom_block);
-	bloom->table = malloc(size);
+	size_t size = bloom_store_size(bloom);
+	if (bloom->type == BLOOM_SPLIT)
+		bloom->split_table = bloom_split_table_new(bloom->table_size);
+	else
+		bloom->table = malloc(size);
 	if (bloom->table == NULL)
 		return -1;
 	memcpy(bloom->table, table, size);
@@ -41,6 +41,10 @@
  *  "Less Hashing, Same Performance: Building a Better Bloom Filter"
  *   https://www.eecs.harvard.edu/~michaelm/postscripts/tr-02-05.pdf
  * 3) Using only one hash value that is splitted into several independent parts
+ * 4) Split block layout, where a value sets at most one bit in each word
+ *  of a block, so that a lookup is a few SIMD instructions:
+ *  Apache Parquet, "Split Block Bloom Filter"
+ *  https://github.com/apache/parquet-format/blob/master/BloomFilter.md
  */
 
 #include <stdint.h>
@@ -56,10 +60,28 @@ extern "C" {
 enum {
 	/* Expected cache line of target processor */
 	BLOOM_CACHE_LINE = 64,
+	/* Number of words in a block of split block bloom filter */
+	BLOOM_SPLIT_WORDS = 8,
 };
 
 typedef uint32_t bloom_hash_t;
 
+/**
+ * Bloom filter table layout
+ */
+enum bloom_type {
+	/*
+	 * hash_count bits are set in a cache-line-size block,
+	 * one after another, see bloom_create()
+	 */
+	BLOOM_CLASSIC,
+	/*
+	 * hash_count bits are set in a 256-bit block, each in
+	 * a separate 32-bit word, see bloom_create_split()
+	 */
+	BLOOM_SPLIT,
+};
+
 /**
  * Cache-line-size block of bloom filter
  */
@@ -67,6 +89,13 @@ struct bloom_block {
 	unsigned char bits[BLOOM_CACHE_LINE];
 };
 
+/**
+ * Block of split block bloom filter, fits in a SIMD register
+ */
+struct bloom_split_block {
+	uint32_t words[BLOOM_SPLIT_WORDS];
+};
+
 /**
  * Bloom filter data structure
  */
@@ -75,12 +104,25 @@ struct bloom {
 	uint32_t table_size;
 	/* Number of hash function per value */
 	uint16_t hash_count;
+	/* Table layout */
+	enum bloom_type type;
 	/* Bit field table */
-	struct bloom_block *table;
+	union {
+		struct bloom_block *table;
+		struct bloom_split_block *split_table;
+	};
 };
 
 /* {{{ API declaration */
 
+/**
+ * Choose the fastest implementation of split block bloom filter
+ * lookup supported by the CPU. Until it is called, the portable
+ * implementation is used.
+ */
+void
+bloom_init(void);
+
 /**
  * Allocate and initialize an instance of bloom filter
  *
@@ -93,6 +135,21 @@ int
 bloom_create(struct bloom *bloom, uint32_t number_of_values,
 	     double false_positive_rate);
 
+/**
+ * Allocate and initialize an instance of split block bloom filter.
+ * It needs about as much memory as a classic bloom filter with
+ * the same false positive rate, but a lookup touches only 32 bytes
+ * and doesn't branch.
+ *
+ * @param bloom - structure to initialize
+ * @param number_of_values - estimated number of values to be added
+ * @param false_positive_rate - desired false positive rate
+ * @return 0 - OK, -1 - memory error
+ */
+int
+bloom_create_split(struct bloom *bloom, uint32_t number_of_values,
+		   double false_positive_rate);
+
 /**
  * Free resources of the bloom filter
  *
@@ -149,7 +206,8 @@ bloom_store(const struct bloom *bloom, char *table);
 
 /**
  * Allocate table and load it from given buffer.
- * Other struct bloom members must be loaded manually.
+ * Other struct bloom members, including the type,
+ * must be loaded manually.
  *
  * @param bloom - structure to load to
  * @param table - data to load
@@ -162,9 +220,105 @@ bloom_load_table(struct bloom *bloom, const char *table);
 
 /* {{{ API definition */
 
+/* Odd multipliers used to derive bit numbers for each word of a block */
+static const uint32_t bloom_split_salt[BLOOM_SPLIT_WORDS] = {
+	0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+	0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+};
+
+/**
+ * Return the number of the block a value belongs to.
+ * Uses the higher part of the hash.
+ */
+static inline uint32_t
+bloom_split_pos(const struct bloom *bloom, bloom_hash_t hash)
+{
+	return ((uint64_t)hash * bloom->table_size) >> 32;
+}
+
+/**
+ * Remix the hash so that bits set in a block don't correlate
+ * with the block number (murmur3 finalizer).
+ */
+static inline bloom_hash_t
+bloom_split_key(bloom_hash_t hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bU;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35U;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+/**
+ * Calculate bits set by a value in each word of a block.
+ * If hash_count is less than the number of words, the value
+ * sets bits in hash_count consecutive words (modulo the
+ * number of words), starting from a word chosen by the lower
+ * part of the hash.
+ */
+static inline void
+bloom_split_mask(const struct bloom *bloom, bloom_hash_t hash,
+		 uint32_t mask[BLOOM_SPLIT_WORDS])
+{
+	bloom_hash_t key = bloom_split_key(hash);
+	uint32_t start = hash % BLOOM_SPLIT_WORDS;
+	for (uint32_t i = 0; i < BLOOM_SPLIT_WORDS; i++) {
+		uint32_t bit_no = (key * bloom_split_salt[i]) >> 27;
+		uint32_t is_used = (i - start) % BLOOM_SPLIT_WORDS <
+				   bloom->hash_count;
+		mask[i] = is_used << bit_no;
+	}
+}
+
+static inline void
+bloom_split_add(struct bloom *bloom, bloom_hash_t hash)
+{
+	uint32_t mask[BLOOM_SPLIT_WORDS];
+	bloom_split_mask(bloom, hash, mask);
+	struct bloom_split_block *block =
+		&bloom->split_table[bloom_split_pos(bloom, hash)];
+	for (uint32_t i = 0; i < BLOOM_SPLIT_WORDS; i++)
+		block->words[i] |= mask[i];
+}
+
+/**
+ * Portable lookup in a split block bloom filter, checks bits
+ * used by the value one word at a time.
+ */
+static inline bool
+bloom_split_maybe_has_generic(const struct bloom *bloom, bloom_hash_t hash)
+{
+	const struct bloom_split_block *block =
+		&bloom->split_table[bloom_split_pos(bloom, hash)];
+	bloom_hash_t key = bloom_split_key(hash);
+	uint32_t start = hash % BLOOM_SPLIT_WORDS;
+	for (uint32_t i = 0; i < bloom->hash_count; i++) {
+		uint32_t word_no = (start + i) % BLOOM_SPLIT_WORDS;
+		uint32_t bit_no = (key * bloom_split_salt[word_no]) >> 27;
+		if ((block->words[word_no] & (1U << bit_no)) == 0)
+			return false;
+	}
+	return true;
+}
+
+typedef bool
+(*bloom_split_maybe_has_f)(const struct bloom *bloom, bloom_hash_t hash);
+
+/*
+ * Pointer to the implementation of split block bloom filter
+ * lookup chosen by bloom_init() for the CPU.
+ */
+extern bloom_split_maybe_has_f bloom_split_maybe_has;
+
 static inline void
 bloom_add(struct bloom *bloom, bloom_hash_t hash)
 {
+	if (bloom->type == BLOOM_SPLIT) {
+		bloom_split_add(bloom, hash);
+		return;
+	}
 	/* Using lower part of the has for finding a block */
 	bloom_hash_t pos = hash % bloom->table_size;
 	hash = hash / bloom->table_size;
@@ -185,6 +339,8 @@ bloom_add(struct bloom *bloom, bloom_hash_t hash)
 static inline bool
 bloom_maybe_has(const struct bloom *bloom, bloom_hash_t hash)
 {
+	if (bloom->type == BLOOM_SPLIT)
+		return bloom_split_maybe_has(bloom, hash);
 	/* Using lower part of the has for finding a block */
 	bloom_hash_t pos = hash % bloom->table_size;
 	hash = hash / bloom->table_size;
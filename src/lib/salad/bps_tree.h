@@ -291,6 +291,16 @@
  * #define BPS_BLOCK_LINEAR_SEARCH
  */
 
+/**
+ * A switch that makes every inner block store the number of elements
+ * in its subtree. It costs a word per inner block and a walk up the
+ * path on every insertion and deletion, but allows to get the number
+ * of elements less than a key and to find an element by its ordinal
+ * position in logarithmic time (see bps_tree_lower_bound_offset,
+ * bps_tree_upper_bound_offset and bps_tree_iterator_at). To turn it on,
+ * #define BPS_TREE_INNER_CARD
+ */
+
 /**
  * A switch that enables collection of executions of different
  * branches of code. Used only for debug purposes, I hope you
@@ -374,6 +384,9 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_lower_bound_elem _api_name(lower_bound_elem)
 #define bps_tree_upper_bound_elem _api_name(upper_bound_elem)
 #define bps_tree_approximate_count _api_name(approximate_count)
+#define bps_tree_lower_bound_offset _api_name(lower_bound_offset)
+#define bps_tree_upper_bound_offset _api_name(upper_bound_offset)
+#define bps_tree_iterator_at _api_name(iterator_at)
 #define bps_tree_iterator_get_elem _api_name(iterator_get_elem)
 #define bps_tree_iterator_next _api_name(iterator_next)
 #define bps_tree_iterator_prev _api_name(iterator_prev)
@@ -406,6 +419,10 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_garbage_pop _bps_tree(garbage_pop)
 #define bps_tree_create_leaf _bps_tree(create_leaf)
 #define bps_tree_create_inner _bps_tree(create_inner)
+#define bps_tree_child_card _bps_tree(child_card)
+#define bps_tree_card_before _bps_tree(card_before)
+#define bps_tree_update_path_card _bps_tree(update_path_card)
+#define bps_tree_move_card _bps_tree(move_card)
 #define bps_tree_dispose_leaf _bps_tree(dispose_leaf)
 #define bps_tree_dispose_inner _bps_tree(dispose_inner)
 #define bps_tree_reserve_blocks _bps_tree(reserve_blocks)
@@ -789,6 +806,49 @@ bps_tree_upper_bound_elem(const struct bps_tree *tree, bps_tree_elem_t key,
 static inline size_t
 bps_tree_approximate_count(const struct bps_tree *tree, bps_tree_key_t key);
 
+#ifdef BPS_TREE_INNER_CARD
+/**
+ * @brief Get the number of elements that are less than the key.
+ * Available only if BPS_TREE_INNER_CARD is defined.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - pointer to a bool value, that will be set to true if
+ *  an element equal to the key is found, false otherwise.
+ *  Pass NULL if you don't need that info.
+ * @return - offset of the lower-bound element, i.e. the ordinal
+ *  position of the element bps_tree_lower_bound would point to.
+ */
+static inline size_t
+bps_tree_lower_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact);
+
+/**
+ * @brief Get the number of elements that are less or equal than the key.
+ * Available only if BPS_TREE_INNER_CARD is defined.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - pointer to a bool value, that will be set to true if
+ *  an element equal to the key is found, false otherwise.
+ *  Pass NULL if you don't need that info.
+ * @return - offset of the upper-bound element, i.e. the ordinal
+ *  position of the element bps_tree_upper_bound would point to.
+ */
+static inline size_t
+bps_tree_upper_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact);
+
+/**
+ * @brief Get an iterator to the element with the given ordinal position.
+ * Available only if BPS_TREE_INNER_CARD is defined.
+ * @param tree - pointer to a tree
+ * @param offset - number of elements preceding the wanted one
+ * @return - Iterator to the element. Invalid if offset is not less
+ *  than the tree size.
+ */
+static inline struct bps_tree_iterator
+bps_tree_iterator_at(const struct bps_tree *tree, size_t offset);
+#endif /* BPS_TREE_INNER_CARD */
+
 /**
  * @brief Get a pointer to the element pointed by iterator.
  *  If iterator is detected as broken, it is invalidated and NULL returned.
@@ -922,8 +982,12 @@ enum bps_tree_max_sizes {
 		 - 2 * sizeof(bps_tree_block_id_t) )
 		/ sizeof(bps_tree_elem_t),
 	BPS_TREE_MAX_COUNT_IN_INNER =
-		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block))
-		/ (sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t)),
+		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block)
+#ifdef BPS_TREE_INNER_CARD
+		 /* Subtree cardinality, possibly preceded by padding */
+		 - 2 * sizeof(size_t)
+#endif
+		 ) / (sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t)),
 	BPS_TREE_MAX_DEPTH = 16
 };
 
@@ -965,6 +1029,10 @@ CT_ASSERT_G(sizeof(struct bps_leaf) <= BPS_TREE_BLOCK_SIZE);
 struct bps_inner {
 	/* Block header */
 	struct bps_block header;
+#ifdef BPS_TREE_INNER_CARD
+	/* Count of elements in all leaves of the subtree */
+	size_t card;
+#endif
 	/* Ordered array of elements. Note -1 in size. See struct descr. */
 	bps_tree_elem_t elems[BPS_TREE_MAX_COUNT_IN_INNER - 1];
 	/* Corresponding child IDs */
@@ -1175,6 +1243,9 @@ bps_tree_build(struct bps_tree *tree, bps_tree_elem_t *sorted_array,
 				}
 				parents[i]->header.type = BPS_TREE_BT_INNER;
 				parents[i]->header.size = 0;
+#ifdef BPS_TREE_INNER_CARD
+				parents[i]->card = 0;
+#endif
 				inner_count++;
 			}
 			parents[i]->child_ids[parents[i]->header.size] =
@@ -1188,6 +1259,10 @@ bps_tree_build(struct bps_tree *tree, bps_tree_elem_t *sorted_array,
 			}
 		}
 
+#ifdef BPS_TREE_INNER_CARD
+		for (bps_tree_block_id_t i = 0; i < depth - 1; i++)
+			parents[i]->card += leaf->header.size;
+#endif
 		bps_tree_elem_t insert_value = current[leaf->header.size - 1];
 		for (bps_tree_block_id_t i = 0; i < depth - 1; i++) {
 			parents[i]->header.size++;
@@ -1304,6 +1379,72 @@ bps_tree_touch_block(struct bps_tree *tree, bps_tree_block_id_t id)
 	return (struct bps_block *)matras_touch(&tree->matras, id);
 }
 
+#ifdef BPS_TREE_INNER_CARD
+/**
+ * @brief Get the count of elements in a subtree by the ID of its root.
+ */
+static inline size_t
+bps_tree_child_card(const struct bps_tree *tree, bps_tree_block_id_t id)
+{
+	struct bps_block *block = bps_tree_restore_block(tree, id);
+	if (block->type == BPS_TREE_BT_LEAF)
+		return block->size;
+	assert(block->type == BPS_TREE_BT_INNER);
+	return ((struct bps_inner *)block)->card;
+}
+
+/**
+ * @brief Get the count of elements in subtrees of the first pos children
+ *  of an inner block. Sums up the children on the shorter side of pos.
+ */
+static inline size_t
+bps_tree_card_before(const struct bps_tree *tree,
+		     const struct bps_inner *inner, bps_tree_pos_t pos)
+{
+	size_t card = 0;
+	if (pos <= inner->header.size / 2) {
+		for (bps_tree_pos_t i = 0; i < pos; i++)
+			card += bps_tree_child_card(tree, inner->child_ids[i]);
+		return card;
+	}
+	for (bps_tree_pos_t i = pos; i < inner->header.size; i++)
+		card += bps_tree_child_card(tree, inner->child_ids[i]);
+	return inner->card - card;
+}
+
+/**
+ * @brief Add a delta to the cardinality of every inner block on a path
+ *  up to the root.
+ */
+static inline void
+bps_tree_update_path_card(struct bps_tree *tree,
+			  struct bps_inner_path_elem *path, int delta)
+{
+	for (; path != NULL; path = path->parent) {
+		path->block = (struct bps_inner *)
+			bps_tree_touch_block(tree, path->block_id);
+		path->block->card += delta;
+	}
+}
+
+/**
+ * @brief Account num children of the inner block dst starting from
+ *  position pos, that were moved to dst from the inner block src.
+ */
+static inline void
+bps_tree_move_card(const struct bps_tree *tree, struct bps_inner *src,
+		   struct bps_inner *dst, bps_tree_pos_t pos,
+		   bps_tree_pos_t num)
+{
+	size_t card = 0;
+	for (bps_tree_pos_t i = pos; i < pos + num; i++)
+		card += bps_tree_child_card(tree, dst->child_ids[i]);
+	assert(src->card >= card);
+	src->card -= card;
+	dst->card += card;
+}
+#endif /* BPS_TREE_INNER_CARD */
+
 /**
  * @brief Get a random element in a tree.
  * @param tree - pointer to a tree
@@ -1957,6 +2098,148 @@ bps_tree_approximate_count(const struct bps_tree *tree, bps_tree_key_t key)
 	return result;
 }
 
+#ifdef BPS_TREE_INNER_CARD
+/**
+ * @brief Get the number of elements that are less than the key.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - pointer to a bool value, that will be set to true if
+ *  an element equal to the key is found, false otherwise.
+ *  Pass NULL if you don't need that info.
+ * @return - offset of the lower-bound element, i.e. the ordinal
+ *  position of the element bps_tree_lower_bound would point to.
+ */
+static inline size_t
+bps_tree_lower_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact)
+{
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	if (tree->root_id == (bps_tree_block_id_t)(-1))
+		return 0;
+	size_t offset = 0;
+	struct bps_block *block = bps_tree_root(tree);
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_ins_point_key(tree, inner->elems,
+						  inner->header.size - 1,
+						  key, exact);
+		offset += bps_tree_card_before(tree, inner, pos);
+		block = bps_tree_restore_block(tree, inner->child_ids[pos]);
+	}
+
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	bps_tree_pos_t pos;
+	pos = bps_tree_find_ins_point_key(tree, leaf->elems, leaf->header.size,
+					  key, exact);
+	return offset + pos;
+}
+
+/**
+ * @brief Get the number of elements that are less or equal than the key.
+ * @param tree - pointer to a tree
+ * @param key - key that will be compared with elements
+ * @param exact - pointer to a bool value, that will be set to true if
+ *  an element equal to the key is found, false otherwise.
+ *  Pass NULL if you don't need that info.
+ * @return - offset of the upper-bound element, i.e. the ordinal
+ *  position of the element bps_tree_upper_bound would point to.
+ */
+static inline size_t
+bps_tree_upper_bound_offset(const struct bps_tree *tree, bps_tree_key_t key,
+			    bool *exact)
+{
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	bool exact_test;
+	if (tree->root_id == (bps_tree_block_id_t)(-1))
+		return 0;
+	size_t offset = 0;
+	struct bps_block *block = bps_tree_root(tree);
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_after_ins_point_key(tree, inner->elems,
+							inner->header.size - 1,
+							key, &exact_test);
+		if (exact_test)
+			*exact = true;
+		offset += bps_tree_card_before(tree, inner, pos);
+		block = bps_tree_restore_block(tree, inner->child_ids[pos]);
+	}
+
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	bps_tree_pos_t pos;
+	pos = bps_tree_find_after_ins_point_key(tree, leaf->elems,
+						leaf->header.size,
+						key, &exact_test);
+	if (exact_test)
+		*exact = true;
+	return offset + pos;
+}
+
+/**
+ * @brief Get an iterator to the element with the given ordinal position.
+ * @param tree - pointer to a tree
+ * @param offset - number of elements preceding the wanted one
+ * @return - Iterator to the element. Invalid if offset is not less
+ *  than the tree size.
+ */
+static inline struct bps_tree_iterator
+bps_tree_iterator_at(const struct bps_tree *tree, size_t offset)
+{
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	if (offset >= tree->size) {
+		res.block_id = (bps_tree_block_id_t)(-1);
+		res.pos = 0;
+		return res;
+	}
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		assert(offset < inner->card);
+		bps_tree_pos_t pos;
+		if (offset < inner->card / 2) {
+			/* Skip children from the left. */
+			for (pos = 0; ; pos++) {
+				assert(pos < inner->header.size);
+				size_t card = bps_tree_child_card(tree,
+							inner->child_ids[pos]);
+				if (offset < card)
+					break;
+				offset -= card;
+			}
+		} else {
+			/* Skip children from the right. */
+			size_t tail = inner->card - offset;
+			for (pos = inner->header.size - 1; ; pos--) {
+				assert(pos >= 0);
+				size_t card = bps_tree_child_card(tree,
+							inner->child_ids[pos]);
+				if (tail <= card) {
+					offset = card - tail;
+					break;
+				}
+				tail -= card;
+			}
+		}
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+	assert(offset < (size_t)block->size);
+	res.block_id = block_id;
+	res.pos = offset;
+	return res;
+}
+#endif /* BPS_TREE_INNER_CARD */
+
 /**
  * @brief Get a pointer to the element pointed by iterator.
  *  If iterator is detected as broken, it is invalidated and NULL returned.
@@ -2165,6 +2448,9 @@ bps_tree_create_inner(struct bps_tree *tree, bps_tree_block_id_t *id)
 	if (!res)
 		res = (struct bps_inner *)matras_alloc(&tree->matras, id);
 	res->header.type = BPS_TREE_BT_INNER;
+#ifdef BPS_TREE_INNER_CARD
+	res->card = 0;
+#endif
 	tree->inner_count++;
 	return res;
 }
@@ -2485,6 +2771,10 @@ bps_tree_insert_into_leaf(struct bps_tree *tree,
 	}
 	leaf->header.size++;
 	tree->size++;
+#ifdef BPS_TREE_INNER_CARD
+	if (tree->root_id != (bps_tree_block_id_t) -1)
+		bps_tree_update_path_card(tree, leaf_path_elem->parent, 1);
+#endif
 }
 
 /**
@@ -2552,6 +2842,10 @@ bps_tree_delete_from_leaf(struct bps_tree *tree,
 	}
 
 	tree->size--;
+#ifdef BPS_TREE_INNER_CARD
+	if (tree->root_id != (bps_tree_block_id_t) -1)
+		bps_tree_update_path_card(tree, leaf_path_elem->parent, -1);
+#endif
 }
 
 /**
@@ -2667,6 +2961,10 @@ bps_tree_move_elems_to_right_inner(struct bps_tree *tree,
 
 	a->header.size -= num;
 	b->header.size += num;
+#ifdef BPS_TREE_INNER_CARD
+	if (tree->root_id != (bps_tree_block_id_t) -1)
+		bps_tree_move_card(tree, a, b, 0, num);
+#endif
 }
 
 /**
@@ -2746,6 +3044,10 @@ bps_tree_move_elems_to_left_inner(struct bps_tree *tree,
 
 	a->header.size += num;
 	b->header.size -= num;
+#ifdef BPS_TREE_INNER_CARD
+	if (tree->root_id != (bps_tree_block_id_t) -1)
+		bps_tree_move_card(tree, b, a, a->header.size - num, num);
+#endif
 }
 
 /**
@@ -2814,6 +3116,10 @@ bps_tree_insert_and_move_elems_to_right_leaf(struct bps_tree *tree,
 		*b_leaf_path_elem->max_elem_copy =
 			b->elems[b->header.size - 1];
 	tree->size++;
+#ifdef BPS_TREE_INNER_CARD
+	if (tree->root_id != (bps_tree_block_id_t) -1)
+		bps_tree_update_path_card(tree, a_leaf_path_elem->parent, 1);
+#endif
 	return ret;
 }
 
@@ -2950,6 +3256,10 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 
 	a->header.size -= (num - 1);
 	b->header.size += num;
+#ifdef BPS_TREE_INNER_CARD
+	if (tree->root_id != (bps_tree_block_id_t) -1)
+		bps_tree_move_card(tree, a, b, 0, num);
+#endif
 }
 
 /**
@@ -3017,6 +3327,10 @@ bps_tree_insert_and_move_elems_to_left_leaf(struct bps_tree *tree,
 		*b_leaf_path_elem->max_elem_copy =
 			b->elems[b->header.size - 1];
 	tree->size++;
+#ifdef BPS_TREE_INNER_CARD
+	if (tree->root_id != (bps_tree_block_id_t) -1)
+		bps_tree_update_path_card(tree, b_leaf_path_elem->parent, 1);
+#endif
 	return ret;
 }
 
@@ -3148,6 +3462,10 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 
 	a->header.size += num;
 	b->header.size -= (num - 1);
+#ifdef BPS_TREE_INNER_CARD
+	if (tree->root_id != (bps_tree_block_id_t) -1)
+		bps_tree_move_card(tree, b, a, a->header.size - num, num);
+#endif
 }
 
 /**
@@ -3714,6 +4032,9 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 		new_root->child_ids[0] = tree->root_id;
 		new_root->child_ids[1] = new_block_id;
 		new_root->elems[0] = tree->max_elem;
+#ifdef BPS_TREE_INNER_CARD
+		new_root->card = tree->size;
+#endif
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
 		tree->depth++;
@@ -4034,6 +4355,9 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 		new_root->child_ids[0] = tree->root_id;
 		new_root->child_ids[1] = new_block_id;
 		new_root->elems[0] = tree->max_elem;
+#ifdef BPS_TREE_INNER_CARD
+		new_root->card = tree->size;
+#endif
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
 		tree->depth++;
@@ -4661,6 +4985,10 @@ bps_tree_debug_check_block(const struct bps_tree *tree, struct bps_block *block,
 				result |= 0x4000000;
 		}
 
+#ifdef BPS_TREE_INNER_CARD
+		size_t calc_count_before = *calc_count;
+#endif
+
 		for (bps_tree_pos_t i = 0; i < block->size; i++)
 			result |= bps_tree_debug_check_block(tree,
 				bps_tree_restore_block(tree,
@@ -4668,6 +4996,10 @@ bps_tree_debug_check_block(const struct bps_tree *tree, struct bps_block *block,
 				inner->child_ids[i], level - 1, calc_count,
 				expected_prev_id, expected_this_id,
 				check_fullness_next);
+#ifdef BPS_TREE_INNER_CARD
+		if (inner->card != *calc_count - calc_count_before)
+			result |= 0x8000000;
+#endif
 		return result;
 	}
 }
@@ -6098,6 +6430,9 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_lower_bound_elem
 #undef bps_tree_upper_bound_elem
 #undef bps_tree_approximate_count
+#undef bps_tree_lower_bound_offset
+#undef bps_tree_upper_bound_offset
+#undef bps_tree_iterator_at
 #undef bps_tree_iterator_get_elem
 #undef bps_tree_iterator_next
 #undef bps_tree_iterator_prev
@@ -6129,6 +6464,10 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_garbage_pop
 #undef bps_tree_create_leaf
 #undef bps_tree_create_inner
+#undef bps_tree_child_card
+#undef bps_tree_card_before
+#undef bps_tree_update_path_card
+#undef bps_tree_move_card
 #undef bps_tree_dispose_leaf
 #undef bps_tree_dispose_inner
 #undef bps_tree_reserve_blocks
@@ -0,0 +1,1034 @@
+/*
+ * *No header guard*: the header is allowed to be included twice
+ * with different sets of defines.
+ */
+/*
+ * Copyright 2010-2026, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Open addressing hash table with the same interface as light.h.
+ *
+ * Values are stored in chunks of SWISS_CHUNK_SLOTS slots. Each chunk
+ * starts with a 16-byte control word that holds a 7-bit tag of the
+ * hash of every stored value, so a lookup compares the tag with all
+ * slots of a chunk at once (with one SSE2 instruction if available)
+ * and calls the comparison function only for the matching slots.
+ * Chunks are probed in the triangular order, a lookup stops at the
+ * first chunk that has an empty slot. A deleted value leaves
+ * a tombstone unless its chunk has an empty slot, because then no
+ * probe sequence can pass through the chunk.
+ *
+ * Chunks are stored in matras, which makes it possible to freeze
+ * an iterator (create a read view) in O(1).
+ *
+ * The table is resized incrementally. When it becomes 3/4 full
+ * (including tombstones), a new table is allocated and initialized
+ * SWISS_PREPARE_STEP chunks per insertion. Once it is ready, new
+ * values go to the new table while the old one is migrated to it
+ * SWISS_MIGRATE_STEP chunks per insertion. Lookups check both
+ * tables until the migration is over. Migrated chunks of the old
+ * table are left intact, so that a frozen iterator may keep using
+ * them. Tables are reference counted and a table is freed only
+ * when the last frozen iterator that uses it is destroyed.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "small/matras.h"
+
+#ifndef SWISS_COMMON_DEFINED
+#define SWISS_COMMON_DEFINED
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+enum {
+	/** Number of values stored in a chunk. */
+	SWISS_CHUNK_SLOTS = 14,
+	/** Mask of control word bytes that correspond to slots. */
+	SWISS_SLOT_MASK = (1 << SWISS_CHUNK_SLOTS) - 1,
+	/** Slot index (see below) of a chunk is chunk_id << this. */
+	SWISS_CHUNK_SHIFT = 4,
+	/** Control byte of an empty slot. */
+	SWISS_CTRL_EMPTY = 0x80,
+	/** Control byte of a deleted slot (tombstone). */
+	SWISS_CTRL_DELETED = 0xfe,
+	/** Chunks initialized per insertion while a table is prepared. */
+	SWISS_PREPARE_STEP = 16,
+	/** Chunks migrated per insertion while a table is resized. */
+	SWISS_MIGRATE_STEP = 1,
+	/** Max number of chunks in a table. */
+	SWISS_MAX_CHUNK_COUNT = 1 << 26,
+};
+
+/**
+ * A position in a hash table: slot index in the main table or,
+ * if the SWISS_POS_OLD bit is set, in the table being migrated.
+ * Slot index is chunk_id << SWISS_CHUNK_SHIFT | slot_no.
+ */
+static const uint32_t SWISS_POS_OLD = 0x80000000;
+
+#if defined(__SSE2__)
+
+/** Return the bit mask of slots whose control byte is @a byte. */
+static inline uint32_t
+swiss_match(const uint8_t *ctrl, uint8_t byte)
+{
+	__m128i word = _mm_loadu_si128((const __m128i *)ctrl);
+	__m128i eq = _mm_cmpeq_epi8(word, _mm_set1_epi8((char)byte));
+	return (uint32_t)_mm_movemask_epi8(eq) & SWISS_SLOT_MASK;
+}
+
+/** Return the bit mask of empty and deleted slots. */
+static inline uint32_t
+swiss_match_free(const uint8_t *ctrl)
+{
+	__m128i word = _mm_loadu_si128((const __m128i *)ctrl);
+	return (uint32_t)_mm_movemask_epi8(word) & SWISS_SLOT_MASK;
+}
+
+#else /* !defined(__SSE2__) */
+
+static inline uint32_t
+swiss_match(const uint8_t *ctrl, uint8_t byte)
+{
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < SWISS_CHUNK_SLOTS; i++)
+		mask |= (uint32_t)(ctrl[i] == byte) << i;
+	return mask;
+}
+
+static inline uint32_t
+swiss_match_free(const uint8_t *ctrl)
+{
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < SWISS_CHUNK_SLOTS; i++)
+		mask |= (uint32_t)(ctrl[i] >> 7) << i;
+	return mask;
+}
+
+#endif /* defined(__SSE2__) */
+
+/** 7-bit tag of a hash stored in the control byte of a slot. */
+static inline uint8_t
+swiss_tag(uint32_t hash)
+{
+	return hash >> 25;
+}
+
+#endif /* SWISS_COMMON_DEFINED */
+
+/**
+ * Additional user defined name that appended to prefix 'swiss'
+ * for all names of structs and functions in this header file.
+ * All names use pattern: swiss<SWISS_NAME>_<name of func/struct>
+ * May be empty, but still have to be defined (just #define SWISS_NAME)
+ */
+#ifndef SWISS_NAME
+#error "SWISS_NAME must be defined"
+#endif
+
+/**
+ * Data type that hash table holds. Must not be greater than 8 bytes.
+ */
+#ifndef SWISS_DATA_TYPE
+#error "SWISS_DATA_TYPE must be defined"
+#endif
+
+/**
+ * Data type that used to for finding values.
+ */
+#ifndef SWISS_KEY_TYPE
+#error "SWISS_KEY_TYPE must be defined"
+#endif
+
+/**
+ * Type of optional third parameter of comparing function.
+ * If not needed, simply use #define SWISS_CMP_ARG_TYPE int
+ */
+#ifndef SWISS_CMP_ARG_TYPE
+#error "SWISS_CMP_ARG_TYPE must be defined"
+#endif
+
+/**
+ * Data comparing function. Takes 3 parameters - value1, value2 and
+ * optional value that stored in hash table struct.
+ */
+#ifndef SWISS_EQUAL
+#error "SWISS_EQUAL must be defined"
+#endif
+
+/**
+ * Data comparing function. Takes 3 parameters - value, key and
+ * optional value that stored in hash table struct.
+ */
+#ifndef SWISS_EQUAL_KEY
+#error "SWISS_EQUAL_KEY must be defined"
+#endif
+
+/**
+ * Hash function. Takes 2 parameters - value and optional value
+ * that stored in hash table struct. Must return the same hash
+ * that was passed along with the value to insert function.
+ * Unlike light.h, hashes aren't stored in the table, so they
+ * are recalculated when the table is resized.
+ */
+#ifndef SWISS_HASH
+#error "SWISS_HASH must be defined"
+#endif
+
+/**
+ * Tools for name substitution:
+ */
+#ifndef CONCAT4
+#define CONCAT4_R(a, b, c, d) a##b##c##d
+#define CONCAT4(a, b, c, d) CONCAT4_R(a, b, c, d)
+#endif
+
+#ifdef _
+#error '_' must be undefinded!
+#endif
+#define SWISS(name) CONCAT4(swiss, SWISS_NAME, _, name)
+
+/**
+ * A chunk of the hash table.
+ */
+struct SWISS(chunk) {
+	/*
+	 * Control bytes: tag of the hash of the value stored in
+	 * the slot, SWISS_CTRL_EMPTY or SWISS_CTRL_DELETED. The last
+	 * two bytes aren't used.
+	 */
+	uint8_t ctrl[16];
+	union {
+		SWISS_DATA_TYPE slots[SWISS_CHUNK_SLOTS];
+		/* Round chunk size up to nearest power of two. */
+		uint8_t padding[(1 << (32 - __builtin_clz(16 +
+			SWISS_CHUNK_SLOTS * sizeof(SWISS_DATA_TYPE) - 1))) - 16];
+	};
+};
+
+/**
+ * Type of functions for memory allocation and deallocation
+ */
+typedef void *(*SWISS(extent_alloc_t))(void *ctx);
+typedef void (*SWISS(extent_free_t))(void *ctx, void *extent);
+
+/**
+ * Array of chunks. A hash table uses up to three of them at once.
+ */
+struct SWISS(table) {
+	/* dynamic storage for chunks */
+	struct matras mtable;
+	/* number of chunks minus one, number of chunks is power of two */
+	uint32_t chunk_mask;
+	/*
+	 * number of allocated chunks; less than chunk_mask + 1
+	 * only while the table is being prepared
+	 */
+	uint32_t chunk_count;
+	/* count of values in the table */
+	uint32_t count;
+	/* count of deleted slots (tombstones) */
+	uint32_t deleted;
+	/* the owning hash table and frozen iterators */
+	uint32_t refs;
+};
+
+/**
+ * Main struct for holding hash table
+ */
+struct SWISS(core) {
+	/* count of values in hash table */
+	uint32_t count;
+	/*
+	 * First slot of the old table that hasn't been migrated
+	 * yet; slots before it are ignored.
+	 */
+	uint32_t cursor;
+	/* main table, new values go there; NULL if never used */
+	struct SWISS(table) *table;
+	/* table being migrated to the main table or NULL */
+	struct SWISS(table) *old;
+	/* table being prepared for the next resize or NULL */
+	struct SWISS(table) *next;
+
+	/* additional parameter for data comparison */
+	SWISS_CMP_ARG_TYPE arg;
+
+	/* memory allocation parameters of tables */
+	size_t extent_size;
+	SWISS(extent_alloc_t) extent_alloc;
+	SWISS(extent_free_t) extent_free;
+	void *alloc_ctx;
+};
+
+/**
+ * Iterator, for iterating all values in hash_table.
+ * It also may be used for restoring one value by key.
+ */
+struct SWISS(iterator) {
+	/* Current position, see SWISS_POS_OLD */
+	uint32_t pos;
+	/* Value of core cursor at the time of freezing */
+	uint32_t cursor;
+	/* Main and old tables of a frozen iterator or NULLs */
+	struct SWISS(table) *tables[2];
+	/* Versions of matras memory of the tables for MVCC */
+	struct matras_view views[2];
+};
+
+/**
+ * Special result of swiss_find that means that nothing was found
+ */
+static const uint32_t SWISS(end) = 0xFFFFFFFF;
+
+/* Functions definition */
+
+/**
+ * @brief Hash table construction. Fills struct swiss members.
+ * @param ht - pointer to a hash table struct
+ * @param extent_size - size of allocating memory blocks
+ * @param extent_alloc_func - memory blocks allocation function
+ * @param extent_free_func - memory blocks allocation function
+ * @param alloc_ctx - argument passed to memory block allocator
+ * @param arg - optional parameter to save for comparing function
+ */
+static inline void
+SWISS(create)(struct SWISS(core) *ht, size_t extent_size,
+	      SWISS(extent_alloc_t) extent_alloc_func,
+	      SWISS(extent_free_t) extent_free_func,
+	      void *alloc_ctx, SWISS_CMP_ARG_TYPE arg)
+{
+	assert(sizeof(SWISS_DATA_TYPE) <= 8);
+	ht->count = 0;
+	ht->cursor = 0;
+	ht->table = NULL;
+	ht->old = NULL;
+	ht->next = NULL;
+	ht->arg = arg;
+	ht->extent_size = extent_size;
+	ht->extent_alloc = extent_alloc_func;
+	ht->extent_free = extent_free_func;
+	ht->alloc_ctx = alloc_ctx;
+}
+
+/**
+ * Allocate a table of @a chunk_count chunks. The chunks
+ * themselves are allocated by SWISS(table_prepare).
+ */
+static inline struct SWISS(table) *
+SWISS(table_new)(struct SWISS(core) *ht, uint32_t chunk_count)
+{
+	assert((chunk_count & (chunk_count - 1)) == 0);
+	assert(chunk_count <= SWISS_MAX_CHUNK_COUNT);
+	struct SWISS(table) *tab =
+		(struct SWISS(table) *)malloc(sizeof(*tab));
+	if (tab == NULL)
+		return NULL;
+	matras_create(&tab->mtable, ht->extent_size,
+		      sizeof(struct SWISS(chunk)), ht->extent_alloc,
+		      ht->extent_free, ht->alloc_ctx);
+	tab->chunk_mask = chunk_count - 1;
+	tab->chunk_count = 0;
+	tab->count = 0;
+	tab->deleted = 0;
+	tab->refs = 1;
+	return tab;
+}
+
+static inline void
+SWISS(table_unref)(struct SWISS(table) *tab)
+{
+	assert(tab->refs > 0);
+	if (--tab->refs > 0)
+		return;
+	matras_destroy(&tab->mtable);
+	free(tab);
+}
+
+/**
+ * Allocate and initialize up to @a step chunks of a table.
+ * Return 0 on success, -1 on memory error.
+ */
+static inline int
+SWISS(table_prepare)(struct SWISS(table) *tab, uint32_t step)
+{
+	for (; step > 0 && tab->chunk_count <= tab->chunk_mask; step--) {
+		matras_id_t id;
+		struct SWISS(chunk) *chunk = (struct SWISS(chunk) *)
+			matras_alloc(&tab->mtable, &id);
+		if (chunk == NULL)
+			return -1;
+		assert(id == tab->chunk_count);
+		memset(chunk->ctrl, SWISS_CTRL_EMPTY, sizeof(chunk->ctrl));
+		tab->chunk_count++;
+	}
+	return 0;
+}
+
+/**
+ * @brief Hash table destruction. Frees all allocated memory
+ * except tables used by frozen iterators, which are freed when
+ * the iterators are destroyed.
+ * @param ht - pointer to a hash table struct
+ */
+static inline void
+SWISS(destroy)(struct SWISS(core) *ht)
+{
+	if (ht->table != NULL)
+		SWISS(table_unref)(ht->table);
+	if (ht->old != NULL)
+		SWISS(table_unref)(ht->old);
+	if (ht->next != NULL)
+		SWISS(table_unref)(ht->next);
+	ht->table = ht->old = ht->next = NULL;
+	ht->count = 0;
+}
+
+/**
+ * Return the table that a position refers to.
+ */
+static inline struct SWISS(table) *
+SWISS(pos_table)(const struct SWISS(core) *ht, uint32_t pos)
+{
+	return (pos & SWISS_POS_OLD) != 0 ? ht->old : ht->table;
+}
+
+/**
+ * Find a value equal to @a value in a table, ignoring slots
+ * before @a min_slot. Return slot index or swiss_end.
+ */
+static inline uint32_t
+SWISS(table_find)(const struct SWISS(core) *ht, const struct SWISS(table) *tab,
+		  uint32_t min_slot, uint32_t hash, SWISS_DATA_TYPE value)
+{
+	uint8_t tag = swiss_tag(hash);
+	uint32_t chunk_id = hash & tab->chunk_mask;
+	for (uint32_t i = 1; ; i++) {
+		const struct SWISS(chunk) *chunk = (const struct SWISS(chunk) *)
+			matras_get(&tab->mtable, chunk_id);
+		uint32_t match = swiss_match(chunk->ctrl, tag);
+		while (match != 0) {
+			uint32_t slot = chunk_id << SWISS_CHUNK_SHIFT |
+					__builtin_ctz(match);
+			if (slot >= min_slot &&
+			    SWISS_EQUAL((chunk->slots[__builtin_ctz(match)]),
+					(value), (ht->arg)))
+				return slot;
+			match &= match - 1;
+		}
+		if (swiss_match(chunk->ctrl, SWISS_CTRL_EMPTY) != 0 ||
+		    i > tab->chunk_mask)
+			return SWISS(end);
+		chunk_id = (chunk_id + i) & tab->chunk_mask;
+	}
+}
+
+/**
+ * Same as SWISS(table_find), but looks up a key.
+ */
+static inline uint32_t
+SWISS(table_find_key)(const struct SWISS(core) *ht,
+		      const struct SWISS(table) *tab,
+		      uint32_t min_slot, uint32_t hash, SWISS_KEY_TYPE key)
+{
+	uint8_t tag = swiss_tag(hash);
+	uint32_t chunk_id = hash & tab->chunk_mask;
+	for (uint32_t i = 1; ; i++) {
+		const struct SWISS(chunk) *chunk = (const struct SWISS(chunk) *)
+			matras_get(&tab->mtable, chunk_id);
+		uint32_t match = swiss_match(chunk->ctrl, tag);
+		while (match != 0) {
+			uint32_t slot = chunk_id << SWISS_CHUNK_SHIFT |
+					__builtin_ctz(match);
+			if (slot >= min_slot &&
+			    SWISS_EQUAL_KEY((chunk->slots[__builtin_ctz(match)]),
+					    (key), (ht->arg)))
+				return slot;
+			match &= match - 1;
+		}
+		if (swiss_match(chunk->ctrl, SWISS_CTRL_EMPTY) != 0 ||
+		    i > tab->chunk_mask)
+			return SWISS(end);
+		chunk_id = (chunk_id + i) & tab->chunk_mask;
+	}
+}
+
+/**
+ * @brief Find a record with given hash and value
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to find
+ * @param data - value to find
+ * @return position of found record or swiss_end if nothing found
+ */
+static inline uint32_t
+SWISS(find)(const struct SWISS(core) *ht, uint32_t hash, SWISS_DATA_TYPE value)
+{
+	if (ht->count == 0)
+		return SWISS(end);
+	uint32_t pos = SWISS(table_find)(ht, ht->table, 0, hash, value);
+	if (pos == SWISS(end) && ht->old != NULL) {
+		pos = SWISS(table_find)(ht, ht->old, ht->cursor, hash, value);
+		if (pos != SWISS(end))
+			pos |= SWISS_POS_OLD;
+	}
+	return pos;
+}
+
+/**
+ * @brief Find a record with given hash and key
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to find
+ * @param data - key to find
+ * @return position of found record or swiss_end if nothing found
+ */
+static inline uint32_t
+SWISS(find_key)(const struct SWISS(core) *ht, uint32_t hash, SWISS_KEY_TYPE key)
+{
+	if (ht->count == 0)
+		return SWISS(end);
+	uint32_t pos = SWISS(table_find_key)(ht, ht->table, 0, hash, key);
+	if (pos == SWISS(end) && ht->old != NULL) {
+		pos = SWISS(table_find_key)(ht, ht->old, ht->cursor, hash, key);
+		if (pos != SWISS(end))
+			pos |= SWISS_POS_OLD;
+	}
+	return pos;
+}
+
+/**
+ * @brief Replace a record with given hash and value
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to find
+ * @param data - value to find and replace
+ * @param replaced - pointer to a value that was stored in table before replace
+ * @return position of found record or swiss_end if nothing found
+ */
+static inline uint32_t
+SWISS(replace)(struct SWISS(core) *ht, uint32_t hash,
+	       SWISS_DATA_TYPE value, SWISS_DATA_TYPE *replaced)
+{
+	uint32_t pos = SWISS(find)(ht, hash, value);
+	if (pos == SWISS(end))
+		return SWISS(end);
+	struct SWISS(table) *tab = SWISS(pos_table)(ht, pos);
+	uint32_t slot = pos & ~SWISS_POS_OLD;
+	struct SWISS(chunk) *chunk = (struct SWISS(chunk) *)
+		matras_touch(&tab->mtable, slot >> SWISS_CHUNK_SHIFT);
+	if (chunk == NULL)
+		return SWISS(end);
+	slot &= (1 << SWISS_CHUNK_SHIFT) - 1;
+	*replaced = chunk->slots[slot];
+	chunk->slots[slot] = value;
+	return pos;
+}
+
+/**
+ * Put a value to the first free slot of its probe sequence.
+ * The value must not be present in the table.
+ * Return slot index or swiss_end on memory error.
+ */
+static inline uint32_t
+SWISS(table_insert)(struct SWISS(table) *tab, uint32_t hash,
+		    SWISS_DATA_TYPE value)
+{
+	uint32_t chunk_id = hash & tab->chunk_mask;
+	for (uint32_t i = 1; ; i++) {
+		const struct SWISS(chunk) *chunk = (const struct SWISS(chunk) *)
+			matras_get(&tab->mtable, chunk_id);
+		uint32_t free_mask = swiss_match_free(chunk->ctrl);
+		if (free_mask != 0) {
+			struct SWISS(chunk) *chunk = (struct SWISS(chunk) *)
+				matras_touch(&tab->mtable, chunk_id);
+			if (chunk == NULL)
+				return SWISS(end);
+			uint32_t slot = __builtin_ctz(free_mask);
+			if (chunk->ctrl[slot] == SWISS_CTRL_DELETED)
+				tab->deleted--;
+			chunk->ctrl[slot] = swiss_tag(hash);
+			chunk->slots[slot] = value;
+			tab->count++;
+			return chunk_id << SWISS_CHUNK_SHIFT | slot;
+		}
+		if (i > tab->chunk_mask)
+			return SWISS(end);
+		chunk_id = (chunk_id + i) & tab->chunk_mask;
+	}
+}
+
+/**
+ * Move up to SWISS_MIGRATE_STEP chunks of the old table to
+ * the main table. Free the old table when it's done.
+ */
+static inline void
+SWISS(migrate)(struct SWISS(core) *ht)
+{
+	struct SWISS(table) *old = ht->old;
+	uint32_t end_slot = (old->chunk_mask + 1) << SWISS_CHUNK_SHIFT;
+	uint32_t end_chunk = (ht->cursor >> SWISS_CHUNK_SHIFT) +
+			     SWISS_MIGRATE_STEP;
+	while (ht->cursor < end_slot &&
+	       (ht->cursor >> SWISS_CHUNK_SHIFT) < end_chunk) {
+		uint32_t slot = ht->cursor & ((1 << SWISS_CHUNK_SHIFT) - 1);
+		const struct SWISS(chunk) *chunk = (const struct SWISS(chunk) *)
+			matras_get(&old->mtable,
+				   ht->cursor >> SWISS_CHUNK_SHIFT);
+		if (slot < SWISS_CHUNK_SLOTS && chunk->ctrl[slot] < 0x80) {
+			SWISS_DATA_TYPE value = chunk->slots[slot];
+			uint32_t value_hash = SWISS_HASH((value), (ht->arg));
+			if (SWISS(table_insert)(ht->table, value_hash,
+						value) == SWISS(end))
+				return; /* retry on the next insertion */
+			old->count--;
+		}
+		ht->cursor++;
+	}
+	if (ht->cursor == end_slot) {
+		assert(old->count == 0);
+		SWISS(table_unref)(old);
+		ht->old = NULL;
+		ht->cursor = 0;
+	}
+}
+
+/**
+ * Advance the resize of the hash table, if any, or start a new
+ * one if the main table is too full. Memory errors are ignored:
+ * the step is retried on the next insertion.
+ */
+static inline void
+SWISS(grow_step)(struct SWISS(core) *ht)
+{
+	if (ht->next != NULL) {
+		struct SWISS(table) *next = ht->next;
+		if (SWISS(table_prepare)(next, SWISS_PREPARE_STEP) != 0 ||
+		    next->chunk_count <= next->chunk_mask)
+			return;
+		ht->old = ht->table;
+		ht->table = next;
+		ht->next = NULL;
+		ht->cursor = 0;
+		return;
+	}
+	if (ht->old != NULL) {
+		SWISS(migrate)(ht);
+		return;
+	}
+	struct SWISS(table) *tab = ht->table;
+	uint64_t capacity = (uint64_t)(tab->chunk_mask + 1) * SWISS_CHUNK_SLOTS;
+	if ((uint64_t)(tab->count + tab->deleted) * 4 < capacity * 3)
+		return;
+	/*
+	 * Make the new table at most 3/8 full. If it's mostly
+	 * tombstones that fill the table, the new table has
+	 * the same size. The table never shrinks, so that values
+	 * inserted during the resize fit in the new table.
+	 */
+	uint32_t chunk_count = tab->chunk_mask + 1;
+	while ((uint64_t)tab->count * 8 >
+	       (uint64_t)chunk_count * SWISS_CHUNK_SLOTS * 3)
+		chunk_count *= 2;
+	if (chunk_count > SWISS_MAX_CHUNK_COUNT)
+		return;
+	ht->next = SWISS(table_new)(ht, chunk_count);
+}
+
+/**
+ * @brief Insert a record with given hash and value
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to insert
+ * @param data - value to insert
+ * @return position of inserted record or swiss_end if failed
+ */
+static inline uint32_t
+SWISS(insert)(struct SWISS(core) *ht, uint32_t hash, SWISS_DATA_TYPE value)
+{
+	if (ht->table == NULL) {
+		struct SWISS(table) *tab = SWISS(table_new)(ht, 1);
+		if (tab == NULL)
+			return SWISS(end);
+		if (SWISS(table_prepare)(tab, 1) != 0) {
+			SWISS(table_unref)(tab);
+			return SWISS(end);
+		}
+		ht->table = tab;
+	} else {
+		SWISS(grow_step)(ht);
+	}
+	uint32_t pos = SWISS(table_insert)(ht->table, hash, value);
+	if (pos != SWISS(end))
+		ht->count++;
+	return pos;
+}
+
+/**
+ * @brief Delete a record from a hash table by given record position
+ * @param ht - pointer to a hash table struct
+ * @param pos - position of a record. See SWISS(find) for details.
+ * @return 0 if ok, -1 on memory error (only with freezed iterators)
+ */
+static inline int
+SWISS(delete)(struct SWISS(core) *ht, uint32_t pos)
+{
+	struct SWISS(table) *tab = SWISS(pos_table)(ht, pos);
+	uint32_t slot = pos & ~SWISS_POS_OLD;
+	assert(tab != NULL && (slot >> SWISS_CHUNK_SHIFT) < tab->chunk_count);
+	struct SWISS(chunk) *chunk = (struct SWISS(chunk) *)
+		matras_touch(&tab->mtable, slot >> SWISS_CHUNK_SHIFT);
+	if (chunk == NULL)
+		return -1;
+	slot &= (1 << SWISS_CHUNK_SHIFT) - 1;
+	assert(chunk->ctrl[slot] < 0x80);
+	if (swiss_match(chunk->ctrl, SWISS_CTRL_EMPTY) != 0) {
+		chunk->ctrl[slot] = SWISS_CTRL_EMPTY;
+	} else {
+		chunk->ctrl[slot] = SWISS_CTRL_DELETED;
+		tab->deleted++;
+	}
+	tab->count--;
+	ht->count--;
+	return 0;
+}
+
+/**
+ * @brief Delete a record from a hash table by that value and its hash.
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash of the value
+ * @param value - value to delete
+ * @return 0 if ok, 1 if not found or -1 on memory error
+ * (only with freezed iterators)
+ */
+static inline int
+SWISS(delete_value)(struct SWISS(core) *ht,
+		    uint32_t hash, SWISS_DATA_TYPE value)
+{
+	uint32_t pos = SWISS(find)(ht, hash, value);
+	if (pos == SWISS(end))
+		return 1;
+	return SWISS(delete)(ht, pos);
+}
+
+/**
+ * @brief Determine if posision holds a value
+ * @param ht - pointer to a hash table struct
+ * @param pos - position of a record
+ */
+static inline bool
+SWISS(pos_valid)(struct SWISS(core) *ht, uint32_t pos)
+{
+	struct SWISS(table) *tab = SWISS(pos_table)(ht, pos);
+	uint32_t slot = pos & ~SWISS_POS_OLD;
+	if (tab == NULL || (slot >> SWISS_CHUNK_SHIFT) >= tab->chunk_count)
+		return false;
+	if ((pos & SWISS_POS_OLD) != 0 && slot < ht->cursor)
+		return false;
+	const struct SWISS(chunk) *chunk = (const struct SWISS(chunk) *)
+		matras_get(&tab->mtable, slot >> SWISS_CHUNK_SHIFT);
+	slot &= (1 << SWISS_CHUNK_SHIFT) - 1;
+	return slot < SWISS_CHUNK_SLOTS && chunk->ctrl[slot] < 0x80;
+}
+
+/**
+ * @brief Get a value from a desired position
+ * @param ht - pointer to a hash table struct
+ * @param pos - position of a record
+ *  Position must be vaild, check it by swiss_pos_valid (asserted).
+ */
+static inline SWISS_DATA_TYPE
+SWISS(get)(struct SWISS(core) *ht, uint32_t pos)
+{
+	assert(SWISS(pos_valid)(ht, pos));
+	struct SWISS(table) *tab = SWISS(pos_table)(ht, pos);
+	uint32_t slot = pos & ~SWISS_POS_OLD;
+	const struct SWISS(chunk) *chunk = (const struct SWISS(chunk) *)
+		matras_get(&tab->mtable, slot >> SWISS_CHUNK_SHIFT);
+	return chunk->slots[slot & ((1 << SWISS_CHUNK_SHIFT) - 1)];
+}
+
+/**
+ * Return the first slot index of a table that is not less than
+ * @a slot and holds a value or swiss_end.
+ */
+static inline uint32_t
+SWISS(table_next)(const struct SWISS(table) *tab,
+		  const struct matras_view *view, uint32_t slot)
+{
+	uint32_t chunk_id = slot >> SWISS_CHUNK_SHIFT;
+	uint32_t skip = slot & ((1 << SWISS_CHUNK_SHIFT) - 1);
+	for (; chunk_id < view->block_count; chunk_id++, skip = 0) {
+		const struct SWISS(chunk) *chunk =
+			(const struct SWISS(chunk) *)
+			matras_view_get(&tab->mtable, view, chunk_id);
+		uint32_t mask = ~swiss_match_free(chunk->ctrl) &
+				SWISS_SLOT_MASK & (~0U << skip);
+		if (mask != 0)
+			return chunk_id << SWISS_CHUNK_SHIFT |
+			       __builtin_ctz(mask);
+	}
+	return SWISS(end);
+}
+
+/**
+ * @brief Get a random value position
+ * @param ht - pointer to a hash table struct
+ * @param rnd - random number
+ * @return position of a record or swiss_end if the table is empty
+ */
+static inline uint32_t
+SWISS(random)(struct SWISS(core) *ht, uint32_t rnd)
+{
+	if (ht->count == 0)
+		return SWISS(end);
+	struct SWISS(table) *tab = ht->table;
+	uint32_t min_slot = 0;
+	uint32_t old_bit = 0;
+	if (tab->count == 0) {
+		tab = ht->old;
+		min_slot = ht->cursor;
+		old_bit = SWISS_POS_OLD;
+	}
+	uint32_t size = tab->chunk_count << SWISS_CHUNK_SHIFT;
+	uint32_t slot = min_slot + rnd % (size - min_slot);
+	slot = SWISS(table_next)(tab, &tab->mtable.head, slot);
+	if (slot == SWISS(end))
+		slot = SWISS(table_next)(tab, &tab->mtable.head, min_slot);
+	assert(slot != SWISS(end));
+	return slot | old_bit;
+}
+
+/**
+ * @brief Total number of memory extents used by the hash table
+ * @param ht - pointer to a hash table struct
+ */
+static inline size_t
+SWISS(extent_count)(const struct SWISS(core) *ht)
+{
+	size_t count = 0;
+	if (ht->table != NULL)
+		count += matras_extent_count(&ht->table->mtable);
+	if (ht->old != NULL)
+		count += matras_extent_count(&ht->old->mtable);
+	if (ht->next != NULL)
+		count += matras_extent_count(&ht->next->mtable);
+	return count;
+}
+
+/**
+ * @brief Set iterator to the beginning of hash table
+ * @param ht - pointer to a hash table struct
+ * @param itr - iterator to set
+ */
+static inline void
+SWISS(iterator_begin)(const struct SWISS(core) *ht, struct SWISS(iterator) *itr)
+{
+	(void)ht;
+	itr->pos = 0;
+	itr->cursor = 0;
+	itr->tables[0] = itr->tables[1] = NULL;
+}
+
+/**
+ * @brief Set iterator to position determined by key
+ * @param ht - pointer to a hash table struct
+ * @param itr - iterator to set
+ * @param hash - hash to find
+ * @param data - key to find
+ */
+static inline void
+SWISS(iterator_key)(const struct SWISS(core) *ht, struct SWISS(iterator) *itr,
+		    uint32_t hash, SWISS_KEY_TYPE data)
+{
+	itr->pos = SWISS(find_key)(ht, hash, data);
+	itr->cursor = 0;
+	itr->tables[0] = itr->tables[1] = NULL;
+}
+
+/**
+ * @brief Get the value that iterator currently points to
+ * @param ht - pointer to a hash table struct
+ * @param itr - iterator to set
+ * @return poiner to the value or NULL if iteration is complete
+ */
+static inline SWISS_DATA_TYPE *
+SWISS(iterator_get_and_next)(const struct SWISS(core) *ht,
+			     struct SWISS(iterator) *itr)
+{
+	bool is_frozen = itr->tables[0] != NULL;
+	while (itr->pos != SWISS(end)) {
+		uint32_t old_bit = itr->pos & SWISS_POS_OLD;
+		const struct SWISS(table) *tab;
+		const struct matras_view *view = NULL;
+		uint32_t min_slot = 0;
+		if (is_frozen) {
+			tab = itr->tables[old_bit != 0];
+			view = &itr->views[old_bit != 0];
+			if (old_bit != 0)
+				min_slot = itr->cursor;
+		} else {
+			tab = old_bit != 0 ? ht->old : ht->table;
+			if (tab != NULL)
+				view = &tab->mtable.head;
+			if (old_bit != 0)
+				min_slot = ht->cursor;
+		}
+		uint32_t slot = itr->pos & ~SWISS_POS_OLD;
+		if (slot < min_slot)
+			slot = min_slot;
+		if (tab != NULL)
+			slot = SWISS(table_next)(tab, view, slot);
+		else
+			slot = SWISS(end);
+		if (slot != SWISS(end)) {
+			itr->pos = (slot + 1) | old_bit;
+			struct SWISS(chunk) *chunk = (struct SWISS(chunk) *)
+				matras_view_get(&tab->mtable, view,
+						slot >> SWISS_CHUNK_SHIFT);
+			return &chunk->slots[slot &
+					     ((1 << SWISS_CHUNK_SHIFT) - 1)];
+		}
+		itr->pos = old_bit != 0 ? SWISS(end) : SWISS_POS_OLD;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Freezes state for given iterator. All following hash table modification
+ * will not apply to that iterator iteration. That iterator should be destroyed
+ * with a swiss_iterator_destroy call after usage.
+ * @param ht - pointer to a hash table struct
+ * @param itr - iterator to freeze
+ */
+static inline void
+SWISS(iterator_freeze)(struct SWISS(core) *ht, struct SWISS(iterator) *itr)
+{
+	assert(itr->tables[0] == NULL);
+	if (ht->table == NULL) {
+		itr->pos = SWISS(end);
+		return;
+	}
+	itr->tables[0] = ht->table;
+	ht->table->refs++;
+	matras_create_read_view(&ht->table->mtable, &itr->views[0]);
+	if (ht->old != NULL) {
+		itr->tables[1] = ht->old;
+		ht->old->refs++;
+		matras_create_read_view(&ht->old->mtable, &itr->views[1]);
+		itr->cursor = ht->cursor;
+	}
+}
+
+/**
+ * @brief Destroy an iterator that was frozen before. Useless for not frozen
+ * iterators.
+ * @param ht - pointer to a hash table struct
+ * @param itr - iterator to destroy
+ */
+static inline void
+SWISS(iterator_destroy)(struct SWISS(core) *ht, struct SWISS(iterator) *itr)
+{
+	(void)ht;
+	for (int i = 0; i < 2; i++) {
+		struct SWISS(table) *tab = itr->tables[i];
+		if (tab == NULL)
+			continue;
+		matras_destroy_read_view(&tab->mtable, &itr->views[i]);
+		SWISS(table_unref)(tab);
+		itr->tables[i] = NULL;
+	}
+}
+
+/*
+ * Selfcheck of the internal state of hash table. Used only for debugging.
+ * That means that you should not use this function.
+ * If return not zero, something went terribly wrong.
+ */
+static inline int
+SWISS(selfcheck)(const struct SWISS(core) *ht)
+{
+	int res = 0;
+	uint32_t total = 0;
+	for (int i = 0; i < 2; i++) {
+		const struct SWISS(table) *tab = i == 0 ? ht->table : ht->old;
+		if (tab == NULL)
+			continue;
+		if (tab->chunk_count != tab->chunk_mask + 1)
+			res |= 1; /* table is not prepared */
+		if (tab->chunk_count != tab->mtable.head.block_count)
+			res |= 2; /* wrong chunk count */
+		uint32_t min_slot = i == 0 ? 0 : ht->cursor;
+		uint32_t count = 0;
+		uint32_t deleted = 0;
+		for (uint32_t chunk_id = 0; chunk_id < tab->chunk_count;
+		     chunk_id++) {
+			const struct SWISS(chunk) *chunk =
+				(const struct SWISS(chunk) *)
+				matras_get(&tab->mtable, chunk_id);
+			for (uint32_t j = 0; j < SWISS_CHUNK_SLOTS; j++) {
+				uint32_t slot = chunk_id << SWISS_CHUNK_SHIFT | j;
+				if (chunk->ctrl[j] == SWISS_CTRL_DELETED) {
+					if (slot >= min_slot)
+						deleted++;
+					continue;
+				}
+				if (chunk->ctrl[j] == SWISS_CTRL_EMPTY ||
+				    slot < min_slot)
+					continue;
+				if (chunk->ctrl[j] >= 0x80) {
+					res |= 4; /* wrong control byte */
+					continue;
+				}
+				count++;
+				SWISS_DATA_TYPE value = chunk->slots[j];
+				uint32_t value_hash = SWISS_HASH((value),
+								 (ht->arg));
+				if (swiss_tag(value_hash) != chunk->ctrl[j])
+					res |= 8; /* wrong tag */
+				if (SWISS(table_find)(ht, tab, min_slot,
+						      value_hash, value) != slot)
+					res |= 16; /* value is unreachable */
+			}
+		}
+		if (count != tab->count)
+			res |= 32; /* wrong table count */
+		if (i == 0 && deleted != tab->deleted)
+			res |= 64; /* wrong deleted count */
+		total += count;
+	}
+	if (total != ht->count)
+		res |= 128; /* wrong count */
+	if (ht->old == NULL && ht->cursor != 0)
+		res |= 256;
+	return res;
+}
@@ -54,6 +54,7 @@
 #include "cbus.h"
 #include "coio_task.h"
 #include <crc32.h>
+#include "salad/bloom.h"
 #include "memory.h"
 #include <say.h>
 #include <rmean.h>
@@ -816,6 +817,7 @@ main(int argc, char **argv)
 	random_init();
 
 	crc32_init();
+	bloom_init();
 	memory_init();
 
 	main_argc = argc;
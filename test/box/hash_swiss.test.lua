@@ -0,0 +1,110 @@
+test_run = require('test_run').new()
+
+--
+-- HASH index with the hash_table option.
+--
+s = box.schema.space.create('test')
+s:create_index('pk', {type = 'hash', hash_table = 'cuckoo'})
+s:create_index('pk', {type = 'hash', hash_table = 1})
+s:create_index('pk', {type = 'tree', hash_table = 'swiss'})
+s:drop()
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {hash_table = 'swiss'})
+s:drop()
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {type = 'hash', hash_table = 'swiss'})
+_ = s:create_index('sk', {type = 'hash', parts = {2, 'string'}, hash_table = 'swiss'})
+_ = s:create_index('ref', {type = 'hash', parts = {2, 'string'}})
+s.index.pk.hash_table
+s.index.ref.hash_table
+
+test_run:cmd("setopt delimiter ';'")
+function check(n)
+    local bad = {}
+    for i = 1, n do
+        local t = s.index.pk:get(i)
+        local t2 = s.index.sk:get('v' .. i)
+        local r = s.index.ref:get('v' .. i)
+        if (t == nil) ~= (r == nil) or (t2 == nil) ~= (r == nil) or
+           (t ~= nil and t[2] ~= 'v' .. i) or (t2 ~= nil and t2[1] ~= i) then
+            table.insert(bad, i)
+        end
+    end
+    local seen = {}
+    local count = 0
+    for _, t in s.index.sk:pairs() do
+        if seen[t[1]] then
+            table.insert(bad, 'duplicate ' .. t[1])
+        end
+        seen[t[1]] = true
+        count = count + 1
+    end
+    if count ~= s.index.ref:count() then
+        table.insert(bad, 'count')
+    end
+    return bad
+end;
+test_run:cmd("setopt delimiter ''");
+
+-- The table is resized a few times.
+box.begin() for i = 1, 10000 do s:insert{i, 'v' .. i} end box.commit()
+s:count()
+s.index.sk:count()
+check(10001)
+s.index.pk:get(10001)
+s.index.sk:get('v0')
+
+-- Replace and delete.
+box.begin() for i = 1, 10000, 2 do s:replace{i, 'v' .. i, i} end box.commit()
+box.begin() for i = 1, 10000, 3 do s:delete(i) end box.commit()
+s:count()
+check(10000)
+box.begin() for i = 1, 10000, 6 do s:insert{i, 'v' .. i} end box.commit()
+s:count()
+check(10000)
+
+-- Duplicates.
+ok, err = pcall(s.insert, s, {2, 'v2'})
+err.code == box.error.TUPLE_FOUND
+ok, err = pcall(s.insert, s, {20000, 'v2'})
+err.code == box.error.TUPLE_FOUND
+s.index.pk:get(20000)
+s:count()
+
+-- Iterators.
+first = s.index.pk:select({}, {limit = 1})[1][1]
+#s.index.pk:select({first}, {iterator = 'GT'}) == s:count() - 1
+s.index.pk:select({2}, {iterator = 'EQ'})
+s.index.pk:select({3}, {iterator = 'EQ'})
+s.index.pk:random(42) ~= nil
+s.index.pk:bsize() > 0
+
+-- Alter.
+s.index.ref:alter({hash_table = 'swiss'})
+s.index.ref.hash_table
+s.index.sk:alter({hash_table = 'light'})
+s.index.sk.hash_table
+check(10000)
+s.index.sk:alter({hash_table = 'swiss'})
+
+-- Recovery.
+box.snapshot()
+test_run:cmd('restart server default')
+s = box.space.test
+s.index.pk.hash_table
+s:count()
+test_run:cmd("setopt delimiter ';'")
+bad = {}
+for i = 1, 10000 do
+    local t = s.index.pk:get(i)
+    if (t == nil) ~= (i % 3 == 1 and i % 6 ~= 1) then
+        table.insert(bad, i)
+    end
+    if t ~= nil and s.index.sk:get('v' .. i) == nil then
+        table.insert(bad, i)
+    end
+end;
+test_run:cmd("setopt delimiter ''");
+bad
+s:drop()
@@ -0,0 +1,19 @@
+#!/usr/bin/env tarantool
+
+--
+-- io_uring may be unsupported by the build or the kernel,
+-- in which case the instance falls back on plain system calls
+-- so that the test produces the same output.
+--
+local cfg = {
+    listen      = os.getenv('LISTEN'),
+    wal_mode    = 'fsync',
+    vinyl_cache = 0,
+    io_uring    = true,
+}
+if not pcall(box.cfg, cfg) then
+    cfg.io_uring = false
+    box.cfg(cfg)
+end
+
+require('console').listen(os.getenv('ADMIN'))
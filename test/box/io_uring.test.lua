@@ -0,0 +1,45 @@
+test_run = require('test_run').new()
+
+--
+-- io_uring can only be enabled at startup.
+--
+box.cfg.io_uring
+ok, err = pcall(box.cfg, {io_uring = true})
+ok
+tostring(err):match('io_uring')
+box.cfg.io_uring
+
+--
+-- WAL writes and vinyl page reads go through io_uring.
+--
+test_run:cmd("create server test with script='box/io_uring.lua'")
+test_run:cmd("start server test")
+test_run:cmd("switch test")
+fiber = require('fiber')
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {page_size = 1024})
+for i = 1, 1000 do s:replace{i, string.rep('x', 100)} end
+box.snapshot()
+s:count()
+s:get(500)[1]
+#s:select({100}, {iterator = 'ge', limit = 100})
+ch = fiber.channel(100)
+for i = 1, 100 do fiber.create(function() ch:put(s:get(i * 10)[1]) end) end
+sum = 0
+for i = 1, 100 do sum = sum + ch:get() end
+sum
+m = box.schema.space.create('memtx')
+_ = m:create_index('pk')
+for i = 1, 100 do fiber.create(function() m:insert{i} ch:put(true) end) end
+for i = 1, 100 do ch:get() end
+m:count()
+test_run:cmd("switch default")
+test_run:cmd("restart server test")
+test_run:cmd("switch test")
+box.space.test:count()
+box.space.test:get(1000)[1]
+box.space.memtx:count()
+test_run:cmd("switch default")
+test_run:cmd("stop server test")
+test_run:cmd("cleanup server test")
+test_run:cmd("delete server test")
@@ -0,0 +1,23 @@
+#!/usr/bin/env tarantool
+
+box.cfg{
+    listen              = os.getenv('LISTEN'),
+    iproto_threads      = 4,
+}
+
+require('console').listen(os.getenv('ADMIN'))
+
+-- Blocks a request until released, see iproto_threads.test.lua.
+started = 0
+released = false
+function block()
+    started = started + 1
+    while not released do
+        require('fiber').sleep(0.01)
+    end
+    return true
+end
+
+box.once('init', function()
+    box.schema.user.grant('guest', 'read,write,execute', 'universe')
+end)
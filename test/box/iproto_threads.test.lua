@@ -0,0 +1,42 @@
+test_run = require('test_run').new()
+net_box = require('net.box')
+
+--
+-- Connections are spread among several network threads.
+--
+box.cfg.iproto_threads
+box.cfg{iproto_threads = 2}
+
+test_run:cmd("create server test with script='box/iproto_threads.lua'")
+test_run:cmd("start server test")
+test_run:eval('test', 'box.cfg.iproto_threads')
+
+uri = test_run:eval('test', 'box.cfg.listen')[1]
+conns = {}
+for i = 1, 8 do conns[i] = net_box.connect(uri) end
+ok = true
+for i = 1, 8 do ok = ok and conns[i]:call('math.abs', {-i}) == i end
+ok
+test_run:eval('test', 'box.stat.net().CONNECTIONS.current')
+test_run:eval('test', '#box.stat.net.thread()')
+test_run:eval('test', "local t = {} for i, s in ipairs(box.stat.net.thread()) do t[i] = s.CONNECTIONS.current end return t")
+
+--
+-- Raising net_msg_max resumes connections stopped in every
+-- network thread, not only in the first one.
+--
+test_run:eval('test', 'box.cfg{net_msg_max = 2}')
+futures = {}
+for i = 1, 8 do for j = 1, 2 do table.insert(futures, conns[i]:call('block', {}, {is_async = true})) end end
+test_run:wait_cond(function() return test_run:eval('test', 'started')[1] > 0 end)
+test_run:eval('test', 'box.cfg{net_msg_max = 100}')
+test_run:wait_cond(function() return test_run:eval('test', 'started')[1] == 16 end)
+test_run:eval('test', 'released = true')
+ok = true
+for _, f in ipairs(futures) do ok = ok and f:wait_result(10)[1] == true end
+ok
+for i = 1, 8 do conns[i]:close() end
+
+test_run:cmd("stop server test")
+test_run:cmd("cleanup server test")
+test_run:cmd("delete server test")
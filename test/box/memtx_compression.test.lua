@@ -0,0 +1,71 @@
+test_run = require('test_run').new()
+
+--
+-- Per-space compression of tuple fields.
+--
+box.schema.space.create('test', {compression = 'lz4'})
+box.schema.space.create('test', {engine = 'vinyl', compression = 'zstd'})
+
+s = box.schema.space.create('test', {compression = 'zstd'})
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'string'}})
+
+doc = string.rep('compressible ', 100)
+for i = 1, 100 do s:insert{i, 'key' .. i, doc .. i, {doc, i}, i} end
+-- Big fields are stored compressed.
+s:bsize() < 100 * #doc
+-- Reads return decompressed tuples.
+t = s:get(1)
+t[3] == doc .. 1, t[4][1] == doc, t[4][2], t[5]
+s.index.sk:get('key2')[3] == doc .. 2
+s:select({10}, {iterator = 'GE', limit = 1})[1][3] == doc .. 10
+s:replace{101, 'key101', doc}[3] == doc
+n = 0
+for _, t in s:pairs() do if t[4][1] == doc then n = n + 1 end end
+n
+box.space.test:delete(101)[3] == doc
+
+-- DML works on decompressed fields.
+_ = s:update(1, {{'=', 3, 'short'}})
+t = s:get(1)
+t[3], t[4][1] == doc
+_ = s:update(2, {{'!', 5, 'new'}})
+t = s:get(2)
+t[3] == doc .. 2, t[4][1] == doc, t[5], t[6]
+s:upsert({3, 'key3'}, {{'=', 5, 'upserted'}})
+t = s:get(3)
+t[3] == doc .. 3, t[5]
+
+-- Format is checked against decompressed fields.
+s:format({{'id', 'unsigned'}, {'key', 'string'}, {'doc', 'unsigned'}})
+s:format({{'id', 'unsigned'}, {'key', 'string'}, {'doc', 'string'}})
+s:get(4).doc == doc .. 4
+
+-- Compressed fields can't be indexed.
+s:create_index('doc', {parts = {3, 'string'}})
+box.space._space:update(s.id, {{'=', 6, {compression = 'none'}}})
+
+-- The decompressed size declared by a client is checked before
+-- anything is allocated: {1, 'k', <zstd frame header of 4 GB>}.
+ffi = require('ffi')
+ffi.cdef[[int box_insert(uint32_t space_id, const char *tuple, const char *tuple_end, box_tuple_t **result);]]
+raw = string.fromhex('9301a16bc7090428b52ffda0ffffffff')
+ffi.C.box_insert(s.id, raw, ffi.cast('const char *', raw) + #raw, nil)
+box.error.last().message
+s:get(1)[2]
+-- So is the decompressed size of a tuple that compresses well.
+ok, err = pcall(s.insert, s, {200, 'key200', string.rep('a', 2 * 1024 * 1024)})
+ok, err.code == box.error.MEMTX_MAX_TUPLE_SIZE
+s:get(200)
+
+-- Compressed tuples are recovered from snapshot and xlog.
+box.snapshot()
+_ = s:update(5, {{'=', 3, doc .. 'updated'}})
+test_run:cmd('restart server default')
+doc = string.rep('compressible ', 100)
+s = box.space.test
+s:count()
+s:get(4).doc == doc .. 4
+s:get(5).doc == doc .. 'updated'
+s.index.sk:get('key6')[4][1] == doc
+s:drop()
@@ -0,0 +1,60 @@
+test_run = require('test_run').new()
+
+--
+-- Background defragmentation of tuple memory.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+_ = s:create_index('hash', {type = 'hash', parts = {3, 'string'}})
+_ = s:create_index('bitset', {type = 'bitset', parts = {2, 'unsigned'}, unique = false})
+_ = s:create_index('rtree', {type = 'rtree', parts = {4, 'array'}, unique = false})
+
+pad = string.rep('x', 200)
+box.begin() for i = 1, 10000 do s:insert{i, i % 100, 'key' .. i, {i, i}, pad} end box.commit()
+-- Leave every tenth tuple so that slabs are sparsely used.
+box.begin() for i = 1, 10000 do if i % 10 ~= 0 then s:delete(i) end end box.commit()
+-- Tuples referenced from Lua are never moved.
+pinned = s:get(5000)
+collectgarbage('collect')
+items_size = box.slab.info().items_size
+
+box.slab.defrag_info().in_progress
+box.slab.defrag()
+box.slab.defrag()
+test_run:wait_cond(function() return not box.slab.defrag_info().in_progress end)
+box.slab.defrag_info().tuple_count > 0
+box.slab.defrag_info().tuple_size > 0
+-- Moving tuples frees slabs. Note, arena_used doesn't change,
+-- because it only accounts memory occupied by tuples.
+box.slab.info().items_size < items_size
+
+-- All indexes reference moved tuples.
+s:count()
+s.index.sk:count(10)
+s.index.bitset:count(10)
+s.index.rtree:count()
+bad = 0
+test_run:cmd("setopt delimiter ';'")
+for i = 10, 10000, 10 do
+    local t = s:get(i)
+    if t == nil or t[5] ~= pad or
+       s.index.hash:get('key' .. i)[1] ~= i or
+       s.index.rtree:select({i, i})[1][1] ~= i then
+        bad = bad + 1
+    end
+end;
+test_run:cmd("setopt delimiter ''");
+bad
+pinned[1], s:get(5000)[1]
+pinned = nil
+
+-- DML and snapshot work after defragmentation.
+_ = s:replace{10, 10, 'key10', {10, 10}, 'new'}
+s:get(10)[5]
+s.index.hash:get('key10')[5]
+_ = s:delete(20)
+s.index.sk:count(20)
+box.snapshot()
+
+s:drop()
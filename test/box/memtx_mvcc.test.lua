@@ -0,0 +1,154 @@
+test_run = require('test_run').new()
+
+--
+-- The transaction manager can only be enabled at startup.
+--
+box.cfg.memtx_use_mvcc_engine
+box.cfg{memtx_use_mvcc_engine = true}
+
+test_run:cmd("create server test with script='box/memtx_mvcc.lua'")
+test_run:cmd("start server test")
+test_run:cmd("switch test")
+box.cfg.memtx_use_mvcc_engine
+box.cfg{memtx_use_mvcc_engine = false}
+
+fiber = require('fiber')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+
+--
+-- txn(f) executes f in a transaction and commits it.
+-- start_txn(f) executes f in a transaction in another fiber
+-- and leaves the transaction in progress. It returns a function
+-- that commits the transaction.
+--
+test_run:cmd("setopt delimiter ';'")
+function txn(f)
+    box.begin()
+    local ok, err = pcall(f)
+    if ok then
+        ok, err = pcall(box.commit)
+    end
+    if not ok then
+        box.rollback()
+        return tostring(err)
+    end
+    return 'ok'
+end;
+function start_txn(f)
+    local cont = fiber.channel(1)
+    local res = fiber.channel(1)
+    fiber.create(function()
+        res:put(txn(function() f() res:put(true) cont:get() end))
+    end)
+    res:get()
+    return function() cont:put(true) return res:get() end
+end;
+test_run:cmd("setopt delimiter ''");
+
+--
+-- A transaction may yield.
+--
+txn(function() s:insert{1, 1} fiber.sleep(0) s:insert{2, 2} end)
+s:select{}
+box.begin() s:replace{1, 10} fiber.sleep(0) s:delete{2} box.rollback()
+s:select{}
+
+--
+-- Changes of an in-progress transaction are invisible to others.
+--
+commit = start_txn(function() s:replace{3, 3} s:delete{1} end)
+s:get(3)
+s:get(1)
+s:select{}
+commit()
+s:select{}
+
+--
+-- A transaction sees its own changes.
+--
+txn(function() s:replace{4, 4} fiber.sleep(0) assert(s:get(4) ~= nil) s:delete{4} assert(s:get(4) == nil) end)
+s:select{}
+
+--
+-- Write-write conflict: the transaction that commits first wins.
+--
+commit = start_txn(function() s:replace{4, 'other'} end)
+txn(function() s:replace{4, 'mine'} end)
+commit()
+s:get(4)
+
+commit = start_txn(function() s:insert{5, 'other'} end)
+s:insert{5, 'mine'}
+commit()
+s:get(5)
+
+--
+-- Read-write conflict: a transaction that read a tuple is
+-- aborted if the tuple is overwritten.
+--
+commit = start_txn(function() s:replace{6, s:get(2)[2]} end)
+s:replace{2, 20}
+commit()
+s:get(6)
+
+--
+-- Duplicates are checked against visible tuples only.
+--
+commit = start_txn(function() s:delete{3} end)
+s:insert{3, 30}
+txn(function() s:delete{3} s:insert{3, 30} end)
+commit()
+s:get(3)
+
+--
+-- DDL aborts in-progress transactions.
+--
+commit = start_txn(function() s:replace{7, 7} end)
+_ = s:create_index('sk', {parts = {1, 'unsigned'}, unique = false})
+commit()
+s:get(7)
+s.index.sk:select{}
+
+--
+-- Phantom reads: a transaction that looked up a missing key
+-- or read a range of keys is aborted if another transaction
+-- inserts a tuple there.
+--
+t = box.schema.space.create('phantom')
+_ = t:create_index('pk')
+commit = start_txn(function() if t:get(1) == nil then t:insert{2} end end)
+t:insert{1}
+commit()
+t:select{}
+
+commit = start_txn(function() t:insert{10, #t:select({5}, {iterator = 'GE'})} end)
+t:insert{3}
+commit()
+t:get(10)
+commit = start_txn(function() t:insert{20, #t:select({5}, {iterator = 'GE'})} end)
+t:insert{6}
+commit()
+t:get(20)
+
+commit = start_txn(function() t:insert{30, t:count()} end)
+t:insert{7}
+commit()
+t:get(30)
+
+--
+-- index:len() includes uncommitted tuples while index:count()
+-- only counts tuples visible to the transaction.
+--
+commit = start_txn(function() t:insert{40} end)
+t:len()
+t:count()
+commit()
+t:count()
+t:drop()
+
+s:drop()
+test_run:cmd("switch default")
+test_run:cmd("stop server test")
+test_run:cmd("cleanup server test")
+test_run:cmd("delete server test")
@@ -0,0 +1,66 @@
+test_run = require('test_run').new()
+
+--
+-- Secondary keys of all spaces are built at once on recovery,
+-- their build arrays are sorted by a pool of threads. Arrays of
+-- test1 are longer than the qsort_arg() multithreading threshold
+-- (128K), so they are sorted by the multithreaded qsort_arg()
+-- instead, while small arrays of test2 go to the sort threads.
+--
+s1 = box.schema.space.create('test1')
+_ = s1:create_index('pk')
+_ = s1:create_index('sk1', {parts = {2, 'unsigned'}})
+_ = s1:create_index('sk2', {parts = {3, 'string'}, unique = false})
+s2 = box.schema.space.create('test2')
+_ = s2:create_index('pk')
+_ = s2:create_index('sk', {parts = {2, 'string'}})
+_ = s2:create_index('hash', {type = 'hash', parts = {2, 'string'}})
+N = 200000
+box.begin() for i = 1, N do s1:insert{i, i * 7919 % N, tostring(i % 10)} if i % 1000 == 0 then box.commit() box.begin() end end box.commit()
+for i = 1, 1000 do s2:insert{i, tostring(i)} end
+box.snapshot()
+s1:insert{N + 1, N + 1, 'x'}
+s2:insert{1001, '1001'}
+
+test_run:cmd('restart server default')
+
+box.cfg.memtx_sort_threads
+N = 200000
+s1 = box.space.test1
+s2 = box.space.test2
+s1.index.sk1:select({}, {limit = 3})
+s1.index.sk1:select({}, {limit = 2, iterator = 'LE'})
+s1.index.sk2:count('5') == N / 10
+s1.index.sk2:count('x')
+s2.index.sk:get('500')
+s2.index.sk:get('1001')
+s2.index.hash:get('1001')
+s1.index.sk1:len() == s1:len()
+s2.index.sk:len() == s2:len()
+
+-- Check the order of whole indexes.
+test_run:cmd("setopt delimiter ';'")
+function is_sorted(index)
+    local fieldno = index.parts[1].fieldno
+    local prev_key, prev_id
+    local count = 0
+    for _, t in index:pairs() do
+        local key, id = t[fieldno], t[1]
+        if prev_key ~= nil and (key < prev_key or
+                                (key == prev_key and id <= prev_id)) then
+            return false
+        end
+        prev_key, prev_id = key, id
+        count = count + 1
+    end
+    return count == box.space[index.space_id]:len()
+end;
+test_run:cmd("setopt delimiter ''");
+is_sorted(s1.index.sk1)
+is_sorted(s1.index.sk2)
+is_sorted(s2.index.sk)
+
+box.cfg{memtx_sort_threads = 2}
+
+s1:drop()
+s2:drop()
@@ -0,0 +1,61 @@
+test_run = require('test_run').new()
+
+--
+-- Snapshot rows are split in blocks compressed in parallel
+-- by the worker thread pool and written to the file in order.
+--
+box.cfg.snap_compress_threads
+tostring(select(2, pcall(box.cfg, {snap_compress_threads = -1}))):match('must be.*')
+tostring(select(2, pcall(box.cfg, {snap_compress_threads = 1000}))):match('must be.*')
+
+-- The number of blocks in flight is capped by the size of
+-- the worker thread pool.
+box.cfg.worker_pool_threads
+box.cfg{snap_compress_threads = 8}
+test_run:grep_log('default', 'snap_compress_threads 8 exceeds worker_pool_threads 4') ~= nil
+box.cfg{snap_compress_threads = 2}
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+pad = string.rep('x', 100)
+for i = 1, 10000 do s:insert{i, pad .. i} end
+
+box.cfg{snap_compress_threads = 0}
+box.snapshot()
+test_run:cmd('restart server default')
+s = box.space.test
+s:count()
+s:get(1)[2] == string.rep('x', 100) .. 1
+s:get(10000)[2] == string.rep('x', 100) .. 10000
+
+box.cfg{snap_compress_threads = 4}
+_ = s:delete(1)
+box.snapshot()
+test_run:cmd('restart server default')
+s = box.space.test
+s:count()
+s:get(1)
+s:get(2)[2] == string.rep('x', 100) .. 2
+s:get(10000)[2] == string.rep('x', 100) .. 10000
+
+--
+-- Snapshot blocks are decompressed in parallel on recovery,
+-- but rows are applied in the order they were written.
+--
+digest = require('digest')
+box.begin() for i = 1, 20000 do s:replace{i, digest.sha512_hex(i) .. digest.sha512_hex(-i)} end box.commit()
+s2 = box.schema.space.create('test2')
+_ = s2:create_index('pk')
+_ = s2:insert{1}
+box.snapshot()
+test_run:cmd('restart server default')
+digest = require('digest')
+s = box.space.test
+s:count()
+bad = 0
+for i = 1, 20000 do if s:get(i)[2] ~= digest.sha512_hex(i) .. digest.sha512_hex(-i) then bad = bad + 1 end end
+bad
+box.space.test2:select()
+box.space.test2:drop()
+
+s:drop()
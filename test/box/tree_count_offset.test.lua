@@ -0,0 +1,103 @@
+test_run = require('test_run').new()
+
+--
+-- TREE index counts tuples in a key range, returns the rank of
+-- a key and skips the select offset without iterating over the
+-- skipped tuples.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+_ = s:create_index('ik', {parts = {2, 'unsigned', 3, 'unsigned'}, inline_key = true})
+h = s:create_index('h', {type = 'hash', parts = {3, 'unsigned'}})
+
+test_run:cmd("setopt delimiter ';'")
+function brute_count(index, key, it)
+    local n = 0
+    for _ in s.index[index]:pairs(key, {iterator = it}) do
+        n = n + 1
+    end
+    return n
+end;
+function check_count(index, keys)
+    local bad = {}
+    for _, it in ipairs({'EQ', 'REQ', 'GT', 'GE', 'LT', 'LE'}) do
+        for _, key in ipairs(keys) do
+            local count = s.index[index]:count(key, {iterator = it})
+            if count ~= brute_count(index, key, it) then
+                table.insert(bad, {it, key})
+            end
+        end
+    end
+    return bad
+end;
+function check_rank(index, keys)
+    local bad = {}
+    for _, key in ipairs(keys) do
+        if s.index[index]:rank(key) ~= brute_count(index, key, 'LT') then
+            table.insert(bad, key)
+        end
+    end
+    return bad
+end;
+function check_offset(index, keys)
+    local bad = {}
+    for _, it in ipairs({'EQ', 'REQ', 'GT', 'GE', 'LT', 'LE'}) do
+        for _, key in ipairs(keys) do
+            local all = s.index[index]:select(key, {iterator = it})
+            for _, offset in ipairs({1, 2, 7, 100, #all, #all + 1,
+                                     math.max(#all - 1, 0)}) do
+                local res = s.index[index]:select(key, {iterator = it,
+                        offset = offset, limit = 3})
+                local ok = #res == math.max(0, math.min(3, #all - offset))
+                for k = 1, #res do
+                    ok = ok and res[k][1] == all[offset + k][1]
+                end
+                if not ok then
+                    table.insert(bad, {it, key, offset})
+                end
+            end
+        end
+    end
+    return bad
+end;
+test_run:cmd("setopt delimiter ''");
+
+for i = 1, 3000 do s:replace{i, i % 100, i} end
+
+pk_keys = {{}, {0}, {1}, {1500}, {2999}, {3000}, {3001}}
+sk_keys = {{}, {0}, {1}, {50}, {99}, {100}}
+ik_keys = {{}, {0}, {5}, {5, 105}, {5, 106}, {99, 2999}, {100}}
+
+s:count()
+s:count(1500, {iterator = 'LT'})
+s.index.sk:count(50)
+s.index.sk:rank(50)
+check_count('pk', pk_keys)
+check_count('sk', sk_keys)
+check_count('ik', ik_keys)
+check_rank('pk', pk_keys)
+check_rank('sk', sk_keys)
+check_rank('ik', ik_keys)
+check_offset('pk', pk_keys)
+check_offset('sk', sk_keys)
+check_offset('ik', ik_keys)
+
+-- Counters are kept up to date when tuples are deleted.
+for i = 1, 3000, 3 do s:delete{i} end
+for i = 1000, 2000 do s:delete{i} end
+
+s:count()
+s.index.sk:count(50)
+check_count('pk', pk_keys)
+check_count('sk', sk_keys)
+check_count('ik', ik_keys)
+check_rank('sk', sk_keys)
+check_offset('pk', pk_keys)
+check_offset('sk', sk_keys)
+check_offset('ik', ik_keys)
+
+-- HASH index can't tell the rank of a key.
+(pcall(h.rank, h, 1))
+
+s:drop()
@@ -0,0 +1,137 @@
+test_run = require('test_run').new()
+
+--
+-- TREE index with the inline_key option.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+s:create_index('hash', {type = 'hash', parts = {2, 'unsigned'}, inline_key = true})
+s:create_index('mk', {parts = {{2, 'unsigned', path = '[*]'}}, unique = false, inline_key = true})
+s:create_index('sk', {parts = {2, 'unsigned'}, inline_key = 1})
+s:drop()
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {inline_key = true})
+s:drop()
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {inline_key = true})
+_ = s:create_index('i', {parts = {2, 'integer'}, unique = false, inline_key = true})
+_ = s:create_index('i_ref', {parts = {2, 'integer'}, unique = false})
+_ = s:create_index('s', {parts = {{3, 'string', is_nullable = true}, {2, 'integer'}}, unique = false, inline_key = true})
+_ = s:create_index('s_ref', {parts = {{3, 'string', is_nullable = true}, {2, 'integer'}}, unique = false})
+s.index.pk.inline_key
+s.index.i_ref.inline_key
+
+-- Strings share a prefix longer than the inlined part of the key.
+prefix = string.rep('x', 30)
+box.begin() for i = 1, 1000 do s:insert{i, (i * 7919) % 2001 - 1000, i % 10 == 0 and box.NULL or prefix .. (i * 31) % 97} end box.commit()
+_ = s:insert{1001, 18446744073709551615ULL, 'a'}
+_ = s:insert{1002, -9223372036854775808LL, 'a\0b'}
+_ = s:insert{1003, 9223372036854775807LL, ''}
+_ = s:insert{1004, -1, 'a\0'}
+
+test_run:cmd("setopt delimiter ';'")
+function check(index, ref, keys)
+    local bad = {}
+    for _, it in ipairs({'EQ', 'REQ', 'GT', 'GE', 'LT', 'LE', 'ALL'}) do
+        for _, key in ipairs(keys) do
+            local a = s.index[index]:select(key, {iterator = it})
+            local b = s.index[ref]:select(key, {iterator = it})
+            local ok = #a == #b
+            for k = 1, #a do
+                ok = ok and a[k][1] == b[k][1]
+            end
+            if not ok then
+                table.insert(bad, {it, key})
+            end
+        end
+    end
+    return bad
+end;
+function check_all()
+    local bad = {}
+    local i_keys = {{}, {-1000}, {-1}, {0}, {1}, {500}, {1000},
+                    {18446744073709551615ULL}, {-9223372036854775808LL},
+                    {9223372036854775807LL}}
+    local s_keys = {{}, {box.NULL}, {''}, {'a'}, {'a\0'}, {'a\0b'},
+                    {prefix}, {prefix .. '5'}, {prefix .. '50'},
+                    {prefix .. '50', 0}, {prefix .. '50', -1000},
+                    {box.NULL, 0}, {'z'}}
+    for _, v in ipairs(check('i', 'i_ref', i_keys)) do
+        table.insert(bad, v)
+    end
+    for _, v in ipairs(check('s', 's_ref', s_keys)) do
+        table.insert(bad, v)
+    end
+    for i = 1, 1004 do
+        if s.index.pk:get(i) == nil then
+            table.insert(bad, i)
+        end
+    end
+    return bad
+end;
+test_run:cmd("setopt delimiter ''");
+
+check_all()
+s.index.pk:get(1005)
+#s.index.pk:select(1000, {iterator = 'GE'})
+
+-- Replace and delete.
+box.begin() for i = 1, 1000, 3 do s:replace{i, -((i * 7919) % 2001 - 1000), prefix .. (i * 13) % 97} end box.commit()
+box.begin() for i = 2, 1000, 5 do s:delete(i) end box.commit()
+box.begin() for i = 2, 1000, 5 do s:insert{i, i, i % 2 == 0 and box.NULL or prefix .. i} end box.commit()
+check_all()
+ok, err = pcall(s.insert, s, {1, 0, 'a'})
+err.code == box.error.TUPLE_FOUND
+
+-- Uniqueness is checked beyond the inlined part of the key.
+u = box.schema.space.create('u')
+_ = u:create_index('pk', {parts = {1, 'string'}, inline_key = true})
+_ = u:insert{prefix .. 'a'}
+_ = u:insert{prefix .. 'b'}
+ok, err = pcall(u.insert, u, {prefix .. 'a'})
+err.code == box.error.TUPLE_FOUND
+u:count()
+u.index.pk:get(prefix .. 'b') ~= nil
+u.index.pk:get(prefix) == nil
+u:drop()
+
+-- Alter.
+s.index.i:alter({inline_key = false})
+s.index.i.inline_key
+s.index.i_ref:alter({inline_key = true})
+s.index.i_ref.inline_key
+check_all()
+s.index.i:alter({inline_key = true})
+s.index.s:alter({parts = {{3, 'string', is_nullable = true}, {2, 'integer'}, {1, 'unsigned'}}})
+check_all()
+
+-- Recovery.
+box.snapshot()
+test_run:cmd('restart server default')
+s = box.space.test
+prefix = string.rep('x', 30)
+s.index.pk.inline_key
+s.index.i.inline_key
+s:count()
+test_run:cmd("setopt delimiter ';'")
+function check(index, ref, keys)
+    local bad = {}
+    for _, it in ipairs({'EQ', 'REQ', 'GT', 'GE', 'LT', 'LE', 'ALL'}) do
+        for _, key in ipairs(keys) do
+            local a = s.index[index]:select(key, {iterator = it})
+            local b = s.index[ref]:select(key, {iterator = it})
+            local ok = #a == #b
+            for k = 1, #a do
+                ok = ok and a[k][1] == b[k][1]
+            end
+            if not ok then
+                table.insert(bad, {it, key})
+            end
+        end
+    end
+    return bad
+end;
+test_run:cmd("setopt delimiter ''");
+check('s', 's_ref', {{}, {box.NULL}, {''}, {'a'}, {prefix .. '5'}, {prefix .. '50', 0}})
+s:drop()
@@ -0,0 +1,58 @@
+--
+-- String and varbinary keys of up to a few dozen bytes are
+-- compared a word at a time. Check that the order is still
+-- bytewise for keys differing at any position.
+--
+test_run = require('test_run').new()
+
+test_run:cmd("setopt delimiter ';'")
+function bytewise_less(a, b)
+    for i = 1, math.min(#a, #b) do
+        local x, y = a:byte(i), b:byte(i)
+        if x ~= y then
+            return x < y
+        end
+    end
+    return #a < #b
+end;
+function gen_keys()
+    local keys = {}
+    for len = 1, 40 do
+        local base = string.rep('a', len)
+        table.insert(keys, base)
+        for pos = 1, len do
+            for _, c in ipairs({'\x00', '\x7f', '\x80', '\xff'}) do
+                table.insert(keys, base:sub(1, pos - 1) .. c ..
+                             base:sub(pos + 1))
+            end
+        end
+    end
+    return keys
+end;
+function check(space)
+    local keys = gen_keys()
+    for _, k in ipairs(keys) do
+        space:replace{k}
+    end
+    local n = 0
+    local prev = nil
+    for _, t in space:pairs() do
+        n = n + 1
+        if prev ~= nil and not bytewise_less(prev, t[1]) then
+            return false
+        end
+        prev = t[1]
+    end
+    return n == #keys or {n, #keys}
+end;
+test_run:cmd("setopt delimiter ''");
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {parts = {1, 'string'}})
+check(s)
+s:drop()
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {parts = {1, 'scalar'}})
+check(s)
+s:drop()
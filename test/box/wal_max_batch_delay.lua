@@ -0,0 +1,9 @@
+#!/usr/bin/env tarantool
+
+box.cfg{
+    listen              = os.getenv('LISTEN'),
+    wal_mode            = 'fsync',
+    wal_max_batch_delay = 0.01,
+}
+
+require('console').listen(os.getenv('ADMIN'))
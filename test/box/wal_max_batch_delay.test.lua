@@ -0,0 +1,46 @@
+test_run = require('test_run').new()
+
+--
+-- Group commit: in fsync mode, batches written within
+-- wal_max_batch_delay share one fsync.
+--
+box.cfg.wal_max_batch_delay
+ok, err = pcall(box.cfg, {wal_max_batch_delay = -1})
+ok
+tostring(err):match('wal_max_batch_delay')
+box.cfg.wal_max_batch_delay
+
+test_run:cmd("create server test with script='box/wal_max_batch_delay.lua'")
+test_run:cmd("start server test")
+test_run:cmd("switch test")
+fiber = require('fiber')
+box.cfg.wal_max_batch_delay
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+count = box.stat.wal().fsync_count
+ch = fiber.channel(100)
+for i = 1, 100 do fiber.create(function() s:insert{i} ch:put(true) end) end
+for i = 1, 100 do ch:get() end
+s:count()
+-- Rows share syncs: there are far fewer syncs than commits,
+-- and the histogram has a bucket of syncs of more than one row.
+box.stat.wal().fsync_count - count <= 10
+max_rows = 0
+for min in box.stat.wal().batch_rows:gmatch('%[(%d+)') do max_rows = math.max(max_rows, tonumber(min)) end
+max_rows > 1
+box.stat.wal().fsync_latency ~= nil
+
+-- The delay can be changed and turned off on the fly.
+box.cfg{wal_max_batch_delay = 0}
+s:insert{101}
+box.cfg{wal_max_batch_delay = 0.001}
+s:insert{102}
+s:count()
+test_run:cmd("switch default")
+test_run:cmd("restart server test")
+test_run:cmd("switch test")
+box.space.test:count()
+test_run:cmd("switch default")
+test_run:cmd("stop server test")
+test_run:cmd("cleanup server test")
+test_run:cmd("delete server test")
@@ -0,0 +1,33 @@
+test_run = require('test_run').new()
+
+--
+-- Batches that arrive at the WAL thread one after another
+-- within wal_max_batch_delay share one sync.
+--
+test_run:cmd("create server test with script='box/wal_max_batch_delay.lua'")
+test_run:cmd("start server test")
+test_run:cmd("switch test")
+fiber = require('fiber')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+-- The sync delay is capped by the average fsync latency,
+-- so make fsync slow.
+box.error.injection.set('ERRINJ_WAL_SYNC_DELAY', 0.1)
+box.cfg{wal_max_batch_delay = 1}
+for i = 1, 10 do s:replace{0} end
+count = box.stat.wal().fsync_count
+ch = fiber.channel(2)
+_ = fiber.create(function() s:insert{1} ch:put(true) end)
+fiber.sleep(0.005)
+_ = fiber.create(function() s:insert{2} ch:put(true) end)
+ch:get()
+ch:get()
+box.stat.wal().fsync_count - count
+box.stat.wal().batch_rows:match('%[2%]:1') ~= nil
+box.error.injection.set('ERRINJ_WAL_SYNC_DELAY', 0)
+s:count()
+
+test_run:cmd("switch default")
+test_run:cmd("stop server test")
+test_run:cmd("cleanup server test")
+test_run:cmd("delete server test")
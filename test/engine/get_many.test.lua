@@ -0,0 +1,35 @@
+test_run = require('test_run').new()
+engine = test_run:get_cfg('engine')
+
+--
+-- index:get_many() looks up tuples by several keys at once.
+--
+s = box.schema.space.create('test', {engine = engine})
+pk = s:create_index('pk')
+sk = s:create_index('sk', {parts = {2, 'unsigned'}})
+nu = s:create_index('nu', {parts = {3, 'unsigned'}, unique = false})
+for i = 1, 100 do s:replace{i, 1000 - i, i % 10} end
+box.snapshot()
+for i = 1, 100, 3 do s:replace{i, 1000 - i, i % 10, 'new'} end
+
+s:get_many({})
+s:get_many({1, 2, 3})
+-- Tuples are returned in the order of keys, missing keys are skipped.
+s:get_many({{3}, {200}, {1}})
+sk:get_many({999, 998, 1})
+
+keys = {}
+for i = 1, 200 do keys[i] = i end
+#s:get_many(keys)
+#sk:get_many(keys)
+
+-- Changes made by the current transaction are visible.
+box.begin() s:replace{2, 998, 2, 'tx'} s:delete{3} r = s:get_many({2, 3}) box.commit()
+r
+
+-- Errors.
+nu:get_many({1})
+s:get_many({{1, 2}})
+s:get_many(1)
+
+s:drop()
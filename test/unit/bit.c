@@ -220,6 +220,66 @@ test_bitmap_size(void)
 	footer();
 }
 
+/** Reference implementation of bytes_compare(). */
+static int
+bytes_compare_slow(const char *a, uint32_t size_a,
+		   const char *b, uint32_t size_b)
+{
+	for (uint32_t i = 0; i < size_a && i < size_b; i++) {
+		if (a[i] != b[i])
+			return (unsigned char)a[i] < (unsigned char)b[i] ?
+			       -1 : 1;
+	}
+	return COMPARE_RESULT(size_a, size_b);
+}
+
+static int
+sign(int r)
+{
+	return r < 0 ? -1 : r > 0;
+}
+
+/** Check bytes_compare() on all strings of the given lengths. */
+static void
+test_bytes_compare_size(uint32_t size_a, uint32_t size_b)
+{
+	/* Byte pairs that differ, including ones with the high bit set. */
+	static const unsigned char diffs[][2] = {
+		{'a', 'b'}, {'b', 'a'}, {0x7f, 0x80}, {0xff, 0x00},
+	};
+	char a[BYTES_COMPARE_WORD_MAX * 2], b[BYTES_COMPARE_WORD_MAX * 2];
+	assert(size_a <= sizeof(a) && size_b <= sizeof(b));
+	uint32_t size = MIN(size_a, size_b);
+	for (uint32_t pos = 0; pos <= size; pos++) {
+		for (size_t i = 0; i < lengthof(diffs); i++) {
+			memset(a, 'x', size_a);
+			memset(b, 'x', size_b);
+			if (pos < size) {
+				a[pos] = diffs[i][0];
+				b[pos] = diffs[i][1];
+			}
+			int r = bytes_compare(a, size_a, b, size_b);
+			int r_slow = bytes_compare_slow(a, size_a, b, size_b);
+			fail_unless(sign(r) == r_slow);
+		}
+	}
+}
+
+static void
+test_bytes_compare(void)
+{
+	header();
+
+	/* Cover both the word-at-a-time and the memcmp() paths. */
+	uint32_t size_max = BYTES_COMPARE_WORD_MAX * 2;
+	for (uint32_t size_a = 0; size_a <= size_max; size_a++) {
+		for (uint32_t size_b = 0; size_b <= size_max; size_b++)
+			test_bytes_compare_size(size_a, size_b);
+	}
+
+	footer();
+}
+
 int
 main(void)
 {
@@ -231,4 +291,5 @@ main(void)
 	test_bit_iter();
 	test_bit_iter_empty();
 	test_bitmap_size();
+	test_bytes_compare();
 }
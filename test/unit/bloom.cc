@@ -10,10 +10,21 @@ uint32_t h(uint32_t i)
 	return i * 2654435761;
 }
 
+static const char *bloom_type_strs[] = { "classic", "split" };
+
+int
+create(struct bloom *bloom, uint32_t count, double p, enum bloom_type type)
+{
+	if (type == BLOOM_SPLIT)
+		return bloom_create_split(bloom, count, p);
+	return bloom_create(bloom, count, p);
+}
+
 void
-simple_test()
+simple_test(enum bloom_type type)
 {
-	cout << "*** " << __func__ << " ***" << endl;
+	cout << "*** " << __func__ << " " << bloom_type_strs[type] << " ***"
+	     << endl;
 	srand(time(0));
 	uint32_t error_count = 0;
 	uint32_t fp_rate_too_big = 0;
@@ -22,7 +33,7 @@ simple_test()
 		uint64_t false_positive = 0;
 		for (uint32_t count = 1000; count <= 10000; count *= 2) {
 			struct bloom bloom;
-			bloom_create(&bloom, count, p);
+			create(&bloom, count, p, type);
 			unordered_set<uint32_t> check;
 			for (uint32_t i = 0; i < count; i++) {
 				uint32_t val = rand() % (count * 10);
@@ -50,9 +61,10 @@ simple_test()
 }
 
 void
-store_load_test()
+store_load_test(enum bloom_type type)
 {
-	cout << "*** " << __func__ << " ***" << endl;
+	cout << "*** " << __func__ << " " << bloom_type_strs[type] << " ***"
+	     << endl;
 	srand(time(0));
 	uint32_t error_count = 0;
 	uint32_t fp_rate_too_big = 0;
@@ -61,7 +73,7 @@ store_load_test()
 		uint64_t false_positive = 0;
 		for (uint32_t count = 300; count <= 3000; count *= 10) {
 			struct bloom bloom;
-			bloom_create(&bloom, count, p);
+			create(&bloom, count, p, type);
 			unordered_set<uint32_t> check;
 			for (uint32_t i = 0; i < count; i++) {
 				uint32_t val = rand() % (count * 10);
@@ -96,9 +108,37 @@ store_load_test()
 	cout << "fp_rate_too_big = " << fp_rate_too_big << endl;
 }
 
+/*
+ * The lookup implementation chosen by bloom_init() must give
+ * the same results as the portable one.
+ */
+void
+split_dispatch_test()
+{
+	cout << "*** " << __func__ << " ***" << endl;
+	uint32_t error_count = 0;
+	for (double p = 0.001; p < 0.5; p *= 2) {
+		struct bloom bloom;
+		bloom_create_split(&bloom, 10000, p);
+		for (uint32_t i = 0; i < 10000; i++)
+			bloom_add(&bloom, h(i * 2));
+		for (uint32_t i = 0; i < 100000; i++) {
+			if (bloom_maybe_has(&bloom, h(i)) !=
+			    bloom_split_maybe_has_generic(&bloom, h(i)))
+				error_count++;
+		}
+		bloom_destroy(&bloom);
+	}
+	cout << "error_count = " << error_count << endl;
+}
+
 int
 main(void)
 {
-	simple_test();
-	store_load_test();
+	bloom_init();
+	simple_test(BLOOM_CLASSIC);
+	store_load_test(BLOOM_CLASSIC);
+	simple_test(BLOOM_SPLIT);
+	store_load_test(BLOOM_SPLIT);
+	split_dispatch_test();
 }
@@ -104,6 +104,29 @@ static int compare_key(const elem_t &a, long b)
 #undef bps_tree_key_t
 #undef bps_tree_arg_t
 
+/* tree with subtree cardinalities for offset test */
+#define BPS_TREE_NAME card
+#define BPS_TREE_BLOCK_SIZE 128 /* value is to low specially for tests */
+#define BPS_TREE_EXTENT_SIZE 2048 /* value is to low specially for tests */
+#define BPS_TREE_IS_IDENTICAL(a, b) (a == b)
+#define BPS_TREE_COMPARE(a, b, arg) compare(a, b)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) compare(a, b)
+#define bps_tree_elem_t type_t
+#define bps_tree_key_t type_t
+#define bps_tree_arg_t int
+#define BPS_TREE_INNER_CARD
+#include "salad/bps_tree.h"
+#undef BPS_TREE_NAME
+#undef BPS_TREE_BLOCK_SIZE
+#undef BPS_TREE_EXTENT_SIZE
+#undef BPS_TREE_IS_IDENTICAL
+#undef BPS_TREE_COMPARE
+#undef BPS_TREE_COMPARE_KEY
+#undef bps_tree_elem_t
+#undef bps_tree_key_t
+#undef bps_tree_arg_t
+#undef BPS_TREE_INNER_CARD
+
 /* tree for approximate_count test */
 #define BPS_TREE_NAME approx
 #define BPS_TREE_BLOCK_SIZE 128 /* value is to low specially for tests */
@@ -858,6 +881,56 @@ delete_value_check()
 	footer();
 }
 
+static void
+offset_check()
+{
+	header();
+	srand(0);
+
+	card tree;
+	card_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+	const type_t key_count = 2000;
+	bool present[key_count];
+	memset(present, 0, sizeof(present));
+	for (long i = 0; i < key_count * 10; i++) {
+		type_t key = rand() % key_count;
+		if (rand() % 3 != 0) {
+			card_insert(&tree, key, NULL);
+			present[key] = true;
+		} else {
+			card_delete(&tree, key);
+			present[key] = false;
+		}
+		if (card_debug_check(&tree))
+			fail("debug check nonzero", "true");
+	}
+
+	size_t less = 0;
+	for (type_t key = 0; key < key_count; key++) {
+		bool exact;
+		size_t offset = card_lower_bound_offset(&tree, key, &exact);
+		if (offset != less || exact != present[key])
+			fail("lower bound offset is wrong", "true");
+		if (present[key]) {
+			card_iterator itr = card_iterator_at(&tree, less);
+			type_t *elem = card_iterator_get_elem(&tree, &itr);
+			if (elem == NULL || *elem != key)
+				fail("iterator at offset is wrong", "true");
+			less++;
+		}
+		offset = card_upper_bound_offset(&tree, key, NULL);
+		if (offset != less)
+			fail("upper bound offset is wrong", "true");
+	}
+	card_iterator itr = card_iterator_at(&tree, card_size(&tree));
+	if (!card_iterator_is_invalid(&itr))
+		fail("iterator past the end must be invalid", "true");
+
+	card_destroy(&tree);
+
+	footer();
+}
+
 int
 main(void)
 {
@@ -873,4 +946,5 @@ main(void)
 		fail("memory leak!", "true");
 	insert_get_iterator();
 	delete_value_check();
+	offset_check();
 }
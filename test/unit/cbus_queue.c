@@ -0,0 +1,295 @@
+#include <assert.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "memory.h"
+#include "fiber.h"
+#include "cbus.h"
+#include "unit.h"
+
+/*
+ * Check that cbus neither loses nor reorders messages when the
+ * consumer alternates between busy-polling and sleeping.
+ *
+ * Each producer thread pushes numbered messages to the main
+ * thread, which bounces them back. A producer keeps at most
+ * 'window' messages in flight: window = 1 makes both threads
+ * go to sleep after every message, a large window keeps the
+ * queues busy. A lost wakeup hangs the test.
+ */
+
+/* Maximal number of producer threads. */
+enum { PRODUCER_MAX = 4 };
+
+/* Number of messages sent by each producer in a run. */
+static const int message_count = 20000;
+
+struct test_msg {
+	struct cmsg cmsg;
+	struct producer *producer;
+	/* Sequence number of the message within the producer. */
+	int seq;
+};
+
+/* Producer thread. */
+struct producer {
+	/* Name of endpoint hosted by this thread. */
+	char name[32];
+	/* Cord corresponding to this thread. */
+	struct cord cord;
+	/* Pipe from this to the main thread. */
+	struct cpipe main_pipe;
+	/* Pipe from the main to this thread. */
+	struct cpipe thread_pipe;
+	/* Route of a test message. */
+	struct cmsg_hop route[2];
+	/* Messages not in flight. */
+	struct test_msg **free;
+	int free_count;
+	/* Max number of messages in flight. */
+	int window;
+	/* Signalled when a message returns. */
+	struct fiber_cond cond;
+	/* Start and completion message. */
+	struct cmsg cmsg;
+	/* Number of messages that made a round trip. */
+	int completed;
+	/* Sequence number of the last message received by main. */
+	int last_received;
+	/* Set if a message was received or returned out of order. */
+	bool is_reordered;
+};
+
+static struct producer producers[PRODUCER_MAX];
+
+/* Number of producers that are still sending messages. */
+static int active_producer_count;
+
+/* Number of messages received by the main thread. */
+static int received;
+
+static void
+test_msg_received_cb(struct cmsg *cmsg)
+{
+	struct test_msg *msg = container_of(cmsg, struct test_msg, cmsg);
+	struct producer *p = msg->producer;
+	if (msg->seq != p->last_received + 1)
+		p->is_reordered = true;
+	p->last_received = msg->seq;
+	received++;
+}
+
+static void
+test_msg_returned_cb(struct cmsg *cmsg)
+{
+	struct test_msg *msg = container_of(cmsg, struct test_msg, cmsg);
+	struct producer *p = msg->producer;
+	if (msg->seq != p->completed)
+		p->is_reordered = true;
+	p->free[p->free_count++] = msg;
+	p->completed++;
+	fiber_cond_signal(&p->cond);
+}
+
+static void
+producer_complete_cb(struct cmsg *cmsg)
+{
+	(void)cmsg;
+	assert(active_producer_count > 0);
+	if (--active_producer_count == 0) {
+		/* Stop the main fiber when all producers are done. */
+		fiber_cancel(fiber());
+	}
+}
+
+static int
+producer_send_f(va_list ap)
+{
+	struct producer *p = va_arg(ap, struct producer *);
+	for (int i = 0; i < message_count; i++) {
+		while (p->free_count == 0)
+			fiber_cond_wait(&p->cond);
+		struct test_msg *msg = p->free[--p->free_count];
+		msg->seq = i;
+		cmsg_init(&msg->cmsg, p->route);
+		cpipe_push(&p->main_pipe, &msg->cmsg);
+	}
+	while (p->free_count < p->window)
+		fiber_cond_wait(&p->cond);
+	/* Notify the main thread that we are done. */
+	static struct cmsg_hop complete_route[] = {
+		{ producer_complete_cb, NULL }
+	};
+	cmsg_init(&p->cmsg, complete_route);
+	cpipe_push(&p->main_pipe, &p->cmsg);
+	return 0;
+}
+
+static void
+producer_start_cb(struct cmsg *cmsg)
+{
+	struct producer *p = container_of(cmsg, struct producer, cmsg);
+	struct fiber *f = fiber_new("send", producer_send_f);
+	assert(f != NULL);
+	fiber_start(f, p);
+}
+
+static int
+producer_f(va_list ap)
+{
+	struct producer *p = va_arg(ap, struct producer *);
+
+	cpipe_create(&p->main_pipe, "main");
+
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, p->name, fiber_schedule_cb, fiber());
+
+	cbus_loop(&endpoint);
+
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&p->main_pipe);
+	return 0;
+}
+
+static void
+producer_create(struct producer *p, int id, int window)
+{
+	snprintf(p->name, sizeof(p->name), "producer_%d", id);
+	p->window = window;
+	p->completed = 0;
+	p->last_received = -1;
+	p->is_reordered = false;
+	fiber_cond_create(&p->cond);
+	p->free = calloc(window, sizeof(*p->free));
+	assert(p->free != NULL);
+	for (int i = 0; i < window; i++) {
+		struct test_msg *msg = malloc(sizeof(*msg));
+		assert(msg != NULL);
+		msg->producer = p;
+		p->free[i] = msg;
+	}
+	p->free_count = window;
+	p->route[0].f = test_msg_received_cb;
+	p->route[0].pipe = &p->thread_pipe;
+	p->route[1].f = test_msg_returned_cb;
+	p->route[1].pipe = NULL;
+
+	if (cord_costart(&p->cord, p->name, producer_f, p) != 0)
+		unreachable();
+
+	cpipe_create(&p->thread_pipe, p->name);
+}
+
+static void
+producer_start(struct producer *p)
+{
+	static struct cmsg_hop start_route[] = {
+		{ producer_start_cb, NULL }
+	};
+	cmsg_init(&p->cmsg, start_route);
+	cpipe_push(&p->thread_pipe, &p->cmsg);
+}
+
+static void
+producer_destroy(struct producer *p)
+{
+	cbus_stop_loop(&p->thread_pipe);
+	cpipe_destroy(&p->thread_pipe);
+
+	if (cord_join(&p->cord) != 0)
+		unreachable();
+
+	assert(p->free_count == p->window);
+	for (int i = 0; i < p->window; i++)
+		free(p->free[i]);
+	free(p->free);
+	fiber_cond_destroy(&p->cond);
+}
+
+static int
+test_f(va_list ap)
+{
+	int producer_count = va_arg(ap, int);
+	int window = va_arg(ap, int);
+	assert(producer_count <= PRODUCER_MAX);
+
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "main", fiber_schedule_cb, fiber());
+
+	received = 0;
+	active_producer_count = producer_count;
+	for (int i = 0; i < producer_count; i++)
+		producer_create(&producers[i], i, window);
+
+	for (int i = 0; i < producer_count; i++)
+		producer_start(&producers[i]);
+
+	cbus_loop(&endpoint);
+
+	int completed = 0;
+	bool is_reordered = false;
+	for (int i = 0; i < producer_count; i++) {
+		completed += producers[i].completed;
+		is_reordered |= producers[i].is_reordered;
+		producer_destroy(&producers[i]);
+	}
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+
+	int total = producer_count * message_count;
+	is(received, total, "producers %d, window %d: all messages received",
+	   producer_count, window);
+	ok(!is_reordered, "producers %d, window %d: messages are in order",
+	   producer_count, window);
+	is(completed, total, "producers %d, window %d: all messages returned",
+	   producer_count, window);
+	return 0;
+}
+
+static void
+test_run(int producer_count, int window)
+{
+	struct fiber *f = fiber_new("test", test_f);
+	assert(f != NULL);
+	fiber_set_joinable(f, true);
+	fiber_start(f, producer_count, window);
+	fiber_join(f);
+}
+
+static int
+main_f(va_list ap)
+{
+	(void)ap;
+	plan(12);
+	test_run(1, 1);
+	test_run(1, 64);
+	test_run(PRODUCER_MAX, 1);
+	test_run(PRODUCER_MAX, 64);
+	check_plan();
+
+	ev_break(loop(), EVBREAK_ALL);
+	return 0;
+}
+
+int
+main()
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	cbus_init();
+
+	header();
+
+	struct fiber *main_fiber = fiber_new("main", main_f);
+	assert(main_fiber != NULL);
+	fiber_wakeup(main_fiber);
+	ev_run(loop(), 0);
+
+	footer();
+
+	cbus_free();
+	fiber_free();
+	memory_free();
+	return 0;
+}
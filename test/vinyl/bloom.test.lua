@@ -39,10 +39,10 @@ box.snapshot()
 -- to allocate at least (100 + 500 + 1000 + 1000) * 7 bits or 2275
 -- bytes. However, since we adjust the fpr of bloom filters of higher
 -- ranks (because a full key lookup checks all its sub keys as well),
--- we use 5, 4, 3, and 1 hash functions for each sub key respectively.
--- This leaves us only (100*5 + 500*4 + 1000*3 + 1000*1) / ln(2) bits
--- or 1172 bytes, and after rounding up to the block size (128 byte)
--- we have 1280 bytes plus the header overhead.
+-- we use 5, 5, 3, and 1 hash functions for each sub key respectively.
+-- This leaves us only (100*5 + 500*5 + 1000*3 + 1000*1) / ln(2) bits
+-- or 1262 bytes, and after rounding up to the block size (32 byte)
+-- we have 1312 bytes plus the header overhead.
 --
 s.index.pk:stat().disk.bloom_size
 
@@ -81,6 +81,14 @@ for i = 1, 1000 do s:select{i, i, i, i} end
 new_reflects() > 980
 new_seeks() < 20
 
+-- REQ lookups are checked against bloom filters as well.
+for i = 1, 1000 do s:select({math.ceil(i / 10), math.ceil(i / 2)}, {iterator = 'req'}) end
+new_reflects() == 0
+new_seeks() == 1000
+for i = 1, 1000 do s:select({math.ceil(i / 10), i + 1000}, {iterator = 'req'}) end
+new_reflects() > 950
+new_seeks() < 20
+
 test_run:cmd('restart server default')
 
 vinyl_cache = box.cfg.vinyl_cache
@@ -88,6 +96,22 @@ box.cfg{vinyl_cache = 0}
 
 s = box.space.test
 
+-- Bloom filters are loaded on the first lookup.
+test_run = require('test_run').new()
+s.index.pk:stat().disk.bloom_size == 0
+_ = s:select{1}
+test_run:wait_cond(function() return s.index.pk:stat().disk.bloom_size > 0 end)
+
+-- Bloom filters are evicted to fit in vinyl_bloom_memory and
+-- reloaded on the next lookup.
+bloom_size = s.index.pk:stat().disk.bloom_size
+box.cfg{vinyl_bloom_memory = 1}
+s.index.pk:stat().disk.bloom_size
+box.stat.vinyl().memory.bloom_filter
+box.cfg{vinyl_bloom_memory = 0}
+_ = s:select{1}
+test_run:wait_cond(function() return s.index.pk:stat().disk.bloom_size >= bloom_size end)
+
 reflects = 0
 function cur_reflects() return box.space.test.index.pk:stat().disk.iterator.bloom.hit end
 function new_reflects() local o = reflects reflects = cur_reflects() return reflects - o end
@@ -132,6 +156,29 @@ new_seeks() < 20
 
 s:drop()
 
+--
+-- Check that range scans skip runs that can't contain the search
+-- key judging by their min and max keys.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {run_count_per_level = 10})
+for i = 1, 10 do s:replace{i} end
+box.snapshot()
+for i = 11, 20 do s:replace{i} end
+box.snapshot()
+function lookups() return s.index.pk:stat().disk.iterator.lookup end
+lookup = lookups()
+#s:select({15}, {iterator = 'gt'}) -- 5
+lookups() - lookup -- 1
+lookup = lookups()
+#s:select({5}, {iterator = 'lt'}) -- 4
+lookups() - lookup -- 1
+lookup = lookups()
+#s:select({21}, {iterator = 'ge'}) -- 0
+#s:select({25}, {iterator = 'req'}) -- 0
+lookups() - lookup -- 0
+s:drop()
+
 box.cfg{vinyl_cache = vinyl_cache}
 
 --
@@ -0,0 +1,119 @@
+test_run = require('test_run').new()
+
+--
+-- Per-index compression options of vinyl run pages.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {compression = 'lz4'})
+s:create_index('pk', {compression_level = 0})
+s:create_index('pk', {compression_dict_size = 100})
+_ = s:create_index('pk', {run_count_per_level = 1, page_size = 4096, compression_level = 5, compression_dict_size = 4096})
+s.index.pk.options.compression
+s.index.pk.options.compression_level
+s.index.pk.options.compression_dict_size
+
+s2 = box.schema.space.create('test2', {engine = 'vinyl'})
+_ = s2:create_index('pk', {run_count_per_level = 1, page_size = 4096, compression_level = 5})
+
+test_run:cmd("setopt delimiter ';'")
+function fill(s, x)
+    for i = 1, 2000 do
+        s:replace{i, string.format('user%08d@example.com', i), 'active', x}
+    end
+    box.snapshot()
+end;
+function compact(s, x)
+    local count = s.index.pk:stat().disk.compaction.count
+    fill(s, x)
+    fill(s, x + 1)
+    test_run:wait_cond(function()
+        local st = s.index.pk:stat()
+        return st.disk.compaction.count > count and st.run_count == 1
+    end)
+end;
+test_run:cmd("setopt delimiter ''");
+
+-- Compaction trains a dictionary and uses it to compress pages.
+compact(s, 1)
+compact(s2, 1)
+st = s.index.pk:stat().disk
+st2 = s2.index.pk:stat().disk
+st.bytes_compressed < st.bytes
+st.bytes_compressed < st2.bytes_compressed
+
+-- The dictionary is loaded from the index file on recovery.
+test_run:cmd('restart server default')
+test_run = require('test_run').new()
+s = box.space.test
+s.index.pk:stat().run_count
+s:count()
+s:get(1000)
+s:select({1995}, {iterator = 'ge'})
+
+-- The dictionary is stored in the run file, so the file can
+-- be read without the index file.
+fio = require('fio')
+xlog = require('xlog')
+files = fio.glob(box.cfg.vinyl_dir .. '/' .. s.id .. '/0/*.run')
+-- The last run file is the one written by compaction.
+table.sort(files)
+count = 0
+for _, row in xlog.pairs(files[#files]) do if row.HEADER.type == 'REPLACE' then count = count + 1 end end
+count
+
+-- Compression can be disabled without rebuilding the index.
+test_run:cmd("setopt delimiter ';'")
+function fill(s, x)
+    for i = 1, 2000 do
+        s:replace{i, string.format('user%08d@example.com', i), 'active', x}
+    end
+    box.snapshot()
+end;
+function compact(s, x)
+    local count = s.index.pk:stat().disk.compaction.count
+    fill(s, x)
+    fill(s, x + 1)
+    test_run:wait_cond(function()
+        local st = s.index.pk:stat()
+        return st.disk.compaction.count > count and st.run_count == 1
+    end)
+end;
+test_run:cmd("setopt delimiter ''");
+
+s.index.pk:alter({compression = 'none'})
+s.index.pk.options.compression
+compact(s, 3)
+st = s.index.pk:stat().disk
+st.bytes_compressed >= st.bytes
+s:get(1000)
+
+s:drop()
+box.space.test2:drop()
+
+-- The index file is rebuilt from a run file that has
+-- a dictionary.
+test_run:cmd('create server force_recovery with script="vinyl/force_recovery.lua"')
+test_run:cmd('start server force_recovery')
+test_run:cmd('switch force_recovery')
+fio = require('fio')
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {run_count_per_level = 1, page_size = 4096, compression_dict_size = 4096})
+for i = 1, 2000 do s:replace{i, string.format('user%08d@example.com', i), 'active', 1} end
+box.snapshot()
+for i = 1, 2000 do s:replace{i, string.format('user%08d@example.com', i), 'active', 2} end
+box.snapshot()
+test_run:wait_cond(function() local st = s.index.pk:stat() return st.disk.compaction.count > 0 and st.run_count == 1 end)
+for _, f in pairs(fio.glob(box.cfg.vinyl_dir .. '/' .. s.id .. '/0/*.index')) do fio.unlink(f) end
+test_run:cmd('switch default')
+test_run:cmd('stop server force_recovery')
+test_run:cmd('start server force_recovery')
+test_run:cmd('switch force_recovery')
+s = box.space.test
+s.index.pk:stat().run_count
+s:count()
+s:get(1000)
+s:select({1999}, {iterator = 'ge'})
+test_run:cmd('switch default')
+test_run:cmd('stop server force_recovery')
+test_run:cmd('cleanup server force_recovery')
+test_run:cmd('delete server force_recovery')
@@ -231,6 +231,37 @@ c:commit()
 itr = nil
 s:drop()
 
+--
+-- index:get_many() must stop looking up keys and fail if
+-- the transaction is aborted while it waits for disk reads.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+for i = 1, 100 do s:replace{i} end
+box.snapshot()
+keys = {}
+for i = 2, 100 do table.insert(keys, i) end
+ch = fiber.channel(1)
+test_run:cmd("setopt delimiter ';'")
+function get_many()
+    box.begin()
+    s:get(1)
+    s:replace{1000}
+    errinj.set('ERRINJ_VY_READ_PAGE_DELAY', true)
+    local ok, err = pcall(s.get_many, s, keys)
+    box.rollback()
+    ch:put(ok or tostring(err))
+end;
+test_run:cmd("setopt delimiter ''");
+_ = fiber.create(get_many)
+-- Abort the transaction while get_many() is blocked on disk reads.
+s:replace{1, 1}
+errinj.set('ERRINJ_VY_READ_PAGE_DELAY', false)
+ch:get()
+s:get(1)
+s:get(1000)
+s:drop()
+
 -- Collect all iterators to make sure no read views are left behind,
 -- as they might disrupt the following test run.
 collectgarbage()
@@ -203,3 +203,39 @@ test_run:cmd('restart server default')
 s = box.space.test
 s.index[1] == nil
 s:drop()
+
+--
+-- Check that vylog is compacted in the background.
+--
+test_run = require('test_run').new()
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+s:replace{1, 10}
+s:replace{2, 20}
+box.snapshot()
+
+box.error.injection.set('ERRINJ_VY_LOG_COMPACT', true)
+_ = s:create_index('tk', {parts = {2, 'unsigned'}})
+test_run:wait_cond(function() return box.stat.vinyl().vylog.compaction_count > 0 end)
+box.error.injection.set('ERRINJ_VY_LOG_COMPACT', false)
+
+-- Records written after compaction go to the compacted log.
+s.index.tk:drop()
+
+-- The checkpoint state is still available for backup.
+#box.backup.start() > 0
+box.backup.stop()
+
+test_run:cmd('restart server default')
+
+s = box.space.test
+s:select()
+s.index.sk:select()
+s.index.tk == nil
+box.stat.vinyl().vylog.compaction_count
+box.stat.vinyl().vylog.recovery_time >= 0
+-- The same statistics are reported by box.info.vinyl().
+box.info.vinyl().vylog.recovery_time == box.stat.vinyl().vylog.recovery_time
+box.info.vinyl().vylog.compaction_count
+s:drop()
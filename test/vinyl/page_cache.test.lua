@@ -0,0 +1,62 @@
+test_run = require('test_run').new()
+
+--
+-- Cache of decompressed run pages.
+--
+vinyl_cache = box.cfg.vinyl_cache
+box.cfg{vinyl_cache = 0}
+box.cfg{vinyl_page_cache = 1024 * 1024}
+
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {page_size = 1024})
+for i = 1, 100 do s:replace{i, string.rep('x', 100)} end
+box.snapshot()
+
+function pstat() return box.stat.vinyl().page_cache end
+function pages() return s.index.pk:stat().disk.iterator.read.pages end
+
+-- The first lookup reads the page from disk and caches it.
+st = pstat()
+p = pages()
+s:get(1)
+pstat().miss - st.miss
+pstat().hit - st.hit
+pages() - p
+pstat().memory > 0
+
+-- The second lookup finds the page in the cache.
+st = pstat()
+p = pages()
+s:get(1)
+pstat().miss - st.miss
+pstat().hit - st.hit
+pages() - p
+
+-- Decreasing the quota evicts pages.
+st = pstat()
+box.cfg{vinyl_page_cache = 0}
+pstat().memory
+pstat().evict - st.evict > 0
+
+-- The cache is disabled.
+st = pstat()
+p = pages()
+s:get(1)
+pstat().miss - st.miss
+pstat().hit - st.hit
+pages() - p
+
+-- Pages of a deleted run are dropped from the cache.
+box.cfg{vinyl_page_cache = 1024 * 1024}
+s:get(1)
+pstat().memory > 0
+s:replace{1, 'y'}
+box.snapshot()
+s.index.pk:compact()
+test_run:wait_cond(function() return s.index.pk:stat().run_count == 1 end)
+test_run:wait_cond(function() return pstat().memory == 0 end)
+s:get(1)
+
+s:drop()
+box.cfg{vinyl_page_cache = 0}
+box.cfg{vinyl_cache = vinyl_cache}
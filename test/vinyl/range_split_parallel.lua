@@ -0,0 +1,9 @@
+#!/usr/bin/env tarantool
+
+box.cfg{
+    listen = os.getenv("LISTEN"),
+    -- 2 dump workers and 6 compaction workers.
+    vinyl_write_threads = 8,
+}
+
+require('console').listen(os.getenv('ADMIN'))
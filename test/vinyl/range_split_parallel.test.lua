@@ -0,0 +1,55 @@
+test_run = require('test_run').new()
+
+--
+-- A range several times bigger than range_size is split in up
+-- to as many parts as there are idle compaction workers so that
+-- the parts are compacted in parallel.
+--
+test_run:cmd("create server test with script='vinyl/range_split_parallel.lua'")
+test_run:cmd("start server test")
+test_run:cmd("switch test")
+
+-- Don't require the range to be 128 MB to be split in parallel.
+box.error.injection.set('ERRINJ_VY_RANGE_SPLIT_PARALLEL_MIN', 0)
+
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {range_size = 64 * 1024, page_size = 1024, run_count_per_level = 1})
+
+-- The oldest run is about 3 * range_size.
+pad = string.rep('x', 1000)
+for i = 1, 200 do s:replace{i, pad} end
+box.snapshot()
+for i = 1, 200 do s:replace{i, i, pad} end
+box.snapshot()
+
+-- Each part is compacted by its own task and isn't split again.
+test_run:wait_cond(function() return s.index.pk:stat().disk.compaction.count >= 3 end)
+s.index.pk:stat().disk.compaction.count
+s.index.pk:stat().range_count
+s.index.pk:stat().run_count
+s:count()
+
+-- Check that the split is recovered and no data is lost.
+test_run:cmd("restart server test")
+s = box.space.test
+s.index.pk:stat().range_count
+s.index.pk:stat().run_count
+pad = string.rep('x', 1000)
+test_run:cmd("setopt delimiter ';'")
+function check()
+    local i = 0
+    for _, t in s:pairs() do
+        i = i + 1
+        if t[1] ~= i or t[2] ~= i or t[3] ~= pad then
+            return false
+        end
+    end
+    return i == 200
+end;
+test_run:cmd("setopt delimiter ''");
+check()
+
+test_run:cmd("switch default")
+test_run:cmd("stop server test")
+test_run:cmd("cleanup server test")
+test_run:cmd("delete server test")
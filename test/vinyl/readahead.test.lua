@@ -0,0 +1,53 @@
+test_run = require('test_run').new()
+
+--
+-- Check that sequential read-ahead doesn't break long scans.
+--
+-- Disable the cache so that all reads go to disk.
+vinyl_cache = box.cfg.vinyl_cache
+box.cfg{vinyl_cache = 0}
+
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {page_size = 256})
+for i = 1, 1000 do s:replace{i, string.rep('x', 32)} end
+box.snapshot()
+
+pages = s.index.pk:stat().disk.pages
+pages > 50
+
+test_run:cmd("setopt delimiter ';'")
+function check_scan(key, iterator)
+    local dir = (iterator == 'ge' or iterator == 'gt') and 1 or -1
+    local prev = nil
+    local count = 0
+    for _, t in s:pairs(key, {iterator = iterator}) do
+        if prev ~= nil and t[1] ~= prev + dir then
+            return false
+        end
+        prev = t[1]
+        count = count + 1
+    end
+    return count
+end;
+test_run:cmd("setopt delimiter ''");
+
+read = s.index.pk:stat().disk.iterator.read.pages
+check_scan({}, 'ge') -- 1000
+-- Pages read ahead are accounted when the iterator reaches them.
+s.index.pk:stat().disk.iterator.read.pages - read == pages
+
+check_scan({}, 'le') -- 1000
+check_scan({500}, 'gt') -- 500
+check_scan({500}, 'lt') -- 499
+check_scan({500}, 'ge') -- 501
+check_scan({500}, 'le') -- 500
+
+-- Stop a scan while pages are being read ahead.
+n = 0
+for _, t in s:pairs({100}, {iterator = 'ge'}) do n = n + 1 if n == 100 then break end end
+n
+collectgarbage()
+
+s:drop()
+
+box.cfg{vinyl_cache = vinyl_cache}
@@ -77,6 +77,7 @@ function istat()
     st.latency = nil
     st.disk.dump.time = nil
     st.disk.compaction.time = nil
+    st.write_amplification = nil -- checked by vinyl/tiered_compaction.test.lua
     return st
 end;
 
@@ -90,6 +91,8 @@ end;
 function gstat()
     local st = box.stat.vinyl()
     st.regulator = nil
+    st.page_cache = nil -- checked by vinyl/page_cache.test.lua
+    st.vylog = nil -- checked by vinyl/errinj_vylog.test.lua
     st.scheduler.dump_time = nil
     st.scheduler.compaction_time = nil
     return st
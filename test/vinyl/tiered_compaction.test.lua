@@ -0,0 +1,44 @@
+test_run = require('test_run').new()
+
+--
+-- Tiered compaction strategy lets the last LSM tree level
+-- accumulate up to run_count_per_level runs.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {compaction_strategy = 'universal'})
+_ = s:create_index('pk', {run_count_per_level = 2, compaction_strategy = 'tiered'})
+s.index.pk.options.compaction_strategy
+
+test_run:cmd("setopt delimiter ';'")
+function dump()
+    for i = 1, 100 do
+        s:replace{i, string.rep('x', 100)}
+    end
+    box.snapshot()
+end;
+function wamp()
+    return s.index.pk:stat().write_amplification
+end;
+test_run:cmd("setopt delimiter ''");
+
+wamp().avg
+wamp().max
+
+-- Runs of the same size are kept at the last level.
+dump()
+dump()
+s.index.pk:stat().run_count -- 2
+s.index.pk:stat().disk.compaction.count -- 0
+wamp().avg -- 1
+wamp().max -- 1
+
+-- Switching back to leveled compaction merges the last level.
+s.index.pk:alter({compaction_strategy = 'leveled'})
+s.index.pk.options.compaction_strategy -- nil
+dump()
+test_run:wait_cond(function() return s.index.pk:stat().run_count == 1 end)
+s.index.pk:stat().disk.compaction.count -- 1
+wamp().avg > 1
+wamp().max >= wamp().avg
+
+s:drop()
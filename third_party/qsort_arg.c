@@ -118,7 +118,7 @@ med3(char *a, char *b, char *c, int (*cmp)(const void *a, const void *b, void *a
 /**
  * Single-thread version of qsort.
  */
-static void
+void
 qsort_arg_st(void *a, size_t n, size_t es, int (*cmp)(const void *a, const void *b, void *arg), void *arg)
 {
 	char	   *pa,
@@ -202,7 +202,7 @@ loop:SWAPINIT(a, es);
 	r = min(pd - pc, pn - pd - (intptr_t)es);
 	vecswap(pb, pn - r, r);
 	if ((r = pb - pa) > (intptr_t)es)
-		qsort_arg(a, r / es, es, cmp, arg);
+		qsort_arg_st(a, r / es, es, cmp, arg);
 	if ((r = pd - pc) > (intptr_t)es)
 	{
 		/* Iterate rather than recurse to save stack space */
@@ -240,3 +240,14 @@ qsort_arg(void *a, size_t n, size_t es,
 #endif
 }
 
+bool
+qsort_arg_is_mt(size_t n)
+{
+#ifdef HAVE_OPENMP
+	return n >= MULTITHREAD_SIZE_THRESHOLD;
+#else
+	(void)n;
+	return false;
+#endif
+}
+
@@ -3,6 +3,7 @@
 
 #include <trivia/config.h>
 #include <sys/types.h>
+#include <stdbool.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -15,6 +16,20 @@ extern "C" {
 void qsort_arg(void *a, size_t n, size_t es,
 	       int (*cmp)(const void *a, const void *b, void *arg), void *arg);
 
+/**
+ * Single-threaded version of qsort. Useful when the caller runs
+ * several sorts in parallel on its own.
+ */
+void qsort_arg_st(void *a, size_t n, size_t es,
+		  int (*cmp)(const void *a, const void *b, void *arg),
+		  void *arg);
+
+/**
+ * Return true if qsort_arg() sorts an array of the given size
+ * using several threads.
+ */
+bool qsort_arg_is_mt(size_t n);
+
 #if defined(__cplusplus)
 }
 #endif /* defined(__cplusplus) */